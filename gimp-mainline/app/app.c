@@ -54,6 +54,7 @@
 #include "gegl/gimp-gegl.h"
 
 #include "core/gimp.h"
+#include "core/gimp-batch-files.h"
 #include "core/gimp-batch.h"
 #include "core/gimp-user-install.h"
 #include "core/gimpimage.h"
@@ -96,6 +97,7 @@ GType gimp_convert_dither_type_compat_get_type (void); /* compat cruft */
 /*  local variables  */
 
 static GObject *initial_monitor = NULL;
+static gint     exit_status     = EXIT_SUCCESS;
 
 
 /*  public functions  */
@@ -163,7 +165,7 @@ app_exit (gint status)
   exit (status);
 }
 
-void
+gint
 app_run (const gchar         *full_prog_name,
          const gchar        **filenames,
          GFile               *alternate_system_gimprc,
@@ -171,6 +173,11 @@ app_run (const gchar         *full_prog_name,
          const gchar         *session_name,
          const gchar         *batch_interpreter,
          const gchar        **batch_commands,
+         const gchar         *batch_files,
+         const gchar        **batch_procedures,
+         const gchar         *batch_output_dir,
+         gint                 batch_jobs,
+         const gchar         *batch_summary,
          gboolean             as_new,
          gboolean             no_interface,
          gboolean             no_data,
@@ -436,6 +443,22 @@ app_run (const gchar         *full_prog_name,
   if (run_loop)
     gimp_batch_run (gimp, batch_interpreter, batch_commands);
 
+  if (run_loop && batch_files)
+    {
+      if (! gimp_batch_run_files (gimp, full_prog_name,
+                                  alternate_system_gimprc, alternate_gimprc,
+                                  batch_files, batch_procedures,
+                                  batch_output_dir, batch_jobs,
+                                  batch_summary))
+        {
+          /*  let scripts notice that not all files made it  */
+          exit_status = EXIT_FAILURE;
+        }
+
+      /*  there is nothing left to do once all files are processed  */
+      gimp_exit (gimp, TRUE);
+    }
+
   if (run_loop)
     g_main_loop_run (loop);
 
@@ -453,6 +476,8 @@ app_run (const gchar         *full_prog_name,
   gimp_debug_instances ();
 
   gegl_exit ();
+
+  return exit_status;
 }
 
 
@@ -510,7 +535,7 @@ app_exit_after_callback (Gimp       *gimp,
 
   gegl_exit ();
 
-  exit (EXIT_SUCCESS);
+  exit (exit_status);
 
 #endif
 
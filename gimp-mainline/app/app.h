@@ -30,13 +30,18 @@ void  app_abort     (gboolean             no_interface,
                      const gchar         *abort_message) G_GNUC_NORETURN;
 void  app_exit      (gint                 status) G_GNUC_NORETURN;
 
-void  app_run       (const gchar         *full_prog_name,
+gint  app_run       (const gchar         *full_prog_name,
                      const gchar        **filenames,
                      GFile               *alternate_system_gimprc,
                      GFile               *alternate_gimprc,
                      const gchar         *session_name,
                      const gchar         *batch_interpreter,
                      const gchar        **batch_commands,
+                     const gchar         *batch_files,
+                     const gchar        **batch_procedures,
+                     const gchar         *batch_output_dir,
+                     gint                 batch_jobs,
+                     const gchar         *batch_summary,
                      gboolean             as_new,
                      gboolean             no_interface,
                      gboolean             no_data,
@@ -106,9 +106,12 @@ enum
   PROP_DEFAULT_GRID,
   PROP_UNDO_LEVELS,
   PROP_UNDO_SIZE,
+  PROP_UNDO_SPILL_SIZE,
   PROP_UNDO_PREVIEW_SIZE,
   PROP_FILTER_HISTORY_SIZE,
   PROP_PLUGINRC_PATH,
+  PROP_PLUG_IN_POOL_SIZE,
+  PROP_PLUG_IN_POOL_MAX_CALLS,
   PROP_LAYER_PREVIEWS,
   PROP_GROUP_LAYER_PREVIEWS,
   PROP_LAYER_PREVIEW_SIZE,
@@ -121,6 +124,13 @@ enum
   PROP_IMPORT_PROMOTE_DITHER,
   PROP_IMPORT_ADD_ALPHA,
   PROP_IMPORT_RAW_PLUG_IN,
+  PROP_XCF_LAZY_LOAD,
+  PROP_XCF_SAVE_PYRAMID,
+  PROP_XCF_ZSTD_COMPRESSION,
+  PROP_XCF_ZSTD_LEVEL,
+  PROP_XCF_ZSTD_DICTIONARY,
+  PROP_XCF_SAVE_ASYNC,
+  PROP_XCF_AUTOSAVE_INTERVAL,
   PROP_EXPORT_FILE_TYPE,
   PROP_EXPORT_COLOR_PROFILE,
   PROP_EXPORT_COMMENT,
@@ -610,6 +620,14 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                             GIMP_PARAM_STATIC_STRINGS |
                             GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_PROP_MEMSIZE (object_class, PROP_UNDO_SPILL_SIZE,
+                            "undo-spill-size",
+                            "Undo spill size",
+                            UNDO_SPILL_SIZE_BLURB,
+                            0, GIMP_MAX_MEMSIZE, (guint64) 1 << 32,
+                            GIMP_PARAM_STATIC_STRINGS |
+                            GIMP_CONFIG_PARAM_CONFIRM);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_UNDO_PREVIEW_SIZE,
                          "undo-preview-size",
                          "Undo preview size",
@@ -637,6 +655,20 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_POOL_SIZE,
+                        "plug-in-pool-size",
+                        "Plug-in pool size",
+                        PLUG_IN_POOL_SIZE_BLURB,
+                        0, 16, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_PLUG_IN_POOL_MAX_CALLS,
+                        "plug-in-pool-max-calls",
+                        "Plug-in pool max calls",
+                        PLUG_IN_POOL_MAX_CALLS_BLURB,
+                        1, G_MAXINT, 100,
+                        GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_LAYER_PREVIEWS,
                             "layer-previews",
                             "Layer previews",
@@ -768,6 +800,55 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                          GIMP_PARAM_STATIC_STRINGS |
                          GIMP_CONFIG_PARAM_RESTART);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_LAZY_LOAD,
+                            "xcf-lazy-load",
+                            "XCF lazy load",
+                            XCF_LAZY_LOAD_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_SAVE_PYRAMID,
+                            "xcf-save-pyramid",
+                            "XCF save pyramid",
+                            XCF_SAVE_PYRAMID_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_ZSTD_COMPRESSION,
+                            "xcf-zstd-compression",
+                            "XCF zstd compression",
+                            XCF_ZSTD_COMPRESSION_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_XCF_ZSTD_LEVEL,
+                        "xcf-zstd-level",
+                        "XCF zstd level",
+                        XCF_ZSTD_LEVEL_BLURB,
+                        1, 22, 3,
+                        GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_ZSTD_DICTIONARY,
+                            "xcf-zstd-dictionary",
+                            "XCF zstd dictionary",
+                            XCF_ZSTD_DICTIONARY_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_XCF_SAVE_ASYNC,
+                            "xcf-save-async",
+                            "XCF save async",
+                            XCF_SAVE_ASYNC_BLURB,
+                            TRUE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
+  GIMP_CONFIG_PROP_INT (object_class, PROP_XCF_AUTOSAVE_INTERVAL,
+                        "xcf-autosave-interval",
+                        "XCF autosave interval",
+                        XCF_AUTOSAVE_INTERVAL_BLURB,
+                        0, 1440, 0,
+                        GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_PROP_ENUM (object_class, PROP_EXPORT_FILE_TYPE,
                          "export-file-type",
                          "Default export file type",
@@ -1075,6 +1156,9 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_UNDO_SIZE:
       core_config->undo_size = g_value_get_uint64 (value);
       break;
+    case PROP_UNDO_SPILL_SIZE:
+      core_config->undo_spill_size = g_value_get_uint64 (value);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       core_config->undo_preview_size = g_value_get_enum (value);
       break;
@@ -1082,6 +1166,12 @@ gimp_core_config_set_property (GObject      *object,
       g_free (core_config->plug_in_rc_path);
       core_config->plug_in_rc_path = g_value_dup_string (value);
       break;
+    case PROP_PLUG_IN_POOL_SIZE:
+      core_config->plug_in_pool_size = g_value_get_int (value);
+      break;
+    case PROP_PLUG_IN_POOL_MAX_CALLS:
+      core_config->plug_in_pool_max_calls = g_value_get_int (value);
+      break;
     case PROP_LAYER_PREVIEWS:
       core_config->layer_previews = g_value_get_boolean (value);
       break;
@@ -1139,6 +1229,27 @@ gimp_core_config_set_property (GObject      *object,
       g_free (core_config->import_raw_plug_in);
       core_config->import_raw_plug_in = g_value_dup_string (value);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      core_config->xcf_lazy_load = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_SAVE_PYRAMID:
+      core_config->xcf_save_pyramid = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_ZSTD_COMPRESSION:
+      core_config->xcf_zstd_compression = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      core_config->xcf_zstd_level = g_value_get_int (value);
+      break;
+    case PROP_XCF_ZSTD_DICTIONARY:
+      core_config->xcf_zstd_dictionary = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_SAVE_ASYNC:
+      core_config->xcf_save_async = g_value_get_boolean (value);
+      break;
+    case PROP_XCF_AUTOSAVE_INTERVAL:
+      core_config->xcf_autosave_interval = g_value_get_int (value);
+      break;
     case PROP_EXPORT_FILE_TYPE:
       core_config->export_file_type = g_value_get_enum (value);
       break;
@@ -1308,12 +1419,21 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_UNDO_SIZE:
       g_value_set_uint64 (value, core_config->undo_size);
       break;
+    case PROP_UNDO_SPILL_SIZE:
+      g_value_set_uint64 (value, core_config->undo_spill_size);
+      break;
     case PROP_UNDO_PREVIEW_SIZE:
       g_value_set_enum (value, core_config->undo_preview_size);
       break;
     case PROP_PLUGINRC_PATH:
       g_value_set_string (value, core_config->plug_in_rc_path);
       break;
+    case PROP_PLUG_IN_POOL_SIZE:
+      g_value_set_int (value, core_config->plug_in_pool_size);
+      break;
+    case PROP_PLUG_IN_POOL_MAX_CALLS:
+      g_value_set_int (value, core_config->plug_in_pool_max_calls);
+      break;
     case PROP_LAYER_PREVIEWS:
       g_value_set_boolean (value, core_config->layer_previews);
       break;
@@ -1368,6 +1488,27 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_IMPORT_RAW_PLUG_IN:
       g_value_set_string (value, core_config->import_raw_plug_in);
       break;
+    case PROP_XCF_LAZY_LOAD:
+      g_value_set_boolean (value, core_config->xcf_lazy_load);
+      break;
+    case PROP_XCF_SAVE_PYRAMID:
+      g_value_set_boolean (value, core_config->xcf_save_pyramid);
+      break;
+    case PROP_XCF_ZSTD_COMPRESSION:
+      g_value_set_boolean (value, core_config->xcf_zstd_compression);
+      break;
+    case PROP_XCF_ZSTD_LEVEL:
+      g_value_set_int (value, core_config->xcf_zstd_level);
+      break;
+    case PROP_XCF_ZSTD_DICTIONARY:
+      g_value_set_boolean (value, core_config->xcf_zstd_dictionary);
+      break;
+    case PROP_XCF_SAVE_ASYNC:
+      g_value_set_boolean (value, core_config->xcf_save_async);
+      break;
+    case PROP_XCF_AUTOSAVE_INTERVAL:
+      g_value_set_int (value, core_config->xcf_autosave_interval);
+      break;
     case PROP_EXPORT_FILE_TYPE:
       g_value_set_enum (value, core_config->export_file_type);
       break;
@@ -81,9 +81,12 @@ struct _GimpCoreConfig
   GimpGrid               *default_grid;
   gint                    levels_of_undo;
   guint64                 undo_size;
+  guint64                 undo_spill_size;
   GimpViewSize            undo_preview_size;
   gint                    filter_history_size;
   gchar                  *plug_in_rc_path;
+  gint                    plug_in_pool_size;
+  gint                    plug_in_pool_max_calls;
   gboolean                layer_previews;
   gboolean                group_layer_previews;
   GimpViewSize            layer_preview_size;
@@ -96,6 +99,13 @@ struct _GimpCoreConfig
   gboolean                import_promote_dither;
   gboolean                import_add_alpha;
   gchar                  *import_raw_plug_in;
+  gboolean                xcf_lazy_load;
+  gboolean                xcf_save_pyramid;
+  gboolean                xcf_zstd_compression;
+  gint                    xcf_zstd_level;
+  gboolean                xcf_zstd_dictionary;
+  gboolean                xcf_save_async;
+  gint                    xcf_autosave_interval;
   GimpExportFileType      export_file_type;
   gboolean                export_color_profile;
   gboolean                export_comment;
@@ -52,6 +52,7 @@ enum
   PROP_NUM_PROCESSORS,
   PROP_TILE_CACHE_SIZE,
   PROP_USE_OPENCL,
+  PROP_THREADED_PROJECTION,
 
   /* ignored, only for backward compatibility: */
   PROP_STINGY_MEMORY_USE
@@ -156,6 +157,13 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                             FALSE,
                             GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_THREADED_PROJECTION,
+                            "threaded-projection",
+                            "Threaded projection",
+                            THREADED_PROJECTION_BLURB,
+                            FALSE,
+                            GIMP_PARAM_STATIC_STRINGS);
+
   /*  only for backward compatibility:  */
   GIMP_CONFIG_PROP_BOOLEAN (object_class, PROP_STINGY_MEMORY_USE,
                             "stingy-memory-use",
@@ -222,6 +230,9 @@ gimp_gegl_config_set_property (GObject      *object,
     case PROP_USE_OPENCL:
       gegl_config->use_opencl = g_value_get_boolean (value);
       break;
+    case PROP_THREADED_PROJECTION:
+      gegl_config->threaded_projection = g_value_get_boolean (value);
+      break;
 
     case PROP_STINGY_MEMORY_USE:
       /* ignored */
@@ -261,6 +272,9 @@ gimp_gegl_config_get_property (GObject    *object,
     case PROP_USE_OPENCL:
       g_value_set_boolean (value, gegl_config->use_opencl);
       break;
+    case PROP_THREADED_PROJECTION:
+      g_value_set_boolean (value, gegl_config->threaded_projection);
+      break;
 
     case PROP_STINGY_MEMORY_USE:
       /* ignored */
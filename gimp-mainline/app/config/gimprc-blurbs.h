@@ -335,6 +335,14 @@ _("Sets how many threads GIMP should use for operations that support it.")
 #define PLUGINRC_PATH_BLURB \
 "Sets the pluginrc search path."
 
+#define PLUG_IN_POOL_SIZE_BLURB \
+"Keep up to this many plug-in processes per plug-in running after their " \
+"procedure returned, and reuse them for the next calls instead of starting " \
+"new ones.  0 starts a new process for every call."
+
+#define PLUG_IN_POOL_MAX_CALLS_BLURB \
+"Replace a reused plug-in process after it ran this many procedures."
+
 #define LAYER_PREVIEWS_BLURB \
 _("Sets whether GIMP should create previews of layers and channels. " \
   "Previews in the layers and channels dialog are nice to have but they " \
@@ -660,6 +668,10 @@ _("Sets the default border style for the 'Border Selection' dialog.")
 #define STROKE_OPTIONS_BLURB \
 "The default stroke options for the stroke dialogs."
 
+#define THREADED_PROJECTION_BLURB \
+_("When enabled, the image projection is rendered on separate threads, " \
+  "in the background.")
+
 #define THUMBNAIL_SIZE_BLURB \
 _("Sets the size of the thumbnail shown in the Open dialog.")
 
@@ -707,6 +719,11 @@ _("Sets an upper limit to the memory that is used per image to keep " \
   "operations on the undo stack. Regardless of this setting, at least " \
   "as many undo-levels as configured can be undone.")
 
+#define UNDO_SPILL_SIZE_BLURB \
+_("Sets an upper limit to the disk space that is used per image to keep " \
+  "operations on the undo stack which don't fit into the undo-size. " \
+  "Set it to zero to never move undo steps to disk.")
+
 #define UNDO_PREVIEW_SIZE_BLURB \
 _("Sets the size of the previews in the Undo History.")
 
@@ -724,6 +741,39 @@ _("When enabled, uses OpenCL for some operations.")
 "The location of the online user manual. This is used if " \
 "'user-manual-online' is enabled."
 
+#define XCF_LAZY_LOAD_BLURB \
+_("When opening a local XCF file, only read the pixels of its layers and " \
+  "channels when they are first needed.  The file must not be modified " \
+  "while the image is open.")
+
+#define XCF_SAVE_PYRAMID_BLURB \
+_("When saving an XCF file, also store reduced-resolution copies of its " \
+  "layers and channels, so lazily loaded images can be shown zoomed out " \
+  "without reading them in full.  Such files can't be opened by older " \
+  "GIMP versions.")
+
+#define XCF_ZSTD_COMPRESSION_BLURB \
+_("Use zstd instead of zlib for XCF files saved with compression.  zstd " \
+  "files open and save faster, but can't be opened by older GIMP " \
+  "versions.")
+
+#define XCF_ZSTD_LEVEL_BLURB \
+_("The zstd compression level used for XCF files.  Higher levels make " \
+  "smaller files, but take longer to save.")
+
+#define XCF_ZSTD_DICTIONARY_BLURB \
+_("When saving a high bit-depth XCF file with zstd compression, train a " \
+  "dictionary on the image's pixels and store it in the file, which " \
+  "compresses small tiles better.")
+
+#define XCF_SAVE_ASYNC_BLURB \
+_("Write XCF files in the background, so the image can be edited while " \
+  "it's being saved.")
+
+#define XCF_AUTOSAVE_INTERVAL_BLURB \
+_("Every this many minutes, save a backup copy of each image with unsaved " \
+  "changes to the \"autosave\" folder.  0 disables autosaving.")
+
 #define ZOOM_QUALITY_BLURB \
 "There's a tradeoff between speed and quality of the zoomed-out display."
 
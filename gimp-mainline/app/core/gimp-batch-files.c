@@ -0,0 +1,943 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-batch-files.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+#include <glib/gstdio.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core-types.h"
+
+#include "file/file-open.h"
+#include "file/file-save.h"
+
+#include "pdb/gimppdb.h"
+#include "pdb/gimppdberror.h"
+#include "pdb/gimpprocedure.h"
+
+#include "plug-in/gimppluginmanager.h"
+#include "plug-in/gimppluginmanager-file.h"
+
+#include "gimp.h"
+#include "gimp-batch-files.h"
+#include "gimpimage.h"
+#include "gimpparamspecs.h"
+
+#include "gimp-intl.h"
+
+
+/*  every per-file line of the summary starts like this, which is how
+ *  the coordinating process tells records from other worker output
+ */
+#define BATCH_RECORD_PREFIX "{\"input\":"
+
+
+typedef struct _GimpBatchFiles  GimpBatchFiles;
+typedef struct _GimpBatchWorker GimpBatchWorker;
+
+struct _GimpBatchFiles
+{
+  Gimp              *gimp;
+  const gchar       *program;
+  GFile             *alternate_system_gimprc;
+  GFile             *alternate_gimprc;
+  const gchar      **procedures;
+  const gchar       *output_dir;
+
+  /*  output path -> input file name, to catch inputs that would
+   *  overwrite each other's output
+   */
+  GHashTable        *outputs;
+
+  GIOChannel        *input;
+  gboolean           input_done;
+  FILE              *summary;
+
+  GMainLoop         *loop;
+  gint               n_workers;
+
+  gint               n_files;
+  gint               n_failed;
+};
+
+struct _GimpBatchWorker
+{
+  GimpBatchFiles    *batch;
+
+  GSubprocess       *process;
+  GOutputStream     *files;    /*  the worker's stdin   */
+  GDataInputStream  *records;  /*  the worker's stdout  */
+
+  gchar             *current;
+};
+
+
+static gchar    * gimp_batch_files_next            (GimpBatchFiles   *batch);
+static gchar    * gimp_batch_files_get_output_path (GimpBatchFiles   *batch,
+                                                    const gchar      *filename);
+
+static void       gimp_batch_files_process         (GimpBatchFiles   *batch);
+static void       gimp_batch_files_process_one     (GimpBatchFiles   *batch,
+                                                    const gchar      *filename);
+static gboolean   gimp_batch_files_run_procedures  (GimpBatchFiles   *batch,
+                                                    GimpImage        *image,
+                                                    GError          **error);
+static gboolean   gimp_batch_files_save            (GimpBatchFiles   *batch,
+                                                    GimpImage        *image,
+                                                    GFile            *file,
+                                                    GError          **error);
+
+static void       gimp_batch_files_coordinate      (GimpBatchFiles   *batch,
+                                                    gint              n_jobs);
+static gboolean   gimp_batch_files_spawn_worker    (GimpBatchFiles   *batch);
+static void       gimp_batch_files_feed_worker     (GimpBatchWorker  *worker);
+static void       gimp_batch_files_worker_read     (GObject          *source,
+                                                    GAsyncResult     *result,
+                                                    gpointer          data);
+static void       gimp_batch_files_worker_exited   (GimpBatchWorker  *worker);
+
+static void       gimp_batch_files_write_record    (GimpBatchFiles   *batch,
+                                                    const gchar      *input,
+                                                    GFile            *output,
+                                                    const GError     *error,
+                                                    const gint64     *times);
+static void       gimp_batch_files_add_record      (GimpBatchFiles   *batch,
+                                                    const gchar      *record);
+static void       gimp_batch_files_append_string   (GString          *string,
+                                                    const gchar      *value);
+static void       gimp_batch_files_append_time     (GString          *string,
+                                                    const gchar      *name,
+                                                    gint64            start,
+                                                    gint64            end);
+
+
+/*  public functions  */
+
+/**
+ * gimp_batch_run_files:
+ * @gimp:                    a #Gimp
+ * @program:                 the name GIMP was started with
+ * @alternate_system_gimprc: the alternate system gimprc GIMP was started
+ *                           with, or %NULL
+ * @alternate_gimprc:        the alternate user gimprc GIMP was started
+ *                           with, or %NULL
+ * @batch_files:             a file listing the images to process, one per
+ *                           line, or "-" to read the list from stdin
+ * @batch_procedures:        procedures to run on each image, in order
+ * @batch_output_dir:        the directory to save the processed images to,
+ *                           or %NULL to not save them
+ * @batch_jobs:              how many images to process at the same time
+ * @batch_summary:           the file to write the summary to, or "-" or
+ *                           %NULL for stdout
+ *
+ * Opens each listed image, runs @batch_procedures on it, and saves
+ * the result to @batch_output_dir. Images listed by a relative path
+ * keep that path below @batch_output_dir, all others are saved under
+ * their name only. An image whose output file was already used for
+ * another image is not processed, and reported as failed.
+ *
+ * One JSON object per image, with the output file, any error and the
+ * time spent loading, processing and saving it, is written to
+ * @batch_summary as soon as the image is done, followed by one object
+ * with the totals.
+ *
+ * With @batch_jobs greater than one, the images are handed out to
+ * that many "gimp --no-interface" worker processes, each holding only
+ * the image it is currently processing. The workers are started with
+ * the same gimprc files as we were.
+ *
+ * Returns: %TRUE if all images were processed successfully.
+ **/
+gboolean
+gimp_batch_run_files (Gimp         *gimp,
+                      const gchar  *program,
+                      GFile        *alternate_system_gimprc,
+                      GFile        *alternate_gimprc,
+                      const gchar  *batch_files,
+                      const gchar **batch_procedures,
+                      const gchar  *batch_output_dir,
+                      gint          batch_jobs,
+                      const gchar  *batch_summary)
+{
+  GimpBatchFiles  batch = { 0, };
+  GString        *totals;
+  gint64          start_time;
+  GError         *error = NULL;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (program != NULL, FALSE);
+  g_return_val_if_fail (alternate_system_gimprc == NULL ||
+                        G_IS_FILE (alternate_system_gimprc), FALSE);
+  g_return_val_if_fail (alternate_gimprc == NULL ||
+                        G_IS_FILE (alternate_gimprc), FALSE);
+  g_return_val_if_fail (batch_files != NULL, FALSE);
+
+  batch.gimp                    = gimp;
+  batch.program                 = program;
+  batch.alternate_system_gimprc = alternate_system_gimprc;
+  batch.alternate_gimprc        = alternate_gimprc;
+  batch.procedures              = batch_procedures;
+  batch.output_dir              = batch_output_dir;
+
+  if (! strcmp (batch_files, "-"))
+    batch.input = g_io_channel_unix_new (fileno (stdin));
+  else
+    batch.input = g_io_channel_new_file (batch_files, "r", &error);
+
+  if (! batch.input)
+    {
+      g_message (_("Could not open '%s' for reading: %s"),
+                 gimp_filename_to_utf8 (batch_files), error->message);
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  /*  the list holds file names, which are not necessarily UTF-8  */
+  g_io_channel_set_encoding (batch.input, NULL, NULL);
+
+  if (! batch_summary || ! strcmp (batch_summary, "-"))
+    batch.summary = stdout;
+  else
+    batch.summary = g_fopen (batch_summary, "w");
+
+  if (! batch.summary)
+    {
+      g_message (_("Could not open '%s' for writing: %s"),
+                 gimp_filename_to_utf8 (batch_summary), g_strerror (errno));
+      g_io_channel_unref (batch.input);
+
+      return FALSE;
+    }
+
+  if (batch_output_dir &&
+      g_mkdir_with_parents (batch_output_dir, 0755) != 0)
+    {
+      g_message (_("Could not create directory '%s': %s"),
+                 gimp_filename_to_utf8 (batch_output_dir), g_strerror (errno));
+      g_io_channel_unref (batch.input);
+
+      if (batch.summary != stdout)
+        fclose (batch.summary);
+
+      return FALSE;
+    }
+
+  batch.outputs = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, g_free);
+
+  start_time = g_get_monotonic_time ();
+
+  if (batch_jobs > 1)
+    gimp_batch_files_coordinate (&batch, batch_jobs);
+
+  /*  process what is left ourselves, which is everything unless
+   *  there were workers, and they all failed to start
+   */
+  gimp_batch_files_process (&batch);
+
+  totals = g_string_new (NULL);
+
+  g_string_append_printf (totals, "{\"files\":%d,\"failed\":%d",
+                          batch.n_files, batch.n_failed);
+  gimp_batch_files_append_time (totals, "time",
+                                start_time, g_get_monotonic_time ());
+  g_string_append (totals, "}\n");
+
+  fputs (totals->str, batch.summary);
+  fflush (batch.summary);
+
+  g_string_free (totals, TRUE);
+
+  g_hash_table_unref (batch.outputs);
+  g_io_channel_unref (batch.input);
+
+  if (batch.summary != stdout)
+    fclose (batch.summary);
+
+  return batch.n_failed == 0;
+}
+
+
+/*  private functions  */
+
+static gchar *
+gimp_batch_files_next (GimpBatchFiles *batch)
+{
+  gchar *line;
+  gsize  terminator_pos;
+
+  while (! batch->input_done)
+    {
+      if (g_io_channel_read_line (batch->input, &line, NULL,
+                                  &terminator_pos,
+                                  NULL) != G_IO_STATUS_NORMAL)
+        {
+          batch->input_done = TRUE;
+
+          break;
+        }
+
+      line[terminator_pos] = '\0';
+
+      if (! *line)
+        {
+          g_free (line);
+
+          continue;
+        }
+
+      if (batch->output_dir)
+        {
+          gchar       *path = gimp_batch_files_get_output_path (batch, line);
+          const gchar *other;
+
+          other = g_hash_table_lookup (batch->outputs, path);
+
+          if (other)
+            {
+              gint64  times[4] = { -1, -1, -1, -1 };
+              GError *error;
+
+              error = g_error_new (GIMP_PDB_ERROR, GIMP_PDB_ERROR_FAILED,
+                                   _("Not processed, '%s' would overwrite "
+                                     "the output of '%s'"),
+                                   gimp_filename_to_utf8 (path),
+                                   gimp_filename_to_utf8 (other));
+
+              gimp_batch_files_write_record (batch, line, NULL,
+                                             error, times);
+
+              g_error_free (error);
+              g_free (path);
+              g_free (line);
+
+              continue;
+            }
+
+          g_hash_table_insert (batch->outputs, path, g_strdup (line));
+        }
+
+      return line;
+    }
+
+  return NULL;
+}
+
+static gchar *
+gimp_batch_files_get_output_path (GimpBatchFiles *batch,
+                                  const gchar    *filename)
+{
+  gchar *scheme = g_uri_parse_scheme (filename);
+  gchar *path   = NULL;
+
+  /*  keep the directories of a relative path, so that equally named
+   *  images from different directories don't end up in the same file
+   */
+  if (! scheme && ! g_path_is_absolute (filename))
+    {
+      gchar     **components;
+      GPtrArray  *elements;
+      gint        i;
+
+      components = g_strsplit_set (filename, "/" G_DIR_SEPARATOR_S, -1);
+      elements   = g_ptr_array_new ();
+
+      g_ptr_array_add (elements, (gpointer) batch->output_dir);
+
+      for (i = 0; components[i]; i++)
+        {
+          /*  never save outside of the output directory  */
+          if (! strcmp (components[i], ".."))
+            break;
+
+          if (*components[i] && strcmp (components[i], "."))
+            g_ptr_array_add (elements, components[i]);
+        }
+
+      if (! components[i])
+        {
+          g_ptr_array_add (elements, NULL);
+
+          path = g_build_filenamev ((gchar **) elements->pdata);
+        }
+
+      g_ptr_array_free (elements, TRUE);
+      g_strfreev (components);
+    }
+
+  if (! path)
+    {
+      GFile *file     = g_file_new_for_commandline_arg (filename);
+      gchar *basename = g_file_get_basename (file);
+
+      path = g_build_filename (batch->output_dir, basename, NULL);
+
+      g_free (basename);
+      g_object_unref (file);
+    }
+
+  g_free (scheme);
+
+  return path;
+}
+
+static void
+gimp_batch_files_process (GimpBatchFiles *batch)
+{
+  gchar *filename;
+
+  while ((filename = gimp_batch_files_next (batch)))
+    {
+      gimp_batch_files_process_one (batch, filename);
+
+      g_free (filename);
+    }
+}
+
+static inline gboolean
+GIMP_IS_PARAM_SPEC_RUN_MODE (GParamSpec *pspec)
+{
+  return (G_IS_PARAM_SPEC_ENUM (pspec) &&
+          pspec->value_type == GIMP_TYPE_RUN_MODE);
+}
+
+static void
+gimp_batch_files_process_one (GimpBatchFiles *batch,
+                              const gchar    *filename)
+{
+  Gimp              *gimp     = batch->gimp;
+  GFile             *file;
+  GFile             *output   = NULL;
+  GimpImage         *image;
+  GimpPDBStatusType  status;
+  gint64             times[4] = { -1, -1, -1, -1 };
+  GError            *error    = NULL;
+
+  file = g_file_new_for_commandline_arg (filename);
+
+  times[0] = g_get_monotonic_time ();
+
+  image = file_open_image (gimp, gimp_get_user_context (gimp), NULL,
+                           file, FALSE, NULL,
+                           GIMP_RUN_NONINTERACTIVE,
+                           &status, NULL, &error);
+
+  times[1] = g_get_monotonic_time ();
+
+  if (image)
+    {
+      if (gimp_batch_files_run_procedures (batch, image, &error))
+        {
+          times[2] = g_get_monotonic_time ();
+
+          if (batch->output_dir)
+            {
+              gchar *path = gimp_batch_files_get_output_path (batch,
+                                                              filename);
+              gchar *dirname;
+
+              output  = g_file_new_for_path (path);
+              dirname = g_path_get_dirname (path);
+
+              if (g_mkdir_with_parents (dirname, 0755) != 0)
+                {
+                  g_set_error (&error, G_FILE_ERROR,
+                               g_file_error_from_errno (errno),
+                               _("Could not create directory '%s': %s"),
+                               gimp_filename_to_utf8 (dirname),
+                               g_strerror (errno));
+                }
+              else if (! gimp_batch_files_save (batch, image, output,
+                                                &error) &&
+                       ! error)
+                {
+                  g_set_error (&error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_FAILED,
+                               _("Saving '%s' failed"),
+                               gimp_file_get_utf8_name (output));
+                }
+
+              g_free (dirname);
+              g_free (path);
+            }
+
+          times[3] = g_get_monotonic_time ();
+        }
+
+      g_object_unref (image);
+    }
+  else if (! error)
+    {
+      g_set_error (&error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_FAILED,
+                   _("Opening '%s' failed"),
+                   gimp_file_get_utf8_name (file));
+    }
+
+  gimp_batch_files_write_record (batch, filename,
+                                 error ? NULL : output, error, times);
+
+  g_clear_error (&error);
+  g_clear_object (&output);
+  g_object_unref (file);
+}
+
+static gboolean
+gimp_batch_files_run_procedures (GimpBatchFiles  *batch,
+                                 GimpImage       *image,
+                                 GError         **error)
+{
+  Gimp *gimp = batch->gimp;
+  gint  i;
+
+  for (i = 0; batch->procedures && batch->procedures[i]; i++)
+    {
+      const gchar       *proc_name = batch->procedures[i];
+      GimpProcedure     *procedure;
+      GimpValueArray    *args;
+      GimpValueArray    *return_vals;
+      GimpPDBStatusType  status;
+      gint               n_args    = 0;
+
+      procedure = gimp_pdb_lookup_procedure (gimp->pdb, proc_name);
+
+      if (! procedure)
+        {
+          g_set_error (error,
+                       GIMP_PDB_ERROR, GIMP_PDB_ERROR_PROCEDURE_NOT_FOUND,
+                       _("Procedure '%s' not found"), proc_name);
+          return FALSE;
+        }
+
+      /*  pass the image and its active drawable the way a menu
+       *  invocation would, and leave all other arguments at their
+       *  defaults
+       */
+      args = gimp_procedure_get_arguments (procedure);
+
+      if (procedure->num_args > n_args &&
+          GIMP_IS_PARAM_SPEC_RUN_MODE (procedure->args[n_args]))
+        {
+          g_value_set_enum (gimp_value_array_index (args, n_args++),
+                            GIMP_RUN_NONINTERACTIVE);
+        }
+
+      if (procedure->num_args > n_args &&
+          GIMP_IS_PARAM_SPEC_IMAGE (procedure->args[n_args]))
+        {
+          g_value_set_object (gimp_value_array_index (args, n_args++),
+                              image);
+
+          if (procedure->num_args > n_args &&
+              GIMP_IS_PARAM_SPEC_DRAWABLE (procedure->args[n_args]))
+            {
+              g_value_set_object (gimp_value_array_index (args, n_args++),
+                                  gimp_image_get_active_drawable (image));
+            }
+        }
+
+      return_vals =
+        gimp_pdb_execute_procedure_by_name_args (gimp->pdb,
+                                                 gimp_get_user_context (gimp),
+                                                 NULL, error,
+                                                 proc_name, args);
+
+      status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+
+      gimp_value_array_unref (return_vals);
+      gimp_value_array_unref (args);
+
+      if (status != GIMP_PDB_SUCCESS)
+        {
+          if (! *error)
+            g_set_error (error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_FAILED,
+                         _("Procedure '%s' failed"), proc_name);
+
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gimp_batch_files_save (GimpBatchFiles  *batch,
+                       GimpImage       *image,
+                       GFile           *file,
+                       GError         **error)
+{
+  GimpPlugInManager   *manager = batch->gimp->plug_in_manager;
+  GimpPlugInProcedure *file_proc;
+  gboolean             export  = FALSE;
+
+  file_proc = gimp_plug_in_manager_file_procedure_find (manager,
+                                                        GIMP_FILE_PROCEDURE_GROUP_SAVE,
+                                                        file, NULL);
+
+  if (! file_proc)
+    {
+      file_proc = gimp_plug_in_manager_file_procedure_find (manager,
+                                                            GIMP_FILE_PROCEDURE_GROUP_EXPORT,
+                                                            file, error);
+      export = TRUE;
+    }
+
+  if (! file_proc)
+    return FALSE;
+
+  return file_save (batch->gimp, image, NULL,
+                    file, file_proc, GIMP_RUN_NONINTERACTIVE,
+                    ! export, FALSE, export,
+                    error) == GIMP_PDB_SUCCESS;
+}
+
+static void
+gimp_batch_files_coordinate (GimpBatchFiles *batch,
+                             gint            n_jobs)
+{
+  gint i;
+
+  batch->loop = g_main_loop_new (NULL, FALSE);
+
+  for (i = 0; i < n_jobs && ! batch->input_done; i++)
+    gimp_batch_files_spawn_worker (batch);
+
+  if (batch->n_workers > 0)
+    g_main_loop_run (batch->loop);
+
+  g_clear_pointer (&batch->loop, g_main_loop_unref);
+}
+
+static gboolean
+gimp_batch_files_spawn_worker (GimpBatchFiles *batch)
+{
+  Gimp            *gimp = batch->gimp;
+  GimpBatchWorker *worker;
+  GPtrArray       *argv;
+  GSubprocess     *process;
+  GError          *error = NULL;
+  gint             i;
+
+  argv = g_ptr_array_new_with_free_func (g_free);
+
+  g_ptr_array_add (argv, g_strdup (batch->program));
+  g_ptr_array_add (argv, g_strdup ("--no-interface"));
+
+  if (gimp->no_data)
+    g_ptr_array_add (argv, g_strdup ("--no-data"));
+
+  if (gimp->no_fonts)
+    g_ptr_array_add (argv, g_strdup ("--no-fonts"));
+
+  if (batch->alternate_system_gimprc)
+    g_ptr_array_add (argv,
+                     g_strconcat ("--system-gimprc=",
+                                  g_file_peek_path (batch->alternate_system_gimprc),
+                                  NULL));
+
+  if (batch->alternate_gimprc)
+    g_ptr_array_add (argv,
+                     g_strconcat ("--gimprc=",
+                                  g_file_peek_path (batch->alternate_gimprc),
+                                  NULL));
+
+  g_ptr_array_add (argv, g_strdup ("--batch-files=-"));
+  g_ptr_array_add (argv, g_strdup ("--batch-jobs=1"));
+  g_ptr_array_add (argv, g_strdup ("--batch-summary=-"));
+
+  if (batch->output_dir)
+    g_ptr_array_add (argv, g_strconcat ("--batch-output-dir=",
+                                        batch->output_dir, NULL));
+
+  for (i = 0; batch->procedures && batch->procedures[i]; i++)
+    g_ptr_array_add (argv, g_strconcat ("--batch-procedure=",
+                                        batch->procedures[i], NULL));
+
+  g_ptr_array_add (argv, NULL);
+
+  process = g_subprocess_newv ((const gchar * const *) argv->pdata,
+                               G_SUBPROCESS_FLAGS_STDIN_PIPE |
+                               G_SUBPROCESS_FLAGS_STDOUT_PIPE,
+                               &error);
+
+  g_ptr_array_free (argv, TRUE);
+
+  if (! process)
+    {
+      g_printerr ("batch worker could not be started:\n%s\n",
+                  error->message);
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  worker = g_slice_new0 (GimpBatchWorker);
+
+  worker->batch   = batch;
+  worker->process = process;
+  worker->files   = g_subprocess_get_stdin_pipe (process);
+  worker->records =
+    g_data_input_stream_new (g_subprocess_get_stdout_pipe (process));
+
+  batch->n_workers++;
+
+  gimp_batch_files_feed_worker (worker);
+
+  return TRUE;
+}
+
+static void
+gimp_batch_files_feed_worker (GimpBatchWorker *worker)
+{
+  g_clear_pointer (&worker->current, g_free);
+
+  worker->current = gimp_batch_files_next (worker->batch);
+
+  if (worker->current)
+    {
+      gchar *line = g_strconcat (worker->current, "\n", NULL);
+
+      /*  if this fails, the worker is gone, and we find out when
+       *  reading from it
+       */
+      g_output_stream_write_all (worker->files, line, strlen (line),
+                                 NULL, NULL, NULL);
+      g_output_stream_flush (worker->files, NULL, NULL);
+
+      g_free (line);
+    }
+  else
+    {
+      /*  no files left, let the worker finish  */
+      g_output_stream_close (worker->files, NULL, NULL);
+    }
+
+  g_data_input_stream_read_line_async (worker->records,
+                                       G_PRIORITY_DEFAULT, NULL,
+                                       gimp_batch_files_worker_read,
+                                       worker);
+}
+
+static void
+gimp_batch_files_worker_read (GObject      *source,
+                              GAsyncResult *result,
+                              gpointer      data)
+{
+  GimpBatchWorker *worker = data;
+  gchar           *line;
+
+  line = g_data_input_stream_read_line_finish (worker->records, result,
+                                               NULL, NULL);
+
+  if (! line)
+    {
+      gimp_batch_files_worker_exited (worker);
+
+      return;
+    }
+
+  if (g_str_has_prefix (line, BATCH_RECORD_PREFIX))
+    {
+      gimp_batch_files_add_record (worker->batch, line);
+      g_free (line);
+
+      gimp_batch_files_feed_worker (worker);
+
+      return;
+    }
+
+  /*  pass on anything the worker printed, except for its totals  */
+  if (line[0] != '{')
+    g_printerr ("%s\n", line);
+
+  g_free (line);
+
+  g_data_input_stream_read_line_async (worker->records,
+                                       G_PRIORITY_DEFAULT, NULL,
+                                       gimp_batch_files_worker_read,
+                                       worker);
+}
+
+static void
+gimp_batch_files_worker_exited (GimpBatchWorker *worker)
+{
+  GimpBatchFiles *batch   = worker->batch;
+  gboolean        crashed = (worker->current != NULL);
+
+  if (crashed)
+    {
+      gint64  times[4] = { -1, -1, -1, -1 };
+      GError *error;
+
+      error = g_error_new_literal (GIMP_PDB_ERROR, GIMP_PDB_ERROR_FAILED,
+                                   _("The batch worker processing this "
+                                     "file exited unexpectedly"));
+
+      gimp_batch_files_write_record (batch, worker->current, NULL,
+                                     error, times);
+
+      g_error_free (error);
+    }
+
+  g_object_unref (worker->records);
+  g_object_unref (worker->process);
+  g_free (worker->current);
+
+  g_slice_free (GimpBatchWorker, worker);
+
+  batch->n_workers--;
+
+  /*  replace a crashed worker as long as there is work left  */
+  if (crashed && ! batch->input_done)
+    gimp_batch_files_spawn_worker (batch);
+
+  if (batch->n_workers == 0)
+    g_main_loop_quit (batch->loop);
+}
+
+static void
+gimp_batch_files_write_record (GimpBatchFiles *batch,
+                               const gchar    *input,
+                               GFile          *output,
+                               const GError   *error,
+                               const gint64   *times)
+{
+  GString *record = g_string_new (BATCH_RECORD_PREFIX);
+
+  gimp_batch_files_append_string (record, gimp_filename_to_utf8 (input));
+
+  g_string_append (record, ",\"output\":");
+
+  if (output)
+    gimp_batch_files_append_string (record, gimp_file_get_utf8_name (output));
+  else
+    g_string_append (record, "null");
+
+  g_string_append_printf (record, ",\"status\":\"%s\",\"error\":",
+                          error ? "error" : "success");
+
+  if (error)
+    gimp_batch_files_append_string (record, error->message);
+  else
+    g_string_append (record, "null");
+
+  gimp_batch_files_append_time (record, "load-time",    times[0], times[1]);
+  gimp_batch_files_append_time (record, "process-time", times[1], times[2]);
+  gimp_batch_files_append_time (record, "save-time",    times[2], times[3]);
+  gimp_batch_files_append_time (record, "total-time",   times[0], times[3]);
+
+  g_string_append (record, "}");
+
+  gimp_batch_files_add_record (batch, record->str);
+
+  g_string_free (record, TRUE);
+}
+
+static void
+gimp_batch_files_add_record (GimpBatchFiles *batch,
+                             const gchar    *record)
+{
+  batch->n_files++;
+
+  /*  strings in the record are escaped, so this can't match inside
+   *  a file name or error message
+   */
+  if (strstr (record, "\"status\":\"error\""))
+    batch->n_failed++;
+
+  fputs (record, batch->summary);
+  fputc ('\n', batch->summary);
+
+  /*  stream the summary, so it can be followed while we run  */
+  fflush (batch->summary);
+}
+
+static void
+gimp_batch_files_append_string (GString     *string,
+                                const gchar *value)
+{
+  const gchar *p;
+
+  g_string_append_c (string, '"');
+
+  for (p = value; *p; p++)
+    {
+      switch (*p)
+        {
+        case '"':
+          g_string_append (string, "\\\"");
+          break;
+
+        case '\\':
+          g_string_append (string, "\\\\");
+          break;
+
+        case '\n':
+          g_string_append (string, "\\n");
+          break;
+
+        case '\r':
+          g_string_append (string, "\\r");
+          break;
+
+        case '\t':
+          g_string_append (string, "\\t");
+          break;
+
+        default:
+          if ((guchar) *p < 0x20)
+            g_string_append_printf (string, "\\u%04x", (guchar) *p);
+          else
+            g_string_append_c (string, *p);
+          break;
+        }
+    }
+
+  g_string_append_c (string, '"');
+}
+
+static void
+gimp_batch_files_append_time (GString     *string,
+                              const gchar *name,
+                              gint64       start,
+                              gint64       end)
+{
+  g_string_append_printf (string, ",\"%s\":", name);
+
+  if (start >= 0 && end >= 0)
+    {
+      gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+      /*  seconds, and not in the locale's number format  */
+      g_ascii_formatd (buf, sizeof (buf), "%.3f",
+                       (gdouble) (end - start) / G_TIME_SPAN_SECOND);
+
+      g_string_append (string, buf);
+    }
+  else
+    {
+      g_string_append (string, "null");
+    }
+}
@@ -0,0 +1,35 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-batch-files.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_BATCH_FILES_H__
+#define __GIMP_BATCH_FILES_H__
+
+
+gboolean   gimp_batch_run_files (Gimp         *gimp,
+                                 const gchar  *program,
+                                 GFile        *alternate_system_gimprc,
+                                 GFile        *alternate_gimprc,
+                                 const gchar  *batch_files,
+                                 const gchar **batch_procedures,
+                                 const gchar  *batch_output_dir,
+                                 gint          batch_jobs,
+                                 const gchar  *batch_summary);
+
+
+#endif /* __GIMP_BATCH_FILES_H__ */
@@ -187,6 +187,10 @@ gimp_data_factories_init (Gimp *gimp)
                                   gimp_palette_get_standard);
   gimp_object_set_static_name (GIMP_OBJECT (gimp->palette_factory),
                                "palette factory");
+  /*  the palette loaders g_message() about broken files, which is
+   *  only safe on the main thread
+   */
+  gimp_data_loader_factory_set_threaded (gimp->palette_factory, FALSE);
   gimp_data_loader_factory_add_loader (gimp->palette_factory,
                                        "GIMP Palette",
                                        gimp_palette_load,
@@ -209,6 +213,8 @@ gimp_data_factories_init (Gimp *gimp)
                                   NULL);
   gimp_object_set_static_name (GIMP_OBJECT (gimp->tool_preset_factory),
                                "tool preset factory");
+  /*  tool presets create tool options, which isn't thread safe  */
+  gimp_data_loader_factory_set_threaded (gimp->tool_preset_factory, FALSE);
   gimp_data_loader_factory_add_loader (gimp->tool_preset_factory,
                                        "GIMP Tool Preset",
                                        gimp_tool_preset_load,
@@ -352,6 +358,29 @@ gimp_data_factories_load (Gimp               *gimp,
 {
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 
+  /*  start reading the data files of all factories in parallel, the
+   *  data is added to the containers by gimp_data_factory_data_init()
+   */
+  if (! gimp->no_data)
+    {
+      gimp_data_loader_factory_preload (gimp->brush_factory,
+                                        gimp->user_context);
+      gimp_data_loader_factory_preload (gimp->dynamics_factory,
+                                        gimp->user_context);
+      gimp_data_loader_factory_preload (gimp->mybrush_factory,
+                                        gimp->user_context);
+      gimp_data_loader_factory_preload (gimp->pattern_factory,
+                                        gimp->user_context);
+      gimp_data_loader_factory_preload (gimp->palette_factory,
+                                        gimp->user_context);
+      gimp_data_loader_factory_preload (gimp->gradient_factory,
+                                        gimp->user_context);
+
+      if (! gimp->no_interface)
+        gimp_data_loader_factory_preload (gimp->tool_preset_factory,
+                                          gimp->user_context);
+    }
+
   /*  initialize the list of gimp brushes    */
   status_callback (NULL, _("Brushes"), 0.1);
   gimp_data_factory_data_init (gimp->brush_factory, gimp->user_context,
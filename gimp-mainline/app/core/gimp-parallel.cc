@@ -45,27 +45,71 @@ extern "C"
 #include "gimpcancelable.h"
 
 
+/* the actual number of threads follows the num-processors setting, which
+ * can't exceed the maximum of GEGL's "threads" property, i.e., 64.
+ *
+ * the async tasks used to run one at a time, on a single thread.  none of the
+ * callers depend on that:
+ *
+ *   - histogram calculations and updates work on copy-on-write copies of
+ *     their buffers.  a calculation waits for the pending updates before it
+ *     starts, and no update starts while a calculation is pending.  the
+ *     updates are deltas, which the main thread adds up in any order.
+ *
+ *   - the compression, spilling and restoring of an undo step only start
+ *     once the previous one of them finished, or after canceling it, and
+ *     each works on data owned by its task.
+ *
+ *   - drawable previews only read their buffer.  buffers which are validated
+ *     on demand are previewed in idles on the main thread instead.
+ *
+ *   - line art and the XCF tile batches work on their own copies of the
+ *     pixels, and the batches of one drawable never overlap.
+ *
+ *   - the data loader factories load different directories, each creating
+ *     its own data objects; the caches they look the files up in are only
+ *     read while loading.
+ *
+ *   - the projection's render jobs each render a snapshot of the graph into
+ *     their own buffers, which the main thread copies into the projection.
+ */
 #define GIMP_PARALLEL_MAX_THREADS           64
-#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS  1
+#define GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS GIMP_PARALLEL_MAX_THREADS
 
 
+typedef struct _GimpParallelRunAsyncThread GimpParallelRunAsyncThread;
+
 typedef struct
 {
-  GimpAsync        *async;
-  gint              priority;
-  GimpRunAsyncFunc  func;
-  gpointer          user_data;
-  GDestroyNotify    user_data_destroy_func;
+  GimpAsync                  *async;
+  GimpAsync                  *parent;
+  gboolean                    child;
+  gint                        priority;
+  GimpRunAsyncFunc            func;
+  gpointer                    user_data;
+  GDestroyNotify              user_data_destroy_func;
+
+  /* the thread whose queue currently holds the task, or NULL.  protected by
+   * the owner's mutex.
+   */
+  GimpParallelRunAsyncThread *owner;
+  GList                       link;
 } GimpParallelRunAsyncTask;
 
-typedef struct
+struct _GimpParallelRunAsyncThread
 {
   GThread   *thread;
 
+  GMutex     mutex;
+  GQueue     queue;
+  /* the length of 'queue', which may be read without the mutex */
+  gint       n_queued;
+
   gboolean   quit;
 
   GimpAsync *current_async;
-} GimpParallelRunAsyncThread;
+  gint       current_priority;
+};
 
 
 /*  local function prototypes  */
@@ -75,13 +119,28 @@ static void                       gimp_parallel_notify_num_processors   (GimpGeg
 static void                       gimp_parallel_set_n_threads           (gint                        n_threads,
                                                                          gboolean                    finish_tasks);
 
+static GimpAsync                * gimp_parallel_run_async_submit        (GimpAsync                  *parent,
+                                                                         gboolean                    child,
+                                                                         gint                        priority,
+                                                                         GimpRunAsyncFunc            func,
+                                                                         gpointer                    user_data,
+                                                                         GDestroyNotify              user_data_destroy_func);
 static void                       gimp_parallel_run_async_set_n_threads (gint                        n_threads,
                                                                          gboolean                    finish_tasks);
 static gpointer                   gimp_parallel_run_async_thread_func   (GimpParallelRunAsyncThread *thread);
-static void                       gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncTask   *task);
-static GimpParallelRunAsyncTask * gimp_parallel_run_async_dequeue_task  (void);
+static void                       gimp_parallel_run_async_enqueue_task  (GimpParallelRunAsyncTask   *task,
+                                                                         GimpParallelRunAsyncThread *thread);
+static void                       gimp_parallel_run_async_insert_task   (GimpParallelRunAsyncThread *thread,
+                                                                         GimpParallelRunAsyncTask   *task);
+static GimpParallelRunAsyncTask * gimp_parallel_run_async_dequeue_task  (GimpParallelRunAsyncThread *thread);
+static GimpParallelRunAsyncTask * gimp_parallel_run_async_pick_task     (GimpParallelRunAsyncThread *thread);
+static gboolean                   gimp_parallel_run_async_should_yield  (GimpParallelRunAsyncThread *thread,
+                                                                         gint                        priority);
+static GimpParallelRunAsyncTask * gimp_parallel_run_async_unlink_task   (GimpAsync                  *async);
 static gboolean                   gimp_parallel_run_async_execute_task  (GimpParallelRunAsyncTask   *task);
+static void                       gimp_parallel_run_async_free_task     (GimpParallelRunAsyncTask   *task);
 static void                       gimp_parallel_run_async_abort_task    (GimpParallelRunAsyncTask   *task);
+static void                       gimp_parallel_run_async_notify_child  (void);
 static void                       gimp_parallel_run_async_cancel        (GimpAsync                  *async);
 static void                       gimp_parallel_run_async_waiting       (GimpAsync                  *async);
 
@@ -91,9 +150,29 @@ static void                       gimp_parallel_run_async_waiting       (GimpAsy
 static gint                       gimp_parallel_run_async_n_threads = 0;
 static GimpParallelRunAsyncThread gimp_parallel_run_async_threads[GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS];
 
+/* the number of queued tasks, across all threads */
+static gint                       gimp_parallel_run_async_n_queued   = 0;
+/* the number of threads waiting on gimp_parallel_run_async_cond */
+static gint                       gimp_parallel_run_async_n_sleeping = 0;
+/* round-robin counter for distributing tasks submitted by non-worker
+ * threads
+ */
+static guint                      gimp_parallel_run_async_next_thread = 0;
+
+/* the global mutex and cond are only used for putting idle threads to sleep,
+ * and for waking them up.  the task queues themselves are per-thread.
+ */
 static GMutex                     gimp_parallel_run_async_mutex;
 static GCond                      gimp_parallel_run_async_cond;
-static GQueue                     gimp_parallel_run_async_queue = G_QUEUE_INIT;
+
+/* signaled, under gimp_parallel_run_async_mutex, whenever a child task stops
+ * or is requeued, while there are threads in
+ * gimp_parallel_run_async_child_wait()
+ */
+static GCond                      gimp_parallel_run_async_child_cond;
+static gint                       gimp_parallel_run_async_n_child_waiters = 0;
+
+static GPrivate                   gimp_parallel_run_async_current_thread;
 
 
 /*  public functions  */
@@ -141,44 +220,102 @@ gimp_parallel_run_async_full (gint             priority,
                               gpointer         user_data,
                               GDestroyNotify   user_data_destroy_func)
 {
-  GimpAsync                *async;
-  GimpParallelRunAsyncTask *task;
+  g_return_val_if_fail (func != NULL, NULL);
 
+  return gimp_parallel_run_async_submit (NULL, FALSE, priority,
+                                         func, user_data,
+                                         user_data_destroy_func);
+}
+
+/* runs 'func' as a child of 'parent'.  when called from within a running
+ * async task, the child is pushed onto the calling worker's own queue, without
+ * touching any shared state, and inherits the priority of the running task.
+ * the child is aborted, rather than executed, if 'parent' is canceled before
+ * the child starts running.  'parent' may be NULL, for children of a thread
+ * which doesn't run an async task of its own, like the main thread.
+ *
+ * a running task must use gimp_parallel_run_async_child_wait(), and not
+ * gimp_waitable_wait(), to wait for its children.
+ */
+GimpAsync *
+gimp_parallel_run_async_child (GimpAsync        *parent,
+                               GimpRunAsyncFunc  func,
+                               gpointer          user_data)
+{
+  return gimp_parallel_run_async_child_full (parent, func, user_data, NULL);
+}
+
+GimpAsync *
+gimp_parallel_run_async_child_full (GimpAsync        *parent,
+                                    GimpRunAsyncFunc  func,
+                                    gpointer          user_data,
+                                    GDestroyNotify    user_data_destroy_func)
+{
+  GimpParallelRunAsyncThread *thread;
+  gint                        priority = 0;
+
+  g_return_val_if_fail (parent == NULL || GIMP_IS_ASYNC (parent), NULL);
   g_return_val_if_fail (func != NULL, NULL);
 
-  async = gimp_async_new ();
+  thread = (GimpParallelRunAsyncThread *) g_private_get (
+    &gimp_parallel_run_async_current_thread);
 
-  task = g_slice_new (GimpParallelRunAsyncTask);
+  if (thread)
+    priority = thread->current_priority;
 
-  task->async                  = GIMP_ASYNC (g_object_ref (async));
-  task->priority               = priority;
-  task->func                   = func;
-  task->user_data              = user_data;
-  task->user_data_destroy_func = user_data_destroy_func;
+  return gimp_parallel_run_async_submit (parent, TRUE, priority,
+                                         func, user_data,
+                                         user_data_destroy_func);
+}
+
+/* waits for 'child', returned by gimp_parallel_run_async_child(), to stop.
+ * if 'child' hasn't started running yet, it's run on the calling thread,
+ * instead of blocking the caller on a task that might be queued behind it,
+ * or on its own queue.  otherwise, it's already running on another thread,
+ * and we wait for it there.
+ *
+ * unlike gimp_waitable_wait(), this may be called from any thread, and
+ * doesn't run the callbacks of 'child', which are still called on the main
+ * thread.
+ */
+void
+gimp_parallel_run_async_child_wait (GimpAsync *child)
+{
+  g_return_if_fail (GIMP_IS_ASYNC (child));
 
-  if (gimp_parallel_run_async_n_threads > 0)
+  while (! gimp_async_is_stopped (child))
     {
-      g_signal_connect_after (async, "cancel",
-                              G_CALLBACK (gimp_parallel_run_async_cancel),
-                              NULL);
-      g_signal_connect_after (async, "waiting",
-                              G_CALLBACK (gimp_parallel_run_async_waiting),
-                              NULL);
+      GimpParallelRunAsyncTask *task;
+
+      task = gimp_parallel_run_async_unlink_task (child);
+
+      if (task)
+        {
+          while (gimp_parallel_run_async_execute_task (task));
+
+          break;
+        }
 
       g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-      gimp_parallel_run_async_enqueue_task (task);
+      /* pairs with the opposite order in
+       * gimp_parallel_run_async_notify_child(), the same way as
+       * gimp_parallel_run_async_n_sleeping does.
+       */
+      g_atomic_int_inc (&gimp_parallel_run_async_n_child_waiters);
 
-      g_cond_signal (&gimp_parallel_run_async_cond);
+      if (! gimp_async_is_stopped (child) &&
+          ! g_object_get_data (G_OBJECT (child),
+                               "gimp-parallel-run-async-queued"))
+        {
+          g_cond_wait (&gimp_parallel_run_async_child_cond,
+                       &gimp_parallel_run_async_mutex);
+        }
+
+      g_atomic_int_add (&gimp_parallel_run_async_n_child_waiters, -1);
 
       g_mutex_unlock (&gimp_parallel_run_async_mutex);
     }
-  else
-    {
-      while (gimp_parallel_run_async_execute_task (task));
-    }
-
-  return async;
 }
 
 GimpAsync *
@@ -267,70 +404,132 @@ gimp_parallel_set_n_threads (gint     n_threads,
   gimp_parallel_run_async_set_n_threads (n_threads, finish_tasks);
 }
 
+static GimpAsync *
+gimp_parallel_run_async_submit (GimpAsync        *parent,
+                                gboolean          child,
+                                gint              priority,
+                                GimpRunAsyncFunc  func,
+                                gpointer          user_data,
+                                GDestroyNotify    user_data_destroy_func)
+{
+  GimpAsync                *async;
+  GimpParallelRunAsyncTask *task;
+
+  async = gimp_async_new ();
+
+  task = g_slice_new0 (GimpParallelRunAsyncTask);
+
+  task->async                  = GIMP_ASYNC (g_object_ref (async));
+  task->parent                 = parent ?
+                                   GIMP_ASYNC (g_object_ref (parent)) : NULL;
+  task->child                  = child;
+  task->priority               = priority;
+  task->func                   = func;
+  task->user_data              = user_data;
+  task->user_data_destroy_func = user_data_destroy_func;
+  task->link.data              = task;
+
+  if (g_atomic_int_get (&gimp_parallel_run_async_n_threads) > 0)
+    {
+      g_signal_connect_after (async, "cancel",
+                              G_CALLBACK (gimp_parallel_run_async_cancel),
+                              NULL);
+      g_signal_connect_after (async, "waiting",
+                              G_CALLBACK (gimp_parallel_run_async_waiting),
+                              NULL);
+
+      gimp_parallel_run_async_enqueue_task (
+        task,
+        (GimpParallelRunAsyncThread *) g_private_get (
+          &gimp_parallel_run_async_current_thread));
+    }
+  else
+    {
+      while (gimp_parallel_run_async_execute_task (task));
+    }
+
+  return async;
+}
+
 static void
 gimp_parallel_run_async_set_n_threads (gint     n_threads,
                                        gboolean finish_tasks)
 {
+  gint old_n_threads;
   gint i;
 
   n_threads = CLAMP (n_threads, 0, GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS);
 
-  if (n_threads > gimp_parallel_run_async_n_threads) /* need more threads */
+  old_n_threads = gimp_parallel_run_async_n_threads;
+
+  if (n_threads > old_n_threads) /* need more threads */
     {
-      for (i = gimp_parallel_run_async_n_threads; i < n_threads; i++)
+      for (i = old_n_threads; i < n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
 
+          g_mutex_lock (&thread->mutex);
+
           thread->quit = FALSE;
 
+          g_mutex_unlock (&thread->mutex);
+
           thread->thread = g_thread_new (
             "async",
             (GThreadFunc) gimp_parallel_run_async_thread_func,
             thread);
         }
+
+      g_atomic_int_set (&gimp_parallel_run_async_n_threads, n_threads);
     }
-  else if (n_threads < gimp_parallel_run_async_n_threads) /* need less threads */
+  else if (n_threads < old_n_threads) /* need less threads */
     {
-      g_mutex_lock (&gimp_parallel_run_async_mutex);
+      g_atomic_int_set (&gimp_parallel_run_async_n_threads, n_threads);
 
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      for (i = n_threads; i < old_n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
 
+          g_mutex_lock (&thread->mutex);
+
           thread->quit = TRUE;
 
           if (thread->current_async && ! finish_tasks)
             gimp_cancelable_cancel (GIMP_CANCELABLE (thread->current_async));
+
+          g_mutex_unlock (&thread->mutex);
         }
 
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
       g_cond_broadcast (&gimp_parallel_run_async_cond);
 
       g_mutex_unlock (&gimp_parallel_run_async_mutex);
 
-      for (i = n_threads; i < gimp_parallel_run_async_n_threads; i++)
+      for (i = n_threads; i < old_n_threads; i++)
         {
           GimpParallelRunAsyncThread *thread =
             &gimp_parallel_run_async_threads[i];
+          GimpParallelRunAsyncTask   *task;
 
           g_thread_join (thread->thread);
-        }
-    }
 
-  gimp_parallel_run_async_n_threads = n_threads;
+          thread->thread = NULL;
 
-  if (n_threads == 0)
-    {
-      GimpParallelRunAsyncTask *task;
-
-      /* finish remaining tasks */
-      while ((task = gimp_parallel_run_async_dequeue_task ()))
-        {
-          if (finish_tasks)
-            while (gimp_parallel_run_async_execute_task (task));
-          else
-            gimp_parallel_run_async_abort_task (task);
+          /* redistribute the tasks left in the thread's queue among the
+           * remaining threads, or run them here if there are none left
+           */
+          while ((task = gimp_parallel_run_async_dequeue_task (thread)))
+            {
+              if (n_threads > 0)
+                gimp_parallel_run_async_enqueue_task (task, NULL);
+              else if (finish_tasks)
+                while (gimp_parallel_run_async_execute_task (task));
+              else
+                gimp_parallel_run_async_abort_task (task);
+            }
         }
     }
 }
@@ -338,72 +537,184 @@ gimp_parallel_run_async_set_n_threads (gint     n_threads,
 static gpointer
 gimp_parallel_run_async_thread_func (GimpParallelRunAsyncThread *thread)
 {
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
+  g_private_set (&gimp_parallel_run_async_current_thread, thread);
 
   while (TRUE)
     {
       GimpParallelRunAsyncTask *task;
 
-      while (! thread->quit &&
-             (task = gimp_parallel_run_async_dequeue_task ()))
+      g_mutex_lock (&thread->mutex);
+
+      if (thread->quit)
         {
-          gboolean resume;
+          g_mutex_unlock (&thread->mutex);
 
-          thread->current_async = GIMP_ASYNC (g_object_ref (task->async));
+          break;
+        }
 
-          do
-            {
-              g_mutex_unlock (&gimp_parallel_run_async_mutex);
+      g_mutex_unlock (&thread->mutex);
+
+      task = gimp_parallel_run_async_pick_task (thread);
+
+      if (task)
+        {
+          gboolean yield = FALSE;
+
+          g_mutex_lock (&thread->mutex);
 
-              resume = gimp_parallel_run_async_execute_task (task);
+          thread->current_async    = GIMP_ASYNC (g_object_ref (task->async));
+          thread->current_priority = task->priority;
 
-              g_mutex_lock (&gimp_parallel_run_async_mutex);
+          g_mutex_unlock (&thread->mutex);
+
+          while (gimp_parallel_run_async_execute_task (task))
+            {
+              yield = gimp_parallel_run_async_should_yield (thread,
+                                                            task->priority);
+
+              if (yield)
+                break;
             }
-          while (resume &&
-                 (g_queue_is_empty (&gimp_parallel_run_async_queue) ||
-                  task->priority <
-                  ((GimpParallelRunAsyncTask *)
-                     g_queue_peek_head (
-                       &gimp_parallel_run_async_queue))->priority));
+
+          g_mutex_lock (&thread->mutex);
 
           g_clear_object (&thread->current_async);
+          thread->current_priority = 0;
+
+          g_mutex_unlock (&thread->mutex);
 
-          if (resume)
-            gimp_parallel_run_async_enqueue_task (task);
+          /* the task yielded to a more urgent one.  put it back into our own
+           * queue, where it can still be stolen by idle threads, or run by a
+           * thread waiting for it as a child.
+           */
+          if (yield)
+            {
+              gboolean child = task->child;
+
+              gimp_parallel_run_async_enqueue_task (task, thread);
+
+              if (child)
+                gimp_parallel_run_async_notify_child ();
+            }
+
+          continue;
         }
 
-      if (thread->quit)
-        break;
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+      /* both the increment of n_sleeping and the read of n_queued are full
+       * memory barriers, pairing with the opposite order in
+       * gimp_parallel_run_async_enqueue_task(), so that either we see the
+       * new task, or the enqueuer sees us sleeping.
+       */
+      g_atomic_int_inc (&gimp_parallel_run_async_n_sleeping);
 
-      g_cond_wait (&gimp_parallel_run_async_cond,
-                   &gimp_parallel_run_async_mutex);
+      if (g_atomic_int_get (&gimp_parallel_run_async_n_queued) == 0 &&
+          ! g_atomic_int_get (&thread->quit))
+        {
+          g_cond_wait (&gimp_parallel_run_async_cond,
+                       &gimp_parallel_run_async_mutex);
+        }
+
+      g_atomic_int_add (&gimp_parallel_run_async_n_sleeping, -1);
+
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
     }
 
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
+  g_private_set (&gimp_parallel_run_async_current_thread, NULL);
 
   return NULL;
 }
 
+/* queues 'task'.  if 'thread' is non-NULL, the task is pushed onto that
+ * thread's queue (used for tasks spawned from a worker thread, and for tasks
+ * that yielded), otherwise a thread is picked in a round-robin fashion.  idle
+ * threads steal work from busy ones, so the initial placement only affects
+ * locality.
+ */
 static void
-gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
+gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask   *task,
+                                      GimpParallelRunAsyncThread *thread)
 {
-  GList *link;
-  GList *iter;
-
-  if (gimp_async_is_canceled (task->async))
+  if (gimp_async_is_canceled (task->async) ||
+      (task->parent && gimp_async_is_canceled (task->parent)))
     {
       gimp_parallel_run_async_abort_task (task);
 
       return;
     }
 
-  link       = g_list_alloc ();
-  link->data = task;
+  if (g_object_get_data (G_OBJECT (task->async),
+                         "gimp-parallel-run-async-waiting"))
+    {
+      task->priority = G_MININT;
+    }
+
+  while (TRUE)
+    {
+      if (! thread)
+        {
+          gint n_threads;
+
+          n_threads = g_atomic_int_get (&gimp_parallel_run_async_n_threads);
+
+          if (n_threads == 0)
+            {
+              /* all threads went away while we were trying to enqueue the
+               * task; run it here.
+               */
+              while (gimp_parallel_run_async_execute_task (task));
+
+              return;
+            }
+
+          thread = &gimp_parallel_run_async_threads[
+            (guint) g_atomic_int_add (&gimp_parallel_run_async_next_thread,
+                                      1) % n_threads];
+        }
+
+      g_mutex_lock (&thread->mutex);
+
+      if (! thread->quit)
+        break;
+
+      g_mutex_unlock (&thread->mutex);
+
+      thread = NULL;
+    }
+
+  gimp_parallel_run_async_insert_task (thread, task);
+
+  g_atomic_int_inc (&thread->n_queued);
 
   g_object_set_data (G_OBJECT (task->async),
-                     "gimp-parallel-run-async-link", link);
+                     "gimp-parallel-run-async-queued", GINT_TO_POINTER (TRUE));
+
+  g_mutex_unlock (&thread->mutex);
+
+  g_atomic_int_inc (&gimp_parallel_run_async_n_queued);
+
+  if (g_atomic_int_get (&gimp_parallel_run_async_n_sleeping) > 0)
+    {
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
+
+      g_cond_signal (&gimp_parallel_run_async_cond);
 
-  for (iter = g_queue_peek_tail_link (&gimp_parallel_run_async_queue);
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
+    }
+}
+
+/* inserts 'task' into 'thread''s queue, which is kept sorted by priority.
+ * must be called with the thread's mutex locked.
+ */
+static void
+gimp_parallel_run_async_insert_task (GimpParallelRunAsyncThread *thread,
+                                     GimpParallelRunAsyncTask   *task)
+{
+  GList *link = &task->link;
+  GList *iter;
+
+  for (iter = g_queue_peek_tail_link (&thread->queue);
        iter;
        iter = g_list_previous (iter))
     {
@@ -424,37 +735,224 @@ gimp_parallel_run_async_enqueue_task (GimpParallelRunAsyncTask *task)
       if (link->next)
         link->next->prev = link;
       else
-        gimp_parallel_run_async_queue.tail = link;
+        thread->queue.tail = link;
 
-      gimp_parallel_run_async_queue.length++;
+      thread->queue.length++;
     }
   else
     {
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
+      g_queue_push_head_link (&thread->queue, link);
     }
+
+  task->owner = thread;
 }
 
 static GimpParallelRunAsyncTask *
-gimp_parallel_run_async_dequeue_task (void)
+gimp_parallel_run_async_dequeue_task (GimpParallelRunAsyncThread *thread)
 {
-  GimpParallelRunAsyncTask *task;
+  GimpParallelRunAsyncTask *task = NULL;
+  GList                    *link;
 
-  task = (GimpParallelRunAsyncTask *) g_queue_pop_head (
-                                        &gimp_parallel_run_async_queue);
+  if (g_atomic_int_get (&thread->n_queued) == 0)
+    return NULL;
 
-  if (task)
+  g_mutex_lock (&thread->mutex);
+
+  link = g_queue_pop_head_link (&thread->queue);
+
+  if (link)
     {
+      g_atomic_int_add (&thread->n_queued, -1);
+
+      task = (GimpParallelRunAsyncTask *) link->data;
+
+      task->owner = NULL;
+
       g_object_set_data (G_OBJECT (task->async),
-                         "gimp-parallel-run-async-link", NULL);
+                         "gimp-parallel-run-async-queued", NULL);
     }
 
+  g_mutex_unlock (&thread->mutex);
+
+  if (task)
+    g_atomic_int_add (&gimp_parallel_run_async_n_queued, -1);
+
   return task;
 }
 
+/* takes the most urgent queued task, comparing the heads of all the queues,
+ * which are sorted by priority.  on equal priority, the calling thread's own
+ * queue comes first, and then the queues of the threads following it.
+ */
+static GimpParallelRunAsyncTask *
+gimp_parallel_run_async_pick_task (GimpParallelRunAsyncThread *thread)
+{
+  gint n_threads;
+  gint index;
+  gint i;
+
+  index = thread - gimp_parallel_run_async_threads;
+
+  while (g_atomic_int_get (&gimp_parallel_run_async_n_queued) > 0)
+    {
+      GimpParallelRunAsyncThread *victim   = NULL;
+      gint                        priority = 0;
+      GimpParallelRunAsyncTask   *task;
+
+      n_threads = g_atomic_int_get (&gimp_parallel_run_async_n_threads);
+
+      /* threads that are about to quit still hold their tasks until they're
+       * redistributed, so consider them as victims too.
+       */
+      n_threads = MAX (n_threads, index + 1);
+
+      for (i = 0; i < n_threads; i++)
+        {
+          GimpParallelRunAsyncThread *other;
+          GimpParallelRunAsyncTask   *head;
+
+          other = &gimp_parallel_run_async_threads[(index + i) % n_threads];
+
+          if (g_atomic_int_get (&other->n_queued) == 0)
+            continue;
+
+          g_mutex_lock (&other->mutex);
+
+          head = (GimpParallelRunAsyncTask *) g_queue_peek_head (
+            &other->queue);
+
+          if (head && (! victim || head->priority < priority))
+            {
+              victim   = other;
+              priority = head->priority;
+            }
+
+          g_mutex_unlock (&other->mutex);
+        }
+
+      if (! victim)
+        return NULL;
+
+      /* the victim's head may have changed since we looked at it, in which
+       * case we still take the new head, or look again if it's gone.
+       */
+      task = gimp_parallel_run_async_dequeue_task (victim);
+
+      if (task)
+        return task;
+    }
+
+  return NULL;
+}
+
+/* returns TRUE if a task of 'priority', running on 'thread', should make way
+ * for a queued one: one at least as urgent in the thread's own queue, so that
+ * tasks of the same priority take turns, or a more urgent one anywhere else.
+ */
+static gboolean
+gimp_parallel_run_async_should_yield (GimpParallelRunAsyncThread *thread,
+                                      gint                        priority)
+{
+  gint n_threads;
+  gint i;
+
+  if (g_atomic_int_get (&gimp_parallel_run_async_n_queued) == 0)
+    return FALSE;
+
+  n_threads = g_atomic_int_get (&gimp_parallel_run_async_n_threads);
+  n_threads = MAX (n_threads, thread - gimp_parallel_run_async_threads + 1);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      GimpParallelRunAsyncThread *other = &gimp_parallel_run_async_threads[i];
+      GimpParallelRunAsyncTask   *head;
+      gboolean                    yield = FALSE;
+
+      if (g_atomic_int_get (&other->n_queued) == 0)
+        continue;
+
+      g_mutex_lock (&other->mutex);
+
+      head = (GimpParallelRunAsyncTask *) g_queue_peek_head (&other->queue);
+
+      if (head)
+        {
+          if (other == thread)
+            yield = head->priority <= priority;
+          else
+            yield = head->priority < priority;
+        }
+
+      g_mutex_unlock (&other->mutex);
+
+      if (yield)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* removes the queued task associated with 'async' from whichever queue it's
+ * in, if any.  returns NULL if the task is not queued (in which case it's
+ * either running, or already done).
+ */
+static GimpParallelRunAsyncTask *
+gimp_parallel_run_async_unlink_task (GimpAsync *async)
+{
+  gint n_threads;
+  gint i;
+
+  if (! g_object_get_data (G_OBJECT (async), "gimp-parallel-run-async-queued"))
+    return NULL;
+
+  n_threads = GIMP_PARALLEL_RUN_ASYNC_MAX_THREADS;
+
+  for (i = 0; i < n_threads; i++)
+    {
+      GimpParallelRunAsyncThread *thread = &gimp_parallel_run_async_threads[i];
+      GList                      *iter;
+
+      if (g_atomic_int_get (&thread->n_queued) == 0)
+        continue;
+
+      g_mutex_lock (&thread->mutex);
+
+      for (iter = g_queue_peek_head_link (&thread->queue);
+           iter;
+           iter = g_list_next (iter))
+        {
+          GimpParallelRunAsyncTask *task =
+            (GimpParallelRunAsyncTask *) iter->data;
+
+          if (task->async == async)
+            {
+              g_queue_unlink (&thread->queue, iter);
+              g_atomic_int_add (&thread->n_queued, -1);
+
+              task->owner = NULL;
+
+              g_object_set_data (G_OBJECT (async),
+                                 "gimp-parallel-run-async-queued", NULL);
+
+              g_mutex_unlock (&thread->mutex);
+
+              g_atomic_int_add (&gimp_parallel_run_async_n_queued, -1);
+
+              return task;
+            }
+        }
+
+      g_mutex_unlock (&thread->mutex);
+    }
+
+  return NULL;
+}
+
 static gboolean
 gimp_parallel_run_async_execute_task (GimpParallelRunAsyncTask *task)
 {
-  if (gimp_async_is_canceled (task->async))
+  if (gimp_async_is_canceled (task->async) ||
+      (task->parent && gimp_async_is_canceled (task->parent)))
     {
       gimp_parallel_run_async_abort_task (task);
 
@@ -465,9 +963,7 @@ gimp_parallel_run_async_execute_task (GimpParallelRunAsyncTask *task)
 
   if (gimp_async_is_stopped (task->async))
     {
-      g_object_unref (task->async);
-
-      g_slice_free (GimpParallelRunAsyncTask, task);
+      gimp_parallel_run_async_free_task (task);
 
       return FALSE;
     }
@@ -476,46 +972,53 @@ gimp_parallel_run_async_execute_task (GimpParallelRunAsyncTask *task)
 }
 
 static void
-gimp_parallel_run_async_abort_task (GimpParallelRunAsyncTask *task)
+gimp_parallel_run_async_free_task (GimpParallelRunAsyncTask *task)
 {
-  if (task->user_data && task->user_data_destroy_func)
-    task->user_data_destroy_func (task->user_data);
-
-  gimp_async_abort (task->async);
+  gboolean child = task->child;
 
   g_object_unref (task->async);
+  g_clear_object (&task->parent);
 
   g_slice_free (GimpParallelRunAsyncTask, task);
+
+  if (child)
+    gimp_parallel_run_async_notify_child ();
 }
 
 static void
-gimp_parallel_run_async_cancel (GimpAsync *async)
+gimp_parallel_run_async_abort_task (GimpParallelRunAsyncTask *task)
 {
-  GList                    *link;
-  GimpParallelRunAsyncTask *task = NULL;
-
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
-
-  if (! link)
-    return;
+  if (task->user_data && task->user_data_destroy_func)
+    task->user_data_destroy_func (task->user_data);
 
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
+  gimp_async_abort (task->async);
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  gimp_parallel_run_async_free_task (task);
+}
 
-  if (link)
+/* wakes up the threads in gimp_parallel_run_async_child_wait(), after a child
+ * task stopped, or was requeued.  this only takes the global mutex if there
+ * are any such threads.
+ */
+static void
+gimp_parallel_run_async_notify_child (void)
+{
+  if (g_atomic_int_get (&gimp_parallel_run_async_n_child_waiters) > 0)
     {
-      g_object_set_data (G_OBJECT (async),
-                         "gimp-parallel-run-async-link", NULL);
+      g_mutex_lock (&gimp_parallel_run_async_mutex);
 
-      task = (GimpParallelRunAsyncTask *) link->data;
+      g_cond_broadcast (&gimp_parallel_run_async_child_cond);
 
-      g_queue_delete_link (&gimp_parallel_run_async_queue, link);
+      g_mutex_unlock (&gimp_parallel_run_async_mutex);
     }
+}
 
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
+static void
+gimp_parallel_run_async_cancel (GimpAsync *async)
+{
+  GimpParallelRunAsyncTask *task;
+
+  task = gimp_parallel_run_async_unlink_task (async);
 
   if (task)
     gimp_parallel_run_async_abort_task (task);
@@ -524,30 +1027,27 @@ gimp_parallel_run_async_cancel (GimpAsync *async)
 static void
 gimp_parallel_run_async_waiting (GimpAsync *async)
 {
-  GList *link;
-
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
-
-  if (! link)
-    return;
+  GimpParallelRunAsyncTask *task;
 
-  g_mutex_lock (&gimp_parallel_run_async_mutex);
+  /* if the task is currently running, make sure it's pushed to the front of
+   * the queue if it yields.
+   */
+  g_object_set_data (G_OBJECT (async),
+                     "gimp-parallel-run-async-waiting", GINT_TO_POINTER (TRUE));
 
-  link = (GList *) g_object_get_data (G_OBJECT (async),
-                                      "gimp-parallel-run-async-link");
+  task = gimp_parallel_run_async_unlink_task (async);
 
-  if (link)
+  if (task)
     {
-      GimpParallelRunAsyncTask *task = (GimpParallelRunAsyncTask *) link->data;
-
       task->priority = G_MININT;
 
-      g_queue_unlink         (&gimp_parallel_run_async_queue, link);
-      g_queue_push_head_link (&gimp_parallel_run_async_queue, link);
+      /* requeue the task at the front of a queue.  "waiting" is only
+       * emitted by gimp_waitable_wait(), which is never called on the worker
+       * threads -- they use gimp_parallel_run_async_child_wait() instead, so
+       * the task can't land on the blocked thread.
+       */
+      gimp_parallel_run_async_enqueue_task (task, NULL);
     }
-
-  g_mutex_unlock (&gimp_parallel_run_async_mutex);
 }
 
 } /* extern "C" */
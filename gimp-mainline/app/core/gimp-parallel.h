@@ -31,6 +31,14 @@ GimpAsync * gimp_parallel_run_async_full             (gint              priority
                                                       GimpRunAsyncFunc  func,
                                                       gpointer          user_data,
                                                       GDestroyNotify    user_data_destroy_func);
+GimpAsync * gimp_parallel_run_async_child            (GimpAsync        *parent,
+                                                      GimpRunAsyncFunc  func,
+                                                      gpointer          user_data);
+GimpAsync * gimp_parallel_run_async_child_full       (GimpAsync        *parent,
+                                                      GimpRunAsyncFunc  func,
+                                                      gpointer          user_data,
+                                                      GDestroyNotify    user_data_destroy_func);
+void        gimp_parallel_run_async_child_wait       (GimpAsync        *child);
 GimpAsync * gimp_parallel_run_async_independent      (GimpRunAsyncFunc  func,
                                                       gpointer          user_data);
 GimpAsync * gimp_parallel_run_async_independent_full (gint              priority,
@@ -118,6 +126,38 @@ gimp_parallel_run_async_full (gint         priority,
                                        });
 }
 
+template <class RunAsyncFunc>
+inline GimpAsync *
+gimp_parallel_run_async_child (GimpAsync    *parent,
+                               RunAsyncFunc  func)
+{
+  RunAsyncFunc *func_copy = g_new (RunAsyncFunc, 1);
+
+  new (func_copy) RunAsyncFunc (func);
+
+  return gimp_parallel_run_async_child_full (parent,
+                                             [] (GimpAsync *async,
+                                                 gpointer   user_data)
+                                             {
+                                               RunAsyncFunc *func_copy =
+                                                 (RunAsyncFunc *) user_data;
+
+                                               (*func_copy) (async);
+
+                                               func_copy->~RunAsyncFunc ();
+                                               g_free (func_copy);
+                                             },
+                                             func_copy,
+                                             [] (gpointer user_data)
+                                             {
+                                               RunAsyncFunc *func_copy =
+                                                 (RunAsyncFunc *) user_data;
+
+                                               func_copy->~RunAsyncFunc ();
+                                               g_free (func_copy);
+                                             });
+}
+
 template <class RunAsyncFunc>
 inline GimpAsync *
 gimp_parallel_run_async_independent_full (gint         priority,
@@ -42,6 +42,7 @@
 #include "paint/gimp-paint.h"
 
 #include "xcf/xcf.h"
+#include "xcf/xcf-autosave.h"
 #include "file-data/file-data.h"
 
 #include "gimp.h"
@@ -565,6 +566,8 @@ gimp_real_restore (Gimp               *gimp,
   status_callback (_("Initialization"), "Babl Fishes", 0.0);
   gimp_babl_init_fishes (status_callback);
 
+  xcf_autosave_init (gimp);
+
   gimp->restored = TRUE;
 }
 
@@ -575,6 +578,10 @@ gimp_real_exit (Gimp     *gimp,
   if (gimp->be_verbose)
     g_print ("EXIT: %s\n", G_STRFUNC);
 
+  /* don't leave files half written */
+  xcf_save_wait (gimp);
+  xcf_autosave_exit (gimp);
+
   gimp_plug_in_manager_exit (gimp->plug_in_manager);
   gimp_extension_manager_exit (gimp->extension_manager);
   gimp_modules_unload (gimp);
@@ -38,7 +38,7 @@ gimp_brush_transform_boundary_exact (GimpBrush *brush,
                                      gboolean   reflect,
                                      gdouble    hardness)
 {
-  const GimpTempBuf *mask;
+  GimpTempBuf *mask;
 
   mask = gimp_brush_transform_mask (brush,
                                     scale, aspect_ratio,
@@ -50,7 +50,7 @@ gimp_brush_transform_boundary_exact (GimpBrush *brush,
       GimpBoundSeg  *bound_segs;
       gint           n_bound_segs;
 
-      buffer = gimp_temp_buf_create_buffer ((GimpTempBuf *) mask);
+      buffer = gimp_temp_buf_create_buffer (mask);
 
       bound_segs = gimp_boundary_find (buffer, NULL,
                                        babl_format ("Y float"),
@@ -62,6 +62,7 @@ gimp_brush_transform_boundary_exact (GimpBrush *brush,
                                        &n_bound_segs);
 
       g_object_unref (buffer);
+      gimp_temp_buf_unref (mask);
 
       if (bound_segs)
         {
@@ -30,6 +30,8 @@
 #include "gimpbrush-header.h"
 #include "gimpbrush-load.h"
 #include "gimpbrush-private.h"
+#include "gimpcontext.h"
+#include "gimpdataloaderfactory.h"
 #include "gimppattern-header.h"
 #include "gimptempbuf.h"
 
@@ -68,6 +70,12 @@ struct _AbrSampledBrushHeader
 
 /*  local function prototypes  */
 
+static gboolean    gimp_brush_load_header        (GFile             *file,
+                                                  GInputStream      *input,
+                                                  GimpBrushHeader   *header,
+                                                  gchar            **name,
+                                                  GError           **error);
+
 static GList     * gimp_brush_load_abr_v12       (GDataInputStream  *input,
                                                   AbrHeader         *abr_hdr,
                                                   GFile             *file,
@@ -116,167 +124,111 @@ gimp_brush_load (GimpContext   *context,
                  GInputStream  *input,
                  GError       **error)
 {
-  GimpBrush *brush;
+  GimpBrush       *brush;
+  GimpBrushHeader  header;
+  gchar           *name;
 
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
   g_return_val_if_fail (G_IS_FILE (file), NULL);
   g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  brush = gimp_brush_load_brush (context, file, input, error);
-  if (! brush)
+  /*  only read the header here, the pixels are loaded by
+   *  gimp_brush_load_contents() when the brush is first used
+   */
+  if (! gimp_brush_load_header (file, input, &header, &name, error))
     return NULL;
 
-  return g_list_prepend (NULL, brush);
-}
+  brush = g_object_new (GIMP_TYPE_BRUSH,
+                        "name",      name,
+                        "mime-type", "image/x-gimp-gbr",
+                        NULL);
+  g_free (name);
 
-GimpBrush *
-gimp_brush_load_brush (GimpContext   *context,
-                       GFile         *file,
-                       GInputStream  *input,
-                       GError       **error)
-{
-  GimpBrush       *brush;
-  gsize            bn_size;
-  GimpBrushHeader  header;
-  gchar           *name = NULL;
-  guchar          *mask;
-  gsize            bytes_read;
-  gssize           i, size;
-  gboolean         success = TRUE;
+  brush->priv->lazy_width  = header.width;
+  brush->priv->lazy_height = header.height;
 
-  g_return_val_if_fail (G_IS_FILE (file), NULL);
-  g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+  brush->priv->spacing  = header.spacing;
+  brush->priv->x_axis.x = header.width  / 2.0;
+  brush->priv->x_axis.y = 0.0;
+  brush->priv->y_axis.x = 0.0;
+  brush->priv->y_axis.y = header.height / 2.0;
 
-  /*  read the header  */
-  if (! g_input_stream_read_all (input, &header, sizeof (header),
-                                 &bytes_read, NULL, error) ||
-      bytes_read != sizeof (header))
-    {
-      return NULL;
-    }
+  gimp_data_set_lazy (GIMP_DATA (brush), context->gimp);
 
-  /*  rearrange the bytes in each unsigned int  */
-  header.header_size  = g_ntohl (header.header_size);
-  header.version      = g_ntohl (header.version);
-  header.width        = g_ntohl (header.width);
-  header.height       = g_ntohl (header.height);
-  header.bytes        = g_ntohl (header.bytes);
-  header.magic_number = g_ntohl (header.magic_number);
-  header.spacing      = g_ntohl (header.spacing);
+  return g_list_prepend (NULL, brush);
+}
 
-  /*  Check for correct file format */
+gboolean
+gimp_brush_load_contents (GimpData  *data,
+                          GError   **error)
+{
+  GimpBrush    *brush = GIMP_BRUSH (data);
+  GFile        *file;
+  GInputStream *input;
+  GimpBrush    *loaded = NULL;
 
-  if (header.width == 0)
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file: Width = 0."));
-      return NULL;
-    }
+  g_return_val_if_fail (GIMP_IS_BRUSH (brush), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-  if (header.height == 0)
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file: Height = 0."));
-      return NULL;
-    }
+  file  = gimp_data_get_file (data);
+  input = G_INPUT_STREAM (g_file_read (file, NULL, error));
 
-  if (header.bytes == 0)
+  if (input)
     {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file: Bytes = 0."));
-      return NULL;
-    }
+      GInputStream *buffered = g_buffered_input_stream_new (input);
 
-  if (header.width  > GIMP_BRUSH_MAX_SIZE ||
-      header.height > GIMP_BRUSH_MAX_SIZE ||
-      G_MAXSIZE / header.width / header.height / MAX (4, header.bytes) < 1)
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file: %dx%d over max size."),
-                   header.width, header.height);
-      return NULL;
+      loaded = gimp_brush_load_brush (NULL, file, buffered, error);
+
+      g_object_unref (buffered);
+      g_object_unref (input);
     }
 
-  switch (header.version)
+  if (! loaded)
     {
-    case 1:
-      /*  If this is a version 1 brush, set the fp back 8 bytes  */
-      if (! g_seekable_seek (G_SEEKABLE (input), -8, G_SEEK_CUR,
-                             NULL, error))
-        return NULL;
-
-      header.header_size += 8;
-      /*  spacing is not defined in version 1  */
-      header.spacing = 25;
-      break;
-
-    case 3:  /*  cinepaint brush  */
-      if (header.bytes == 18  /* FLOAT16_GRAY_GIMAGE */)
-        {
-          header.bytes = 2;
-        }
-      else
-        {
-          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                       _("Fatal parse error in brush file: Unknown depth %d."),
-                       header.bytes);
-          return NULL;
-        }
-      /*  fallthrough  */
+      /*  keep the brush usable, it may have changed on disk  */
+      brush->priv->mask = gimp_temp_buf_new (brush->priv->lazy_width,
+                                             brush->priv->lazy_height,
+                                             babl_format ("Y u8"));
+      gimp_temp_buf_data_clear (brush->priv->mask);
 
-    case 2:
-      if (header.magic_number == GIMP_BRUSH_MAGIC)
-        break;
+      g_prefix_error (error, _("Error loading '%s': "),
+                      gimp_file_get_utf8_name (file));
 
-    default:
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file: Unknown version %d."),
-                   header.version);
-      return NULL;
+      return FALSE;
     }
 
-  if (header.header_size < sizeof (GimpBrushHeader))
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Unsupported brush format"));
-      return NULL;
-    }
+  brush->priv->mask   = g_steal_pointer (&loaded->priv->mask);
+  brush->priv->pixmap = g_steal_pointer (&loaded->priv->pixmap);
 
-  /*  Read in the brush name  */
-  if ((bn_size = (header.header_size - sizeof (header))))
-    {
-      gchar *utf8;
+  brush->priv->lazy_width  = gimp_temp_buf_get_width  (brush->priv->mask);
+  brush->priv->lazy_height = gimp_temp_buf_get_height (brush->priv->mask);
 
-      if (bn_size > GIMP_BRUSH_MAX_NAME)
-        {
-          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                       _("Invalid header data in '%s': "
-                         "Brush name is too long: %lu"),
-                       gimp_file_get_utf8_name (file),
-                       (gulong) bn_size);
-          return NULL;
-        }
+  g_object_unref (loaded);
 
-      name = g_new0 (gchar, bn_size + 1);
+  return TRUE;
+}
 
-      if (! g_input_stream_read_all (input, name, bn_size,
-                                     &bytes_read, NULL, error) ||
-          bytes_read != bn_size)
-        {
-          g_free (name);
-          return NULL;
-        }
+GimpBrush *
+gimp_brush_load_brush (GimpContext   *context,
+                       GFile         *file,
+                       GInputStream  *input,
+                       GError       **error)
+{
+  GimpBrush       *brush;
+  GimpBrushHeader  header;
+  gchar           *name;
+  guchar          *mask;
+  gsize            bytes_read;
+  gssize           i, size;
+  gboolean         success = TRUE;
 
-      utf8 = gimp_any_to_utf8 (name, bn_size - 1,
-                               _("Invalid UTF-8 string in brush file '%s'."),
-                               gimp_file_get_utf8_name (file));
-      g_free (name);
-      name = utf8;
-    }
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  if (! name)
-    name = g_strdup (_("Unnamed"));
+  if (! gimp_brush_load_header (file, input, &header, &name, error))
+    return NULL;
 
   brush = g_object_new (GIMP_TYPE_BRUSH,
                         "name",      name,
@@ -437,13 +389,9 @@ gimp_brush_load_brush (GimpContext   *context,
       break;
 
     default:
+      /*  rejected by gimp_brush_load_header()  */
       g_object_unref (brush);
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Fatal parse error in brush file:\n"
-                     "Unsupported brush depth %d\n"
-                     "GIMP brushes must be GRAY or RGBA."),
-                   header.bytes);
-      return NULL;
+      g_return_val_if_reached (NULL);
     }
 
   if (! success)
@@ -529,6 +477,162 @@ gimp_brush_load_abr (GimpContext   *context,
 
 /*  private functions  */
 
+static gboolean
+gimp_brush_load_header (GFile            *file,
+                        GInputStream     *input,
+                        GimpBrushHeader  *header,
+                        gchar           **name,
+                        GError          **error)
+{
+  gsize bn_size;
+  gsize bytes_read;
+
+  *name = NULL;
+
+  /*  read the header  */
+  if (! g_input_stream_read_all (input, header, sizeof (GimpBrushHeader),
+                                 &bytes_read, NULL, error) ||
+      bytes_read != sizeof (GimpBrushHeader))
+    {
+      return FALSE;
+    }
+
+  /*  rearrange the bytes in each unsigned int  */
+  header->header_size  = g_ntohl (header->header_size);
+  header->version      = g_ntohl (header->version);
+  header->width        = g_ntohl (header->width);
+  header->height       = g_ntohl (header->height);
+  header->bytes        = g_ntohl (header->bytes);
+  header->magic_number = g_ntohl (header->magic_number);
+  header->spacing      = g_ntohl (header->spacing);
+
+  /*  Check for correct file format */
+
+  if (header->width == 0)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file: Width = 0."));
+      return FALSE;
+    }
+
+  if (header->height == 0)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file: Height = 0."));
+      return FALSE;
+    }
+
+  if (header->bytes == 0)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file: Bytes = 0."));
+      return FALSE;
+    }
+
+  if (header->width  > GIMP_BRUSH_MAX_SIZE ||
+      header->height > GIMP_BRUSH_MAX_SIZE ||
+      G_MAXSIZE / header->width / header->height / MAX (4, header->bytes) < 1)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file: %dx%d over max size."),
+                   header->width, header->height);
+      return FALSE;
+    }
+
+  switch (header->version)
+    {
+    case 1:
+      /*  If this is a version 1 brush, set the fp back 8 bytes  */
+      if (! g_seekable_seek (G_SEEKABLE (input), -8, G_SEEK_CUR,
+                             NULL, error))
+        return FALSE;
+
+      header->header_size += 8;
+      /*  spacing is not defined in version 1  */
+      header->spacing = 25;
+      break;
+
+    case 3:  /*  cinepaint brush  */
+      if (header->bytes == 18  /* FLOAT16_GRAY_GIMAGE */)
+        {
+          header->bytes = 2;
+        }
+      else
+        {
+          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                       _("Fatal parse error in brush file: Unknown depth %d."),
+                       header->bytes);
+          return FALSE;
+        }
+      /*  fallthrough  */
+
+    case 2:
+      if (header->magic_number == GIMP_BRUSH_MAGIC)
+        break;
+
+    default:
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file: Unknown version %d."),
+                   header->version);
+      return FALSE;
+    }
+
+  if (header->bytes != 1 && header->bytes != 2 && header->bytes != 4)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file:\n"
+                     "Unsupported brush depth %d\n"
+                     "GIMP brushes must be GRAY or RGBA."),
+                   header->bytes);
+      return FALSE;
+    }
+
+  if (header->header_size < sizeof (GimpBrushHeader))
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Unsupported brush format"));
+      return FALSE;
+    }
+
+  /*  Read in the brush name  */
+  if ((bn_size = (header->header_size - sizeof (GimpBrushHeader))))
+    {
+      gchar *utf8;
+
+      if (bn_size > GIMP_BRUSH_MAX_NAME)
+        {
+          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                       _("Invalid header data in '%s': "
+                         "Brush name is too long: %lu"),
+                       gimp_file_get_utf8_name (file),
+                       (gulong) bn_size);
+          return FALSE;
+        }
+
+      *name = g_new0 (gchar, bn_size + 1);
+
+      if (! g_input_stream_read_all (input, *name, bn_size,
+                                     &bytes_read, NULL, error) ||
+          bytes_read != bn_size)
+        {
+          g_clear_pointer (name, g_free);
+          return FALSE;
+        }
+
+      utf8 = gimp_data_loader_factory_any_to_utf8 (
+               *name, bn_size - 1,
+               _("Invalid UTF-8 string in brush file '%s'."),
+               gimp_file_get_utf8_name (file));
+      g_free (*name);
+      *name = utf8;
+    }
+
+  if (! *name)
+    *name = g_strdup (_("Unnamed"));
+
+  return TRUE;
+}
+
 static GList *
 gimp_brush_load_abr_v12 (GDataInputStream  *input,
                          AbrHeader         *abr_hdr,
@@ -26,6 +26,9 @@ struct _GimpBrushPrivate
   GimpTempBuf     *pixmap;         /*  optional pixmap data               */
   GimpTempBuf     *blurred_pixmap;  /*  optional pixmap data blurred cache  */
 
+  gint             lazy_width;      /*  mask size while it isn't loaded     */
+  gint             lazy_height;
+
   gdouble          blur_hardness;
 
   gint             n_horz_mipmaps;
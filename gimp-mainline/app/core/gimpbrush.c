@@ -43,6 +43,12 @@
 #include "gimp-intl.h"
 
 
+/*  how far, in pixels, quantizing the transform parameters may move
+ *  the outline of the transformed brush
+ */
+#define QUANTIZE_PRECISION 0.25
+
+
 enum
 {
   SPACING_CHANGED,
@@ -85,6 +91,7 @@ static void          gimp_brush_dirty                 (GimpData             *dat
 static const gchar * gimp_brush_get_extension         (GimpData             *data);
 static void          gimp_brush_copy                  (GimpData             *data,
                                                        GimpData             *src_data);
+static gboolean      gimp_brush_unload_contents       (GimpData             *data);
 
 static void          gimp_brush_real_begin_use        (GimpBrush            *brush);
 static void          gimp_brush_real_end_use          (GimpBrush            *brush);
@@ -97,6 +104,15 @@ static gboolean      gimp_brush_real_want_null_motion (GimpBrush            *bru
 
 static gchar       * gimp_brush_get_checksum          (GimpTagged           *tagged);
 
+static void          gimp_brush_get_mask_size         (GimpBrush            *brush,
+                                                       gint                 *width,
+                                                       gint                 *height);
+static void          gimp_brush_quantize_transform    (GimpBrush            *brush,
+                                                       gdouble              *scale,
+                                                       gdouble              *aspect_ratio,
+                                                       gdouble              *angle,
+                                                       gdouble              *hardness);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpBrush, gimp_brush, GIMP_TYPE_DATA,
                          G_ADD_PRIVATE (GimpBrush)
@@ -139,6 +155,8 @@ gimp_brush_class_init (GimpBrushClass *klass)
   data_class->save                  = gimp_brush_save;
   data_class->get_extension         = gimp_brush_get_extension;
   data_class->copy                  = gimp_brush_copy;
+  data_class->load_contents         = gimp_brush_load_contents;
+  data_class->unload_contents       = gimp_brush_unload_contents;
 
   klass->begin_use                  = gimp_brush_real_begin_use;
   klass->end_use                    = gimp_brush_real_end_use;
@@ -260,8 +278,7 @@ gimp_brush_get_size (GimpViewable *viewable,
 {
   GimpBrush *brush = GIMP_BRUSH (viewable);
 
-  *width  = gimp_temp_buf_get_width  (brush->priv->mask);
-  *height = gimp_temp_buf_get_height (brush->priv->mask);
+  gimp_brush_get_mask_size (brush, width, height);
 
   return TRUE;
 }
@@ -273,8 +290,8 @@ gimp_brush_get_new_preview (GimpViewable *viewable,
                             gint          height)
 {
   GimpBrush         *brush       = GIMP_BRUSH (viewable);
-  const GimpTempBuf *mask_buf    = brush->priv->mask;
-  const GimpTempBuf *pixmap_buf  = brush->priv->pixmap;
+  const GimpTempBuf *mask_buf;
+  const GimpTempBuf *pixmap_buf;
   GimpTempBuf       *return_buf  = NULL;
   gint               mask_width;
   gint               mask_height;
@@ -284,6 +301,11 @@ gimp_brush_get_new_preview (GimpViewable *viewable,
   gint               x, y;
   gboolean           scaled = FALSE;
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
+  mask_buf   = brush->priv->mask;
+  pixmap_buf = brush->priv->pixmap;
+
   mask_width  = gimp_temp_buf_get_width  (mask_buf);
   mask_height = gimp_temp_buf_get_height (mask_buf);
 
@@ -392,11 +414,14 @@ gimp_brush_get_description (GimpViewable  *viewable,
                             gchar        **tooltip)
 {
   GimpBrush *brush = GIMP_BRUSH (viewable);
+  gint       width;
+  gint       height;
+
+  gimp_brush_get_mask_size (brush, &width, &height);
 
   return g_strdup_printf ("%s (%d × %d)",
                           gimp_object_get_name (brush),
-                          gimp_temp_buf_get_width  (brush->priv->mask),
-                          gimp_temp_buf_get_height (brush->priv->mask));
+                          width, height);
 }
 
 static void
@@ -449,17 +474,38 @@ gimp_brush_copy (GimpData *data,
   gimp_data_dirty (data);
 }
 
+static gboolean
+gimp_brush_unload_contents (GimpData *data)
+{
+  GimpBrush *brush = GIMP_BRUSH (data);
+
+  if (brush->priv->use_count > 0)
+    return FALSE;
+
+  gimp_brush_mipmap_clear (brush);
+
+  g_clear_pointer (&brush->priv->mask,           gimp_temp_buf_unref);
+  g_clear_pointer (&brush->priv->pixmap,         gimp_temp_buf_unref);
+  g_clear_pointer (&brush->priv->blurred_mask,   gimp_temp_buf_unref);
+  g_clear_pointer (&brush->priv->blurred_pixmap, gimp_temp_buf_unref);
+
+  return TRUE;
+}
+
 static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
   brush->priv->mask_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
+    gimp_brush_cache_new ((GBoxedCopyFunc) gimp_temp_buf_ref,
+                          (GDestroyNotify) gimp_temp_buf_unref, 'M', 'm');
 
   brush->priv->pixmap_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
+    gimp_brush_cache_new ((GBoxedCopyFunc) gimp_temp_buf_ref,
+                          (GDestroyNotify) gimp_temp_buf_unref, 'P', 'p');
 
   brush->priv->boundary_cache =
-    gimp_brush_cache_new ((GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
+    gimp_brush_cache_new ((GBoxedCopyFunc) gimp_bezier_desc_copy,
+                          (GDestroyNotify) gimp_bezier_desc_free, 'B', 'b');
 }
 
 static void
@@ -495,6 +541,8 @@ gimp_brush_get_checksum (GimpTagged *tagged)
   GimpBrush *brush           = GIMP_BRUSH (tagged);
   gchar     *checksum_string = NULL;
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
   if (brush->priv->mask)
     {
       GChecksum *checksum = g_checksum_new (G_CHECKSUM_MD5);
@@ -524,6 +572,91 @@ gimp_brush_get_checksum (GimpTagged *tagged)
   return checksum_string;
 }
 
+static void
+gimp_brush_get_mask_size (GimpBrush *brush,
+                          gint      *width,
+                          gint      *height)
+{
+  /*  don't load lazy contents just to learn their size  */
+  if (brush->priv->mask)
+    {
+      *width  = gimp_temp_buf_get_width  (brush->priv->mask);
+      *height = gimp_temp_buf_get_height (brush->priv->mask);
+    }
+  else
+    {
+      *width  = brush->priv->lazy_width;
+      *height = brush->priv->lazy_height;
+    }
+}
+
+static gdouble
+gimp_brush_quantize (gdouble value,
+                     gdouble step)
+{
+  gint exponent;
+
+  /*  round the step down to a power of two, so that values like 0.0,
+   *  0.5 and 1.0, which have fast paths, stay exact
+   */
+  frexp (step, &exponent);
+  step = ldexp (1.0, exponent - 1);
+
+  /*  adding 0.0 turns -0.0 into 0.0  */
+  return RINT (value / step) * step + 0.0;
+}
+
+/*  dynamics produce slightly different transform parameters for
+ *  almost every dab, which would always miss the transform caches.
+ *  Snap them to a grid that is just fine enough not to move the
+ *  brush outline by more than QUANTIZE_PRECISION pixels.
+ */
+static void
+gimp_brush_quantize_transform (GimpBrush *brush,
+                               gdouble   *scale,
+                               gdouble   *aspect_ratio,
+                               gdouble   *angle,
+                               gdouble   *hardness)
+{
+  gint    width;
+  gint    height;
+  gdouble size;
+  gdouble quantized;
+
+  gimp_brush_get_mask_size (brush, &width, &height);
+
+  size = MAX (width, height);
+
+  if (size < 1.0)
+    return;
+
+  quantized = gimp_brush_quantize (*scale, QUANTIZE_PRECISION / size);
+
+  if (quantized > 0.0)
+    *scale = quantized;
+
+  size = MAX (size * *scale, 1.0);
+
+  /*  aspect_ratio is in [-20, 20] and stretches each side by up to
+   *  its whole length
+   */
+  *aspect_ratio = gimp_brush_quantize (*aspect_ratio,
+                                       MIN (20.0 * QUANTIZE_PRECISION / size,
+                                            1.0));
+
+  /*  angle is in turns, a turn moves the outline by pi * size pixels  */
+  *angle = *angle - floor (*angle);
+  *angle = gimp_brush_quantize (*angle,
+                                MIN (QUANTIZE_PRECISION / (G_PI * size),
+                                     1.0 / 256.0));
+
+  if (*angle >= 1.0)
+    *angle -= 1.0;
+
+  if (hardness)
+    *hardness = gimp_brush_quantize (*hardness, 1.0 / 256.0);
+}
+
 /*  public functions  */
 
 GimpData *
@@ -561,6 +694,9 @@ gimp_brush_begin_use (GimpBrush *brush)
 {
   g_return_if_fail (GIMP_IS_BRUSH (brush));
 
+  /*  load lazy contents here, before any paint thread needs them  */
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
   brush->priv->use_count++;
 
   if (brush->priv->use_count == 1)
@@ -621,22 +757,31 @@ gimp_brush_transform_size (GimpBrush     *brush,
   g_return_if_fail (width != NULL);
   g_return_if_fail (height != NULL);
 
+  gimp_brush_quantize_transform (brush, &scale, &aspect_ratio, &angle, NULL);
+
   if (scale             == 1.0 &&
       aspect_ratio      == 0.0 &&
       fmod (angle, 0.5) == 0.0)
     {
-      *width  = gimp_temp_buf_get_width  (brush->priv->mask);
-      *height = gimp_temp_buf_get_height (brush->priv->mask);
+      gimp_brush_get_mask_size (brush, width, height);
 
       return;
     }
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
   GIMP_BRUSH_GET_CLASS (brush)->transform_size (brush,
                                                 scale, aspect_ratio, angle, reflect,
                                                 width, height);
 }
 
-const GimpTempBuf *
+/*  the transform_mask(), transform_pixmap() and transform_boundary()
+ *  results are shared with the brush's caches, which may be used from
+ *  other threads.  the caller owns a reference to the returned mask and
+ *  pixmap, and a copy of the returned boundary.
+ */
+
+GimpTempBuf *
 gimp_brush_transform_mask (GimpBrush *brush,
                            gdouble    scale,
                            gdouble    aspect_ratio,
@@ -644,14 +789,20 @@ gimp_brush_transform_mask (GimpBrush *brush,
                            gboolean   reflect,
                            gdouble    hardness)
 {
-  const GimpTempBuf *mask;
-  gint               width;
-  gint               height;
-  gdouble            effective_hardness = hardness;
+  GimpTempBuf *mask;
+  gint         width;
+  gint         height;
+  gdouble      effective_hardness = hardness;
 
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
   g_return_val_if_fail (scale > 0.0, NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+  effective_hardness = hardness;
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              &width, &height);
@@ -694,16 +845,18 @@ gimp_brush_transform_mask (GimpBrush *brush,
                                                            reflect,
                                                            effective_hardness);
 
-      gimp_brush_cache_add (brush->priv->mask_cache,
-                            (gpointer) mask,
-                            width, height,
-                            scale, aspect_ratio, angle, reflect, effective_hardness);
+      mask = gimp_brush_cache_add (brush->priv->mask_cache,
+                                   mask,
+                                   gimp_temp_buf_get_memsize (mask),
+                                   width, height,
+                                   scale, aspect_ratio, angle, reflect,
+                                   effective_hardness);
     }
 
   return mask;
 }
 
-const GimpTempBuf *
+GimpTempBuf *
 gimp_brush_transform_pixmap (GimpBrush *brush,
                              gdouble    scale,
                              gdouble    aspect_ratio,
@@ -711,15 +864,22 @@ gimp_brush_transform_pixmap (GimpBrush *brush,
                              gboolean   reflect,
                              gdouble    hardness)
 {
-  const GimpTempBuf *pixmap;
-  gint               width;
-  gint               height;
-  gdouble            effective_hardness = hardness;
+  GimpTempBuf *pixmap;
+  gint         width;
+  gint         height;
+  gdouble      effective_hardness = hardness;
 
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
-  g_return_val_if_fail (brush->priv->pixmap != NULL, NULL);
   g_return_val_if_fail (scale > 0.0, NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
+  g_return_val_if_fail (brush->priv->pixmap != NULL, NULL);
+
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+  effective_hardness = hardness;
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              &width, &height);
@@ -757,16 +917,18 @@ gimp_brush_transform_pixmap (GimpBrush *brush,
                                                                reflect,
                                                                effective_hardness);
 
-      gimp_brush_cache_add (brush->priv->pixmap_cache,
-                            (gpointer) pixmap,
-                            width, height,
-                            scale, aspect_ratio, angle, reflect, effective_hardness);
+      pixmap = gimp_brush_cache_add (brush->priv->pixmap_cache,
+                                     pixmap,
+                                     gimp_temp_buf_get_memsize (pixmap),
+                                     width, height,
+                                     scale, aspect_ratio, angle, reflect,
+                                     effective_hardness);
     }
 
   return pixmap;
 }
 
-const GimpBezierDesc *
+GimpBezierDesc *
 gimp_brush_transform_boundary (GimpBrush *brush,
                                gdouble    scale,
                                gdouble    aspect_ratio,
@@ -776,13 +938,18 @@ gimp_brush_transform_boundary (GimpBrush *brush,
                                gint      *width,
                                gint      *height)
 {
-  const GimpBezierDesc *boundary;
+  GimpBezierDesc *boundary;
 
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
   g_return_val_if_fail (scale > 0.0, NULL);
   g_return_val_if_fail (width != NULL, NULL);
   g_return_val_if_fail (height != NULL, NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
+  gimp_brush_quantize_transform (brush,
+                                 &scale, &aspect_ratio, &angle, &hardness);
+
   gimp_brush_transform_size (brush,
                              scale, aspect_ratio, angle, reflect,
                              width, height);
@@ -809,10 +976,14 @@ gimp_brush_transform_boundary (GimpBrush *brush,
        *         properly implemented
        */
       if (boundary)
-        gimp_brush_cache_add (brush->priv->boundary_cache,
-                              (gpointer) boundary,
-                              *width, *height,
-                              scale, aspect_ratio, angle, reflect, hardness);
+        boundary = gimp_brush_cache_add (brush->priv->boundary_cache,
+                                         boundary,
+                                         sizeof (GimpBezierDesc) +
+                                         boundary->num_data *
+                                         sizeof (cairo_path_data_t),
+                                         *width, *height,
+                                         scale, aspect_ratio, angle, reflect,
+                                         hardness);
     }
 
   return boundary;
@@ -824,6 +995,8 @@ gimp_brush_get_mask (GimpBrush *brush)
   g_return_val_if_fail (brush != NULL, NULL);
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
   if (brush->priv->blurred_mask)
     {
       return brush->priv->blurred_mask;
@@ -837,6 +1010,8 @@ gimp_brush_get_pixmap (GimpBrush *brush)
   g_return_val_if_fail (brush != NULL, NULL);
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (brush));
+
   if(brush->priv->blurred_pixmap)
     {
       return brush->priv->blurred_pixmap;
@@ -873,6 +1048,9 @@ gimp_brush_get_blur_hardness (GimpBrush *brush)
 gint
 gimp_brush_get_width (GimpBrush *brush)
 {
+  gint width;
+  gint height;
+
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), 0);
 
   if (brush->priv->blurred_mask)
@@ -881,12 +1059,17 @@ gimp_brush_get_width (GimpBrush *brush)
   if (brush->priv->blurred_pixmap)
     return gimp_temp_buf_get_width (brush->priv->blurred_pixmap);
 
-  return gimp_temp_buf_get_width (brush->priv->mask);
+  gimp_brush_get_mask_size (brush, &width, &height);
+
+  return width;
 }
 
 gint
 gimp_brush_get_height (GimpBrush *brush)
 {
+  gint width;
+  gint height;
+
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), 0);
 
   if (brush->priv->blurred_mask)
@@ -895,7 +1078,9 @@ gimp_brush_get_height (GimpBrush *brush)
   if (brush->priv->blurred_pixmap)
     return gimp_temp_buf_get_height (brush->priv->blurred_pixmap);
 
-  return gimp_temp_buf_get_height (brush->priv->mask);
+  gimp_brush_get_mask_size (brush, &width, &height);
+
+  return height;
 }
 
 gint
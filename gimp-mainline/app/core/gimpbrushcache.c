@@ -27,18 +27,25 @@
 
 #include "core-types.h"
 
+#include "gimp-memsize.h"
 #include "gimpbrushcache.h"
 
 #include "gimp-log.h"
 #include "gimp-intl.h"
 
 
-#define MAX_CACHED_DATA 20
+/*  the cache's memory budget may only push out units as long as at
+ *  least this many are left, so a few big transforms can't push out
+ *  the whole working set of a stroke
+ */
+#define MIN_CACHED_DATA  20
+#define MAX_CACHED_SIZE  (16 << 20)  /*  16 MiB  */
 
 
 enum
 {
   PROP_0,
+  PROP_DATA_COPY,
   PROP_DATA_DESTROY
 };
 
@@ -47,28 +54,39 @@ typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
 
 struct _GimpBrushCacheUnit
 {
-  gpointer data;
-
-  gint     width;
-  gint     height;
-  gdouble  scale;
-  gdouble  aspect_ratio;
-  gdouble  angle;
-  gboolean reflect;
-  gdouble  hardness;
+  gpointer  data;
+  gsize     size;
+  GList    *link;
+
+  gint      width;
+  gint      height;
+  gdouble   scale;
+  gdouble   aspect_ratio;
+  gdouble   angle;
+  gboolean  reflect;
+  gdouble   hardness;
 };
 
 
-static void   gimp_brush_cache_constructed  (GObject      *object);
-static void   gimp_brush_cache_finalize     (GObject      *object);
-static void   gimp_brush_cache_set_property (GObject      *object,
-                                             guint         property_id,
-                                             const GValue *value,
-                                             GParamSpec   *pspec);
-static void   gimp_brush_cache_get_property (GObject      *object,
-                                             guint         property_id,
-                                             GValue       *value,
-                                             GParamSpec   *pspec);
+static void     gimp_brush_cache_constructed  (GObject            *object);
+static void     gimp_brush_cache_finalize     (GObject            *object);
+static void     gimp_brush_cache_set_property (GObject            *object,
+                                               guint               property_id,
+                                               const GValue       *value,
+                                               GParamSpec         *pspec);
+static void     gimp_brush_cache_get_property (GObject            *object,
+                                               guint               property_id,
+                                               GValue             *value,
+                                               GParamSpec         *pspec);
+
+static gint64   gimp_brush_cache_get_memsize  (GimpObject         *object,
+                                               gint64             *gui_size);
+
+static guint    gimp_brush_cache_unit_hash    (gconstpointer       key);
+static gboolean gimp_brush_cache_unit_equal   (gconstpointer       a,
+                                               gconstpointer       b);
+static void     gimp_brush_cache_unit_free    (GimpBrushCache     *cache,
+                                               GimpBrushCacheUnit *unit);
 
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
@@ -79,12 +97,21 @@ G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 static void
 gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 {
-  GObjectClass  *object_class = G_OBJECT_CLASS (klass);
+  GObjectClass    *object_class      = G_OBJECT_CLASS (klass);
+  GimpObjectClass *gimp_object_class = GIMP_OBJECT_CLASS (klass);
+
+  object_class->constructed      = gimp_brush_cache_constructed;
+  object_class->finalize         = gimp_brush_cache_finalize;
+  object_class->set_property     = gimp_brush_cache_set_property;
+  object_class->get_property     = gimp_brush_cache_get_property;
+
+  gimp_object_class->get_memsize = gimp_brush_cache_get_memsize;
 
-  object_class->constructed  = gimp_brush_cache_constructed;
-  object_class->finalize     = gimp_brush_cache_finalize;
-  object_class->set_property = gimp_brush_cache_set_property;
-  object_class->get_property = gimp_brush_cache_get_property;
+  g_object_class_install_property (object_class, PROP_DATA_COPY,
+                                   g_param_spec_pointer ("data-copy",
+                                                         NULL, NULL,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 
   g_object_class_install_property (object_class, PROP_DATA_DESTROY,
                                    g_param_spec_pointer ("data-destroy",
@@ -94,8 +121,14 @@ gimp_brush_cache_class_init (GimpBrushCacheClass *klass)
 }
 
 static void
-gimp_brush_cache_init (GimpBrushCache *brush)
+gimp_brush_cache_init (GimpBrushCache *cache)
 {
+  g_mutex_init (&cache->mutex);
+
+  cache->units = g_hash_table_new (gimp_brush_cache_unit_hash,
+                                   gimp_brush_cache_unit_equal);
+
+  g_queue_init (&cache->lru);
 }
 
 static void
@@ -105,6 +138,7 @@ gimp_brush_cache_constructed (GObject *object)
 
   G_OBJECT_CLASS (parent_class)->constructed (object);
 
+  gimp_assert (cache->data_copy    != NULL);
   gimp_assert (cache->data_destroy != NULL);
 }
 
@@ -115,6 +149,10 @@ gimp_brush_cache_finalize (GObject *object)
 
   gimp_brush_cache_clear (cache);
 
+  g_clear_pointer (&cache->units, g_hash_table_unref);
+
+  g_mutex_clear (&cache->mutex);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -128,6 +166,9 @@ gimp_brush_cache_set_property (GObject      *object,
 
   switch (property_id)
     {
+    case PROP_DATA_COPY:
+      cache->data_copy = g_value_get_pointer (value);
+      break;
     case PROP_DATA_DESTROY:
       cache->data_destroy = g_value_get_pointer (value);
       break;
@@ -148,6 +189,9 @@ gimp_brush_cache_get_property (GObject    *object,
 
   switch (property_id)
     {
+    case PROP_DATA_COPY:
+      g_value_set_pointer (value, cache->data_copy);
+      break;
     case PROP_DATA_DESTROY:
       g_value_set_pointer (value, cache->data_destroy);
       break;
@@ -159,18 +203,106 @@ gimp_brush_cache_get_property (GObject    *object,
 }
 
 
+static gint64
+gimp_brush_cache_get_memsize (GimpObject *object,
+                              gint64     *gui_size)
+{
+  GimpBrushCache *cache   = GIMP_BRUSH_CACHE (object);
+  gint64          memsize = 0;
+
+  g_mutex_lock (&cache->mutex);
+
+  memsize += gimp_g_hash_table_get_memsize (cache->units,
+                                            sizeof (GimpBrushCacheUnit));
+  memsize += gimp_g_list_get_memsize (cache->lru.head, 0);
+  memsize += cache->size;
+
+  g_mutex_unlock (&cache->mutex);
+
+  return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
+                                                                  gui_size);
+}
+
+static guint
+gimp_brush_cache_double_hash (gdouble value)
+{
+  /*  make 0.0 and -0.0, which compare equal, hash equal too  */
+  value += 0.0;
+
+  return g_double_hash (&value);
+}
+
+static guint
+gimp_brush_cache_unit_hash (gconstpointer key)
+{
+  const GimpBrushCacheUnit *unit = key;
+  guint                     hash;
+
+  hash = unit->width;
+  hash = hash * 31 + unit->height;
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->scale);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->aspect_ratio);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->angle);
+  hash = hash * 31 + (unit->reflect ? 1 : 0);
+  hash = hash * 31 + gimp_brush_cache_double_hash (unit->hardness);
+
+  return hash;
+}
+
+static gboolean
+gimp_brush_cache_unit_equal (gconstpointer a,
+                             gconstpointer b)
+{
+  const GimpBrushCacheUnit *unit_a = a;
+  const GimpBrushCacheUnit *unit_b = b;
+
+  return (unit_a->width        == unit_b->width        &&
+          unit_a->height       == unit_b->height       &&
+          unit_a->scale        == unit_b->scale        &&
+          unit_a->aspect_ratio == unit_b->aspect_ratio &&
+          unit_a->angle        == unit_b->angle        &&
+          ! unit_a->reflect    == ! unit_b->reflect    &&
+          unit_a->hardness     == unit_b->hardness);
+}
+
+static void
+gimp_brush_cache_unit_free (GimpBrushCache     *cache,
+                            GimpBrushCacheUnit *unit)
+{
+  cache->data_destroy (unit->data);
+
+  g_slice_free (GimpBrushCacheUnit, unit);
+}
+
+
 /*  public functions  */
 
+/**
+ * gimp_brush_cache_new:
+ * @data_copy:    returns a new reference to, or a copy of, cached data
+ * @data_destroy: frees what @data_copy returned, and the cached data
+ * @debug_hit:    the character to log for a cache hit
+ * @debug_miss:   the character to log for a cache miss
+ *
+ * The cache may be used from any thread. Since units can be pushed out
+ * by other threads at any time, cached data is only handed out through
+ * @data_copy, and the caller owns the result.
+ *
+ * Returns: a new #GimpBrushCache
+ **/
 GimpBrushCache *
-gimp_brush_cache_new (GDestroyNotify  data_destroy,
+gimp_brush_cache_new (GBoxedCopyFunc  data_copy,
+                      GDestroyNotify  data_destroy,
                       gchar           debug_hit,
                       gchar           debug_miss)
 {
   GimpBrushCache *cache;
 
+  g_return_val_if_fail (data_copy != NULL, NULL);
   g_return_val_if_fail (data_destroy != NULL, NULL);
 
   cache =  g_object_new (GIMP_TYPE_BRUSH_CACHE,
+                         "data-copy",    data_copy,
                          "data-destroy", data_destroy,
                          NULL);
 
@@ -183,25 +315,26 @@ gimp_brush_cache_new (GDestroyNotify  data_destroy,
 void
 gimp_brush_cache_clear (GimpBrushCache *cache)
 {
+  GimpBrushCacheUnit *unit;
+
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->cached_units)
-    {
-      GList *iter;
+  g_mutex_lock (&cache->mutex);
 
-      for (iter = cache->cached_units; iter; iter = g_list_next (iter))
-        {
-          GimpBrushCacheUnit *unit = iter->data;
+  g_hash_table_remove_all (cache->units);
 
-          cache->data_destroy (unit->data);
-        }
+  while ((unit = g_queue_pop_head (&cache->lru)))
+    gimp_brush_cache_unit_free (cache, unit);
 
-      g_list_free_full (cache->cached_units, g_free);
-      cache->cached_units = NULL;
-    }
+  cache->size = 0;
+
+  g_mutex_unlock (&cache->mutex);
 }
 
-gconstpointer
+/*  returns a reference to, or copy of, the data cached for the
+ *  transform parameters, or NULL.  the caller owns the result.
+ */
+gpointer
 gimp_brush_cache_get (GimpBrushCache *cache,
                       gint            width,
                       gint            height,
@@ -211,46 +344,51 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList *iter;
+  GimpBrushCacheUnit  key = { 0, };
+  GimpBrushCacheUnit *unit;
+  gpointer            data = NULL;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  key.width        = width;
+  key.height       = height;
+  key.scale        = scale;
+  key.aspect_ratio = aspect_ratio;
+  key.angle        = angle;
+  key.reflect      = reflect;
+  key.hardness     = hardness;
+
+  g_mutex_lock (&cache->mutex);
+
+  unit = g_hash_table_lookup (cache->units, &key);
+
+  if (unit)
     {
-      GimpBrushCacheUnit *unit = iter->data;
-
-      if (unit->data                         &&
-          unit->width        == width        &&
-          unit->height       == height       &&
-          unit->scale        == scale        &&
-          unit->aspect_ratio == aspect_ratio &&
-          unit->angle        == angle        &&
-          unit->reflect      == reflect      &&
-          unit->hardness     == hardness)
-        {
-          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-            g_printerr ("%c", cache->debug_hit);
-
-          /* Make the returned cached brush first in the list. */
-          cache->cached_units = g_list_remove_link (cache->cached_units, iter);
-          iter->next = cache->cached_units;
-          if (cache->cached_units)
-            cache->cached_units->prev = iter;
-          cache->cached_units = iter;
-
-          return (gconstpointer) unit->data;
-        }
+      /* Make the returned cached brush the most recently used one. */
+      g_queue_unlink (&cache->lru, unit->link);
+      g_queue_push_head_link (&cache->lru, unit->link);
+
+      /*  while we hold the lock, nobody can push the unit out  */
+      data = cache->data_copy (unit->data);
     }
 
+  g_mutex_unlock (&cache->mutex);
+
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-    g_printerr ("%c", cache->debug_miss);
+    g_printerr ("%c", data ? cache->debug_hit : cache->debug_miss);
 
-  return NULL;
+  return data;
 }
 
-void
+/*  takes ownership of @data, of @size bytes, and returns a reference
+ *  to, or copy of, the cached data.  if another thread added data for
+ *  the same transform parameters in the meantime, @data is freed, and
+ *  the existing data is returned instead.
+ */
+gpointer
 gimp_brush_cache_add (GimpBrushCache *cache,
                       gpointer        data,
+                      gsize           size,
                       gint            width,
                       gint            height,
                       gdouble         scale,
@@ -259,44 +397,64 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gboolean        reflect,
                       gdouble         hardness)
 {
-  GList              *iter;
   GimpBrushCacheUnit *unit;
-  GList              *last   = NULL;
-  gint                length = 0;
+  GimpBrushCacheUnit *existing;
 
-  g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
-  g_return_if_fail (data != NULL);
+  g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
+  g_return_val_if_fail (data != NULL, NULL);
+
+  unit = g_slice_new0 (GimpBrushCacheUnit);
+
+  unit->data         = data;
+  unit->size         = size;
+  unit->width        = width;
+  unit->height       = height;
+  unit->scale        = scale;
+  unit->aspect_ratio = aspect_ratio;
+  unit->angle        = angle;
+  unit->reflect      = reflect;
+  unit->hardness     = hardness;
 
-  for (iter = cache->cached_units; iter; iter = g_list_next (iter))
+  g_mutex_lock (&cache->mutex);
+
+  existing = g_hash_table_lookup (cache->units, unit);
+
+  if (existing)
     {
-      unit = iter->data;
+      gpointer existing_data = cache->data_copy (existing->data);
+
+      g_mutex_unlock (&cache->mutex);
 
-      if (data == unit->data)
-        return;
+      /*  another thread transformed the brush the same way while we
+       *  did, keep the copy that other callers may already be using
+       */
+      gimp_brush_cache_unit_free (cache, unit);
 
-      length++;
-      last = iter;
+      return existing_data;
     }
 
-  if (length > MAX_CACHED_DATA)
+  g_hash_table_add (cache->units, unit);
+
+  g_queue_push_head (&cache->lru, unit);
+  unit->link = cache->lru.head;
+
+  cache->size += size;
+
+  while (cache->size       > MAX_CACHED_SIZE &&
+         cache->lru.length > MIN_CACHED_DATA)
     {
-      unit = last->data;
+      GimpBrushCacheUnit *last = g_queue_pop_tail (&cache->lru);
+
+      g_hash_table_remove (cache->units, last);
+      cache->size -= last->size;
 
-      cache->data_destroy (unit->data);
-      cache->cached_units = g_list_delete_link (cache->cached_units, last);
-      g_free (unit);
+      gimp_brush_cache_unit_free (cache, last);
     }
 
-  unit = g_new0 (GimpBrushCacheUnit, 1);
+  /*  @data may be pushed out by another thread as soon as we unlock  */
+  data = cache->data_copy (data);
 
-  unit->data         = data;
-  unit->width        = width;
-  unit->height       = height;
-  unit->scale        = scale;
-  unit->aspect_ratio = aspect_ratio;
-  unit->angle        = angle;
-  unit->reflect      = reflect;
-  unit->hardness     = hardness;
+  g_mutex_unlock (&cache->mutex);
 
-  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  return data;
 }
@@ -39,9 +39,13 @@ struct _GimpBrushCache
 {
   GimpObject      parent_instance;
 
+  GBoxedCopyFunc  data_copy;
   GDestroyNotify  data_destroy;
 
-  GList          *cached_units;
+  GMutex          mutex;
+  GHashTable     *units;  /*  transform parameters -> unit  */
+  GQueue          lru;    /*  units, most recently used first  */
+  gsize           size;
 
   gchar           debug_hit;
   gchar           debug_miss;
@@ -55,13 +59,14 @@ struct _GimpBrushCacheClass
 
 GType            gimp_brush_cache_get_type (void) G_GNUC_CONST;
 
-GimpBrushCache * gimp_brush_cache_new      (GDestroyNotify  data_destory,
+GimpBrushCache * gimp_brush_cache_new      (GBoxedCopyFunc  data_copy,
+                                            GDestroyNotify  data_destroy,
                                             gchar           debug_hit,
                                             gchar           debug_miss);
 
 void             gimp_brush_cache_clear    (GimpBrushCache *cache);
 
-gconstpointer    gimp_brush_cache_get      (GimpBrushCache *cache,
+gpointer         gimp_brush_cache_get      (GimpBrushCache *cache,
                                             gint            width,
                                             gint            height,
                                             gdouble         scale,
@@ -69,8 +74,9 @@ gconstpointer    gimp_brush_cache_get      (GimpBrushCache *cache,
                                             gdouble         angle,
                                             gboolean        reflect,
                                             gdouble         hardness);
-void             gimp_brush_cache_add      (GimpBrushCache *cache,
+gpointer         gimp_brush_cache_add      (GimpBrushCache *cache,
                                             gpointer        data,
+                                            gsize           size,
                                             gint            width,
                                             gint            height,
                                             gdouble         scale,
@@ -31,6 +31,7 @@
 #include "gimp-utils.h"
 #include "gimpbrushgenerated.h"
 #include "gimpbrushgenerated-load.h"
+#include "gimpdataloaderfactory.h"
 
 #include "gimp-intl.h"
 
@@ -122,9 +123,10 @@ gimp_brush_generated_load (GimpContext   *context,
     }
   else
     {
-      name = gimp_any_to_utf8 (string, -1,
-                               _("Invalid UTF-8 string in brush file '%s'."),
-                               gimp_file_get_utf8_name (file));
+      name = gimp_data_loader_factory_any_to_utf8 (
+               string, -1,
+               _("Invalid UTF-8 string in brush file '%s'."),
+               gimp_file_get_utf8_name (file));
     }
 
   g_free (string);
@@ -30,6 +30,7 @@
 #include "gimpbrush-private.h"
 #include "gimpbrushpipe.h"
 #include "gimpbrushpipe-load.h"
+#include "gimpdataloaderfactory.h"
 
 #include "gimp-intl.h"
 
@@ -66,9 +67,10 @@ gimp_brush_pipe_load (GimpContext   *context,
   if (buffer->len > 0 && buffer->len < 1024)
     {
       gchar *utf8 =
-        gimp_any_to_utf8 (buffer->str, buffer->len,
-                          _("Invalid UTF-8 string in brush file '%s'."),
-                          gimp_file_get_utf8_name (file));
+        gimp_data_loader_factory_any_to_utf8 (
+          buffer->str, buffer->len,
+          _("Invalid UTF-8 string in brush file '%s'."),
+          gimp_file_get_utf8_name (file));
 
       pipe = g_object_new (GIMP_TYPE_BRUSH_PIPE,
                            "name",      utf8,
@@ -27,6 +27,7 @@
 
 #include "core-types.h"
 
+#include "gimp.h"
 #include "gimp-memsize.h"
 #include "gimpdata.h"
 #include "gimpmarshal.h"
@@ -52,6 +53,12 @@ enum
 };
 
 
+/*  how many bytes of lazily loaded contents are kept around before the
+ *  least recently used ones are dropped again
+ */
+#define GIMP_DATA_LAZY_CONTENTS_BUDGET (64 * 1024 * 1024)
+
+
 struct _GimpDataPrivate
 {
   GFile  *file;
@@ -60,9 +67,25 @@ struct _GimpDataPrivate
   guint   deletable : 1;
   guint   dirty     : 1;
   guint   internal  : 1;
+  guint   lazy      : 1;
   gint    freeze_count;
   gint64  mtime;
 
+  /*  guards loading and unloading the lazily loaded contents, so
+   *  only this data is blocked while its file is read
+   */
+  GRecMutex  contents_mutex;
+
+  /*  where errors loading the contents are reported, and the one
+   *  waiting to be reported
+   */
+  Gimp      *gimp;
+  GError    *lazy_error;
+
+  /*  set while lazily loaded contents are in memory  */
+  GList  *lazy_link;
+  gint64  lazy_size;
+
   /* Identifies the GimpData object across sessions. Used when there
    * is not a filename associated with the object.
    */
@@ -106,6 +129,10 @@ static GList    * gimp_data_get_tags          (GimpTagged          *tagged);
 static gchar    * gimp_data_get_identifier    (GimpTagged          *tagged);
 static gchar    * gimp_data_get_checksum      (GimpTagged          *tagged);
 
+static void       gimp_data_lazy_remove       (GimpData            *data);
+static gboolean   gimp_data_lazy_evict_idle   (gpointer             user_data);
+static gboolean   gimp_data_lazy_report_idle  (GimpData            *data);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpData, gimp_data, GIMP_TYPE_VIEWABLE,
                          G_ADD_PRIVATE (GimpData)
@@ -116,6 +143,12 @@ G_DEFINE_TYPE_WITH_CODE (GimpData, gimp_data, GIMP_TYPE_VIEWABLE,
 
 static guint data_signals[LAST_SIGNAL] = { 0 };
 
+/*  guards the LRU queue of lazily loaded contents only  */
+static GRecMutex  lazy_mutex;
+static GQueue     lazy_queue   = G_QUEUE_INIT;
+static gint64     lazy_size    = 0;
+static guint      lazy_idle_id = 0;
+
 
 static void
 gimp_data_class_init (GimpDataClass *klass)
@@ -151,6 +184,8 @@ gimp_data_class_init (GimpDataClass *klass)
   klass->copy                      = NULL;
   klass->duplicate                 = gimp_data_real_duplicate;
   klass->compare                   = gimp_data_real_compare;
+  klass->load_contents             = NULL;
+  klass->unload_contents           = NULL;
 
   g_object_class_install_property (object_class, PROP_FILE,
                                    g_param_spec_object ("file", NULL, NULL,
@@ -195,6 +230,8 @@ gimp_data_init (GimpData *data)
   private->deletable = TRUE;
   private->dirty     = TRUE;
 
+  g_rec_mutex_init (&private->contents_mutex);
+
   /*  freeze the data object during construction  */
   gimp_data_freeze (data);
 }
@@ -217,6 +254,11 @@ gimp_data_finalize (GObject *object)
 {
   GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (object);
 
+  gimp_data_lazy_remove (GIMP_DATA (object));
+
+  g_clear_error (&private->lazy_error);
+  g_rec_mutex_clear (&private->contents_mutex);
+
   g_clear_object (&private->file);
 
   if (private->tags)
@@ -493,6 +535,84 @@ gimp_data_get_checksum (GimpTagged *tagged)
   return NULL;
 }
 
+static void
+gimp_data_lazy_remove (GimpData *data)
+{
+  GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (data);
+
+  g_rec_mutex_lock (&lazy_mutex);
+
+  if (private->lazy_link)
+    {
+      g_queue_delete_link (&lazy_queue, private->lazy_link);
+      private->lazy_link = NULL;
+
+      lazy_size -= private->lazy_size;
+      private->lazy_size = 0;
+    }
+
+  g_rec_mutex_unlock (&lazy_mutex);
+}
+
+static gboolean
+gimp_data_lazy_evict_idle (gpointer user_data)
+{
+  GList *list;
+  GList *prev;
+
+  g_rec_mutex_lock (&lazy_mutex);
+
+  for (list = lazy_queue.tail;
+       list && lazy_size > GIMP_DATA_LAZY_CONTENTS_BUDGET;
+       list = prev)
+    {
+      GimpData        *data    = list->data;
+      GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (data);
+
+      prev = list->prev;
+
+      /*  skip data which is being loaded right now, it's taking the
+       *  locks in the opposite order
+       */
+      if (! g_rec_mutex_trylock (&private->contents_mutex))
+        continue;
+
+      /*  the class refuses if the contents are in use right now  */
+      if (! private->dirty &&
+          GIMP_DATA_GET_CLASS (data)->unload_contents (data))
+        {
+          gimp_data_lazy_remove (data);
+        }
+
+      g_rec_mutex_unlock (&private->contents_mutex);
+    }
+
+  lazy_idle_id = 0;
+
+  g_rec_mutex_unlock (&lazy_mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gimp_data_lazy_report_idle (GimpData *data)
+{
+  GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (data);
+  GError          *error;
+
+  g_rec_mutex_lock (&private->contents_mutex);
+
+  error = g_steal_pointer (&private->lazy_error);
+
+  g_rec_mutex_unlock (&private->contents_mutex);
+
+  gimp_message_literal (private->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        error->message);
+  g_error_free (error);
+
+  return G_SOURCE_REMOVE;
+}
+
 /**
  * gimp_data_save:
  * @data:  object whose contents are to be saved.
@@ -528,6 +648,8 @@ gimp_data_save (GimpData  *data,
 
   g_return_val_if_fail (G_IS_FILE (private->file), FALSE);
 
+  gimp_data_ensure_contents (data);
+
   if (GIMP_DATA_GET_CLASS (data)->save)
     {
       GOutputStream *output;
@@ -698,6 +820,112 @@ gimp_data_is_frozen (GimpData *data)
   return private->freeze_count > 0;
 }
 
+/**
+ * gimp_data_set_lazy:
+ * @data: a #GimpData object.
+ * @gimp: a #Gimp instance, to report errors loading the contents to.
+ *
+ * Marks @data as having its contents (usually pixels) not loaded yet.
+ * They are loaded from the data's file using the class' load_contents()
+ * the first time gimp_data_ensure_contents() is called, and may be
+ * unloaded again when memory is needed for other lazily loaded data.
+ *
+ * Data loaders use this to only read file headers at startup.
+ **/
+void
+gimp_data_set_lazy (GimpData *data,
+                    Gimp     *gimp)
+{
+  GimpDataPrivate *private;
+
+  g_return_if_fail (GIMP_IS_DATA (data));
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  g_return_if_fail (GIMP_DATA_GET_CLASS (data)->load_contents   != NULL);
+  g_return_if_fail (GIMP_DATA_GET_CLASS (data)->unload_contents != NULL);
+
+  private = GIMP_DATA_GET_PRIVATE (data);
+
+  private->lazy = TRUE;
+  private->gimp = gimp;
+}
+
+/**
+ * gimp_data_ensure_contents:
+ * @data: a #GimpData object.
+ *
+ * Makes sure the contents of a lazily loaded @data are in memory, see
+ * gimp_data_set_lazy().  Does nothing for all other data.
+ *
+ * This may be called from any thread.  Errors loading the contents
+ * are reported to the user from the main thread.
+ **/
+void
+gimp_data_ensure_contents (GimpData *data)
+{
+  GimpDataPrivate *private;
+  gboolean         loaded;
+
+  g_return_if_fail (GIMP_IS_DATA (data));
+
+  private = GIMP_DATA_GET_PRIVATE (data);
+
+  if (! private->lazy)
+    return;
+
+  g_rec_mutex_lock (&private->contents_mutex);
+
+  g_rec_mutex_lock (&lazy_mutex);
+
+  loaded = (private->lazy_link != NULL);
+
+  if (loaded)
+    {
+      /*  most recently used first  */
+      g_queue_unlink (&lazy_queue, private->lazy_link);
+      g_queue_push_head_link (&lazy_queue, private->lazy_link);
+    }
+
+  g_rec_mutex_unlock (&lazy_mutex);
+
+  if (! loaded && private->lazy)
+    {
+      GError *error = NULL;
+
+      /*  on failure, the class leaves valid placeholder contents  */
+      if (! GIMP_DATA_GET_CLASS (data)->load_contents (data, &error))
+        {
+          if (! private->lazy_error)
+            {
+              private->lazy_error = error;
+
+              g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                               (GSourceFunc) gimp_data_lazy_report_idle,
+                               g_object_ref (data),
+                               (GDestroyNotify) g_object_unref);
+            }
+          else
+            {
+              g_clear_error (&error);
+            }
+        }
+
+      g_rec_mutex_lock (&lazy_mutex);
+
+      g_queue_push_head (&lazy_queue, data);
+      private->lazy_link = lazy_queue.head;
+
+      private->lazy_size = gimp_object_get_memsize (GIMP_OBJECT (data), NULL);
+      lazy_size += private->lazy_size;
+
+      if (lazy_size > GIMP_DATA_LAZY_CONTENTS_BUDGET && ! lazy_idle_id)
+        lazy_idle_id = g_idle_add (gimp_data_lazy_evict_idle, NULL);
+
+      g_rec_mutex_unlock (&lazy_mutex);
+    }
+
+  g_rec_mutex_unlock (&private->contents_mutex);
+}
+
 /**
  * gimp_data_delete_from_disk:
  * @data:  a #GimpData object.
@@ -1111,7 +1339,21 @@ gimp_data_copy (GimpData *data,
                     GIMP_DATA_GET_CLASS (src_data)->copy);
 
   if (data != src_data)
-    GIMP_DATA_GET_CLASS (data)->copy (data, src_data);
+    {
+      GimpDataPrivate *private = GIMP_DATA_GET_PRIVATE (data);
+
+      gimp_data_ensure_contents (src_data);
+
+      /*  the copied contents can't be reloaded from our file  */
+      g_rec_mutex_lock (&private->contents_mutex);
+
+      gimp_data_lazy_remove (data);
+      private->lazy = FALSE;
+
+      g_rec_mutex_unlock (&private->contents_mutex);
+
+      GIMP_DATA_GET_CLASS (data)->copy (data, src_data);
+    }
 }
 
 gboolean
@@ -60,15 +60,18 @@ struct _GimpDataClass
   void          (* dirty)         (GimpData  *data);
 
   /*  virtual functions  */
-  gboolean      (* save)          (GimpData       *data,
-                                   GOutputStream  *output,
-                                   GError        **error);
-  const gchar * (* get_extension) (GimpData       *data);
-  void          (* copy)          (GimpData       *data,
-                                   GimpData       *src_data);
-  GimpData    * (* duplicate)     (GimpData       *data);
-  gint          (* compare)       (GimpData       *data1,
-                                   GimpData       *data2);
+  gboolean      (* save)            (GimpData       *data,
+                                     GOutputStream  *output,
+                                     GError        **error);
+  const gchar * (* get_extension)   (GimpData       *data);
+  void          (* copy)            (GimpData       *data,
+                                     GimpData       *src_data);
+  GimpData    * (* duplicate)       (GimpData       *data);
+  gint          (* compare)         (GimpData       *data1,
+                                     GimpData       *data2);
+  gboolean      (* load_contents)   (GimpData       *data,
+                                     GError        **error);
+  gboolean      (* unload_contents) (GimpData       *data);
 };
 
 
@@ -85,6 +88,10 @@ void          gimp_data_freeze           (GimpData     *data);
 void          gimp_data_thaw             (GimpData     *data);
 gboolean      gimp_data_is_frozen        (GimpData     *data);
 
+void          gimp_data_set_lazy         (GimpData     *data,
+                                          Gimp         *gimp);
+void          gimp_data_ensure_contents  (GimpData     *data);
+
 gboolean      gimp_data_delete_from_disk (GimpData     *data,
                                           GError      **error);
 
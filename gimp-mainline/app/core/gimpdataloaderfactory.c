@@ -30,10 +30,14 @@
 #include "core-types.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
+#include "gimpasync.h"
 #include "gimpcontainer.h"
+#include "gimpcontext.h"
 #include "gimpdata.h"
 #include "gimpdataloaderfactory.h"
+#include "gimpwaitable.h"
 
 #include "gimp-intl.h"
 
@@ -44,7 +48,9 @@
 #define GIMP_OBSOLETE_DATA_DIR_NAME "gimp-obsolete-files"
 
 
-typedef struct _GimpDataLoader GimpDataLoader;
+typedef struct _GimpDataLoader    GimpDataLoader;
+typedef struct _GimpDataLoadDir   GimpDataLoadDir;
+typedef struct _GimpDataLoadFile  GimpDataLoadFile;
 
 struct _GimpDataLoader
 {
@@ -54,49 +60,89 @@ struct _GimpDataLoader
   gboolean          writable;
 };
 
+/*  one top-level data directory, read by a gimp_parallel worker  */
+struct _GimpDataLoadDir
+{
+  GimpDataFactory *factory;  /*  not referenced, it cancels the workers  */
+  GimpContext     *context;
+  GHashTable      *cache;
+  gboolean         threaded;
+  gboolean         dir_writable;
+  GFile           *directory;
+  GPtrArray       *files;
+};
+
+struct _GimpDataLoadFile
+{
+  GimpDataLoader *loader;
+  GFile          *file;
+  guint64         mtime;
+  gboolean        cached;    /*  unchanged since the data was loaded    */
+  GBytes         *contents;  /*  read ahead for loading on main thread  */
+  GList          *data_list;
+  GError         *error;
+  GSList         *messages;  /*  warnings, shown on the main thread    */
+};
+
 
 struct _GimpDataLoaderFactoryPrivate
 {
   GList          *loaders;
   GimpDataLoader *fallback;
+  gboolean        threaded;
+
+  GList          *load_asyncs;
 };
 
 #define GET_PRIVATE(obj) (((GimpDataLoaderFactory *) (obj))->priv)
 
+/*  the file a worker is currently running a loader on  */
+static GPrivate current_load_file;
 
-static void   gimp_data_loader_factory_finalize       (GObject         *object);
 
-static void   gimp_data_loader_factory_data_init      (GimpDataFactory *factory,
-                                                       GimpContext     *context);
-static void   gimp_data_loader_factory_data_refresh   (GimpDataFactory *factory,
-                                                       GimpContext     *context);
+static void   gimp_data_loader_factory_finalize       (GObject          *object);
+
+static void   gimp_data_loader_factory_data_init      (GimpDataFactory  *factory,
+                                                       GimpContext      *context);
+static void   gimp_data_loader_factory_data_refresh   (GimpDataFactory  *factory,
+                                                       GimpContext      *context);
+static void   gimp_data_loader_factory_data_cancel    (GimpDataFactory  *factory);
 
 static GimpDataLoader *
-              gimp_data_loader_factory_get_loader     (GimpDataFactory *factory,
-                                                       GFile           *file);
-
-static void   gimp_data_loader_factory_load           (GimpDataFactory *factory,
-                                                       GimpContext     *context,
-                                                       GHashTable      *cache);
-static void   gimp_data_loader_factory_load_directory (GimpDataFactory *factory,
-                                                       GimpContext     *context,
-                                                       GHashTable      *cache,
-                                                       gboolean         dir_writable,
-                                                       GFile           *directory,
-                                                       GFile           *top_directory);
-static void   gimp_data_loader_factory_load_data      (GimpDataFactory *factory,
-                                                       GimpContext     *context,
-                                                       GHashTable      *cache,
-                                                       gboolean         dir_writable,
-                                                       GFile           *file,
-                                                       GFileInfo       *info,
-                                                       GFile           *top_directory);
-
-static GimpDataLoader * gimp_data_loader_new          (const gchar     *name,
-                                                       GimpDataLoadFunc load_func,
-                                                       const gchar     *extension,
-                                                       gboolean         writable);
-static void            gimp_data_loader_free          (GimpDataLoader  *loader);
+              gimp_data_loader_factory_get_loader     (GimpDataFactory  *factory,
+                                                       GFile            *file);
+
+static void   gimp_data_loader_factory_start          (GimpDataFactory  *factory,
+                                                       GimpContext      *context,
+                                                       GHashTable       *cache);
+static void   gimp_data_loader_factory_load           (GimpDataFactory  *factory,
+                                                       GimpContext      *context,
+                                                       GHashTable       *cache);
+static void   gimp_data_loader_factory_load_async     (GimpAsync        *async,
+                                                       GimpDataLoadDir  *dir);
+static gboolean
+              gimp_data_loader_factory_load_directory (GimpAsync        *async,
+                                                       GimpDataLoadDir  *dir,
+                                                       GFile            *directory);
+static GList *
+              gimp_data_loader_factory_run_loader     (GimpDataLoader   *loader,
+                                                       GimpContext      *context,
+                                                       GFile            *file,
+                                                       GInputStream     *input,
+                                                       GError          **error);
+static void   gimp_data_loader_factory_read_data      (GimpDataLoadDir  *dir,
+                                                       GimpDataLoadFile *load_file);
+static void   gimp_data_loader_factory_add_data       (GimpDataLoadDir  *dir,
+                                                       GimpDataLoadFile *load_file);
+
+static GimpDataLoader * gimp_data_loader_new          (const gchar      *name,
+                                                       GimpDataLoadFunc  load_func,
+                                                       const gchar      *extension,
+                                                       gboolean          writable);
+static void            gimp_data_loader_free          (GimpDataLoader   *loader);
+
+static void            gimp_data_load_dir_free        (GimpDataLoadDir  *dir);
+static void            gimp_data_load_file_free       (GimpDataLoadFile *load_file);
 
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpDataLoaderFactory, gimp_data_loader_factory,
@@ -115,12 +161,15 @@ gimp_data_loader_factory_class_init (GimpDataLoaderFactoryClass *klass)
 
   factory_class->data_init    = gimp_data_loader_factory_data_init;
   factory_class->data_refresh = gimp_data_loader_factory_data_refresh;
+  factory_class->data_cancel  = gimp_data_loader_factory_data_cancel;
 }
 
 static void
 gimp_data_loader_factory_init (GimpDataLoaderFactory *factory)
 {
   factory->priv = gimp_data_loader_factory_get_instance_private (factory);
+
+  factory->priv->threaded = TRUE;
 }
 
 static void
@@ -128,6 +177,9 @@ gimp_data_loader_factory_finalize (GObject *object)
 {
   GimpDataLoaderFactoryPrivate *priv = GET_PRIVATE (object);
 
+  /*  the workers use the loaders  */
+  gimp_data_loader_factory_data_cancel (GIMP_DATA_FACTORY (object));
+
   g_list_free_full (priv->loaders, (GDestroyNotify) gimp_data_loader_free);
   priv->loaders = NULL;
 
@@ -220,6 +272,21 @@ gimp_data_loader_factory_data_refresh (GimpDataFactory *factory,
   gimp_container_thaw (container);
 }
 
+static void
+gimp_data_loader_factory_data_cancel (GimpDataFactory *factory)
+{
+  GimpDataLoaderFactoryPrivate *priv = GET_PRIVATE (factory);
+  GList                        *list;
+
+  for (list = priv->load_asyncs; list; list = g_list_next (list))
+    gimp_async_cancel_and_wait (list->data);
+
+  g_list_free_full (priv->load_asyncs, g_object_unref);
+  priv->load_asyncs = NULL;
+
+  GIMP_DATA_FACTORY_CLASS (parent_class)->data_cancel (factory);
+}
+
 
 /*  public functions  */
 
@@ -289,6 +356,102 @@ gimp_data_loader_factory_add_fallback (GimpDataFactory  *factory,
   priv->fallback = gimp_data_loader_new (name, load_func, NULL, FALSE);
 }
 
+/**
+ * gimp_data_loader_factory_set_threaded:
+ * @factory:  a #GimpDataLoaderFactory.
+ * @threaded: whether the load functions may run on worker threads.
+ *
+ * Data files are always enumerated and read on gimp_parallel workers.
+ * Factories whose load functions touch state that isn't thread safe
+ * pass %FALSE here, so their files are only parsed on the main thread,
+ * from contents read ahead by the workers.
+ **/
+void
+gimp_data_loader_factory_set_threaded (GimpDataFactory *factory,
+                                       gboolean         threaded)
+{
+  g_return_if_fail (GIMP_IS_DATA_LOADER_FACTORY (factory));
+
+  GET_PRIVATE (factory)->threaded = threaded ? TRUE : FALSE;
+}
+
+/**
+ * gimp_data_loader_factory_preload:
+ * @factory: a #GimpDataLoaderFactory.
+ * @context: the context to load data with.
+ *
+ * Starts reading @factory's data files in the background.  The loaded
+ * data is added to the factory's container, in the same order as when
+ * loading serially, by the following gimp_data_factory_data_init().
+ *
+ * Calling this for all factories before initializing any of them lets
+ * their files be read at the same time.
+ **/
+void
+gimp_data_loader_factory_preload (GimpDataFactory *factory,
+                                  GimpContext     *context)
+{
+  g_return_if_fail (GIMP_IS_DATA_LOADER_FACTORY (factory));
+  g_return_if_fail (GIMP_IS_CONTEXT (context));
+
+  if (! GET_PRIVATE (factory)->load_asyncs)
+    gimp_data_loader_factory_start (factory, context, NULL);
+}
+
+/**
+ * gimp_data_loader_factory_any_to_utf8:
+ * @str:            the string to convert
+ * @len:            the length of @str, or -1 if it is nul-terminated
+ * @warning_format: the warning to show if @str can't be converted
+ * @...:            arguments for @warning_format
+ *
+ * Like gimp_any_to_utf8(), for use by #GimpDataLoadFunc implementations.
+ * Loaders may run on worker threads, where the warning can't be shown,
+ * so it is kept with the file and shown when the file's data is added
+ * on the main thread.
+ *
+ * Returns: the UTF-8 string, free with g_free()
+ **/
+gchar *
+gimp_data_loader_factory_any_to_utf8 (const gchar *str,
+                                      gssize       len,
+                                      const gchar *warning_format,
+                                      ...)
+{
+  GimpDataLoadFile *load_file;
+  gchar            *utf8;
+  gchar            *message;
+  va_list           args;
+
+  g_return_val_if_fail (str != NULL, NULL);
+
+  if (g_utf8_validate (str, len, NULL))
+    return gimp_any_to_utf8 (str, len, NULL);
+
+  utf8 = g_locale_to_utf8 (str, len, NULL, NULL, NULL);
+
+  if (utf8)
+    return utf8;
+
+  va_start (args, warning_format);
+  message = g_strdup_vprintf (warning_format, args);
+  va_end (args);
+
+  load_file = g_private_get (&current_load_file);
+
+  if (load_file)
+    {
+      load_file->messages = g_slist_append (load_file->messages, message);
+    }
+  else
+    {
+      g_message ("%s", message);
+      g_free (message);
+    }
+
+  return gimp_any_to_utf8 (str, len, NULL);
+}
+
 
 /*  private functions  */
 
@@ -311,14 +474,16 @@ gimp_data_loader_factory_get_loader (GimpDataFactory *factory,
 }
 
 static void
-gimp_data_loader_factory_load (GimpDataFactory *factory,
-                               GimpContext     *context,
-                               GHashTable      *cache)
+gimp_data_loader_factory_start (GimpDataFactory *factory,
+                                GimpContext     *context,
+                                GHashTable      *cache)
 {
-  const GList *ext_path;
-  GList       *path;
-  GList       *writable_path;
-  GList       *list;
+  GimpDataLoaderFactoryPrivate *priv = GET_PRIVATE (factory);
+  const GList                  *ext_path;
+  GList                        *path;
+  GList                        *writable_path;
+  GList                        *dirs = NULL;
+  GList                        *list;
 
   path          = gimp_data_factory_get_data_path          (factory);
   writable_path = gimp_data_factory_get_data_path_writable (factory);
@@ -326,44 +491,128 @@ gimp_data_loader_factory_load (GimpDataFactory *factory,
 
   for (list = (GList *) ext_path; list; list = g_list_next (list))
     {
+      GimpDataLoadDir *dir = g_slice_new0 (GimpDataLoadDir);
+
       /* Adding data from extensions.
        * Consider these always non-writable (even when the directory is
        * writable, since writability of extension is only taken into
        * account for extension update).
        */
-      gimp_data_loader_factory_load_directory (factory, context, cache,
-                                               FALSE,
-                                               list->data,
-                                               list->data);
+      dir->dir_writable = FALSE;
+      dir->directory    = g_object_ref (list->data);
+
+      dirs = g_list_prepend (dirs, dir);
     }
 
   for (list = path; list; list = g_list_next (list))
     {
-      gboolean dir_writable = FALSE;
+      GimpDataLoadDir *dir = g_slice_new0 (GimpDataLoadDir);
 
       if (g_list_find_custom (writable_path, list->data,
                               (GCompareFunc) gimp_file_compare))
-        dir_writable = TRUE;
+        dir->dir_writable = TRUE;
 
-      gimp_data_loader_factory_load_directory (factory, context, cache,
-                                               dir_writable,
-                                               list->data,
-                                               list->data);
+      dir->directory = g_object_ref (list->data);
+
+      dirs = g_list_prepend (dirs, dir);
     }
 
   g_list_free_full (path,          (GDestroyNotify) g_object_unref);
   g_list_free_full (writable_path, (GDestroyNotify) g_object_unref);
+
+  /*  one worker per top-level directory; the results are added in
+   *  this order by gimp_data_loader_factory_load()
+   */
+  for (list = g_list_reverse (dirs); list; list = g_list_next (list))
+    {
+      GimpDataLoadDir *dir = list->data;
+      GimpAsync       *async;
+
+      dir->factory  = factory;
+      dir->context  = g_object_ref (context);
+      dir->cache    = cache;
+      dir->threaded = priv->threaded;
+      dir->files    = g_ptr_array_new_with_free_func (
+                        (GDestroyNotify) gimp_data_load_file_free);
+
+      async = gimp_parallel_run_async_full (
+        0,
+        (GimpRunAsyncFunc) gimp_data_loader_factory_load_async,
+        dir,
+        (GDestroyNotify) gimp_data_load_dir_free);
+
+      priv->load_asyncs = g_list_append (priv->load_asyncs, async);
+    }
+
+  g_list_free (dirs);
+}
+
+static void
+gimp_data_loader_factory_load (GimpDataFactory *factory,
+                               GimpContext     *context,
+                               GHashTable      *cache)
+{
+  GimpDataLoaderFactoryPrivate *priv = GET_PRIVATE (factory);
+  GList                        *asyncs;
+  GList                        *list;
+
+  /*  the directories may already be read by
+   *  gimp_data_loader_factory_preload()
+   */
+  if (cache || ! priv->load_asyncs)
+    {
+      gimp_data_loader_factory_data_cancel (factory);
+      gimp_data_loader_factory_start (factory, context, cache);
+    }
+
+  asyncs = priv->load_asyncs;
+  priv->load_asyncs = NULL;
+
+  for (list = asyncs; list; list = g_list_next (list))
+    {
+      GimpAsync *async = list->data;
+
+      gimp_waitable_wait (GIMP_WAITABLE (async));
+
+      if (gimp_async_is_finished (async))
+        {
+          GimpDataLoadDir *dir = gimp_async_get_result (async);
+          gint             i;
+
+          for (i = 0; i < dir->files->len; i++)
+            gimp_data_loader_factory_add_data (dir,
+                                               g_ptr_array_index (dir->files,
+                                                                  i));
+        }
+    }
+
+  g_list_free_full (asyncs, g_object_unref);
 }
 
 static void
-gimp_data_loader_factory_load_directory (GimpDataFactory *factory,
-                                         GimpContext     *context,
-                                         GHashTable      *cache,
-                                         gboolean         dir_writable,
-                                         GFile           *directory,
-                                         GFile           *top_directory)
+gimp_data_loader_factory_load_async (GimpAsync       *async,
+                                     GimpDataLoadDir *dir)
+{
+  if (gimp_data_loader_factory_load_directory (async, dir, dir->directory))
+    {
+      gimp_async_finish_full (async, dir,
+                              (GDestroyNotify) gimp_data_load_dir_free);
+    }
+  else
+    {
+      gimp_data_load_dir_free (dir);
+
+      gimp_async_abort (async);
+    }
+}
+
+static gboolean
+gimp_data_loader_factory_load_directory (GimpAsync       *async,
+                                         GimpDataLoadDir *dir,
+                                         GFile           *directory)
 {
   GFileEnumerator *enumerator;
+  gboolean         success = TRUE;
 
   enumerator = g_file_enumerate_children (directory,
                                           G_FILE_ATTRIBUTE_STANDARD_NAME ","
@@ -377,7 +626,8 @@ gimp_data_loader_factory_load_directory (GimpDataFactory *factory,
     {
       GFileInfo *info;
 
-      while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)))
+      while (success &&
+             (info = g_file_enumerator_next_file (enumerator, NULL, NULL)))
         {
           GFileType  file_type;
           GFile     *child;
@@ -393,17 +643,32 @@ gimp_data_loader_factory_load_directory (GimpDataFactory *factory,
 
           if (file_type == G_FILE_TYPE_DIRECTORY)
             {
-              gimp_data_loader_factory_load_directory (factory, context, cache,
-                                                       dir_writable,
-                                                       child,
-                                                       top_directory);
+              success = gimp_data_loader_factory_load_directory (async, dir,
+                                                                 child);
             }
           else if (file_type == G_FILE_TYPE_REGULAR)
             {
-              gimp_data_loader_factory_load_data (factory, context, cache,
-                                                  dir_writable,
-                                                  child, info,
-                                                  top_directory);
+              GimpDataLoader *loader;
+
+              loader = gimp_data_loader_factory_get_loader (dir->factory,
+                                                            child);
+
+              if (loader)
+                {
+                  GimpDataLoadFile *load_file = g_slice_new0 (GimpDataLoadFile);
+
+                  load_file->loader = loader;
+                  load_file->file   = g_object_ref (child);
+                  load_file->mtime  =
+                    g_file_info_get_attribute_uint64 (info,
+                                                      G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+                  gimp_data_loader_factory_read_data (dir, load_file);
+
+                  g_ptr_array_add (dir->files, load_file);
+                }
+
+              success = ! gimp_async_is_canceled (async);
             }
 
           g_object_unref (child);
@@ -412,76 +677,97 @@ gimp_data_loader_factory_load_directory (GimpDataFactory *factory,
 
       g_object_unref (enumerator);
     }
+
+  return success;
 }
 
-static void
-gimp_data_loader_factory_load_data (GimpDataFactory *factory,
-                                    GimpContext     *context,
-                                    GHashTable      *cache,
-                                    gboolean         dir_writable,
-                                    GFile           *file,
-                                    GFileInfo       *info,
-                                    GFile           *top_directory)
+static GList *
+gimp_data_loader_factory_run_loader (GimpDataLoader  *loader,
+                                     GimpContext     *context,
+                                     GFile           *file,
+                                     GInputStream    *input,
+                                     GError         **error)
 {
-  GimpDataLoader *loader;
-  GimpContainer  *container;
-  GimpContainer  *container_obsolete;
-  GList          *data_list = NULL;
-  GInputStream   *input;
-  guint64         mtime;
-  GError         *error = NULL;
+  GList *data_list;
 
-  loader = gimp_data_loader_factory_get_loader (factory, file);
+  data_list = loader->load_func (context, file, input, error);
 
-  if (! loader)
-    return;
-
-  container          = gimp_data_factory_get_container          (factory);
-  container_obsolete = gimp_data_factory_get_container_obsolete (factory);
+  if (*error)
+    {
+      g_prefix_error (error,
+                      _("Error loading '%s': "),
+                      gimp_file_get_utf8_name (file));
+    }
+  else if (! data_list)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Error loading '%s'"),
+                   gimp_file_get_utf8_name (file));
+    }
 
-  if (gimp_data_factory_get_gimp (factory)->be_verbose)
-    g_print ("  Loading %s\n", gimp_file_get_utf8_name (file));
+  return data_list;
+}
 
-  mtime = g_file_info_get_attribute_uint64 (info,
-                                            G_FILE_ATTRIBUTE_TIME_MODIFIED);
+/*  runs on a worker thread, unless the directory's worker task was
+ *  started on the main thread by waiting for it
+ */
+static void
+gimp_data_loader_factory_read_data (GimpDataLoadDir  *dir,
+                                    GimpDataLoadFile *load_file)
+{
+  GFile        *file  = load_file->file;
+  GInputStream *input;
+  GError       *error = NULL;
 
-  if (cache)
+  if (dir->cache)
     {
-      GList *cached_data = g_hash_table_lookup (cache, file);
+      GList *cached_data = g_hash_table_lookup (dir->cache, file);
 
       if (cached_data &&
           gimp_data_get_mtime (cached_data->data) != 0 &&
-          gimp_data_get_mtime (cached_data->data) == mtime)
+          gimp_data_get_mtime (cached_data->data) == load_file->mtime)
         {
-          GList *list;
-
-          for (list = cached_data; list; list = g_list_next (list))
-            gimp_container_add (container, list->data);
+          load_file->cached = TRUE;
 
           return;
         }
     }
 
+  if (! dir->threaded)
+    {
+      gchar *contents;
+      gsize  length;
+
+      /*  only read the file here, it's parsed on the main thread  */
+      if (g_file_load_contents (file, NULL, &contents, &length, NULL, &error))
+        {
+          load_file->contents = g_bytes_new_take (contents, length);
+        }
+      else
+        {
+          g_prefix_error (&error,
+                          _("Could not open '%s' for reading: "),
+                          gimp_file_get_utf8_name (file));
+        }
+
+      load_file->error = error;
+
+      return;
+    }
+
   input = G_INPUT_STREAM (g_file_read (file, NULL, &error));
 
   if (input)
     {
       GInputStream *buffered = g_buffered_input_stream_new (input);
 
-      data_list = loader->load_func (context, file, buffered, &error);
+      g_private_set (&current_load_file, load_file);
 
-      if (error)
-        {
-          g_prefix_error (&error,
-                          _("Error loading '%s': "),
-                          gimp_file_get_utf8_name (file));
-        }
-      else if (! data_list)
-        {
-          g_set_error (&error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                       _("Error loading '%s'"),
-                       gimp_file_get_utf8_name (file));
-        }
+      load_file->data_list =
+        gimp_data_loader_factory_run_loader (load_file->loader, dir->context,
+                                             file, buffered, &error);
+
+      g_private_set (&current_load_file, NULL);
 
       g_object_unref (buffered);
       g_object_unref (input);
@@ -493,6 +779,65 @@ gimp_data_loader_factory_load_data (GimpDataFactory *factory,
                       gimp_file_get_utf8_name (file));
     }
 
+  load_file->error = error;
+}
+
+static void
+gimp_data_loader_factory_add_data (GimpDataLoadDir  *dir,
+                                   GimpDataLoadFile *load_file)
+{
+  GimpDataFactory *factory = dir->factory;
+  GFile           *file    = load_file->file;
+  GimpContainer   *container;
+  GimpContainer   *container_obsolete;
+  GList           *data_list;
+  GError          *error;
+  GSList          *message;
+
+  container          = gimp_data_factory_get_container          (factory);
+  container_obsolete = gimp_data_factory_get_container_obsolete (factory);
+
+  if (gimp_data_factory_get_gimp (factory)->be_verbose)
+    g_print ("  Loading %s\n", gimp_file_get_utf8_name (file));
+
+  for (message = load_file->messages;
+       message;
+       message = g_slist_next (message))
+    {
+      gimp_message_literal (gimp_data_factory_get_gimp (factory), NULL,
+                            GIMP_MESSAGE_WARNING, message->data);
+    }
+
+  if (load_file->cached)
+    {
+      GList *cached;
+
+      for (cached = g_hash_table_lookup (dir->cache, file);
+           cached;
+           cached = g_list_next (cached))
+        {
+          gimp_container_add (container, cached->data);
+        }
+
+      return;
+    }
+
+  data_list = g_steal_pointer (&load_file->data_list);
+  error     = g_steal_pointer (&load_file->error);
+
+  if (load_file->contents)
+    {
+      GInputStream *input;
+
+      input = g_memory_input_stream_new_from_bytes (load_file->contents);
+
+      data_list = gimp_data_loader_factory_run_loader (load_file->loader,
+                                                       dir->context,
+                                                       file, input, &error);
+
+      g_object_unref (input);
+    }
+
   if (G_LIKELY (data_list))
     {
       GList    *list;
@@ -510,8 +855,8 @@ gimp_data_loader_factory_load_data (GimpDataFactory *factory,
       /* obsolete files are immutable, don't check their writability */
       if (! obsolete)
         {
-          deletable = (g_list_length (data_list) == 1 && dir_writable);
-          writable  = (deletable && loader->writable);
+          deletable = (g_list_length (data_list) == 1 && dir->dir_writable);
+          writable  = (deletable && load_file->loader->writable);
         }
 
       for (list = data_list; list; list = g_list_next (list))
@@ -519,7 +864,7 @@ gimp_data_loader_factory_load_data (GimpDataFactory *factory,
           GimpData *data = list->data;
 
           gimp_data_set_file (data, file, writable, deletable);
-          gimp_data_set_mtime (data, mtime);
+          gimp_data_set_mtime (data, load_file->mtime);
           gimp_data_clean (data);
 
           if (obsolete)
@@ -529,7 +874,7 @@ gimp_data_loader_factory_load_data (GimpDataFactory *factory,
             }
           else
             {
-              gimp_data_set_folder_tags (data, top_directory);
+              gimp_data_set_folder_tags (data, dir->directory);
 
               gimp_container_add (container,
                                   GIMP_OBJECT (data));
@@ -578,3 +923,27 @@ gimp_data_loader_free (GimpDataLoader *loader)
 
   g_slice_free (GimpDataLoader, loader);
 }
+
+static void
+gimp_data_load_dir_free (GimpDataLoadDir *dir)
+{
+  g_object_unref (dir->context);
+  g_object_unref (dir->directory);
+
+  g_ptr_array_unref (dir->files);
+
+  g_slice_free (GimpDataLoadDir, dir);
+}
+
+static void
+gimp_data_load_file_free (GimpDataLoadFile *load_file)
+{
+  g_object_unref (load_file->file);
+
+  g_clear_pointer (&load_file->contents, g_bytes_unref);
+  g_list_free_full (load_file->data_list, g_object_unref);
+  g_clear_error (&load_file->error);
+  g_slist_free_full (load_file->messages, g_free);
+
+  g_slice_free (GimpDataLoadFile, load_file);
+}
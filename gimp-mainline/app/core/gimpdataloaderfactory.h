@@ -73,6 +73,16 @@ void              gimp_data_loader_factory_add_loader   (GimpDataFactory
 void              gimp_data_loader_factory_add_fallback (GimpDataFactory         *factory,
                                                          const gchar             *name,
                                                          GimpDataLoadFunc         load_func);
+void              gimp_data_loader_factory_set_threaded (GimpDataFactory         *factory,
+                                                         gboolean                 threaded);
+
+void              gimp_data_loader_factory_preload      (GimpDataFactory         *factory,
+                                                         GimpContext             *context);
+
+gchar           * gimp_data_loader_factory_any_to_utf8  (const gchar             *str,
+                                                         gssize                   len,
+                                                         const gchar             *warning_format,
+                                                         ...) G_GNUC_PRINTF (3, 4);
 
 
 #endif  /*  __GIMP_DATA_LOADER_FACTORY_H__  */
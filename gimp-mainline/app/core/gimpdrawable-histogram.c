@@ -256,3 +256,68 @@ gimp_drawable_calculate_histogram_async (GimpDrawable  *drawable,
                                                      histogram, with_filters,
                                                      TRUE);
 }
+
+/**
+ * gimp_drawable_update_histogram_async:
+ * @drawable:     a #GimpDrawable
+ * @histogram:    an incremental #GimpHistogram of @drawable
+ * @with_filters: whether the histogram includes @drawable's filters
+ * @update_rect:  the changed area of @drawable
+ *
+ * Updates @histogram, previously calculated by
+ * gimp_drawable_calculate_histogram_async(), for a change of
+ * @update_rect only.  See gimp_histogram_update_async().
+ *
+ * Returns: (nullable): a #GimpAsync for the update, or %NULL if the
+ *          histogram needs to be recalculated.
+ **/
+GimpAsync *
+gimp_drawable_update_histogram_async (GimpDrawable        *drawable,
+                                      GimpHistogram       *histogram,
+                                      gboolean             with_filters,
+                                      const GeglRectangle *update_rect)
+{
+  GimpImage   *image;
+  GimpChannel *mask;
+  gint         x, y, width, height;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
+  g_return_val_if_fail (histogram != NULL, NULL);
+  g_return_val_if_fail (update_rect != NULL, NULL);
+
+  /*  the filtered pixels of the changed area can depend on pixels
+   *  outside of it
+   */
+  if (with_filters && gimp_drawable_has_filters (drawable))
+    return NULL;
+
+  if (! gimp_item_mask_intersect (GIMP_ITEM (drawable), &x, &y, &width, &height))
+    return NULL;
+
+  image = gimp_item_get_image (GIMP_ITEM (drawable));
+  mask  = gimp_image_get_mask (image);
+
+  if (! gimp_channel_is_empty (mask))
+    {
+      gint off_x, off_y;
+
+      gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+      return gimp_histogram_update_async (
+        histogram, gimp_drawable_get_buffer (drawable),
+        GEGL_RECTANGLE (x, y, width, height),
+        gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
+        GEGL_RECTANGLE (x + off_x, y + off_y,
+                        width, height),
+        update_rect);
+    }
+  else
+    {
+      return gimp_histogram_update_async (
+        histogram, gimp_drawable_get_buffer (drawable),
+        GEGL_RECTANGLE (x, y, width, height),
+        NULL, NULL,
+        update_rect);
+    }
+}
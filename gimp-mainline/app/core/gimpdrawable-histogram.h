@@ -27,6 +27,10 @@ void        gimp_drawable_calculate_histogram       (GimpDrawable  *drawable,
 GimpAsync * gimp_drawable_calculate_histogram_async (GimpDrawable  *drawable,
                                                      GimpHistogram *histogram,
                                                      gboolean       with_filters);
+GimpAsync * gimp_drawable_update_histogram_async    (GimpDrawable        *drawable,
+                                                     GimpHistogram       *histogram,
+                                                     gboolean             with_filters,
+                                                     const GeglRectangle *update_rect);
 
 
 #endif /* __GIMP_HISTOGRAM_H__ */
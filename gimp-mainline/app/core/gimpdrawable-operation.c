@@ -30,6 +30,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "operations/gimp-operation-config.h"
+#include "operations/gimpoperationpointfilterlut.h"
 #include "operations/gimpoperationsettings.h"
 
 #include "gimpdrawable.h"
@@ -60,6 +61,7 @@ gimp_drawable_apply_operation_with_config (GimpDrawable *drawable,
                                            GObject      *config)
 {
   GimpDrawableFilter *filter;
+  GeglNode           *node;
 
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)));
@@ -74,7 +76,20 @@ gimp_drawable_apply_operation_with_config (GimpDrawable *drawable,
       return;
     }
 
-  filter = gimp_drawable_filter_new (drawable, undo_desc, operation, NULL);
+  if (config)
+    gimp_operation_config_sync_node (config, operation);
+
+  /*  run point filters through a lookup table, so that they're tabulated
+   *  for integer formats
+   */
+  if (gimp_operation_point_filter_lut_can_wrap (operation))
+    node = gimp_operation_point_filter_lut_new_node (operation);
+  else
+    node = g_object_ref (operation);
+
+  filter = gimp_drawable_filter_new (drawable, undo_desc, node, NULL);
+
+  g_object_unref (node);
 
   gimp_drawable_filter_set_add_alpha (filter,
                                       gimp_gegl_node_has_key (operation,
@@ -82,8 +97,6 @@ gimp_drawable_apply_operation_with_config (GimpDrawable *drawable,
 
   if (config)
     {
-      gimp_operation_config_sync_node (config, operation);
-
       gimp_operation_settings_sync_drawable_filter (
         GIMP_OPERATION_SETTINGS (config), filter);
     }
@@ -37,6 +37,8 @@ struct _GimpDrawablePrivate
 
   GeglNode         *mode_node;
 
+  guint             dirty_generation; /* bumped on every pixel change */
+
   gint              paint_count;
   GeglBuffer       *paint_buffer;
   cairo_region_t   *paint_copy_region;
@@ -47,6 +47,9 @@
 #include "gimpimage.h"
 #include "gimpimage-colormap.h"
 #include "gimpimage-undo-push.h"
+#include "gimplayer.h"
+#include "gimplayermask.h"
+#include "gimplayerstack.h"
 #include "gimpmarshal.h"
 #include "gimppickable.h"
 #include "gimpprogress.h"
@@ -210,6 +213,12 @@ static GeglNode * gimp_drawable_real_get_source_node (GimpDrawable    *drawable)
 
 static void       gimp_drawable_format_changed     (GimpDrawable      *drawable);
 static void       gimp_drawable_alpha_changed      (GimpDrawable      *drawable);
+static void       gimp_drawable_buffer_changed     (GeglBuffer        *buffer,
+                                                    const GeglRectangle *rect,
+                                                    GimpDrawable      *drawable);
+
+static void       gimp_drawable_paint_cache_update (GimpDrawable      *drawable,
+                                                    gboolean           start);
 
 
 G_DEFINE_TYPE_WITH_CODE (GimpDrawable, gimp_drawable, GIMP_TYPE_ITEM,
@@ -363,6 +372,13 @@ gimp_drawable_finalize (GObject *object)
   while (drawable->private->paint_count)
     gimp_drawable_end_paint (drawable);
 
+  if (drawable->private->buffer)
+    {
+      g_signal_handlers_disconnect_by_func (drawable->private->buffer,
+                                            gimp_drawable_buffer_changed,
+                                            drawable);
+    }
+
   g_clear_object (&drawable->private->buffer);
   g_clear_object (&drawable->private->format_profile);
 
@@ -905,9 +921,20 @@ gimp_drawable_real_set_buffer (GimpDrawable        *drawable,
     {
       old_format    = gimp_drawable_get_format (drawable);
       old_has_alpha = gimp_drawable_has_alpha (drawable);
+
+      g_signal_handlers_disconnect_by_func (drawable->private->buffer,
+                                            gimp_drawable_buffer_changed,
+                                            drawable);
     }
 
   g_set_object (&drawable->private->buffer, buffer);
+
+  gegl_buffer_signal_connect (buffer, "changed",
+                              G_CALLBACK (gimp_drawable_buffer_changed),
+                              drawable);
+
+  g_atomic_int_inc (&drawable->private->dirty_generation);
+
   g_clear_object (&drawable->private->format_profile);
 
   if (drawable->private->buffer_source_node)
@@ -951,6 +978,7 @@ gimp_drawable_real_push_undo (GimpDrawable *drawable,
                               gint          height)
 {
   GimpImage *image;
+  gboolean   delta = TRUE;
 
   if (! buffer)
     {
@@ -976,9 +1004,17 @@ gimp_drawable_real_push_undo (GimpDrawable *drawable,
         &drawable_rect, GEGL_ABYSS_NONE,
         buffer,
         GEGL_RECTANGLE (0, 0, 0, 0));
+
+      /*  the drawable is modified only after the undo is pushed, so the
+       *  undo can't tell which tiles are going to change
+       */
+      delta = FALSE;
     }
   else
     {
+      /*  a buffer passed by the caller holds the original pixels of an
+       *  already-applied modification
+       */
       g_object_ref (buffer);
     }
 
@@ -986,7 +1022,7 @@ gimp_drawable_real_push_undo (GimpDrawable *drawable,
 
   gimp_image_undo_push_drawable (image,
                                  undo_desc, drawable,
-                                 buffer, x, y);
+                                 buffer, x, y, delta);
 
   g_object_unref (buffer);
 }
@@ -1043,6 +1079,46 @@ gimp_drawable_alpha_changed (GimpDrawable *drawable)
   g_signal_emit (drawable, gimp_drawable_signals[ALPHA_CHANGED], 0);
 }
 
+/*  may be called from any thread writing to the buffer
+ */
+static void
+gimp_drawable_buffer_changed (GeglBuffer          *buffer,
+                              const GeglRectangle *rect,
+                              GimpDrawable        *drawable)
+{
+  g_atomic_int_inc (&drawable->private->dirty_generation);
+}
+
+/*  splits the layer stacks containing the painted layer, and its ancestors,
+ *  for the duration of the stroke.  see gimp_layer_stack_start_paint().
+ */
+static void
+gimp_drawable_paint_cache_update (GimpDrawable *drawable,
+                                  gboolean      start)
+{
+  GimpItem *item = GIMP_ITEM (drawable);
+
+  if (GIMP_IS_LAYER_MASK (item))
+    item = GIMP_ITEM (gimp_layer_mask_get_layer (GIMP_LAYER_MASK (item)));
+
+  while (item && GIMP_IS_LAYER (item))
+    {
+      GimpContainer *container = gimp_item_get_container (item);
+
+      if (GIMP_IS_LAYER_STACK (container))
+        {
+          if (start)
+            gimp_layer_stack_start_paint (GIMP_LAYER_STACK (container),
+                                          GIMP_LAYER (item));
+          else
+            gimp_layer_stack_end_paint (GIMP_LAYER_STACK (container),
+                                        GIMP_LAYER (item));
+        }
+
+      item = gimp_item_get_parent (item);
+    }
+}
+
 
 /*  public functions  */
 
@@ -1184,6 +1260,18 @@ gimp_drawable_update_all (GimpDrawable *drawable)
   GIMP_DRAWABLE_GET_CLASS (drawable)->update_all (drawable);
 }
 
+/* returns a number which changes whenever the drawable's pixels change,
+ * so callers can tell if something they derived from the pixels is
+ * still current.
+ */
+guint
+gimp_drawable_get_dirty_generation (GimpDrawable *drawable)
+{
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), 0);
+
+  return g_atomic_int_get (&drawable->private->dirty_generation);
+}
+
 void
 gimp_drawable_invalidate_boundary (GimpDrawable *drawable)
 {
@@ -1894,6 +1982,8 @@ gimp_drawable_start_paint (GimpDrawable *drawable)
       g_return_if_fail (drawable->private->paint_update_region == NULL);
 
       drawable->private->paint_buffer = gimp_gegl_buffer_dup (buffer);
+
+      gimp_drawable_paint_cache_update (drawable, TRUE);
     }
 
   drawable->private->paint_count++;
@@ -1912,6 +2002,8 @@ gimp_drawable_end_paint (GimpDrawable *drawable)
       result = gimp_drawable_flush_paint (drawable);
 
       g_clear_object (&drawable->private->paint_buffer);
+
+      gimp_drawable_paint_cache_update (drawable, FALSE);
     }
 
   drawable->private->paint_count--;
@@ -132,6 +132,9 @@ void            gimp_drawable_update             (GimpDrawable       *drawable,
                                                   gint                height);
 void            gimp_drawable_update_all         (GimpDrawable       *drawable);
 
+guint           gimp_drawable_get_dirty_generation
+                                                 (GimpDrawable       *drawable);
+
 void           gimp_drawable_invalidate_boundary (GimpDrawable       *drawable);
 void         gimp_drawable_get_active_components (GimpDrawable       *drawable,
                                                   gboolean           *active);
@@ -17,6 +17,10 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include <zlib.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gegl.h>
 
@@ -24,10 +28,32 @@
 
 #include "core-types.h"
 
+#include "gegl/gimp-gegl-loops.h"
+#include "gegl/gimp-gegl-utils.h"
+
+#include "gimp.h"
 #include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
+#include "gimpcancelable.h"
 #include "gimpimage.h"
 #include "gimpdrawable.h"
 #include "gimpdrawableundo.h"
+#include "gimpwaitable.h"
+
+#include "gimp-intl.h"
+
+
+/*  the buffer of a drawable undo is compressed on a separate thread after
+ *  the undo is pushed, and decompressed when the undo is popped.  each tile
+ *  of the buffer is compressed separately; when the undo is a delta, tiles
+ *  which are identical to the drawable are not stored at all, and are taken
+ *  from the drawable when the buffer is restored.
+ *
+ *  when the undo history grows too large, the compressed tiles are written
+ *  to a scratch file in the background, and read back in the background once
+ *  the undo gets close to being popped.
+ */
 
 
 enum
@@ -35,10 +61,42 @@ enum
   PROP_0,
   PROP_BUFFER,
   PROP_X,
-  PROP_Y
+  PROP_Y,
+  PROP_DELTA
 };
 
 
+typedef struct
+{
+  GeglRectangle  rect;
+  guchar        *data;
+  gsize          size;
+} DrawableUndoTile;
+
+typedef struct
+{
+  gint32         x;
+  gint32         y;
+  gint32         width;
+  gint32         height;
+  guint64        size;
+} DrawableUndoTileHeader;
+
+typedef struct
+{
+  GeglBuffer    *buffer;
+  GeglBuffer    *reference;
+  gint           x;
+  gint           y;
+} CompressData;
+
+typedef struct
+{
+  GPtrArray     *tiles;
+  GFile         *file;
+} SpillData;
+
+
 static void     gimp_drawable_undo_constructed  (GObject             *object);
 static void     gimp_drawable_undo_set_property (GObject             *object,
                                                  guint                property_id,
@@ -57,6 +115,45 @@ static void     gimp_drawable_undo_pop          (GimpUndo            *undo,
                                                  GimpUndoAccumulator *accum);
 static void     gimp_drawable_undo_free         (GimpUndo            *undo,
                                                  GimpUndoMode         undo_mode);
+static gboolean gimp_drawable_undo_spill        (GimpUndo            *undo);
+static gint64   gimp_drawable_undo_get_spill_size
+                                                (GimpUndo            *undo);
+static void     gimp_drawable_undo_restore      (GimpUndo            *undo);
+
+static void     gimp_drawable_undo_compress     (GimpDrawableUndo    *drawable_undo);
+static void     gimp_drawable_undo_compress_func
+                                                (GimpAsync           *async,
+                                                 CompressData        *data);
+static void     gimp_drawable_undo_compress_callback
+                                                (GimpAsync           *async,
+                                                 GimpDrawableUndo    *drawable_undo);
+static GeglBuffer * gimp_drawable_undo_decompress
+                                                (GimpDrawableUndo    *drawable_undo);
+static void     gimp_drawable_undo_set_tiles    (GimpDrawableUndo    *drawable_undo,
+                                                 GPtrArray           *tiles);
+static void     gimp_drawable_undo_spill_func   (GimpAsync           *async,
+                                                 SpillData           *data);
+static void     gimp_drawable_undo_spill_callback
+                                                (GimpAsync           *async,
+                                                 GimpDrawableUndo    *drawable_undo);
+static void     gimp_drawable_undo_restore_func (GimpAsync           *async,
+                                                 GFile               *file);
+static void     gimp_drawable_undo_restore_callback
+                                                (GimpAsync           *async,
+                                                 GimpDrawableUndo    *drawable_undo);
+static void     gimp_drawable_undo_clear_spill_file
+                                                (GimpDrawableUndo    *drawable_undo);
+
+static gboolean    drawable_undo_tiles_save     (GPtrArray           *tiles,
+                                                 GFile               *file,
+                                                 GimpAsync           *async,
+                                                 GError             **error);
+static GPtrArray * drawable_undo_tiles_load     (GFile               *file,
+                                                 GError             **error);
+
+static void     drawable_undo_tile_free         (DrawableUndoTile    *tile);
+static void     compress_data_free              (CompressData        *data);
+static void     spill_data_free                 (SpillData           *data);
 
 
 G_DEFINE_TYPE (GimpDrawableUndo, gimp_drawable_undo, GIMP_TYPE_ITEM_UNDO)
@@ -79,6 +176,9 @@ gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
 
   undo_class->pop                = gimp_drawable_undo_pop;
   undo_class->free               = gimp_drawable_undo_free;
+  undo_class->spill              = gimp_drawable_undo_spill;
+  undo_class->get_spill_size     = gimp_drawable_undo_get_spill_size;
+  undo_class->restore            = gimp_drawable_undo_restore;
 
   g_object_class_install_property (object_class, PROP_BUFFER,
                                    g_param_spec_object ("buffer", NULL, NULL,
@@ -97,6 +197,12 @@ gimp_drawable_undo_class_init (GimpDrawableUndoClass *klass)
                                                      0, GIMP_MAX_IMAGE_SIZE, 0,
                                                      GIMP_PARAM_READWRITE |
                                                      G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class, PROP_DELTA,
+                                   g_param_spec_boolean ("delta", NULL, NULL,
+                                                         FALSE,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
@@ -113,6 +219,8 @@ gimp_drawable_undo_constructed (GObject *object)
 
   gimp_assert (GIMP_IS_DRAWABLE (GIMP_ITEM_UNDO (object)->item));
   gimp_assert (GEGL_IS_BUFFER (drawable_undo->buffer));
+
+  gimp_drawable_undo_compress (drawable_undo);
 }
 
 static void
@@ -134,6 +242,9 @@ gimp_drawable_undo_set_property (GObject      *object,
     case PROP_Y:
       drawable_undo->y = g_value_get_int (value);
       break;
+    case PROP_DELTA:
+      drawable_undo->delta = g_value_get_boolean (value);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -160,6 +271,9 @@ gimp_drawable_undo_get_property (GObject    *object,
     case PROP_Y:
       g_value_set_int (value, drawable_undo->y);
       break;
+    case PROP_DELTA:
+      g_value_set_boolean (value, drawable_undo->delta);
+      break;
 
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -176,6 +290,14 @@ gimp_drawable_undo_get_memsize (GimpObject *object,
 
   memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
 
+  /*  tiles which are being spilled count as being on disk already  */
+  if (drawable_undo->tiles && ! drawable_undo->spill_file)
+    {
+      memsize += drawable_undo->tiles->len * (sizeof (gpointer) +
+                                              sizeof (DrawableUndoTile));
+      memsize += drawable_undo->compressed_size;
+    }
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -189,10 +311,68 @@ gimp_drawable_undo_pop (GimpUndo            *undo,
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
+  if (drawable_undo->compress_async)
+    gimp_waitable_wait (GIMP_WAITABLE (drawable_undo->compress_async));
+
+  /*  the tiles are still in memory if the spill didn't finish yet  */
+  if (drawable_undo->spill_async)
+    gimp_async_cancel_and_wait (drawable_undo->spill_async);
+
+  if (drawable_undo->restore_async)
+    gimp_waitable_wait (GIMP_WAITABLE (drawable_undo->restore_async));
+
+  if (drawable_undo->spill_file)
+    {
+      /*  the tiles weren't read back in the background  */
+      GPtrArray *tiles;
+      GError    *error = NULL;
+
+      tiles = drawable_undo_tiles_load (drawable_undo->spill_file, &error);
+
+      if (tiles)
+        {
+          gimp_drawable_undo_set_tiles (drawable_undo, tiles);
+          g_ptr_array_unref (tiles);
+        }
+      else
+        {
+          gimp_message (undo->image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        _("Could not read back the undo step \"%s\" "
+                          "from disk, its pixels are lost:\n\n%s"),
+                        gimp_object_get_name (undo), error->message);
+          g_clear_error (&error);
+
+          /*  without any tiles, a delta restores the drawable as it is,
+           *  so the undo leaves the pixels alone instead of replacing them
+           *  with garbage, now and when it's redone
+           */
+          g_clear_pointer (&drawable_undo->tiles, g_ptr_array_unref);
+          drawable_undo->compressed_size = 0;
+          drawable_undo->delta           = TRUE;
+        }
+
+      gimp_drawable_undo_clear_spill_file (drawable_undo);
+    }
+
+  if (! drawable_undo->buffer)
+    {
+      drawable_undo->buffer = gimp_drawable_undo_decompress (drawable_undo);
+
+      g_clear_pointer (&drawable_undo->tiles, g_ptr_array_unref);
+      drawable_undo->compressed_size = 0;
+    }
+
   gimp_drawable_swap_pixels (GIMP_DRAWABLE (GIMP_ITEM_UNDO (undo)->item),
                              drawable_undo->buffer,
                              drawable_undo->x,
                              drawable_undo->y);
+
+  /*  the drawable now holds the result of the operation the buffer undoes,
+   *  so from now on, the undo is always a delta
+   */
+  drawable_undo->delta = TRUE;
+
+  gimp_drawable_undo_compress (drawable_undo);
 }
 
 static void
@@ -201,7 +381,609 @@ gimp_drawable_undo_free (GimpUndo     *undo,
 {
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
 
+  if (drawable_undo->compress_async)
+    gimp_async_cancel_and_wait (drawable_undo->compress_async);
+
+  if (drawable_undo->spill_async)
+    gimp_async_cancel_and_wait (drawable_undo->spill_async);
+
+  if (drawable_undo->restore_async)
+    gimp_async_cancel_and_wait (drawable_undo->restore_async);
+
   g_clear_object (&drawable_undo->buffer);
+  g_clear_pointer (&drawable_undo->tiles, g_ptr_array_unref);
+
+  gimp_drawable_undo_clear_spill_file (drawable_undo);
 
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gboolean
+gimp_drawable_undo_spill (GimpUndo *undo)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+  SpillData        *data;
+
+  /*  only the compressed tiles are spilled, so wait for compression  */
+  if (! drawable_undo->tiles      ||
+      drawable_undo->spill_file   ||
+      drawable_undo->spill_failed)
+    {
+      return FALSE;
+    }
+
+  drawable_undo->spill_file = gimp_get_temp_file (undo->image->gimp, "undo");
+  drawable_undo->spill_size = drawable_undo->compressed_size;
+
+  data = g_slice_new (SpillData);
+
+  data->tiles = g_ptr_array_ref (drawable_undo->tiles);
+  data->file  = g_object_ref (drawable_undo->spill_file);
+
+  drawable_undo->spill_async = gimp_parallel_run_async_full (
+    +10,
+    (GimpRunAsyncFunc) gimp_drawable_undo_spill_func,
+    data, (GDestroyNotify) spill_data_free);
+
+  gimp_async_add_callback_for_object (
+    drawable_undo->spill_async,
+    (GimpAsyncCallback) gimp_drawable_undo_spill_callback,
+    drawable_undo,
+    drawable_undo);
+
+  return TRUE;
+}
+
+static gint64
+gimp_drawable_undo_get_spill_size (GimpUndo *undo)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  return drawable_undo->spill_size;
+}
+
+static void
+gimp_drawable_undo_restore (GimpUndo *undo)
+{
+  GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+
+  /*  the tiles are still in memory, don't bother finishing the spill  */
+  if (drawable_undo->spill_async)
+    {
+      gimp_cancelable_cancel (GIMP_CANCELABLE (drawable_undo->spill_async));
+
+      return;
+    }
+
+  if (! drawable_undo->spill_file || drawable_undo->restore_async)
+    return;
+
+  drawable_undo->restore_async = gimp_parallel_run_async_full (
+    +10,
+    (GimpRunAsyncFunc) gimp_drawable_undo_restore_func,
+    g_object_ref (drawable_undo->spill_file),
+    (GDestroyNotify) g_object_unref);
+
+  gimp_async_add_callback_for_object (
+    drawable_undo->restore_async,
+    (GimpAsyncCallback) gimp_drawable_undo_restore_callback,
+    drawable_undo,
+    drawable_undo);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_undo_compress (GimpDrawableUndo *drawable_undo)
+{
+  CompressData *data;
+
+  drawable_undo->format = gegl_buffer_get_format (drawable_undo->buffer);
+  drawable_undo->width  = gegl_buffer_get_width  (drawable_undo->buffer);
+  drawable_undo->height = gegl_buffer_get_height (drawable_undo->buffer);
+
+  data = g_slice_new0 (CompressData);
+
+  data->buffer = g_object_ref (drawable_undo->buffer);
+
+  if (drawable_undo->delta)
+    {
+      GimpDrawable *drawable = GIMP_DRAWABLE (GIMP_ITEM_UNDO (drawable_undo)->item);
+
+      /*  a copy-on-write snapshot of the drawable, so that it can be
+       *  compared against from the compression thread
+       */
+      data->reference = gimp_gegl_buffer_dup (gimp_drawable_get_buffer (drawable));
+      data->x         = drawable_undo->x;
+      data->y         = drawable_undo->y;
+    }
+
+  drawable_undo->compress_async = gimp_parallel_run_async_full (
+    +10,
+    (GimpRunAsyncFunc) gimp_drawable_undo_compress_func,
+    data, (GDestroyNotify) compress_data_free);
+
+  gimp_async_add_callback_for_object (
+    drawable_undo->compress_async,
+    (GimpAsyncCallback) gimp_drawable_undo_compress_callback,
+    drawable_undo,
+    drawable_undo);
+}
+
+static void
+gimp_drawable_undo_compress_func (GimpAsync    *async,
+                                  CompressData *data)
+{
+  const Babl *format = gegl_buffer_get_format (data->buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  gint        width  = gegl_buffer_get_width  (data->buffer);
+  gint        height = gegl_buffer_get_height (data->buffer);
+  GPtrArray  *tiles;
+  gint        tile_width;
+  gint        tile_height;
+  guchar     *src;
+  guchar     *ref = NULL;
+  guchar     *dest;
+  gsize       max_size;
+  gint        x;
+  gint        y;
+
+  g_object_get (data->buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                NULL);
+
+  tiles = g_ptr_array_new_with_free_func (
+    (GDestroyNotify) drawable_undo_tile_free);
+
+  max_size = (gsize) tile_width * tile_height * bpp;
+
+  src  = g_malloc (max_size);
+  dest = g_malloc (compressBound (max_size));
+
+  if (data->reference)
+    ref = g_malloc (max_size);
+
+  for (y = 0; y < height; y += tile_height)
+    {
+      for (x = 0; x < width; x += tile_width)
+        {
+          GeglRectangle     rect;
+          DrawableUndoTile *tile;
+          gsize             size;
+          uLongf            dest_size;
+
+          if (gimp_async_is_canceled (async))
+            {
+              g_ptr_array_unref (tiles);
+
+              g_free (src);
+              g_free (ref);
+              g_free (dest);
+
+              gimp_async_abort (async);
+
+              return;
+            }
+
+          rect.x      = x;
+          rect.y      = y;
+          rect.width  = MIN (tile_width,  width  - x);
+          rect.height = MIN (tile_height, height - y);
+
+          size = (gsize) rect.width * rect.height * bpp;
+
+          gegl_buffer_get (data->buffer, &rect, 1.0, format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          if (ref)
+            {
+              gegl_buffer_get (data->reference,
+                               GEGL_RECTANGLE (data->x + rect.x,
+                                               data->y + rect.y,
+                                               rect.width,
+                                               rect.height),
+                               1.0, format, ref,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+              /*  unchanged tile, restored from the drawable  */
+              if (! memcmp (src, ref, size))
+                continue;
+            }
+
+          tile = g_slice_new (DrawableUndoTile);
+
+          tile->rect = rect;
+
+          dest_size = compressBound (size);
+
+          if (compress2 (dest, &dest_size, src, size, Z_BEST_SPEED) == Z_OK &&
+              dest_size < size)
+            {
+              tile->data = g_memdup (dest, dest_size);
+              tile->size = dest_size;
+            }
+          else
+            {
+              /*  incompressible tile, stored as is  */
+              tile->data = g_memdup (src, size);
+              tile->size = size;
+            }
+
+          g_ptr_array_add (tiles, tile);
+        }
+    }
+
+  g_free (src);
+  g_free (ref);
+  g_free (dest);
+
+  gimp_async_finish_full (async,
+                          tiles, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void
+gimp_drawable_undo_compress_callback (GimpAsync        *async,
+                                      GimpDrawableUndo *drawable_undo)
+{
+  if (gimp_async_is_finished (async))
+    {
+      gimp_drawable_undo_set_tiles (drawable_undo,
+                                    gimp_async_get_result (async));
+
+      g_clear_object (&drawable_undo->buffer);
+    }
+
+  g_clear_object (&drawable_undo->compress_async);
+}
+
+static GeglBuffer *
+gimp_drawable_undo_decompress (GimpDrawableUndo *drawable_undo)
+{
+  GeglBuffer *buffer;
+  gint        bpp;
+  guchar     *data      = NULL;
+  gsize       data_size = 0;
+  guint       i;
+
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                            drawable_undo->width,
+                                            drawable_undo->height),
+                            drawable_undo->format);
+
+  if (drawable_undo->delta)
+    {
+      GimpDrawable *drawable = GIMP_DRAWABLE (GIMP_ITEM_UNDO (drawable_undo)->item);
+
+      gimp_gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
+                             GEGL_RECTANGLE (drawable_undo->x,
+                                             drawable_undo->y,
+                                             drawable_undo->width,
+                                             drawable_undo->height),
+                             GEGL_ABYSS_NONE,
+                             buffer,
+                             GEGL_RECTANGLE (0, 0, 0, 0));
+    }
+
+  bpp = babl_format_get_bytes_per_pixel (drawable_undo->format);
+
+  for (i = 0; drawable_undo->tiles && i < drawable_undo->tiles->len; i++)
+    {
+      DrawableUndoTile *tile = g_ptr_array_index (drawable_undo->tiles, i);
+      gsize             size;
+
+      size = (gsize) tile->rect.width * tile->rect.height * bpp;
+
+      if (tile->size < size)
+        {
+          uLongf dest_size = size;
+
+          if (size > data_size)
+            {
+              data      = g_realloc (data, size);
+              data_size = size;
+            }
+
+          if (uncompress (data, &dest_size, tile->data, tile->size) != Z_OK ||
+              dest_size != size)
+            {
+              g_warning ("%s: failed to decompress undo tile", G_STRFUNC);
+
+              continue;
+            }
+
+          gegl_buffer_set (buffer, &tile->rect, 0, drawable_undo->format,
+                           data, GEGL_AUTO_ROWSTRIDE);
+        }
+      else
+        {
+          gegl_buffer_set (buffer, &tile->rect, 0, drawable_undo->format,
+                           tile->data, GEGL_AUTO_ROWSTRIDE);
+        }
+    }
+
+  g_free (data);
+
+  return buffer;
+}
+
+static void
+gimp_drawable_undo_set_tiles (GimpDrawableUndo *drawable_undo,
+                              GPtrArray        *tiles)
+{
+  guint i;
+
+  g_clear_pointer (&drawable_undo->tiles, g_ptr_array_unref);
+
+  drawable_undo->tiles           = g_ptr_array_ref (tiles);
+  drawable_undo->compressed_size = 0;
+
+  for (i = 0; i < tiles->len; i++)
+    {
+      DrawableUndoTile *tile = g_ptr_array_index (tiles, i);
+
+      drawable_undo->compressed_size += tile->size;
+    }
+}
+
+static void
+gimp_drawable_undo_spill_func (GimpAsync *async,
+                               SpillData *data)
+{
+  GError *error = NULL;
+
+  if (drawable_undo_tiles_save (data->tiles, data->file, async, &error))
+    gimp_async_finish (async, NULL);
+  else if (error)
+    gimp_async_finish_full (async, error, (GDestroyNotify) g_error_free);
+  else
+    gimp_async_abort (async);
+}
+
+static void
+gimp_drawable_undo_spill_callback (GimpAsync        *async,
+                                   GimpDrawableUndo *drawable_undo)
+{
+  GError *error = NULL;
+
+  if (gimp_async_is_finished (async))
+    error = gimp_async_get_result (async);
+
+  if (gimp_async_is_finished (async) && ! error)
+    {
+      g_clear_pointer (&drawable_undo->tiles, g_ptr_array_unref);
+      drawable_undo->compressed_size = 0;
+    }
+  else
+    {
+      /*  canceled or failed, keep the tiles in memory  */
+      gimp_drawable_undo_clear_spill_file (drawable_undo);
+
+      if (error)
+        {
+          GimpUndo *undo = GIMP_UNDO (drawable_undo);
+
+          gimp_message (undo->image->gimp, NULL, GIMP_MESSAGE_WARNING,
+                        _("Could not move the undo step \"%s\" "
+                          "to disk:\n\n%s"),
+                        gimp_object_get_name (undo), error->message);
+
+          drawable_undo->spill_failed = TRUE;
+        }
+    }
+
+  g_clear_object (&drawable_undo->spill_async);
+}
+
+static void
+gimp_drawable_undo_restore_func (GimpAsync *async,
+                                 GFile     *file)
+{
+  GPtrArray *tiles;
+
+  tiles = drawable_undo_tiles_load (file, NULL);
+
+  if (tiles)
+    {
+      gimp_async_finish_full (async,
+                              tiles, (GDestroyNotify) g_ptr_array_unref);
+    }
+  else
+    {
+      /*  pop() will retry, and report the error  */
+      gimp_async_abort (async);
+    }
+}
+
+static void
+gimp_drawable_undo_restore_callback (GimpAsync        *async,
+                                     GimpDrawableUndo *drawable_undo)
+{
+  if (gimp_async_is_finished (async))
+    {
+      gimp_drawable_undo_set_tiles (drawable_undo,
+                                    gimp_async_get_result (async));
+
+      gimp_drawable_undo_clear_spill_file (drawable_undo);
+    }
+
+  g_clear_object (&drawable_undo->restore_async);
+}
+
+static void
+gimp_drawable_undo_clear_spill_file (GimpDrawableUndo *drawable_undo)
+{
+  if (drawable_undo->spill_file)
+    {
+      g_file_delete (drawable_undo->spill_file, NULL, NULL);
+
+      g_clear_object (&drawable_undo->spill_file);
+    }
+
+  drawable_undo->spill_size = 0;
+}
+
+/*  returns FALSE without setting 'error' if 'async' is canceled  */
+static gboolean
+drawable_undo_tiles_save (GPtrArray  *tiles,
+                          GFile      *file,
+                          GimpAsync  *async,
+                          GError    **error)
+{
+  GOutputStream *output;
+  guint          i;
+
+  output = G_OUTPUT_STREAM (g_file_replace (file,
+                                            NULL, FALSE,
+                                            G_FILE_CREATE_PRIVATE,
+                                            NULL, error));
+  if (! output)
+    return FALSE;
+
+  for (i = 0; i < tiles->len; i++)
+    {
+      DrawableUndoTile       *tile = g_ptr_array_index (tiles, i);
+      DrawableUndoTileHeader  header;
+
+      if (gimp_async_is_canceled (async))
+        {
+          g_output_stream_close (output, NULL, NULL);
+          g_object_unref (output);
+
+          g_file_delete (file, NULL, NULL);
+
+          return FALSE;
+        }
+
+      header.x      = tile->rect.x;
+      header.y      = tile->rect.y;
+      header.width  = tile->rect.width;
+      header.height = tile->rect.height;
+      header.size   = tile->size;
+
+      if (! g_output_stream_write_all (output, &header, sizeof (header),
+                                       NULL, NULL, error) ||
+          ! g_output_stream_write_all (output, tile->data, tile->size,
+                                       NULL, NULL, error))
+        {
+          g_output_stream_close (output, NULL, NULL);
+          g_object_unref (output);
+
+          g_file_delete (file, NULL, NULL);
+
+          return FALSE;
+        }
+    }
+
+  if (! g_output_stream_close (output, NULL, error))
+    {
+      g_object_unref (output);
+
+      g_file_delete (file, NULL, NULL);
+
+      return FALSE;
+    }
+
+  g_object_unref (output);
+
+  return TRUE;
+}
+
+static GPtrArray *
+drawable_undo_tiles_load (GFile   *file,
+                          GError **error)
+{
+  GInputStream *input;
+  GPtrArray    *tiles;
+
+  input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+
+  if (! input)
+    return NULL;
+
+  tiles = g_ptr_array_new_with_free_func (
+    (GDestroyNotify) drawable_undo_tile_free);
+
+  while (TRUE)
+    {
+      DrawableUndoTileHeader  header;
+      DrawableUndoTile       *tile;
+      gsize                   bytes_read;
+
+      if (! g_input_stream_read_all (input, &header, sizeof (header),
+                                     &bytes_read, NULL, error))
+        {
+          break;
+        }
+
+      if (bytes_read == 0)
+        {
+          g_object_unref (input);
+
+          return tiles;
+        }
+
+      if (bytes_read != sizeof (header))
+        {
+          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                               _("Undo scratch file is truncated"));
+          break;
+        }
+
+      tile = g_slice_new (DrawableUndoTile);
+
+      tile->rect.x      = header.x;
+      tile->rect.y      = header.y;
+      tile->rect.width  = header.width;
+      tile->rect.height = header.height;
+      tile->size        = header.size;
+      tile->data        = g_malloc (tile->size);
+
+      g_ptr_array_add (tiles, tile);
+
+      if (! g_input_stream_read_all (input, tile->data, tile->size,
+                                     &bytes_read, NULL, error))
+        {
+          break;
+        }
+
+      if (bytes_read != tile->size)
+        {
+          g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+                               _("Undo scratch file is truncated"));
+          break;
+        }
+    }
+
+  g_object_unref (input);
+  g_ptr_array_unref (tiles);
+
+  return NULL;
+}
+
+static void
+drawable_undo_tile_free (DrawableUndoTile *tile)
+{
+  g_free (tile->data);
+
+  g_slice_free (DrawableUndoTile, tile);
+}
+
+static void
+compress_data_free (CompressData *data)
+{
+  g_object_unref (data->buffer);
+  g_clear_object (&data->reference);
+
+  g_slice_free (CompressData, data);
+}
+
+static void
+spill_data_free (SpillData *data)
+{
+  g_ptr_array_unref (data->tiles);
+  g_object_unref (data->file);
+
+  g_slice_free (SpillData, data);
+}
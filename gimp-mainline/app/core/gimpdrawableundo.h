@@ -40,6 +40,29 @@ struct _GimpDrawableUndo
   GeglBuffer   *buffer;
   gint          x;
   gint          y;
+
+  /* if TRUE, the drawable contains the result of the undone operation, and
+   * only the tiles of 'buffer' which differ from it need to be stored
+   */
+  gboolean      delta;
+
+  /* compressed storage, replacing 'buffer' once compression is done */
+  const Babl   *format;
+  gint          width;
+  gint          height;
+  GPtrArray    *tiles;
+  gint64        compressed_size;
+
+  GimpAsync    *compress_async;
+
+  /* the scratch file holding the tiles while the undo is spilled, set as
+   * soon as writing the file is started by 'spill_async'
+   */
+  GFile        *spill_file;
+  gint64        spill_size;
+  gboolean      spill_failed;
+  GimpAsync    *spill_async;
+  GimpAsync    *restore_async;
 };
 
 struct _GimpDrawableUndoClass
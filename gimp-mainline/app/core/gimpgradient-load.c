@@ -33,6 +33,7 @@
 #include "config/gimpxmlparser.h"
 
 #include "gimp-utils.h"
+#include "gimpdataloaderfactory.h"
 #include "gimpgradient.h"
 #include "gimpgradient-load.h"
 
@@ -92,9 +93,10 @@ gimp_gradient_load (GimpContext   *context,
     {
       gchar *utf8;
 
-      utf8 = gimp_any_to_utf8 (g_strstrip (line + strlen ("Name: ")), -1,
-                               _("Invalid UTF-8 string in gradient file '%s'."),
-                               gimp_file_get_utf8_name (file));
+      utf8 = gimp_data_loader_factory_any_to_utf8 (
+               g_strstrip (line + strlen ("Name: ")), -1,
+               _("Invalid UTF-8 string in gradient file '%s'."),
+               gimp_file_get_utf8_name (file));
       gimp_object_take_name (GIMP_OBJECT (gradient), utf8);
 
       g_free (line);
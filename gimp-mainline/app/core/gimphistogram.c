@@ -62,6 +62,16 @@ struct _GimpHistogramPrivate
   gint         n_bins;
   gdouble     *values;
   GimpAsync   *calculate_async;
+  GList       *update_asyncs;
+
+  /*  copies of the buffers the current values were calculated from,
+   *  kept for incremental updates
+   */
+  gboolean       incremental;
+  GeglBuffer    *buffer;
+  GeglRectangle  buffer_rect;
+  GeglBuffer    *mask;
+  GeglRectangle  mask_rect;
 };
 
 typedef struct
@@ -88,6 +98,12 @@ typedef struct
   GSList           *values_list;
 } CalculateData;
 
+typedef struct
+{
+  CalculateContext  old_context;
+  CalculateContext  new_context;
+} UpdateContext;
+
 
 /*  local function prototypes  */
 
@@ -112,12 +128,21 @@ static void       gimp_histogram_set_values               (GimpHistogram
                                                            gint                  n_bins,
                                                            gdouble              *values);
 
+static void       gimp_histogram_clear_reference          (GimpHistogram        *histogram);
+static void       gimp_histogram_wait_updates             (GimpHistogram        *histogram);
+
+static gboolean   gimp_histogram_calculate_values         (GimpAsync            *async,
+                                                           CalculateContext     *context);
 static void       gimp_histogram_calculate_internal       (GimpAsync            *async,
                                                            CalculateContext     *context);
 static void       gimp_histogram_calculate_area           (const GeglRectangle  *area,
                                                            CalculateData        *data);
 static void       gimp_histogram_calculate_async_callback (GimpAsync            *async,
                                                            CalculateContext     *context);
+static void       gimp_histogram_update_internal          (GimpAsync            *async,
+                                                           UpdateContext        *context);
+static void       gimp_histogram_update_async_callback    (GimpAsync            *async,
+                                                           UpdateContext        *context);
 
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
@@ -259,6 +284,8 @@ gimp_histogram_duplicate (GimpHistogram *histogram)
   if (histogram->priv->calculate_async)
     gimp_waitable_wait (GIMP_WAITABLE (histogram->priv->calculate_async));
 
+  gimp_histogram_wait_updates (histogram);
+
   dup = gimp_histogram_new (histogram->priv->trc);
 
   dup->priv->n_channels = histogram->priv->n_channels;
@@ -287,6 +314,9 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
   if (histogram->priv->calculate_async)
     gimp_async_cancel_and_wait (histogram->priv->calculate_async);
 
+  gimp_histogram_wait_updates (histogram);
+  gimp_histogram_clear_reference (histogram);
+
   context.histogram   = histogram;
   context.buffer      = buffer;
   context.buffer_rect = *buffer_rect;
@@ -325,6 +355,8 @@ gimp_histogram_calculate_async (GimpHistogram       *histogram,
   if (histogram->priv->calculate_async)
     gimp_async_cancel_and_wait (histogram->priv->calculate_async);
 
+  gimp_histogram_wait_updates (histogram);
+
   gegl_rectangle_align_to_buffer (&rect, buffer_rect, buffer,
                                   GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
 
@@ -366,6 +398,162 @@ gimp_histogram_calculate_async (GimpHistogram       *histogram,
   return histogram->priv->calculate_async;
 }
 
+/**
+ * gimp_histogram_set_incremental:
+ * @histogram:   a %GimpHistogram
+ * @incremental: whether to keep the calculated buffers around
+ *
+ * Makes gimp_histogram_calculate_async() keep a copy-on-write copy of
+ * the buffer and mask it calculated the histogram from, so that later
+ * changes can be folded in by gimp_histogram_update_async().
+ **/
+void
+gimp_histogram_set_incremental (GimpHistogram *histogram,
+                                gboolean       incremental)
+{
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+
+  histogram->priv->incremental = incremental;
+
+  if (! incremental)
+    gimp_histogram_clear_reference (histogram);
+}
+
+/**
+ * gimp_histogram_update_async:
+ * @histogram:   a %GimpHistogram
+ * @buffer:      the buffer the histogram was calculated from
+ * @buffer_rect: the area of @buffer the histogram was calculated from
+ * @mask:        the mask the histogram was calculated with, or %NULL
+ * @mask_rect:   the area of @mask, or %NULL
+ * @update_rect: the area of @buffer that changed
+ *
+ * Updates the values of @histogram for a change of @update_rect,
+ * by subtracting the previous contents of the area, and adding its
+ * new contents, instead of recalculating the whole histogram.
+ *
+ * This only works for an incremental histogram, whose last full
+ * calculation was done by gimp_histogram_calculate_async() with the
+ * same @buffer_rect and @mask_rect; the contents of @mask must not
+ * have changed since.
+ *
+ * Returns: (nullable): a %GimpAsync for the update, or %NULL if the
+ *          histogram can't be updated incrementally, and needs to be
+ *          recalculated.
+ **/
+GimpAsync *
+gimp_histogram_update_async (GimpHistogram       *histogram,
+                             GeglBuffer          *buffer,
+                             const GeglRectangle *buffer_rect,
+                             GeglBuffer          *mask,
+                             const GeglRectangle *mask_rect,
+                             const GeglRectangle *update_rect)
+{
+  GimpHistogramPrivate *priv;
+  UpdateContext        *context;
+  GimpAsync            *async;
+  const Babl           *format;
+  GeglRectangle         rect;
+  GeglRectangle         aligned_rect;
+
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (buffer_rect != NULL, NULL);
+  g_return_val_if_fail (update_rect != NULL, NULL);
+
+  priv = histogram->priv;
+
+  if (! priv->buffer || ! priv->values || priv->calculate_async)
+    return NULL;
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (format != gegl_buffer_get_format (priv->buffer) ||
+      ! gegl_rectangle_equal (buffer_rect, &priv->buffer_rect))
+    {
+      return NULL;
+    }
+
+  if (mask)
+    {
+      if (! priv->mask ||
+          ! gegl_rectangle_equal (mask_rect ?
+                                  mask_rect : gegl_buffer_get_extent (mask),
+                                  &priv->mask_rect))
+        {
+          return NULL;
+        }
+    }
+  else if (priv->mask)
+    {
+      return NULL;
+    }
+
+  if (! gegl_rectangle_intersect (&rect, update_rect, buffer_rect))
+    {
+      async = gimp_async_new ();
+
+      gimp_async_finish (async, NULL);
+
+      return async;
+    }
+
+  gegl_rectangle_align_to_buffer (&aligned_rect, &rect, buffer,
+                                  GEGL_RECTANGLE_ALIGNMENT_SUPERSET);
+  gegl_rectangle_intersect (&aligned_rect, &aligned_rect,
+                            gegl_buffer_get_extent (priv->buffer));
+
+  context = g_slice_new0 (UpdateContext);
+
+  context->old_context.histogram   = histogram;
+  context->old_context.buffer      = gegl_buffer_new (&aligned_rect, format);
+  context->old_context.buffer_rect = rect;
+
+  gimp_gegl_buffer_copy (priv->buffer, &aligned_rect, GEGL_ABYSS_NONE,
+                         context->old_context.buffer, NULL);
+
+  context->new_context.histogram   = histogram;
+  context->new_context.buffer      = gegl_buffer_new (&aligned_rect, format);
+  context->new_context.buffer_rect = rect;
+
+  gimp_gegl_buffer_copy (buffer, &aligned_rect, GEGL_ABYSS_NONE,
+                         context->new_context.buffer, NULL);
+
+  /*  advance the reference buffer right away, so that further updates
+   *  can be started before this one finishes
+   */
+  gimp_gegl_buffer_copy (context->new_context.buffer, &aligned_rect,
+                         GEGL_ABYSS_NONE,
+                         priv->buffer, NULL);
+
+  if (priv->mask)
+    {
+      GeglRectangle mask_area = rect;
+
+      mask_area.x += priv->mask_rect.x - priv->buffer_rect.x;
+      mask_area.y += priv->mask_rect.y - priv->buffer_rect.y;
+
+      context->old_context.mask      = g_object_ref (priv->mask);
+      context->old_context.mask_rect = mask_area;
+
+      context->new_context.mask      = g_object_ref (priv->mask);
+      context->new_context.mask_rect = mask_area;
+    }
+
+  async = gimp_parallel_run_async (
+    (GimpRunAsyncFunc) gimp_histogram_update_internal,
+    context);
+
+  priv->update_asyncs = g_list_prepend (priv->update_asyncs, async);
+
+  gimp_async_add_callback (
+    async,
+    (GimpAsyncCallback) gimp_histogram_update_async_callback,
+    context);
+
+  return async;
+}
+
 void
 gimp_histogram_clear_values (GimpHistogram *histogram,
                              gint           n_components)
@@ -375,6 +563,9 @@ gimp_histogram_clear_values (GimpHistogram *histogram,
   if (histogram->priv->calculate_async)
     gimp_async_cancel_and_wait (histogram->priv->calculate_async);
 
+  gimp_histogram_wait_updates (histogram);
+  gimp_histogram_clear_reference (histogram);
+
   gimp_histogram_set_values (histogram, n_components, 0, NULL);
 }
 
@@ -878,8 +1069,25 @@ gimp_histogram_set_values (GimpHistogram *histogram,
 }
 
 static void
-gimp_histogram_calculate_internal (GimpAsync        *async,
-                                   CalculateContext *context)
+gimp_histogram_clear_reference (GimpHistogram *histogram)
+{
+  g_clear_object (&histogram->priv->buffer);
+  g_clear_object (&histogram->priv->mask);
+}
+
+static void
+gimp_histogram_wait_updates (GimpHistogram *histogram)
+{
+  /*  updates ignore cancellation, this merely waits for them and runs
+   *  their callbacks, which remove them from the list
+   */
+  while (histogram->priv->update_asyncs)
+    gimp_async_cancel_and_wait (histogram->priv->update_asyncs->data);
+}
+
+static gboolean
+gimp_histogram_calculate_values (GimpAsync        *async,
+                                 CalculateContext *context)
 {
   CalculateData         data;
   GimpHistogramPrivate *priv;
@@ -916,10 +1124,7 @@ gimp_histogram_calculate_internal (GimpAsync        *async,
       break;
 
     default:
-      if (async)
-        gimp_async_abort (async);
-
-      g_return_if_reached ();
+      g_return_val_if_reached (FALSE);
     }
 
   context->n_components = babl_format_get_n_components (format);
@@ -964,13 +1169,27 @@ gimp_histogram_calculate_internal (GimpAsync        *async,
 
       context->values = total_values;
 
-      if (async)
-        gimp_async_finish (async, NULL);
+      return TRUE;
     }
   else
     {
       g_slist_free_full (data.values_list, g_free);
 
+      return FALSE;
+    }
+}
+
+static void
+gimp_histogram_calculate_internal (GimpAsync        *async,
+                                   CalculateContext *context)
+{
+  if (gimp_histogram_calculate_values (async, context))
+    {
+      if (async)
+        gimp_async_finish (async, NULL);
+    }
+  else
+    {
       if (async)
         gimp_async_abort (async);
     }
@@ -1211,18 +1430,99 @@ static void
 gimp_histogram_calculate_async_callback (GimpAsync        *async,
                                          CalculateContext *context)
 {
-  context->histogram->priv->calculate_async = NULL;
+  GimpHistogramPrivate *priv = context->histogram->priv;
+
+  priv->calculate_async = NULL;
 
   if (gimp_async_is_finished (async))
     {
       gimp_histogram_set_values (context->histogram,
                                  context->n_components, context->n_bins,
                                  context->values);
+
+      gimp_histogram_clear_reference (context->histogram);
+
+      if (priv->incremental)
+        {
+          priv->buffer      = g_steal_pointer (&context->buffer);
+          priv->buffer_rect = context->buffer_rect;
+          priv->mask        = g_steal_pointer (&context->mask);
+          priv->mask_rect   = context->mask_rect;
+        }
     }
 
-  g_object_unref (context->buffer);
-  if (context->mask)
-    g_object_unref (context->mask);
+  g_clear_object (&context->buffer);
+  g_clear_object (&context->mask);
 
   g_slice_free (CalculateContext, context);
 }
+
+static void
+gimp_histogram_update_internal (GimpAsync     *async,
+                                UpdateContext *context)
+{
+  /*  the reference buffer has already been advanced past this update,
+   *  so it always runs to completion, regardless of cancellation
+   */
+  if (gimp_histogram_calculate_values (NULL, &context->old_context) &&
+      gimp_histogram_calculate_values (NULL, &context->new_context))
+    {
+      gint n_values = (context->new_context.n_components +
+                       N_DERIVED_CHANNELS) *
+                      context->new_context.n_bins;
+      gint i;
+
+      for (i = 0; i < n_values; i++)
+        context->new_context.values[i] -= context->old_context.values[i];
+
+      gimp_async_finish (async, NULL);
+    }
+  else
+    {
+      gimp_async_abort (async);
+    }
+}
+
+static void
+gimp_histogram_update_async_callback (GimpAsync     *async,
+                                      UpdateContext *context)
+{
+  GimpHistogram        *histogram = context->new_context.histogram;
+  GimpHistogramPrivate *priv      = histogram->priv;
+  const gdouble        *delta     = context->new_context.values;
+
+  priv->update_asyncs = g_list_remove (priv->update_asyncs, async);
+
+  if (gimp_async_is_finished (async) &&
+      priv->values                   &&
+      context->new_context.n_bins == priv->n_bins &&
+      context->new_context.n_components + N_DERIVED_CHANNELS ==
+      priv->n_channels)
+    {
+      gint n_values = priv->n_channels * priv->n_bins;
+      gint i;
+
+      /*  clamp away rounding errors of the subtraction  */
+      for (i = 0; i < n_values; i++)
+        priv->values[i] = MAX (priv->values[i] + delta[i], 0.0);
+
+      g_object_notify (G_OBJECT (histogram), "values");
+    }
+  else
+    {
+      /*  the values no longer match the reference buffer, force the
+       *  next update to recalculate the whole histogram
+       */
+      gimp_histogram_clear_reference (histogram);
+    }
+
+  g_object_unref (context->old_context.buffer);
+  g_clear_object (&context->old_context.mask);
+  g_free (context->old_context.values);
+
+  g_object_unref (context->new_context.buffer);
+  g_clear_object (&context->new_context.mask);
+  g_free (context->new_context.values);
+
+  g_slice_free (UpdateContext, context);
+}
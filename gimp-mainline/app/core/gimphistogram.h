@@ -65,6 +65,15 @@ GimpAsync     * gimp_histogram_calculate_async (GimpHistogram        *histogram,
                                                 GeglBuffer           *mask,
                                                 const GeglRectangle  *mask_rect);
 
+void            gimp_histogram_set_incremental (GimpHistogram        *histogram,
+                                                gboolean              incremental);
+GimpAsync     * gimp_histogram_update_async    (GimpHistogram        *histogram,
+                                                GeglBuffer           *buffer,
+                                                const GeglRectangle  *buffer_rect,
+                                                GeglBuffer           *mask,
+                                                const GeglRectangle  *mask_rect,
+                                                const GeglRectangle  *update_rect);
+
 void            gimp_histogram_clear_values    (GimpHistogram        *histogram,
                                                 gint                  n_components);
 
@@ -49,6 +49,8 @@
 #include "gimpsamplepoint.h"
 
 
+static void          gimp_image_duplicate_contents         (GimpImage *image,
+                                                            GimpImage *new_image);
 static void          gimp_image_duplicate_resolution       (GimpImage *image,
                                                             GimpImage *new_image);
 static void          gimp_image_duplicate_save_source_file (GimpImage *image,
@@ -83,15 +85,16 @@ static void          gimp_image_duplicate_parasites        (GimpImage *image,
                                                             GimpImage *new_image);
 static void          gimp_image_duplicate_color_profile    (GimpImage *image,
                                                             GimpImage *new_image);
+static void          gimp_image_duplicate_tattoos          (GimpImage *image,
+                                                            GimpImage *new_image);
+static void          gimp_image_duplicate_item_tattoos     (GList     *items,
+                                                            GList     *new_items);
 
 
 GimpImage *
 gimp_image_duplicate (GimpImage *image)
 {
-  GimpImage    *new_image;
-  GList        *active_layers;
-  GList        *active_channels;
-  GList        *active_vectors;
+  GimpImage *new_image;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
 
@@ -104,6 +107,52 @@ gimp_image_duplicate (GimpImage *image)
                                  gimp_image_get_base_type (image),
                                  gimp_image_get_precision (image),
                                  FALSE);
+
+  gimp_image_duplicate_contents (image, new_image);
+
+  /*  Explicitly mark image as dirty, so that its dirty time is set  */
+  gimp_image_dirty (new_image, GIMP_DIRTY_ALL);
+
+  return new_image;
+}
+
+/*  Creates a copy of @image's current state, for saving it in the
+ *  background.  Unlike gimp_image_duplicate(), the copy isn't added to
+ *  the list of open images, and its items keep their tattoos, so the
+ *  saved file is the same as if @image itself had been saved.
+ */
+GimpImage *
+gimp_image_duplicate_snapshot (GimpImage *image)
+{
+  GimpImage *new_image;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+
+  new_image = g_object_new (GIMP_TYPE_IMAGE,
+                            "gimp",      image->gimp,
+                            "width",     gimp_image_get_width  (image),
+                            "height",    gimp_image_get_height (image),
+                            "base-type", gimp_image_get_base_type (image),
+                            "precision", gimp_image_get_precision (image),
+                            "listed",    FALSE,
+                            NULL);
+
+  gimp_image_duplicate_contents (image, new_image);
+
+  /*  Copy the tattoos last, items get new ones when they are added  */
+  gimp_image_duplicate_tattoos (image, new_image);
+
+  return new_image;
+}
+
+static void
+gimp_image_duplicate_contents (GimpImage *image,
+                               GimpImage *new_image)
+{
+  GList *active_layers;
+  GList *active_channels;
+  GList *active_vectors;
+
   gimp_image_undo_disable (new_image);
 
   /*  Store the source uri to be used by the save dialog  */
@@ -163,11 +212,6 @@ gimp_image_duplicate (GimpImage *image)
   gimp_image_duplicate_quick_mask (image, new_image);
 
   gimp_image_undo_enable (new_image);
-
-  /*  Explicitly mark image as dirty, so that its dirty time is set  */
-  gimp_image_dirty (new_image, GIMP_DIRTY_ALL);
-
-  return new_image;
 }
 
 static void
@@ -543,3 +587,83 @@ gimp_image_duplicate_color_profile (GimpImage *image,
   gimp_image_set_color_profile (new_image, profile, NULL);
   _gimp_image_set_hidden_profile (new_image, hidden, FALSE);
 }
+
+static void
+gimp_image_duplicate_tattoos (GimpImage *image,
+                              GimpImage *new_image)
+{
+  GimpLayer *floating_sel     = gimp_image_get_floating_selection (image);
+  GimpLayer *new_floating_sel = gimp_image_get_floating_selection (new_image);
+
+  gimp_image_duplicate_item_tattoos (gimp_image_get_layer_iter (image),
+                                     gimp_image_get_layer_iter (new_image));
+  gimp_image_duplicate_item_tattoos (gimp_image_get_channel_iter (image),
+                                     gimp_image_get_channel_iter (new_image));
+  gimp_image_duplicate_item_tattoos (gimp_image_get_vectors_iter (image),
+                                     gimp_image_get_vectors_iter (new_image));
+
+  if (floating_sel && new_floating_sel)
+    gimp_item_set_tattoo (GIMP_ITEM (new_floating_sel),
+                          gimp_item_get_tattoo (GIMP_ITEM (floating_sel)));
+
+  gimp_item_set_tattoo (GIMP_ITEM (gimp_image_get_mask (new_image)),
+                        gimp_item_get_tattoo (GIMP_ITEM (gimp_image_get_mask (image))));
+
+  gimp_image_set_tattoo_state (new_image, gimp_image_get_tattoo_state (image));
+}
+
+static void
+gimp_image_duplicate_item_tattoos (GList *items,
+                                   GList *new_items)
+{
+  while (items && new_items)
+    {
+      GimpItem      *item     = items->data;
+      GimpItem      *new_item = new_items->data;
+      GimpContainer *children;
+
+      /*  the floating selection is handled separately  */
+      if (GIMP_IS_LAYER (item) &&
+          gimp_layer_is_floating_sel (GIMP_LAYER (item)))
+        {
+          items = g_list_next (items);
+          continue;
+        }
+
+      if (GIMP_IS_LAYER (new_item) &&
+          gimp_layer_is_floating_sel (GIMP_LAYER (new_item)))
+        {
+          new_items = g_list_next (new_items);
+          continue;
+        }
+
+      gimp_item_set_tattoo (new_item, gimp_item_get_tattoo (item));
+
+      if (GIMP_IS_LAYER (item)                    &&
+          gimp_layer_get_mask (GIMP_LAYER (item)) &&
+          gimp_layer_get_mask (GIMP_LAYER (new_item)))
+        {
+          gimp_item_set_tattoo (
+            GIMP_ITEM (gimp_layer_get_mask (GIMP_LAYER (new_item))),
+            gimp_item_get_tattoo (
+              GIMP_ITEM (gimp_layer_get_mask (GIMP_LAYER (item)))));
+        }
+
+      children = gimp_viewable_get_children (GIMP_VIEWABLE (item));
+
+      if (children)
+        {
+          GimpContainer *new_children;
+
+          new_children = gimp_viewable_get_children (GIMP_VIEWABLE (new_item));
+
+          if (new_children)
+            gimp_image_duplicate_item_tattoos (
+              gimp_item_stack_get_item_iter (GIMP_ITEM_STACK (children)),
+              gimp_item_stack_get_item_iter (GIMP_ITEM_STACK (new_children)));
+        }
+
+      items     = g_list_next (items);
+      new_items = g_list_next (new_items);
+    }
+}
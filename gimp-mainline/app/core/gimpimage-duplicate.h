@@ -19,7 +19,8 @@
 #define __GIMP_IMAGE_DUPLICATE_H__
 
 
-GimpImage * gimp_image_duplicate (GimpImage *image);
+GimpImage * gimp_image_duplicate          (GimpImage *image);
+GimpImage * gimp_image_duplicate_snapshot (GimpImage *image);
 
 
 #endif  /*  __GIMP_IMAGE_DUPLICATE_H__  */
@@ -33,6 +33,7 @@ struct _GimpImageFlushAccumulator
 struct _GimpImagePrivate
 {
   gint               ID;                    /*  provides a unique ID         */
+  gboolean           listed;                /*  among gimp->images           */
 
   GimpPlugInProcedure *load_proc;           /*  procedure used for loading   */
   GimpPlugInProcedure *save_proc;           /*  last save procedure used     */
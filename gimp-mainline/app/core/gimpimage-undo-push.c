@@ -249,7 +249,8 @@ gimp_image_undo_push_drawable (GimpImage    *image,
                                GimpDrawable *drawable,
                                GeglBuffer   *buffer,
                                gint          x,
-                               gint          y)
+                               gint          y,
+                               gboolean      delta)
 {
   GimpItem *item;
 
@@ -268,6 +269,7 @@ gimp_image_undo_push_drawable (GimpImage    *image,
                                "buffer", buffer,
                                "x",      x,
                                "y",      y,
+                               "delta",  delta,
                                NULL);
 }
 
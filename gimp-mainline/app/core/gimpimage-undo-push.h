@@ -67,7 +67,8 @@ GimpUndo * gimp_image_undo_push_drawable            (GimpImage     *image,
                                                      GimpDrawable  *drawable,
                                                      GeglBuffer    *buffer,
                                                      gint           x,
-                                                     gint           y);
+                                                     gint           y,
+                                                     gboolean       delta);
 GimpUndo * gimp_image_undo_push_drawable_mod        (GimpImage     *image,
                                                      const gchar   *undo_desc,
                                                      GimpDrawable  *drawable,
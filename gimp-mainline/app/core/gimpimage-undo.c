@@ -41,6 +41,7 @@ static void          gimp_image_undo_pop_stack       (GimpImage     *image,
                                                       GimpUndoStack *redo_stack,
                                                       GimpUndoMode   undo_mode);
 static void          gimp_image_undo_free_space      (GimpImage     *image);
+static gboolean      gimp_image_undo_spill           (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
 static GimpDirtyMask gimp_image_undo_dirty_from_type (GimpUndoType   undo_type);
@@ -483,6 +484,10 @@ gimp_image_undo_pop_stack (GimpImage     *image,
 
       gimp_undo_stack_push_undo (redo_stack, undo);
 
+      /*  start reading back the next step, if it was spilled to disk  */
+      if (gimp_undo_stack_peek (undo_stack))
+        gimp_undo_restore_async (gimp_undo_stack_peek (undo_stack));
+
       if (accum.mode_changed)
         gimp_image_mode_changed (image);
 
@@ -540,8 +545,19 @@ gimp_image_undo_free_space (GimpImage *image)
   while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
          (gimp_container_get_n_children (container) > max_undo_levels))
     {
-      GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
-                                                     GIMP_UNDO_MODE_UNDO);
+      GimpUndo *freed;
+
+      /*  move the oldest steps to disk before freeing any of them.  spilled
+       *  data doesn't count against undo_size, so once nothing more can be
+       *  spilled, steps are freed from the bottom until the data left in
+       *  memory fits again
+       */
+      if (gimp_container_get_n_children (container) <= max_undo_levels &&
+          gimp_image_undo_spill (image))
+        continue;
+
+      freed = gimp_undo_stack_free_bottom (private->undo_stack,
+                                           GIMP_UNDO_MODE_UNDO);
 
 #ifdef DEBUG_IMAGE_UNDO
       g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
@@ -559,6 +575,45 @@ gimp_image_undo_free_space (GimpImage *image)
     }
 }
 
+/* spills the oldest undo step which is not yet on disk, except for the
+ * newest step, which is likely to be undone next.  returns FALSE if there
+ * is nothing left to spill, or if the undo-spill-size limit is reached.
+ */
+static gboolean
+gimp_image_undo_spill (GimpImage *image)
+{
+  GimpImagePrivate *private   = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpContainer    *container = private->undo_stack->undos;
+  gint64            spill_size;
+  GList            *list;
+
+  spill_size = gimp_undo_get_spill_size (GIMP_UNDO (private->undo_stack));
+
+  if (spill_size >= (gint64) image->gimp->config->undo_spill_size)
+    return FALSE;
+
+  for (list = GIMP_LIST (container)->queue->tail;
+       list && list != GIMP_LIST (container)->queue->head;
+       list = g_list_previous (list))
+    {
+      GimpUndo *undo = list->data;
+
+      if (gimp_undo_spill (undo))
+        {
+#ifdef DEBUG_IMAGE_UNDO
+          g_printerr ("spilled one step: undo_steps: %d    undo_bytes: %ld\n",
+                      gimp_container_get_n_children (container),
+                      (glong) gimp_object_get_memsize (GIMP_OBJECT (container),
+                                                       NULL));
+#endif
+
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
 static void
 gimp_image_undo_free_redo (GimpImage *image)
 {
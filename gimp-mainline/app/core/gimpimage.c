@@ -140,7 +140,8 @@ enum
   PROP_PRECISION,
   PROP_METADATA,
   PROP_BUFFER,
-  PROP_SYMMETRY
+  PROP_SYMMETRY,
+  PROP_LISTED
 };
 
 
@@ -670,6 +671,13 @@ gimp_image_class_init (GimpImageClass *klass)
                                                        GIMP_TYPE_SYMMETRY,
                                                        GIMP_PARAM_READWRITE |
                                                        G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (object_class, PROP_LISTED,
+                                   g_param_spec_boolean ("listed",
+                                                         NULL, NULL,
+                                                         TRUE,
+                                                         GIMP_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT_ONLY));
 }
 
 static void
@@ -911,7 +919,8 @@ gimp_image_constructed (GObject *object)
                            G_CALLBACK (gimp_viewable_size_changed),
                            image, G_CONNECT_SWAPPED);
 
-  gimp_container_add (image->gimp->images, GIMP_OBJECT (image));
+  if (private->listed)
+    gimp_container_add (image->gimp->images, GIMP_OBJECT (image));
 }
 
 static void
@@ -983,6 +992,10 @@ gimp_image_set_property (GObject      *object,
       }
       break;
 
+    case PROP_LISTED:
+      private->listed = g_value_get_boolean (value);
+      break;
+
     case PROP_ID:
     case PROP_METADATA:
     case PROP_BUFFER:
@@ -1033,6 +1046,9 @@ gimp_image_get_property (GObject    *object,
                          G_TYPE_FROM_INSTANCE (private->active_symmetry) :
                          G_TYPE_NONE);
       break;
+    case PROP_LISTED:
+      g_value_set_boolean (value, private->listed);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -2825,6 +2841,24 @@ gimp_image_get_xcf_version (GimpImage    *image,
       version = MAX (14, version);
     }
 
+  /* need version 15 for reduced-resolution levels, since older versions
+   * expect them to be empty
+   */
+  if (image->gimp->config->xcf_save_pyramid)
+    {
+      ADD_REASON (g_strdup_printf (_("Reduced-resolution copies of layers "
+                                     "were added in %s"), "GIMP 3.0"));
+      version = MAX (15, version);
+    }
+
+  /* need version 16 for zstd compression */
+  if (zlib_compression && image->gimp->config->xcf_zstd_compression)
+    {
+      ADD_REASON (g_strdup_printf (_("Internal zstd compression was "
+                                     "added in %s"), "GIMP 3.0"));
+      version = MAX (16, version);
+    }
+
 #undef ADD_REASON
 
   switch (version)
@@ -2854,6 +2888,12 @@ gimp_image_get_xcf_version (GimpImage    *image,
       if (gimp_version)   *gimp_version   = 210;
       if (version_string) *version_string = "GIMP 2.10";
       break;
+
+    case 15:
+    case 16:
+      if (gimp_version)   *gimp_version   = 300;
+      if (version_string) *version_string = "GIMP 3.0";
+      break;
     }
 
   if (version_reason && reasons)
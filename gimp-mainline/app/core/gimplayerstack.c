@@ -25,6 +25,8 @@
 
 #include "core-types.h"
 
+#include "gegl/gimp-gegl-nodes.h"
+
 #include "gimplayer.h"
 #include "gimplayerstack.h"
 
@@ -45,6 +47,8 @@ static void   gimp_layer_stack_layer_active            (GimpLayer      *layer,
                                                         GimpLayerStack *stack);
 static void   gimp_layer_stack_layer_excludes_backdrop (GimpLayer      *layer,
                                                         GimpLayerStack *stack);
+static void   gimp_layer_stack_layer_graph_changed     (GimpLayer      *layer,
+                                                        GimpLayerStack *stack);
 
 static void   gimp_layer_stack_update_backdrop         (GimpLayerStack *stack,
                                                         GimpLayer      *layer,
@@ -54,6 +58,9 @@ static void   gimp_layer_stack_update_range            (GimpLayerStack *stack,
                                                         gint            first,
                                                         gint            last);
 
+static void   gimp_layer_stack_paint_cache_setup       (GimpLayerStack *stack);
+static void   gimp_layer_stack_paint_cache_teardown    (GimpLayerStack *stack);
+
 
 G_DEFINE_TYPE (GimpLayerStack, gimp_layer_stack, GIMP_TYPE_DRAWABLE_STACK)
 
@@ -94,6 +101,17 @@ gimp_layer_stack_constructed (GObject *object)
   gimp_container_add_handler (container, "excludes-backdrop-changed",
                               G_CALLBACK (gimp_layer_stack_layer_excludes_backdrop),
                               container);
+
+  /*  these are connected after the filter stack's handlers, and therefore
+   *  run before them, so that the paint cache is torn down before the filter
+   *  stack rewires the graph.
+   */
+  gimp_container_add_handler (container, "active-changed",
+                              G_CALLBACK (gimp_layer_stack_layer_graph_changed),
+                              container);
+  gimp_container_add_handler (container, "effective-mode-changed",
+                              G_CALLBACK (gimp_layer_stack_layer_graph_changed),
+                              container);
 }
 
 static void
@@ -102,9 +120,13 @@ gimp_layer_stack_add (GimpContainer *container,
 {
   GimpLayerStack *stack = GIMP_LAYER_STACK (container);
 
+  gimp_layer_stack_paint_cache_teardown (stack);
+
   GIMP_CONTAINER_CLASS (parent_class)->add (container, object);
 
   gimp_layer_stack_update_backdrop (stack, GIMP_LAYER (object), FALSE, FALSE);
+
+  gimp_layer_stack_paint_cache_setup (stack);
 }
 
 static void
@@ -121,10 +143,20 @@ gimp_layer_stack_remove (GimpContainer *container,
   if (update_backdrop)
     index = gimp_container_get_child_index (container, object);
 
+  gimp_layer_stack_paint_cache_teardown (stack);
+
+  if (stack->paint_layer == GIMP_LAYER (object))
+    {
+      stack->paint_layer = NULL;
+      stack->paint_count = 0;
+    }
+
   GIMP_CONTAINER_CLASS (parent_class)->remove (container, object);
 
   if (update_backdrop)
     gimp_layer_stack_update_range (stack, index, -1);
+
+  gimp_layer_stack_paint_cache_setup (stack);
 }
 
 static void
@@ -142,10 +174,14 @@ gimp_layer_stack_reorder (GimpContainer *container,
   if (update_backdrop)
     index = gimp_container_get_child_index (container, object);
 
+  gimp_layer_stack_paint_cache_teardown (stack);
+
   GIMP_CONTAINER_CLASS (parent_class)->reorder (container, object, new_index);
 
   if (update_backdrop)
     gimp_layer_stack_update_range (stack, index, new_index);
+
+  gimp_layer_stack_paint_cache_setup (stack);
 }
 
 
@@ -163,6 +199,61 @@ gimp_layer_stack_new (GType layer_type)
                        NULL);
 }
 
+/*  while painting on a single layer, the stack's graph is split at the painted
+ *  layer: the composite of the layers below it is cached, and, if all the
+ *  visible layers above it use NORMAL mode with UNION compositing in linear
+ *  RGB (in which case compositing is associative), so is the composite of the
+ *  layers above it, which is then combined with the output of the painted
+ *  layer using a single NORMAL-mode node.  each paint dab then only needs to
+ *  composite the painted layer, rather than the entire stack.
+ *
+ *  both caches are GEGL caches, and are therefore invalidated whenever
+ *  anything below, or above, the painted layer changes.  any structural
+ *  change to the stack tears the split down; the split is rebuilt where
+ *  possible.
+ */
+void
+gimp_layer_stack_start_paint (GimpLayerStack *stack,
+                              GimpLayer      *layer)
+{
+  g_return_if_fail (GIMP_IS_LAYER_STACK (stack));
+  g_return_if_fail (GIMP_IS_LAYER (layer));
+  g_return_if_fail (gimp_container_have (GIMP_CONTAINER (stack),
+                                         GIMP_OBJECT (layer)));
+
+  if (stack->paint_count > 0)
+    {
+      /*  we only ever split the stack at a single layer  */
+      if (layer == stack->paint_layer)
+        stack->paint_count++;
+
+      return;
+    }
+
+  stack->paint_layer = layer;
+  stack->paint_count = 1;
+
+  gimp_layer_stack_paint_cache_setup (stack);
+}
+
+void
+gimp_layer_stack_end_paint (GimpLayerStack *stack,
+                            GimpLayer      *layer)
+{
+  g_return_if_fail (GIMP_IS_LAYER_STACK (stack));
+  g_return_if_fail (GIMP_IS_LAYER (layer));
+
+  if (layer != stack->paint_layer)
+    return;
+
+  if (--stack->paint_count == 0)
+    {
+      gimp_layer_stack_paint_cache_teardown (stack);
+
+      stack->paint_layer = NULL;
+    }
+}
+
 
 /*  private functions  */
 
@@ -180,6 +271,17 @@ gimp_layer_stack_layer_excludes_backdrop (GimpLayer      *layer,
   gimp_layer_stack_update_backdrop (stack, layer, FALSE, TRUE);
 }
 
+static void
+gimp_layer_stack_layer_graph_changed (GimpLayer      *layer,
+                                      GimpLayerStack *stack)
+{
+  /*  the filter stack may be about to rewire the graph, or the layer may no
+   *  longer be eligible for the above-cache; the split is rebuilt on the next
+   *  stroke.
+   */
+  gimp_layer_stack_paint_cache_teardown (stack);
+}
+
 static void
 gimp_layer_stack_update_backdrop (GimpLayerStack *stack,
                                   GimpLayer      *layer,
@@ -241,3 +343,156 @@ gimp_layer_stack_update_range (GimpLayerStack *stack,
         }
     }
 }
+
+static void
+gimp_layer_stack_paint_cache_setup (GimpLayerStack *stack)
+{
+  GeglNode  *graph = GIMP_FILTER_STACK (stack)->graph;
+  GeglNode  *node;
+  GeglNode  *below;
+  GimpLayer *first_above = NULL;
+  gint       n_above     = 0;
+  GList     *list;
+
+  if (! graph || ! stack->paint_layer)
+    return;
+
+  if (stack->below_cache_node || stack->above_combine_node)
+    return;
+
+  if (! gimp_filter_get_active (GIMP_FILTER (stack->paint_layer)))
+    return;
+
+  node = gimp_filter_get_node (GIMP_FILTER (stack->paint_layer));
+
+  /*  cache the composite of everything below the painted layer  */
+  below = gegl_node_get_producer (node, "input", NULL);
+
+  if (below && below != gegl_node_get_input_proxy (graph, "input"))
+    {
+      stack->below_cache_node = gegl_node_new_child (graph,
+                                                     "operation", "gegl:cache",
+                                                     NULL);
+
+      gegl_node_connect_to (below,                   "output",
+                            stack->below_cache_node, "input");
+      gegl_node_connect_to (stack->below_cache_node, "output",
+                            node,                    "input");
+    }
+
+  /*  check whether the layers above can be composited independently  */
+  list = g_list_find (GIMP_LIST (stack)->queue->head, stack->paint_layer);
+
+  for (list = g_list_previous (list); list; list = g_list_previous (list))
+    {
+      GimpLayer              *layer = list->data;
+      GimpLayerMode           mode;
+      GimpLayerColorSpace     composite_space;
+      GimpLayerCompositeMode  composite_mode;
+
+      if (! gimp_filter_get_active (GIMP_FILTER (layer)))
+        continue;
+
+      gimp_layer_get_effective_mode (layer,
+                                     &mode, NULL,
+                                     &composite_space, &composite_mode);
+
+      if (mode            != GIMP_LAYER_MODE_NORMAL            ||
+          composite_space != GIMP_LAYER_COLOR_SPACE_RGB_LINEAR ||
+          composite_mode  != GIMP_LAYER_COMPOSITE_UNION)
+        {
+          return;
+        }
+
+      if (! first_above)
+        first_above = layer;
+
+      n_above++;
+    }
+
+  /*  with a single layer above, there's nothing to gain  */
+  if (n_above > 1)
+    {
+      GeglNode *output = gegl_node_get_output_proxy (graph, "output");
+      GeglNode *top    = gegl_node_get_producer (output, "input", NULL);
+
+      stack->above_first_node   = gimp_filter_get_node (GIMP_FILTER (first_above));
+      stack->above_cache_node   = gegl_node_new_child (graph,
+                                                       "operation", "gegl:cache",
+                                                       NULL);
+      stack->above_combine_node = gegl_node_new_child (graph,
+                                                       "operation", "gimp:normal",
+                                                       NULL);
+
+      gimp_gegl_mode_node_set_mode (stack->above_combine_node,
+                                    GIMP_LAYER_MODE_NORMAL,
+                                    GIMP_LAYER_COLOR_SPACE_AUTO,
+                                    GIMP_LAYER_COLOR_SPACE_RGB_LINEAR,
+                                    GIMP_LAYER_COMPOSITE_UNION);
+      gimp_gegl_mode_node_set_opacity (stack->above_combine_node, 1.0);
+
+      /*  the lowest layer above is composited over nothing, so the top layer
+       *  produces the composite of the layers above alone
+       */
+      gegl_node_disconnect (stack->above_first_node, "input");
+
+      gegl_node_connect_to (top,                       "output",
+                            stack->above_cache_node,   "input");
+      gegl_node_connect_to (node,                      "output",
+                            stack->above_combine_node, "input");
+      gegl_node_connect_to (stack->above_cache_node,   "output",
+                            stack->above_combine_node, "aux");
+      gegl_node_connect_to (stack->above_combine_node, "output",
+                            output,                    "input");
+    }
+}
+
+static void
+gimp_layer_stack_paint_cache_teardown (GimpLayerStack *stack)
+{
+  GeglNode *graph = GIMP_FILTER_STACK (stack)->graph;
+
+  if (stack->above_combine_node)
+    {
+      GeglNode *output = gegl_node_get_output_proxy (graph, "output");
+      GeglNode *top;
+      GeglNode *node;
+
+      top  = gegl_node_get_producer (stack->above_cache_node,   "input", NULL);
+      node = gegl_node_get_producer (stack->above_combine_node, "input", NULL);
+
+      gegl_node_disconnect (stack->above_cache_node,   "input");
+      gegl_node_disconnect (stack->above_combine_node, "input");
+      gegl_node_disconnect (stack->above_combine_node, "aux");
+
+      gegl_node_connect_to (top,  "output",
+                            output, "input");
+      gegl_node_connect_to (node,                    "output",
+                            stack->above_first_node, "input");
+
+      gegl_node_remove_child (graph, stack->above_cache_node);
+      gegl_node_remove_child (graph, stack->above_combine_node);
+
+      stack->above_cache_node   = NULL;
+      stack->above_combine_node = NULL;
+      stack->above_first_node   = NULL;
+    }
+
+  if (stack->below_cache_node)
+    {
+      GeglNode *below;
+      GeglNode *node;
+
+      below = gegl_node_get_producer (stack->below_cache_node, "input", NULL);
+      node  = gimp_filter_get_node (GIMP_FILTER (stack->paint_layer));
+
+      gegl_node_disconnect (stack->below_cache_node, "input");
+
+      gegl_node_connect_to (below, "output",
+                            node,  "input");
+
+      gegl_node_remove_child (graph, stack->below_cache_node);
+
+      stack->below_cache_node = NULL;
+    }
+}
@@ -36,6 +36,14 @@ typedef struct _GimpLayerStackClass GimpLayerStackClass;
 struct _GimpLayerStack
 {
   GimpDrawableStack  parent_instance;
+
+  /*  split-composite cache, used while painting on a single layer  */
+  GimpLayer         *paint_layer;
+  gint               paint_count;
+  GeglNode          *below_cache_node;
+  GeglNode          *above_cache_node;
+  GeglNode          *above_combine_node;
+  GeglNode          *above_first_node;
 };
 
 struct _GimpLayerStackClass
@@ -44,8 +52,13 @@ struct _GimpLayerStackClass
 };
 
 
-GType           gimp_layer_stack_get_type  (void) G_GNUC_CONST;
-GimpContainer * gimp_layer_stack_new       (GType layer_type);
+GType           gimp_layer_stack_get_type    (void) G_GNUC_CONST;
+GimpContainer * gimp_layer_stack_new         (GType           layer_type);
+
+void            gimp_layer_stack_start_paint (GimpLayerStack *stack,
+                                              GimpLayer      *layer);
+void            gimp_layer_stack_end_paint   (GimpLayerStack *stack,
+                                              GimpLayer      *layer);
 
 
 #endif  /*  __GIMP_LAYER_STACK_H__  */
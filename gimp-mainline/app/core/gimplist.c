@@ -84,6 +84,17 @@ static void         gimp_list_uniquefy_name      (GimpList                *gimp_
 static void         gimp_list_object_renamed     (GimpObject              *object,
                                                   GimpList                *list);
 
+static gboolean     gimp_list_split_name         (const gchar             *name,
+                                                  gchar                  **base,
+                                                  gint                    *number);
+static void         gimp_list_index_add          (GimpList                *list,
+                                                  GimpObject              *object);
+static void         gimp_list_index_remove       (GimpList                *list,
+                                                  GimpObject              *object);
+static void         gimp_list_index_reorder      (GimpList                *list,
+                                                  GimpObject              *object);
+static void         gimp_list_index_rebuild      (GimpList                *list);
+
 
 G_DEFINE_TYPE (GimpList, gimp_list, GIMP_TYPE_CONTAINER)
 
@@ -143,6 +154,13 @@ gimp_list_init (GimpList *list)
   list->unique_names = FALSE;
   list->sort_func    = NULL;
   list->append       = FALSE;
+
+  list->name_index    = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_queue_free);
+  list->child_names   = g_hash_table_new (NULL, NULL);
+  list->name_counters = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                               g_free, NULL);
 }
 
 static void
@@ -156,6 +174,10 @@ gimp_list_finalize (GObject *object)
       list->queue = NULL;
     }
 
+  g_clear_pointer (&list->name_index,    g_hash_table_unref);
+  g_clear_pointer (&list->child_names,   g_hash_table_unref);
+  g_clear_pointer (&list->name_counters, g_hash_table_unref);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -230,6 +252,11 @@ gimp_list_get_memsize (GimpObject *object,
       memsize += gimp_g_queue_get_memsize (list->queue, 0);
     }
 
+  memsize += gimp_g_hash_table_get_memsize (list->name_index,
+                                            sizeof (GQueue));
+  memsize += gimp_g_hash_table_get_memsize (list->child_names, 0);
+  memsize += gimp_g_hash_table_get_memsize (list->name_counters, 0);
+
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
 }
@@ -253,10 +280,11 @@ gimp_list_add (GimpContainer *container,
   if (list->unique_names)
     gimp_list_uniquefy_name (list, object);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_connect (object, "name-changed",
-                      G_CALLBACK (gimp_list_object_renamed),
-                      list);
+  gimp_list_index_add (list, object);
+
+  g_signal_connect (object, "name-changed",
+                    G_CALLBACK (gimp_list_object_renamed),
+                    list);
 
   if (list->sort_func)
     {
@@ -272,6 +300,8 @@ gimp_list_add (GimpContainer *container,
       g_queue_push_head (list->queue, object);
     }
 
+  gimp_list_index_reorder (list, object);
+
   GIMP_CONTAINER_CLASS (parent_class)->add (container, object);
 }
 
@@ -281,10 +311,11 @@ gimp_list_remove (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_handlers_disconnect_by_func (object,
-                                          gimp_list_object_renamed,
-                                          list);
+  g_signal_handlers_disconnect_by_func (object,
+                                        gimp_list_object_renamed,
+                                        list);
+
+  gimp_list_index_remove (list, object);
 
   g_queue_remove (list->queue, object);
 
@@ -304,6 +335,8 @@ gimp_list_reorder (GimpContainer *container,
     g_queue_push_tail (list->queue, object);
   else
     g_queue_push_nth (list->queue, object, new_index);
+
+  gimp_list_index_reorder (list, object);
 }
 
 static void
@@ -370,17 +403,15 @@ gimp_list_get_child_by_name (GimpContainer *container,
                              const gchar   *name)
 {
   GimpList *list = GIMP_LIST (container);
-  GList    *glist;
+  GQueue   *children;
 
-  for (glist = list->queue->head; glist; glist = g_list_next (glist))
-    {
-      GimpObject *object = glist->data;
+  children = g_hash_table_lookup (list->name_index, name);
 
-      if (! strcmp (gimp_object_get_name (object), name))
-        return object;
-    }
+  if (! children)
+    return NULL;
 
-  return NULL;
+  /*  the children are in list order, return the first one  */
+  return g_queue_peek_head (children);
 }
 
 static GimpObject *
@@ -484,6 +515,7 @@ gimp_list_reverse (GimpList *list)
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_reverse (list->queue);
+      gimp_list_index_rebuild (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -548,6 +580,7 @@ gimp_list_sort (GimpList     *list,
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       g_queue_sort (list->queue, gimp_list_sort_func, sort_func);
+      gimp_list_index_rebuild (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -573,86 +606,49 @@ static void
 gimp_list_uniquefy_name (GimpList   *gimp_list,
                          GimpObject *object)
 {
-  gchar *name = (gchar *) gimp_object_get_name (object);
-  GList *list;
-
-  if (! name)
+  const gchar *name = gimp_object_get_name (object);
+  gchar       *base;
+  gchar       *new_name   = NULL;
+  gint         unique_ext = 0;
+  gint         n_taken;
+
+  /*  @object is never in the index here  */
+  if (! name || ! g_hash_table_contains (gimp_list->name_index, name))
     return;
 
-  for (list = gimp_list->queue->head; list; list = g_list_next (list))
+  if (! gimp_list_split_name (name, &base, &unique_ext))
     {
-      GimpObject  *object2 = list->data;
-      const gchar *name2   = gimp_object_get_name (object2);
-
-      if (object != object2 &&
-          name2             &&
-          ! strcmp (name, name2))
-        break;
+      base       = g_strdup (name);
+      unique_ext = 0;
     }
 
-  if (list)
-    {
-      gchar *ext;
-      gchar *new_name   = NULL;
-      gint   unique_ext = 0;
-
-      name = g_strdup (name);
-
-      ext = strrchr (name, '#');
-
-      if (ext)
-        {
-          gchar ext_str[8];
-
-          unique_ext = atoi (ext + 1);
-
-          g_snprintf (ext_str, sizeof (ext_str), "%d", unique_ext);
-
-          /*  check if the extension really is of the form "#<n>"  */
-          if (! strcmp (ext_str, ext + 1))
-            {
-              if (ext > name && *(ext - 1) == ' ')
-                ext--;
-
-              *ext = '\0';
-            }
-          else
-            {
-              unique_ext = 0;
-            }
-        }
-
-      do
-        {
-          unique_ext++;
+  /*  "base #1" to "base #n_taken" are all taken, skip them  */
+  n_taken = GPOINTER_TO_INT (g_hash_table_lookup (gimp_list->name_counters,
+                                                  base));
+  if (unique_ext >= 0)
+    unique_ext = MAX (unique_ext, n_taken);
 
-          g_free (new_name);
-
-          new_name = g_strdup_printf ("%s #%d", name, unique_ext);
+  do
+    {
+      unique_ext++;
 
-          for (list = gimp_list->queue->head; list; list = g_list_next (list))
-            {
-              GimpObject  *object2 = list->data;
-              const gchar *name2   = gimp_object_get_name (object2);
+      g_free (new_name);
 
-              if (object != object2 &&
-                  name2             &&
-                  ! strcmp (new_name, name2))
-                break;
-            }
-        }
-      while (list);
+      new_name = g_strdup_printf ("%s #%d", base, unique_ext);
+    }
+  while (g_hash_table_contains (gimp_list->name_index, new_name));
 
-      g_free (name);
+  g_free (base);
 
-      gimp_object_take_name (object, new_name);
-    }
+  gimp_object_take_name (object, new_name);
 }
 
 static void
 gimp_list_object_renamed (GimpObject *object,
                           GimpList   *list)
 {
+  gimp_list_index_remove (list, object);
+
   if (list->unique_names)
     {
       g_signal_handlers_block_by_func (object,
@@ -666,6 +662,9 @@ gimp_list_object_renamed (GimpObject *object,
                                          list);
     }
 
+  gimp_list_index_add (list, object);
+  gimp_list_index_reorder (list, object);
+
   if (list->sort_func)
     {
       GList *glist;
@@ -691,3 +690,209 @@ gimp_list_object_renamed (GimpObject *object,
         gimp_container_reorder (GIMP_CONTAINER (list), object, new_index);
     }
 }
+
+/*  splits "foo #3" into "foo" and 3, like gimp_list_uniquefy_name()
+ *  always did
+ */
+static gboolean
+gimp_list_split_name (const gchar  *name,
+                      gchar       **base,
+                      gint         *number)
+{
+  const gchar *ext = strrchr (name, '#');
+  gchar        ext_str[8];
+  gint         n;
+
+  if (! ext)
+    return FALSE;
+
+  n = atoi (ext + 1);
+
+  g_snprintf (ext_str, sizeof (ext_str), "%d", n);
+
+  /*  check if the extension really is of the form "#<n>"  */
+  if (strcmp (ext_str, ext + 1))
+    return FALSE;
+
+  if (ext > name && *(ext - 1) == ' ')
+    ext--;
+
+  *base   = g_strndup (name, ext - name);
+  *number = n;
+
+  return TRUE;
+}
+
+static void
+gimp_list_index_add (GimpList   *list,
+                     GimpObject *object)
+{
+  const gchar *name = gimp_object_get_name (object);
+  gchar       *key;
+  GQueue      *children;
+  gchar       *base;
+  gint         number;
+
+  if (! name)
+    return;
+
+  if (! g_hash_table_lookup_extended (list->name_index, name,
+                                      (gpointer *) &key,
+                                      (gpointer *) &children))
+    {
+      key      = g_strdup (name);
+      children = g_queue_new ();
+
+      g_hash_table_insert (list->name_index, key, children);
+    }
+
+  g_queue_push_tail (children, object);
+  g_hash_table_insert (list->child_names, object, key);
+
+  if (list->unique_names && gimp_list_split_name (name, &base, &number))
+    {
+      gint n_taken;
+
+      n_taken = GPOINTER_TO_INT (g_hash_table_lookup (list->name_counters,
+                                                      base));
+
+      if (number == n_taken + 1)
+        {
+          gchar *next = NULL;
+
+          /*  extend the run of taken names as far as it goes  */
+          do
+            {
+              n_taken++;
+
+              g_free (next);
+
+              next = g_strdup_printf ("%s #%d", base, n_taken + 1);
+            }
+          while (g_hash_table_contains (list->name_index, next));
+
+          g_free (next);
+
+          g_hash_table_insert (list->name_counters, base,
+                               GINT_TO_POINTER (n_taken));
+        }
+      else
+        {
+          g_free (base);
+        }
+    }
+}
+
+static void
+gimp_list_index_remove (GimpList   *list,
+                        GimpObject *object)
+{
+  gchar  *key;
+  GQueue *children;
+  gchar  *base;
+  gint    number;
+
+  key = g_hash_table_lookup (list->child_names, object);
+
+  if (! key)
+    return;
+
+  g_hash_table_remove (list->child_names, object);
+
+  children = g_hash_table_lookup (list->name_index, key);
+  g_queue_remove (children, object);
+
+  if (list->unique_names && gimp_list_split_name (key, &base, &number))
+    {
+      gint n_taken;
+
+      n_taken = GPOINTER_TO_INT (g_hash_table_lookup (list->name_counters,
+                                                      base));
+
+      if (number >= 1 && number <= n_taken)
+        {
+          if (number > 1)
+            {
+              g_hash_table_insert (list->name_counters, base,
+                                   GINT_TO_POINTER (number - 1));
+            }
+          else
+            {
+              g_hash_table_remove (list->name_counters, base);
+              g_free (base);
+            }
+        }
+      else
+        {
+          g_free (base);
+        }
+    }
+
+  /*  frees key  */
+  if (g_queue_is_empty (children))
+    g_hash_table_remove (list->name_index, key);
+}
+
+/*  moves @object to its place in list order among the children that have
+ *  the same name.  this only walks the list if there are several of them.
+ */
+static void
+gimp_list_index_reorder (GimpList   *list,
+                         GimpObject *object)
+{
+  gchar  *key;
+  GQueue *children;
+  GList  *glist;
+  gint    index = 0;
+
+  key = g_hash_table_lookup (list->child_names, object);
+
+  if (! key)
+    return;
+
+  children = g_hash_table_lookup (list->name_index, key);
+
+  if (children->length == 1)
+    return;
+
+  g_queue_remove (children, object);
+
+  for (glist = list->queue->head;
+       glist && glist->data != object && index < children->length;
+       glist = g_list_next (glist))
+    {
+      if (g_hash_table_lookup (list->child_names, glist->data) == key)
+        index++;
+    }
+
+  g_queue_push_nth (children, object, index);
+}
+
+static void
+gimp_list_index_clear_func (gpointer key,
+                            GQueue  *children,
+                            gpointer data)
+{
+  g_queue_clear (children);
+}
+
+/*  puts all children back into list order, after the whole list was
+ *  reordered
+ */
+static void
+gimp_list_index_rebuild (GimpList *list)
+{
+  GList *glist;
+
+  g_hash_table_foreach (list->name_index,
+                        (GHFunc) gimp_list_index_clear_func, NULL);
+
+  for (glist = list->queue->head; glist; glist = g_list_next (glist))
+    {
+      gchar *key = g_hash_table_lookup (list->child_names, glist->data);
+
+      if (key)
+        g_queue_push_tail (g_hash_table_lookup (list->name_index, key),
+                           glist->data);
+    }
+}
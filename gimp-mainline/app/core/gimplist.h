@@ -43,6 +43,10 @@ struct _GimpList
   gboolean       unique_names;
   GCompareFunc   sort_func;
   gboolean       append;
+
+  GHashTable    *name_index;    /*  name  -> GQueue of children       */
+  GHashTable    *child_names;   /*  child -> its key in name_index    */
+  GHashTable    *name_counters; /*  "foo" -> n if "foo #1..n" exist   */
 };
 
 struct _GimpListClass
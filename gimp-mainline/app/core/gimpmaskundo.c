@@ -26,9 +26,17 @@
 
 #include "gegl/gimp-gegl-loops.h"
 
+#include "gimp.h"
 #include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
+#include "gimpcancelable.h"
 #include "gimpchannel.h"
+#include "gimpimage.h"
 #include "gimpmaskundo.h"
+#include "gimpwaitable.h"
+
+#include "gimp-intl.h"
 
 
 enum
@@ -38,6 +46,13 @@ enum
 };
 
 
+typedef struct
+{
+  GeglBuffer *buffer;
+  GFile      *file;
+} SpillData;
+
+
 static void     gimp_mask_undo_constructed  (GObject             *object);
 static void     gimp_mask_undo_set_property (GObject             *object,
                                              guint                property_id,
@@ -56,6 +71,25 @@ static void     gimp_mask_undo_pop          (GimpUndo            *undo,
                                              GimpUndoAccumulator *accum);
 static void     gimp_mask_undo_free         (GimpUndo            *undo,
                                              GimpUndoMode         undo_mode);
+static gboolean gimp_mask_undo_spill        (GimpUndo            *undo);
+static gint64   gimp_mask_undo_get_spill_size
+                                            (GimpUndo            *undo);
+static void     gimp_mask_undo_restore      (GimpUndo            *undo);
+
+static void     gimp_mask_undo_spill_func   (GimpAsync           *async,
+                                             SpillData           *data);
+static void     gimp_mask_undo_spill_callback
+                                            (GimpAsync           *async,
+                                             GimpMaskUndo        *mask_undo);
+static void     gimp_mask_undo_restore_func (GimpAsync           *async,
+                                             gchar               *path);
+static void     gimp_mask_undo_restore_callback
+                                            (GimpAsync           *async,
+                                             GimpMaskUndo        *mask_undo);
+static void     gimp_mask_undo_clear_spill_file
+                                            (GimpMaskUndo        *mask_undo);
+
+static void     spill_data_free             (SpillData           *data);
 
 
 G_DEFINE_TYPE (GimpMaskUndo, gimp_mask_undo, GIMP_TYPE_ITEM_UNDO)
@@ -78,6 +112,9 @@ gimp_mask_undo_class_init (GimpMaskUndoClass *klass)
 
   undo_class->pop                = gimp_mask_undo_pop;
   undo_class->free               = gimp_mask_undo_free;
+  undo_class->spill              = gimp_mask_undo_spill;
+  undo_class->get_spill_size     = gimp_mask_undo_get_spill_size;
+  undo_class->restore            = gimp_mask_undo_restore;
 
   g_object_class_install_property (object_class, PROP_CONVERT_FORMAT,
                                    g_param_spec_boolean ("convert-format",
@@ -180,7 +217,9 @@ gimp_mask_undo_get_memsize (GimpObject *object,
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (object);
   gint64        memsize   = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (mask_undo->buffer);
+  /*  a buffer which is being spilled counts as being on disk already  */
+  if (! mask_undo->spill_file)
+    memsize += gimp_gegl_buffer_get_memsize (mask_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -199,9 +238,39 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   GeglRectangle  bounds     = {};
   GeglRectangle  rect       = {};
   const Babl    *format;
+  gboolean       lost       = FALSE;
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
+  /*  the buffer is still in memory if the spill didn't finish yet  */
+  if (mask_undo->spill_async)
+    gimp_async_cancel_and_wait (mask_undo->spill_async);
+
+  if (mask_undo->restore_async)
+    gimp_waitable_wait (GIMP_WAITABLE (mask_undo->restore_async));
+
+  if (mask_undo->spill_file)
+    {
+      /*  the buffer wasn't read back in the background  */
+      gchar *path = g_file_get_path (mask_undo->spill_file);
+
+      mask_undo->buffer = gegl_buffer_load (path);
+
+      if (! mask_undo->buffer)
+        {
+          gimp_message (undo->image->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        _("Could not read back the undo step \"%s\" "
+                          "from disk, the mask it restores is lost."),
+                        gimp_object_get_name (undo));
+
+          lost = TRUE;
+        }
+
+      g_free (path);
+
+      gimp_mask_undo_clear_spill_file (mask_undo);
+    }
+
   format = gimp_drawable_get_format (drawable);
 
   if (gimp_item_bounds (item,
@@ -225,6 +294,15 @@ gimp_mask_undo_pop (GimpUndo            *undo,
       gegl_buffer_clear (buffer, &rect);
     }
 
+  if (lost)
+    {
+      /*  leave the mask as it is, now and when the undo is redone  */
+      mask_undo->buffer = new_buffer ? g_object_ref (new_buffer) : NULL;
+      mask_undo->bounds = bounds;
+      mask_undo->x      = rect.x;
+      mask_undo->y      = rect.y;
+    }
+
   if (mask_undo->convert_format)
     {
       GeglBuffer *buffer;
@@ -288,7 +366,206 @@ gimp_mask_undo_free (GimpUndo     *undo,
 {
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
 
+  if (mask_undo->spill_async)
+    gimp_async_cancel_and_wait (mask_undo->spill_async);
+
+  if (mask_undo->restore_async)
+    gimp_async_cancel_and_wait (mask_undo->restore_async);
+
   g_clear_object (&mask_undo->buffer);
 
+  gimp_mask_undo_clear_spill_file (mask_undo);
+
   GIMP_UNDO_CLASS (parent_class)->free (undo, undo_mode);
 }
+
+static gboolean
+gimp_mask_undo_spill (GimpUndo *undo)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+  SpillData    *data;
+
+  if (! mask_undo->buffer      ||
+      mask_undo->spill_file    ||
+      mask_undo->spill_failed)
+    {
+      return FALSE;
+    }
+
+  mask_undo->spill_file = gimp_get_temp_file (undo->image->gimp, "undo");
+  mask_undo->spill_size = gimp_gegl_buffer_get_memsize (mask_undo->buffer);
+
+  data = g_slice_new (SpillData);
+
+  data->buffer = g_object_ref (mask_undo->buffer);
+  data->file   = g_object_ref (mask_undo->spill_file);
+
+  mask_undo->spill_async = gimp_parallel_run_async_full (
+    +10,
+    (GimpRunAsyncFunc) gimp_mask_undo_spill_func,
+    data, (GDestroyNotify) spill_data_free);
+
+  gimp_async_add_callback_for_object (
+    mask_undo->spill_async,
+    (GimpAsyncCallback) gimp_mask_undo_spill_callback,
+    mask_undo,
+    mask_undo);
+
+  return TRUE;
+}
+
+static gint64
+gimp_mask_undo_get_spill_size (GimpUndo *undo)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  return mask_undo->spill_size;
+}
+
+static void
+gimp_mask_undo_restore (GimpUndo *undo)
+{
+  GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (undo);
+
+  /*  the buffer is still in memory, don't bother finishing the spill  */
+  if (mask_undo->spill_async)
+    {
+      gimp_cancelable_cancel (GIMP_CANCELABLE (mask_undo->spill_async));
+
+      return;
+    }
+
+  if (! mask_undo->spill_file || mask_undo->restore_async)
+    return;
+
+  mask_undo->restore_async = gimp_parallel_run_async_full (
+    +10,
+    (GimpRunAsyncFunc) gimp_mask_undo_restore_func,
+    g_file_get_path (mask_undo->spill_file),
+    (GDestroyNotify) g_free);
+
+  gimp_async_add_callback_for_object (
+    mask_undo->restore_async,
+    (GimpAsyncCallback) gimp_mask_undo_restore_callback,
+    mask_undo,
+    mask_undo);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_mask_undo_spill_func (GimpAsync *async,
+                           SpillData *data)
+{
+  GFileInfo *info;
+  gchar     *path;
+
+  if (gimp_async_is_canceled (async))
+    {
+      gimp_async_abort (async);
+
+      return;
+    }
+
+  path = g_file_get_path (data->file);
+
+  gegl_buffer_save (data->buffer, path, NULL);
+
+  g_free (path);
+
+  /*  gegl_buffer_save() doesn't report errors, so check what it wrote  */
+  info = g_file_query_info (data->file, G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+
+  if (info && g_file_info_get_size (info) > 0)
+    {
+      gimp_async_finish_full (async, info, g_object_unref);
+    }
+  else
+    {
+      g_clear_object (&info);
+
+      gimp_async_abort (async);
+    }
+}
+
+static void
+gimp_mask_undo_spill_callback (GimpAsync    *async,
+                               GimpMaskUndo *mask_undo)
+{
+  if (gimp_async_is_finished (async))
+    {
+      GFileInfo *info = gimp_async_get_result (async);
+
+      mask_undo->spill_size = g_file_info_get_size (info);
+
+      g_clear_object (&mask_undo->buffer);
+    }
+  else
+    {
+      /*  canceled or failed, keep the buffer in memory  */
+      gimp_mask_undo_clear_spill_file (mask_undo);
+
+      if (! gimp_async_is_canceled (async))
+        {
+          GimpUndo *undo = GIMP_UNDO (mask_undo);
+
+          gimp_message (undo->image->gimp, NULL, GIMP_MESSAGE_WARNING,
+                        _("Could not move the undo step \"%s\" to disk."),
+                        gimp_object_get_name (undo));
+
+          mask_undo->spill_failed = TRUE;
+        }
+    }
+
+  g_clear_object (&mask_undo->spill_async);
+}
+
+static void
+gimp_mask_undo_restore_func (GimpAsync *async,
+                             gchar     *path)
+{
+  GeglBuffer *buffer = gegl_buffer_load (path);
+
+  if (buffer)
+    gimp_async_finish_full (async, buffer, g_object_unref);
+  else
+    gimp_async_abort (async);
+}
+
+static void
+gimp_mask_undo_restore_callback (GimpAsync    *async,
+                                 GimpMaskUndo *mask_undo)
+{
+  if (gimp_async_is_finished (async))
+    {
+      mask_undo->buffer = g_object_ref (gimp_async_get_result (async));
+
+      gimp_mask_undo_clear_spill_file (mask_undo);
+    }
+
+  g_clear_object (&mask_undo->restore_async);
+}
+
+static void
+gimp_mask_undo_clear_spill_file (GimpMaskUndo *mask_undo)
+{
+  if (mask_undo->spill_file)
+    {
+      g_file_delete (mask_undo->spill_file, NULL, NULL);
+
+      g_clear_object (&mask_undo->spill_file);
+    }
+
+  mask_undo->spill_size = 0;
+}
+
+static void
+spill_data_free (SpillData *data)
+{
+  g_object_unref (data->buffer);
+  g_object_unref (data->file);
+
+  g_slice_free (SpillData, data);
+}
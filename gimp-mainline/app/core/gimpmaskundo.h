@@ -44,6 +44,15 @@ struct _GimpMaskUndo
   GeglRectangle  bounds;
   gint           x;
   gint           y;
+
+  /* the scratch file holding 'buffer' while the undo is spilled, set as
+   * soon as writing the file is started by 'spill_async'
+   */
+  GFile         *spill_file;
+  gint64         spill_size;
+  gboolean       spill_failed;
+  GimpAsync     *spill_async;
+  GimpAsync     *restore_async;
 };
 
 struct _GimpMaskUndoClass
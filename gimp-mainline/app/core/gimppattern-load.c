@@ -26,6 +26,8 @@
 
 #include "core-types.h"
 
+#include "gimpcontext.h"
+#include "gimpdataloaderfactory.h"
 #include "gimppattern.h"
 #include "gimppattern-header.h"
 #include "gimppattern-load.h"
@@ -34,111 +36,72 @@
 #include "gimp-intl.h"
 
 
+static gboolean   gimp_pattern_load_header (GFile              *file,
+                                           GInputStream       *input,
+                                           GimpPatternHeader  *header,
+                                           gchar             **name,
+                                           GError            **error);
+
+
+/*  public functions  */
+
 GList *
 gimp_pattern_load (GimpContext   *context,
                    GFile         *file,
                    GInputStream  *input,
                    GError       **error)
 {
-  GimpPattern       *pattern = NULL;
-  const Babl        *format  = NULL;
+  GimpPattern       *pattern;
   GimpPatternHeader  header;
-  gsize              size;
-  gsize              bytes_read;
-  gsize              bn_size;
-  gchar             *name = NULL;
+  gchar             *name;
 
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
   g_return_val_if_fail (G_IS_FILE (file), NULL);
   g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  /*  read the size  */
-  if (! g_input_stream_read_all (input, &header, sizeof (header),
-                                 &bytes_read, NULL, error) ||
-      bytes_read != sizeof (header))
+  /*  only read the header here, the pixels are loaded by
+   *  gimp_pattern_load_contents() when the pattern is first used
+   */
+  if (! gimp_pattern_load_header (file, input, &header, &name, error))
     {
-      g_prefix_error (error, _("File appears truncated: "));
-      goto error;
+      g_prefix_error (error, _("Fatal parse error in pattern file: "));
+      return NULL;
     }
 
-  /*  rearrange the bytes in each unsigned int  */
-  header.header_size  = g_ntohl (header.header_size);
-  header.version      = g_ntohl (header.version);
-  header.width        = g_ntohl (header.width);
-  header.height       = g_ntohl (header.height);
-  header.bytes        = g_ntohl (header.bytes);
-  header.magic_number = g_ntohl (header.magic_number);
-
-  /*  Check for correct file format */
-  if (header.magic_number != GIMP_PATTERN_MAGIC ||
-      header.version      != 1                  ||
-      header.header_size  <= sizeof (header))
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Unknown pattern format version %d."),
-                   header.version);
-      goto error;
-    }
-
-  /*  Check for supported bit depths  */
-  if (header.bytes < 1 || header.bytes > 4)
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Unsupported pattern depth %d.\n"
-                     "GIMP Patterns must be GRAY or RGB."),
-                   header.bytes);
-      goto error;
-    }
-
-  /*  Validate dimensions  */
-  if ((header.width  == 0) || (header.width  > GIMP_PATTERN_MAX_SIZE) ||
-      (header.height == 0) || (header.height > GIMP_PATTERN_MAX_SIZE) ||
-      (G_MAXSIZE / header.width / header.height / header.bytes < 1))
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                   _("Invalid header data in '%s': width=%lu, height=%lu, "
-                     "bytes=%lu"), gimp_file_get_utf8_name (file),
-                   (gulong) header.width,
-                   (gulong) header.height,
-                   (gulong) header.bytes);
-      goto error;
-    }
+  pattern = g_object_new (GIMP_TYPE_PATTERN,
+                          "name",      name,
+                          "mime-type", "image/x-gimp-pat",
+                          NULL);
+  g_free (name);
 
-  /*  Read in the pattern name  */
-  if ((bn_size = (header.header_size - sizeof (header))))
-    {
-      gchar *utf8;
+  pattern->lazy_width  = header.width;
+  pattern->lazy_height = header.height;
 
-      if (bn_size > GIMP_PATTERN_MAX_NAME)
-        {
-          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                       _("Invalid header data in '%s': "
-                         "Pattern name is too long: %lu"),
-                       gimp_file_get_utf8_name (file),
-                       (gulong) bn_size);
-          goto error;
-        }
+  gimp_data_set_lazy (GIMP_DATA (pattern), context->gimp);
 
-      name = g_new0 (gchar, bn_size + 1);
+  return g_list_prepend (NULL, pattern);
+}
 
-      if (! g_input_stream_read_all (input, name, bn_size,
-                                     &bytes_read, NULL, error) ||
-          bytes_read != bn_size)
-        {
-          g_prefix_error (error, _("File appears truncated."));
-          g_free (name);
-          goto error;
-        }
+GimpPattern *
+gimp_pattern_load_pattern (GimpContext   *context,
+                           GFile         *file,
+                           GInputStream  *input,
+                           GError       **error)
+{
+  GimpPattern       *pattern = NULL;
+  const Babl        *format  = NULL;
+  GimpPatternHeader  header;
+  gsize              size;
+  gsize              bytes_read;
+  gchar             *name;
 
-      utf8 = gimp_any_to_utf8 (name, bn_size - 1,
-                               _("Invalid UTF-8 string in pattern file '%s'."),
-                               gimp_file_get_utf8_name (file));
-      g_free (name);
-      name = utf8;
-    }
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_INPUT_STREAM (input), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  if (! name)
-    name = g_strdup (_("Unnamed"));
+  if (! gimp_pattern_load_header (file, input, &header, &name, error))
+    goto error;
 
   pattern = g_object_new (GIMP_TYPE_PATTERN,
                           "name",      name,
@@ -167,7 +130,10 @@ gimp_pattern_load (GimpContext   *context,
       goto error;
     }
 
-  return g_list_prepend (NULL, pattern);
+  pattern->lazy_width  = header.width;
+  pattern->lazy_height = header.height;
+
+  return pattern;
 
  error:
 
@@ -179,6 +145,55 @@ gimp_pattern_load (GimpContext   *context,
   return NULL;
 }
 
+gboolean
+gimp_pattern_load_contents (GimpData  *data,
+                            GError   **error)
+{
+  GimpPattern  *pattern = GIMP_PATTERN (data);
+  GFile        *file;
+  GInputStream *input;
+  GimpPattern  *loaded  = NULL;
+
+  g_return_val_if_fail (GIMP_IS_PATTERN (pattern), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  file  = gimp_data_get_file (data);
+  input = G_INPUT_STREAM (g_file_read (file, NULL, error));
+
+  if (input)
+    {
+      GInputStream *buffered = g_buffered_input_stream_new (input);
+
+      loaded = gimp_pattern_load_pattern (NULL, file, buffered, error);
+
+      g_object_unref (buffered);
+      g_object_unref (input);
+    }
+
+  if (! loaded)
+    {
+      /*  keep the pattern usable, it may have changed on disk  */
+      pattern->mask = gimp_temp_buf_new (pattern->lazy_width,
+                                         pattern->lazy_height,
+                                         babl_format ("R'G'B' u8"));
+      gimp_temp_buf_data_clear (pattern->mask);
+
+      g_prefix_error (error, _("Error loading '%s': "),
+                      gimp_file_get_utf8_name (file));
+
+      return FALSE;
+    }
+
+  pattern->mask = g_steal_pointer (&loaded->mask);
+
+  pattern->lazy_width  = gimp_temp_buf_get_width  (pattern->mask);
+  pattern->lazy_height = gimp_temp_buf_get_height (pattern->mask);
+
+  g_object_unref (loaded);
+
+  return TRUE;
+}
+
 GList *
 gimp_pattern_load_pixbuf (GimpContext   *context,
                           GFile         *file,
@@ -217,3 +232,110 @@ gimp_pattern_load_pixbuf (GimpContext   *context,
 
   return g_list_prepend (NULL, pattern);
 }
+
+
+/*  private functions  */
+
+static gboolean
+gimp_pattern_load_header (GFile              *file,
+                          GInputStream       *input,
+                          GimpPatternHeader  *header,
+                          gchar             **name,
+                          GError            **error)
+{
+  gsize bytes_read;
+  gsize bn_size;
+
+  *name = NULL;
+
+  /*  read the size  */
+  if (! g_input_stream_read_all (input, header, sizeof (GimpPatternHeader),
+                                 &bytes_read, NULL, error) ||
+      bytes_read != sizeof (GimpPatternHeader))
+    {
+      g_prefix_error (error, _("File appears truncated: "));
+      return FALSE;
+    }
+
+  /*  rearrange the bytes in each unsigned int  */
+  header->header_size  = g_ntohl (header->header_size);
+  header->version      = g_ntohl (header->version);
+  header->width        = g_ntohl (header->width);
+  header->height       = g_ntohl (header->height);
+  header->bytes        = g_ntohl (header->bytes);
+  header->magic_number = g_ntohl (header->magic_number);
+
+  /*  Check for correct file format */
+  if (header->magic_number != GIMP_PATTERN_MAGIC ||
+      header->version      != 1                  ||
+      header->header_size  <= sizeof (GimpPatternHeader))
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Unknown pattern format version %d."),
+                   header->version);
+      return FALSE;
+    }
+
+  /*  Check for supported bit depths  */
+  if (header->bytes < 1 || header->bytes > 4)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Unsupported pattern depth %d.\n"
+                     "GIMP Patterns must be GRAY or RGB."),
+                   header->bytes);
+      return FALSE;
+    }
+
+  /*  Validate dimensions  */
+  if ((header->width  == 0) || (header->width  > GIMP_PATTERN_MAX_SIZE) ||
+      (header->height == 0) || (header->height > GIMP_PATTERN_MAX_SIZE) ||
+      (G_MAXSIZE / header->width / header->height / header->bytes < 1))
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Invalid header data in '%s': width=%lu, height=%lu, "
+                     "bytes=%lu"), gimp_file_get_utf8_name (file),
+                   (gulong) header->width,
+                   (gulong) header->height,
+                   (gulong) header->bytes);
+      return FALSE;
+    }
+
+  /*  Read in the pattern name  */
+  if ((bn_size = (header->header_size - sizeof (GimpPatternHeader))))
+    {
+      gchar *utf8;
+
+      if (bn_size > GIMP_PATTERN_MAX_NAME)
+        {
+          g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                       _("Invalid header data in '%s': "
+                         "Pattern name is too long: %lu"),
+                       gimp_file_get_utf8_name (file),
+                       (gulong) bn_size);
+          return FALSE;
+        }
+
+      *name = g_new0 (gchar, bn_size + 1);
+
+      if (! g_input_stream_read_all (input, *name, bn_size,
+                                     &bytes_read, NULL, error) ||
+          bytes_read != bn_size)
+        {
+          g_prefix_error (error, _("File appears truncated."));
+          g_clear_pointer (name, g_free);
+          return FALSE;
+        }
+
+      utf8 = gimp_data_loader_factory_any_to_utf8 (
+               *name, bn_size - 1,
+               _("Invalid UTF-8 string in pattern file '%s'."),
+               gimp_file_get_utf8_name (file));
+      g_free (*name);
+      *name = utf8;
+    }
+
+  if (! *name)
+    *name = g_strdup (_("Unnamed"));
+
+  return TRUE;
+}
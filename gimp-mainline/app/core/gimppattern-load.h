@@ -22,14 +22,19 @@
 #define GIMP_PATTERN_FILE_EXTENSION ".pat"
 
 
-GList * gimp_pattern_load        (GimpContext   *context,
-                                  GFile         *file,
-                                  GInputStream  *input,
-                                  GError       **error);
-GList * gimp_pattern_load_pixbuf (GimpContext   *context,
-                                  GFile         *file,
-                                  GInputStream  *input,
-                                  GError       **error);
-
+GList       * gimp_pattern_load          (GimpContext   *context,
+                                          GFile         *file,
+                                          GInputStream  *input,
+                                          GError       **error);
+GimpPattern * gimp_pattern_load_pattern  (GimpContext   *context,
+                                          GFile         *file,
+                                          GInputStream  *input,
+                                          GError       **error);
+gboolean      gimp_pattern_load_contents (GimpData      *data,
+                                          GError       **error);
+GList       * gimp_pattern_load_pixbuf   (GimpContext   *context,
+                                          GFile         *file,
+                                          GInputStream  *input,
+                                          GError       **error);
 
 #endif /* __GIMP_PATTERN_LOAD_H__ */
@@ -56,9 +56,14 @@ static gchar       * gimp_pattern_get_description   (GimpViewable         *viewa
 static const gchar * gimp_pattern_get_extension     (GimpData             *data);
 static void          gimp_pattern_copy              (GimpData             *data,
                                                      GimpData             *src_data);
+static gboolean      gimp_pattern_unload_contents   (GimpData             *data);
 
 static gchar       * gimp_pattern_get_checksum      (GimpTagged           *tagged);
 
+static void          gimp_pattern_get_mask_size     (GimpPattern          *pattern,
+                                                     gint                 *width,
+                                                     gint                 *height);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpPattern, gimp_pattern, GIMP_TYPE_DATA,
                          G_IMPLEMENT_INTERFACE (GIMP_TYPE_TAGGED,
@@ -87,6 +92,8 @@ gimp_pattern_class_init (GimpPatternClass *klass)
   data_class->save                  = gimp_pattern_save;
   data_class->get_extension         = gimp_pattern_get_extension;
   data_class->copy                  = gimp_pattern_copy;
+  data_class->load_contents         = gimp_pattern_load_contents;
+  data_class->unload_contents       = gimp_pattern_unload_contents;
 }
 
 static void
@@ -131,8 +138,7 @@ gimp_pattern_get_size (GimpViewable *viewable,
 {
   GimpPattern *pattern = GIMP_PATTERN (viewable);
 
-  *width  = gimp_temp_buf_get_width  (pattern->mask);
-  *height = gimp_temp_buf_get_height (pattern->mask);
+  gimp_pattern_get_mask_size (pattern, width, height);
 
   return TRUE;
 }
@@ -150,6 +156,8 @@ gimp_pattern_get_new_preview (GimpViewable *viewable,
   gint         copy_width;
   gint         copy_height;
 
+  gimp_data_ensure_contents (GIMP_DATA (pattern));
+
   copy_width  = MIN (width,  gimp_temp_buf_get_width  (pattern->mask));
   copy_height = MIN (height, gimp_temp_buf_get_height (pattern->mask));
 
@@ -175,11 +183,14 @@ gimp_pattern_get_description (GimpViewable  *viewable,
                               gchar        **tooltip)
 {
   GimpPattern *pattern = GIMP_PATTERN (viewable);
+  gint         width;
+  gint         height;
+
+  gimp_pattern_get_mask_size (pattern, &width, &height);
 
   return g_strdup_printf ("%s (%d × %d)",
                           gimp_object_get_name (pattern),
-                          gimp_temp_buf_get_width  (pattern->mask),
-                          gimp_temp_buf_get_height (pattern->mask));
+                          width, height);
 }
 
 static const gchar *
@@ -201,12 +212,25 @@ gimp_pattern_copy (GimpData *data,
   gimp_data_dirty (data);
 }
 
+static gboolean
+gimp_pattern_unload_contents (GimpData *data)
+{
+  GimpPattern *pattern = GIMP_PATTERN (data);
+
+  /*  buffers from gimp_pattern_create_buffer() keep their own reference  */
+  g_clear_pointer (&pattern->mask, gimp_temp_buf_unref);
+
+  return TRUE;
+}
+
 static gchar *
 gimp_pattern_get_checksum (GimpTagged *tagged)
 {
   GimpPattern *pattern         = GIMP_PATTERN (tagged);
   gchar       *checksum_string = NULL;
 
+  gimp_data_ensure_contents (GIMP_DATA (pattern));
+
   if (pattern->mask)
     {
       GChecksum *checksum = g_checksum_new (G_CHECKSUM_MD5);
@@ -222,6 +246,24 @@ gimp_pattern_get_checksum (GimpTagged *tagged)
   return checksum_string;
 }
 
+static void
+gimp_pattern_get_mask_size (GimpPattern *pattern,
+                            gint        *width,
+                            gint        *height)
+{
+  /*  don't load lazy contents just to learn their size  */
+  if (pattern->mask)
+    {
+      *width  = gimp_temp_buf_get_width  (pattern->mask);
+      *height = gimp_temp_buf_get_height (pattern->mask);
+    }
+  else
+    {
+      *width  = pattern->lazy_width;
+      *height = pattern->lazy_height;
+    }
+}
+
 GimpData *
 gimp_pattern_new (GimpContext *context,
                   const gchar *name)
@@ -275,6 +317,8 @@ gimp_pattern_get_mask (GimpPattern *pattern)
 {
   g_return_val_if_fail (GIMP_IS_PATTERN (pattern), NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (pattern));
+
   return pattern->mask;
 }
 
@@ -283,5 +327,7 @@ gimp_pattern_create_buffer (GimpPattern *pattern)
 {
   g_return_val_if_fail (GIMP_IS_PATTERN (pattern), NULL);
 
+  gimp_data_ensure_contents (GIMP_DATA (pattern));
+
   return gimp_temp_buf_create_buffer (pattern->mask);
 }
@@ -37,6 +37,9 @@ struct _GimpPattern
   GimpData     parent_instance;
 
   GimpTempBuf *mask;
+
+  gint         lazy_width;   /*  mask size while it isn't loaded  */
+  gint         lazy_height;
 };
 
 struct _GimpPatternClass
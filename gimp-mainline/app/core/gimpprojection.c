@@ -29,12 +29,17 @@
 
 #include "core-types.h"
 
+#include "config/gimpgeglconfig.h"
+
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
 #include "gimp-memsize.h"
+#include "gimp-parallel.h"
+#include "gimpasync.h"
+#include "gimpcancelable.h"
 #include "gimpchunkiterator.h"
 #include "gimpimage.h"
 #include "gimpmarshal.h"
@@ -51,6 +56,26 @@
 #define GIMP_PROJECTION_UPDATE_CHUNK_WIDTH  32
 #define GIMP_PROJECTION_UPDATE_CHUNK_HEIGHT 32
 
+/*  the area rendered by each job, in threaded mode  */
+#define GIMP_PROJECTION_RENDER_JOB_AREA     (256 * 256)
+
+
+typedef struct
+{
+  GeglRectangle   rect;
+  GeglBuffer     *buffer;
+} GimpProjectionChunk;
+
+typedef struct
+{
+  GimpProjection *proj;
+  GimpAsync      *async;
+  GeglNode       *graph;
+  const Babl     *format;
+  GArray         *chunks;
+  cairo_region_t *invalid_region;
+} GimpProjectionRenderJob;
+
 
 enum
 {
@@ -79,6 +104,8 @@ struct _GimpProjectionPrivate
   GimpChunkIterator         *iter;
   guint                      idle_id;
 
+  GList                     *render_jobs;
+
   gboolean                   invalidate_preview;
 };
 
@@ -141,6 +168,18 @@ static void        gimp_projection_chunk_render_stop     (GimpProjection  *proj,
                                                           gboolean         merge);
 static gboolean    gimp_projection_chunk_render_callback (GimpProjection  *proj);
 static gboolean    gimp_projection_chunk_render_iteration(GimpProjection  *proj);
+static void        gimp_projection_chunk_render_dispatch (GimpProjection  *proj);
+static void        gimp_projection_chunk_render_thread_func
+                                                         (GimpAsync       *async,
+                                                          GimpProjectionRenderJob *job);
+static void        gimp_projection_chunk_render_done     (GimpAsync       *async,
+                                                          GimpProjectionRenderJob *job);
+static void        gimp_projection_chunk_render_cancel   (GimpProjection  *proj,
+                                                          gboolean         merge);
+static void        gimp_projection_chunk_render_commit   (GimpProjection  *proj,
+                                                          GimpProjectionRenderJob *job,
+                                                          const GimpProjectionChunk *chunk);
+static void        gimp_projection_render_job_free       (GimpProjectionRenderJob *job);
 static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gboolean         now,
                                                           gint             x,
@@ -551,6 +590,13 @@ gimp_projection_finish_draw (GimpProjection *proj)
 {
   g_return_if_fail (GIMP_IS_PROJECTION (proj));
 
+  /*  render the rects of the running jobs here, too  */
+  if (proj->priv->render_jobs)
+    {
+      gimp_projection_chunk_render_cancel (proj, TRUE);
+      gimp_projection_chunk_render_start (proj);
+    }
+
   if (proj->priv->iter)
     {
       gimp_chunk_iterator_set_priority_rect (proj->priv->iter, NULL);
@@ -657,9 +703,13 @@ gimp_projection_flush_whenever (GimpProjection *proj,
 
       if (now)  /* Synchronous */
         {
-          gint n_rects = cairo_region_num_rectangles (proj->priv->update_region);
+          gint n_rects;
           gint i;
 
+          gimp_projection_chunk_render_cancel (proj, TRUE);
+
+          n_rects = cairo_region_num_rectangles (proj->priv->update_region);
+
           for (i = 0; i < n_rects; i++)
             {
               cairo_rectangle_int_t rect;
@@ -684,7 +734,10 @@ gimp_projection_flush_whenever (GimpProjection *proj,
           gimp_projection_chunk_render_start (proj);
         }
     }
-  else if (! now && ! proj->priv->iter && proj->priv->invalidate_preview)
+  else if (! now                     &&
+           ! proj->priv->iter          &&
+           ! proj->priv->render_jobs   &&
+           proj->priv->invalidate_preview)
     {
       /* invalidate the preview here since it is constructed from
        * the projection
@@ -772,7 +825,7 @@ gimp_projection_chunk_render_start (GimpProjection *proj)
           proj->priv->idle_id = 0;
         }
 
-      if (invalidate_preview)
+      if (invalidate_preview && ! proj->priv->render_jobs)
         {
           /* invalidate the preview here since it is constructed from
            * the projection
@@ -788,6 +841,8 @@ static void
 gimp_projection_chunk_render_stop (GimpProjection *proj,
                                    gboolean        merge)
 {
+  gimp_projection_chunk_render_cancel (proj, merge);
+
   if (proj->priv->idle_id)
     {
       g_source_remove (proj->priv->idle_id);
@@ -825,7 +880,18 @@ gimp_projection_chunk_render_stop (GimpProjection *proj,
 static gboolean
 gimp_projection_chunk_render_callback (GimpProjection *proj)
 {
-  if (gimp_projection_chunk_render_iteration (proj))
+  GimpImage *image = gimp_projectable_get_image (proj->priv->projectable);
+
+  if (GIMP_GEGL_CONFIG (image->gimp->config)->threaded_projection)
+    {
+      /*  the jobs' callbacks dispatch the rest  */
+      gimp_projection_chunk_render_dispatch (proj);
+
+      proj->priv->idle_id = 0;
+
+      return G_SOURCE_REMOVE;
+    }
+  else if (gimp_projection_chunk_render_iteration (proj))
     {
       return G_SOURCE_CONTINUE;
     }
@@ -876,6 +942,266 @@ gimp_projection_chunk_render_iteration (GimpProjection *proj)
     }
 }
 
+/*  in threaded mode, the update region is rendered by up to one job per
+ *  thread.  each job takes a few rects off the chunk iterator, and renders
+ *  them into temporary buffers using a snapshot of the projectable's graph,
+ *  so that the graph can be modified while the job runs.  the rendered
+ *  rects are copied into the projection, back on the main thread, once the
+ *  job's async completes.
+ */
+static void
+gimp_projection_chunk_render_dispatch (GimpProjection *proj)
+{
+  GimpImage *image    = gimp_projectable_get_image (proj->priv->projectable);
+  gint       max_jobs = GIMP_GEGL_CONFIG (image->gimp->config)->num_processors;
+
+  while (proj->priv->iter &&
+         g_list_length (proj->priv->render_jobs) < max_jobs)
+    {
+      GimpProjectionRenderJob *job;
+      GeglRectangle            rect;
+      gint                     area = 0;
+
+      job = g_slice_new0 (GimpProjectionRenderJob);
+
+      job->proj   = proj;
+      job->format = gimp_projection_get_format (GIMP_PICKABLE (proj));
+      job->chunks = g_array_new (FALSE, TRUE, sizeof (GimpProjectionChunk));
+
+      /*  the iterator sizes its rects according to the time between
+       *  successive rects of an iteration, which isn't the rendering time
+       *  here.  start a new iteration for each rect instead, which keeps
+       *  them at about the size of a tile.
+       */
+      while (area < GIMP_PROJECTION_RENDER_JOB_AREA)
+        {
+          if (! gimp_chunk_iterator_next (proj->priv->iter))
+            {
+              proj->priv->iter = NULL;
+
+              break;
+            }
+
+          if (gimp_chunk_iterator_get_rect (proj->priv->iter, &rect))
+            {
+              GimpProjectionChunk chunk = { rect, NULL };
+
+              g_array_append_val (job->chunks, chunk);
+
+              area += rect.width * rect.height;
+            }
+        }
+
+      if (job->chunks->len == 0)
+        {
+          gimp_projection_render_job_free (job);
+
+          break;
+        }
+
+      gimp_projectable_begin_render (proj->priv->projectable);
+
+      job->graph = gimp_gegl_node_snapshot (
+        gimp_projectable_get_graph (proj->priv->projectable));
+
+      gimp_projectable_end_render (proj->priv->projectable);
+
+      job->async = gimp_parallel_run_async_full (
+        proj->priv->priority,
+        (GimpRunAsyncFunc) gimp_projection_chunk_render_thread_func,
+        job, NULL);
+
+      gimp_async_add_callback (job->async,
+                               (GimpAsyncCallback) gimp_projection_chunk_render_done,
+                               job);
+
+      proj->priv->render_jobs = g_list_prepend (proj->priv->render_jobs, job);
+    }
+
+  if (! proj->priv->iter        &&
+      ! proj->priv->render_jobs &&
+      proj->priv->invalidate_preview)
+    {
+      /* invalidate the preview here since it is constructed from
+       * the projection
+       */
+      proj->priv->invalidate_preview = FALSE;
+
+      gimp_projectable_invalidate_preview (proj->priv->projectable);
+    }
+}
+
+static void
+gimp_projection_chunk_render_thread_func (GimpAsync               *async,
+                                          GimpProjectionRenderJob *job)
+{
+  gint i;
+
+  for (i = 0; i < job->chunks->len; i++)
+    {
+      GimpProjectionChunk *chunk = &g_array_index (job->chunks,
+                                                   GimpProjectionChunk, i);
+
+      if (gimp_async_is_canceled (async))
+        {
+          gimp_async_abort (async);
+
+          return;
+        }
+
+      chunk->buffer = gegl_buffer_new (&chunk->rect, job->format);
+
+      gegl_node_blit_buffer (job->graph, chunk->buffer, &chunk->rect, 0,
+                             GEGL_ABYSS_NONE);
+    }
+
+  gimp_async_finish (async, NULL);
+}
+
+/*  runs on the main thread.  the job's projection is NULL if the job was
+ *  canceled, in which case its rects were already put back, or dropped.
+ */
+static void
+gimp_projection_chunk_render_done (GimpAsync               *async,
+                                   GimpProjectionRenderJob *job)
+{
+  GimpProjection *proj = job->proj;
+
+  if (proj)
+    {
+      gint i;
+
+      proj->priv->render_jobs = g_list_remove (proj->priv->render_jobs, job);
+
+      for (i = 0; i < job->chunks->len; i++)
+        {
+          gimp_projection_chunk_render_commit (
+            proj, job,
+            &g_array_index (job->chunks, GimpProjectionChunk, i));
+        }
+
+      gimp_projection_chunk_render_dispatch (proj);
+    }
+
+  gimp_projection_render_job_free (job);
+}
+
+/*  cancels the running jobs, without waiting for them.  if @merge is TRUE,
+ *  their rects are added back to the update region.
+ */
+static void
+gimp_projection_chunk_render_cancel (GimpProjection *proj,
+                                     gboolean        merge)
+{
+  GList *list;
+
+  for (list = proj->priv->render_jobs; list; list = g_list_next (list))
+    {
+      GimpProjectionRenderJob *job = list->data;
+      gint                     i;
+
+      job->proj = NULL;
+
+      gimp_cancelable_cancel (GIMP_CANCELABLE (job->async));
+
+      for (i = 0; merge && i < job->chunks->len; i++)
+        {
+          GimpProjectionChunk *chunk = &g_array_index (job->chunks,
+                                                       GimpProjectionChunk, i);
+
+          gimp_projection_add_update_area (proj,
+                                           chunk->rect.x,
+                                           chunk->rect.y,
+                                           chunk->rect.width,
+                                           chunk->rect.height);
+        }
+    }
+
+  g_clear_pointer (&proj->priv->render_jobs, g_list_free);
+}
+
+static void
+gimp_projection_chunk_render_commit (GimpProjection            *proj,
+                                     GimpProjectionRenderJob   *job,
+                                     const GimpProjectionChunk *chunk)
+{
+  cairo_region_t *region;
+  gint            off_x, off_y;
+  GeglRectangle   bounding_box;
+  gint            n_rects;
+  gint            i;
+
+  gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
+  bounding_box = gimp_projectable_get_bounding_box (proj->priv->projectable);
+
+  region = cairo_region_create_rectangle (
+    (const cairo_rectangle_int_t *) &chunk->rect);
+
+  /*  the parts that were invalidated while the job was running are
+   *  already back in the update region
+   */
+  if (job->invalid_region)
+    cairo_region_subtract (region, job->invalid_region);
+
+  cairo_region_intersect_rectangle (
+    region, (const cairo_rectangle_int_t *) &bounding_box);
+
+  n_rects = cairo_region_num_rectangles (region);
+
+  gimp_tile_handler_validate_begin_validate (proj->priv->validate_handler);
+
+  for (i = 0; i < n_rects; i++)
+    {
+      GeglRectangle rect;
+
+      cairo_region_get_rectangle (region, i,
+                                  (cairo_rectangle_int_t *) &rect);
+
+      gegl_buffer_copy (chunk->buffer, &rect, GEGL_ABYSS_NONE,
+                        proj->priv->buffer, &rect);
+
+      gimp_tile_handler_validate_undo_invalidate (proj->priv->validate_handler,
+                                                  &rect);
+
+      /*  add the projectable's offsets because the list of update areas
+       *  is in tile-pyramid coordinates, but our external API is always
+       *  in terms of image coordinates.
+       */
+      g_signal_emit (proj, projection_signals[UPDATE], 0,
+                     TRUE,
+                     rect.x + off_x,
+                     rect.y + off_y,
+                     rect.width,
+                     rect.height);
+    }
+
+  gimp_tile_handler_validate_end_validate (proj->priv->validate_handler);
+
+  cairo_region_destroy (region);
+}
+
+static void
+gimp_projection_render_job_free (GimpProjectionRenderJob *job)
+{
+  gint i;
+
+  for (i = 0; i < job->chunks->len; i++)
+    {
+      GimpProjectionChunk *chunk = &g_array_index (job->chunks,
+                                                   GimpProjectionChunk, i);
+
+      g_clear_object (&chunk->buffer);
+    }
+
+  g_array_free (job->chunks, TRUE);
+
+  g_clear_object (&job->async);
+  g_clear_object (&job->graph);
+  g_clear_pointer (&job->invalid_region, cairo_region_destroy);
+
+  g_slice_free (GimpProjectionRenderJob, job);
+}
+
 static void
 gimp_projection_paint_area (GimpProjection *proj,
                             gboolean        now,
@@ -933,7 +1259,8 @@ gimp_projection_projectable_invalidate (GimpProjectable *projectable,
                                         gint             h,
                                         GimpProjection  *proj)
 {
-  gint off_x, off_y;
+  GList *list;
+  gint   off_x, off_y;
 
   gimp_projectable_get_offset (proj->priv->projectable, &off_x, &off_y);
 
@@ -944,6 +1271,18 @@ gimp_projection_projectable_invalidate (GimpProjectable *projectable,
   x -= off_x;
   y -= off_y;
 
+  /*  the running jobs may have rendered the area before it changed  */
+  for (list = proj->priv->render_jobs; list; list = g_list_next (list))
+    {
+      GimpProjectionRenderJob *job  = list->data;
+      cairo_rectangle_int_t    rect = { x, y, w, h };
+
+      if (job->invalid_region)
+        cairo_region_union_rectangle (job->invalid_region, &rect);
+      else
+        job->invalid_region = cairo_region_create_rectangle (&rect);
+    }
+
   gimp_projection_add_update_area (proj, x, y, w, h);
 }
 
@@ -83,6 +83,7 @@ static void          gimp_tag_cache_object_initialize  (GimpTagged             *
                                                         GimpTagCache           *cache);
 static void          gimp_tag_cache_add_object         (GimpTagCache           *cache,
                                                         GimpTagged             *tagged);
+static void          gimp_tag_cache_data_dirty         (GimpData               *data);
 
 static void          gimp_tag_cache_load_start_element (GMarkupParseContext    *context,
                                                         const gchar            *element_name,
@@ -108,6 +109,7 @@ static const gchar * gimp_tag_cache_attribute_name_to_value
                                                         const gchar            *name);
 
 static GQuark        gimp_tag_cache_get_error_domain   (void);
+static GQuark        gimp_tag_cache_checksum_quark     (void);
 
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpTagCache, gimp_tag_cache, GIMP_TYPE_OBJECT)
@@ -257,6 +259,22 @@ gimp_tag_cache_add_object (GimpTagCache *cache,
                   gimp_tagged_add_tag (tagged, GIMP_TAG (list->data));
                 }
 
+              /*  remember the checksum, so saving the cache doesn't
+               *  have to load the contents of lazily loaded data
+               */
+              if (rec->checksum && GIMP_IS_DATA (tagged))
+                {
+                  GQuark quark = gimp_tag_cache_checksum_quark ();
+
+                  if (! g_object_get_qdata (G_OBJECT (tagged), quark))
+                    g_signal_connect (tagged, "dirty",
+                                      G_CALLBACK (gimp_tag_cache_data_dirty),
+                                      NULL);
+
+                  g_object_set_qdata (G_OBJECT (tagged), quark,
+                                      GUINT_TO_POINTER (rec->checksum));
+                }
+
               rec->referenced = TRUE;
               return;
             }
@@ -301,6 +319,12 @@ gimp_tag_cache_add_object (GimpTagCache *cache,
 
 }
 
+static void
+gimp_tag_cache_data_dirty (GimpData *data)
+{
+  g_object_set_qdata (G_OBJECT (data), gimp_tag_cache_checksum_quark (), NULL);
+}
+
 static void
 gimp_tag_cache_object_initialize (GimpTagged   *tagged,
                                   GimpTagCache *cache)
@@ -317,16 +341,24 @@ gimp_tag_cache_tagged_to_cache_record_foreach (GimpTagged  *tagged,
   if (identifier)
     {
       GimpTagCacheRecord *cache_rec = g_new (GimpTagCacheRecord, 1);
-      gchar              *checksum;
+      GQuark              checksum_quark;
 
-      checksum = gimp_tagged_get_checksum (tagged);
+      checksum_quark =
+        GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (tagged),
+                                              gimp_tag_cache_checksum_quark ()));
+
+      if (! checksum_quark)
+        {
+          gchar *checksum = gimp_tagged_get_checksum (tagged);
+
+          checksum_quark = g_quark_from_string (checksum);
+          g_free (checksum);
+        }
 
       cache_rec->identifier = g_quark_from_string (identifier);
-      cache_rec->checksum   = g_quark_from_string (checksum);
+      cache_rec->checksum   = checksum_quark;
       cache_rec->tags       = g_list_copy (gimp_tagged_get_tags (tagged));
 
-      g_free (checksum);
-
       *cache_records = g_list_prepend (*cache_records, cache_rec);
     }
 
@@ -644,3 +676,9 @@ gimp_tag_cache_get_error_domain (void)
 {
   return g_quark_from_static_string ("gimp-tag-cache-error-quark");
 }
+
+static GQuark
+gimp_tag_cache_checksum_quark (void)
+{
+  return g_quark_from_static_string ("gimp-tag-cache-checksum");
+}
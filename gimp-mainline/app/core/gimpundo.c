@@ -89,6 +89,9 @@ static void          gimp_undo_real_pop            (GimpUndo            *undo,
                                                     GimpUndoAccumulator *accum);
 static void          gimp_undo_real_free           (GimpUndo            *undo,
                                                     GimpUndoMode         undo_mode);
+static gboolean      gimp_undo_real_spill          (GimpUndo            *undo);
+static gint64        gimp_undo_real_get_spill_size (GimpUndo            *undo);
+static void          gimp_undo_real_restore        (GimpUndo            *undo);
 
 static gboolean      gimp_undo_create_preview_idle (gpointer             data);
 static void       gimp_undo_create_preview_private (GimpUndo            *undo,
@@ -142,6 +145,9 @@ gimp_undo_class_init (GimpUndoClass *klass)
 
   klass->pop                        = gimp_undo_real_pop;
   klass->free                       = gimp_undo_real_free;
+  klass->spill                      = gimp_undo_real_spill;
+  klass->get_spill_size             = gimp_undo_real_get_spill_size;
+  klass->restore                    = gimp_undo_real_restore;
 
   g_object_class_install_property (object_class, PROP_IMAGE,
                                    g_param_spec_object ("image", NULL, NULL,
@@ -345,6 +351,23 @@ gimp_undo_real_free (GimpUndo     *undo,
 {
 }
 
+static gboolean
+gimp_undo_real_spill (GimpUndo *undo)
+{
+  return FALSE;
+}
+
+static gint64
+gimp_undo_real_get_spill_size (GimpUndo *undo)
+{
+  return 0;
+}
+
+static void
+gimp_undo_real_restore (GimpUndo *undo)
+{
+}
+
 void
 gimp_undo_pop (GimpUndo            *undo,
                GimpUndoMode         undo_mode,
@@ -379,6 +402,40 @@ gimp_undo_free (GimpUndo     *undo,
   g_signal_emit (undo, undo_signals[FREE], 0, undo_mode);
 }
 
+/* starts moving the bulk of the undo's data to a scratch file, to be read
+ * back when the undo is popped.  the data is written in the background, and
+ * no longer counts towards the undo's memsize once the write was started.
+ * returns TRUE if any write was started.
+ */
+gboolean
+gimp_undo_spill (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), FALSE);
+
+  return GIMP_UNDO_GET_CLASS (undo)->spill (undo);
+}
+
+/* returns the number of bytes of the undo's data which are on disk  */
+gint64
+gimp_undo_get_spill_size (GimpUndo *undo)
+{
+  g_return_val_if_fail (GIMP_IS_UNDO (undo), 0);
+
+  return GIMP_UNDO_GET_CLASS (undo)->get_spill_size (undo);
+}
+
+/* starts reading back the spilled data of the undo in the background, so
+ * that it's ready by the time the undo is popped.  popping a spilled undo
+ * without calling this function first reads the data synchronously.
+ */
+void
+gimp_undo_restore_async (GimpUndo *undo)
+{
+  g_return_if_fail (GIMP_IS_UNDO (undo));
+
+  GIMP_UNDO_GET_CLASS (undo)->restore (undo);
+}
+
 typedef struct _GimpUndoIdle GimpUndoIdle;
 
 struct _GimpUndoIdle
@@ -67,11 +67,16 @@ struct _GimpUndoClass
 {
   GimpViewableClass  parent_class;
 
-  void (* pop)  (GimpUndo            *undo,
-                 GimpUndoMode         undo_mode,
-                 GimpUndoAccumulator *accum);
-  void (* free) (GimpUndo            *undo,
-                 GimpUndoMode         undo_mode);
+  void     (* pop)            (GimpUndo            *undo,
+                               GimpUndoMode         undo_mode,
+                               GimpUndoAccumulator *accum);
+  void     (* free)           (GimpUndo            *undo,
+                               GimpUndoMode         undo_mode);
+
+  /*  moving the undo's data to disk, and back  */
+  gboolean (* spill)          (GimpUndo            *undo);
+  gint64   (* get_spill_size) (GimpUndo            *undo);
+  void     (* restore)        (GimpUndo            *undo);
 };
 
 
@@ -83,6 +88,10 @@ void          gimp_undo_pop             (GimpUndo            *undo,
 void          gimp_undo_free            (GimpUndo            *undo,
                                          GimpUndoMode         undo_mode);
 
+gboolean      gimp_undo_spill           (GimpUndo            *undo);
+gint64        gimp_undo_get_spill_size  (GimpUndo            *undo);
+void          gimp_undo_restore_async   (GimpUndo            *undo);
+
 void          gimp_undo_create_preview  (GimpUndo            *undo,
                                          GimpContext         *context,
                                          gboolean             create_now);
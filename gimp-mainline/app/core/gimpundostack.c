@@ -28,16 +28,20 @@
 #include "gimpundostack.h"
 
 
-static void    gimp_undo_stack_finalize    (GObject             *object);
+static void     gimp_undo_stack_finalize    (GObject             *object);
 
-static gint64  gimp_undo_stack_get_memsize (GimpObject          *object,
-                                            gint64              *gui_size);
+static gint64   gimp_undo_stack_get_memsize (GimpObject          *object,
+                                             gint64              *gui_size);
 
-static void    gimp_undo_stack_pop         (GimpUndo            *undo,
-                                            GimpUndoMode         undo_mode,
-                                            GimpUndoAccumulator *accum);
-static void    gimp_undo_stack_free        (GimpUndo            *undo,
-                                            GimpUndoMode         undo_mode);
+static void     gimp_undo_stack_pop         (GimpUndo            *undo,
+                                             GimpUndoMode         undo_mode,
+                                             GimpUndoAccumulator *accum);
+static void     gimp_undo_stack_free        (GimpUndo            *undo,
+                                             GimpUndoMode         undo_mode);
+static gboolean gimp_undo_stack_spill       (GimpUndo            *undo);
+static gint64   gimp_undo_stack_get_spill_size
+                                            (GimpUndo            *undo);
+static void     gimp_undo_stack_restore     (GimpUndo            *undo);
 
 
 G_DEFINE_TYPE (GimpUndoStack, gimp_undo_stack, GIMP_TYPE_UNDO)
@@ -58,6 +62,9 @@ gimp_undo_stack_class_init (GimpUndoStackClass *klass)
 
   undo_class->pop                = gimp_undo_stack_pop;
   undo_class->free               = gimp_undo_stack_free;
+  undo_class->spill              = gimp_undo_stack_spill;
+  undo_class->get_spill_size     = gimp_undo_stack_get_spill_size;
+  undo_class->restore            = gimp_undo_stack_restore;
 }
 
 static void
@@ -127,6 +134,61 @@ gimp_undo_stack_free (GimpUndo     *undo,
   gimp_container_clear (stack->undos);
 }
 
+static gboolean
+gimp_undo_stack_spill (GimpUndo *undo)
+{
+  GimpUndoStack *stack   = GIMP_UNDO_STACK (undo);
+  gboolean       spilled = FALSE;
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      if (gimp_undo_spill (child))
+        spilled = TRUE;
+    }
+
+  return spilled;
+}
+
+static gint64
+gimp_undo_stack_get_spill_size (GimpUndo *undo)
+{
+  GimpUndoStack *stack      = GIMP_UNDO_STACK (undo);
+  gint64         spill_size = 0;
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      spill_size += gimp_undo_get_spill_size (child);
+    }
+
+  return spill_size;
+}
+
+static void
+gimp_undo_stack_restore (GimpUndo *undo)
+{
+  GimpUndoStack *stack = GIMP_UNDO_STACK (undo);
+  GList         *list;
+
+  for (list = GIMP_LIST (stack->undos)->queue->head;
+       list;
+       list = g_list_next (list))
+    {
+      GimpUndo *child = list->data;
+
+      gimp_undo_restore_async (child);
+    }
+}
+
 GimpUndoStack *
 gimp_undo_stack_new (GimpImage *image)
 {
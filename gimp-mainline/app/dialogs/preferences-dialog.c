@@ -1179,21 +1179,24 @@ prefs_dialog_new (Gimp       *gimp,
   prefs_memsize_entry_add (object, "undo-size",
                            _("Maximum undo _memory:"),
                            GTK_GRID (grid), 1, size_group);
+  prefs_memsize_entry_add (object, "undo-spill-size",
+                           _("Maximum undo _disk space:"),
+                           GTK_GRID (grid), 2, size_group);
   prefs_memsize_entry_add (object, "tile-cache-size",
                            _("Tile cache _size:"),
-                           GTK_GRID (grid), 2, size_group);
+                           GTK_GRID (grid), 3, size_group);
   prefs_memsize_entry_add (object, "max-new-image-size",
                            _("Maximum _new image size:"),
-                           GTK_GRID (grid), 3, size_group);
+                           GTK_GRID (grid), 4, size_group);
 
   prefs_compression_combo_box_add (object, "swap-compression",
                                    _("S_wap compression:"),
-                                   GTK_GRID (grid), 4, size_group);
+                                   GTK_GRID (grid), 5, size_group);
 
 #ifdef ENABLE_MP
   prefs_spin_button_add (object, "num-processors", 1.0, 4.0, 0,
                          _("Number of _threads to use:"),
-                         GTK_GRID (grid), 5, size_group);
+                         GTK_GRID (grid), 6, size_group);
 #endif /* ENABLE_MP */
 
   /*  Hardware Acceleration  */
@@ -76,14 +76,11 @@ file_pat_load_invoker (GimpProcedure         *procedure,
 
   if (input)
     {
-      GList *list = gimp_pattern_load (context, file, input, error);
+      GimpPattern *pattern = gimp_pattern_load_pattern (context, file, input,
+                                                        error);
 
-      if (list)
+      if (pattern)
         {
-          GimpPattern *pattern = list->data;
-
-          g_list_free (list);
-
           image = file_pat_pattern_to_image (gimp, pattern);
           g_object_unref (pattern);
         }
@@ -25,6 +25,8 @@
 #include <gegl.h>
 #include <gegl-plugin.h>
 
+#include "libgimpconfig/gimpconfig.h"
+
 #include "gimp-gegl-types.h"
 
 #include "core/gimpprogress.h"
@@ -245,6 +247,194 @@ gimp_gegl_node_get_underlying_operation (GeglNode *node)
     return node;
 }
 
+static GeglNode * gimp_gegl_node_snapshot_output (GeglNode     *snapshot,
+                                                  GHashTable   *map,
+                                                  GeglNode     *node,
+                                                  const gchar **pad_name);
+
+static GeglNode *
+gimp_gegl_node_snapshot_operation (GeglNode   *snapshot,
+                                   GHashTable *map,
+                                   GeglNode   *node)
+{
+  GeglNode     *clone;
+  const gchar  *operation;
+  GParamSpec  **pspecs;
+  guint         n_pspecs;
+  gchar       **pads;
+  gint          i;
+
+  clone = g_hash_table_lookup (map, node);
+
+  if (clone)
+    return clone;
+
+  operation = gegl_node_get_operation (node);
+
+  clone = gegl_node_new_child (snapshot,
+                               "operation", operation,
+                               NULL);
+
+  g_hash_table_insert (map, node, clone);
+
+  pspecs = gegl_operation_list_properties (operation, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GParamSpec *pspec = pspecs[i];
+      GValue      value = G_VALUE_INIT;
+
+      if (! (pspec->flags & G_PARAM_READABLE)     ||
+          ! (pspec->flags & G_PARAM_WRITABLE)     ||
+          (pspec->flags & G_PARAM_CONSTRUCT_ONLY) ||
+          gegl_node_has_pad (node, pspec->name))
+        {
+          continue;
+        }
+
+      g_value_init (&value, pspec->value_type);
+
+      gegl_node_get_property (node, pspec->name, &value);
+
+      /*  config objects are edited in place by filter tools, give the
+       *  snapshot its own copy.  buffers are shared, their contents are
+       *  covered by the projection's update region.
+       */
+      if (G_VALUE_HOLDS_OBJECT (&value) &&
+          GIMP_IS_CONFIG (g_value_get_object (&value)))
+        {
+          g_value_take_object (&value,
+                               gimp_config_duplicate (
+                                 g_value_get_object (&value)));
+        }
+
+      gegl_node_set_property (clone, pspec->name, &value);
+
+      g_value_unset (&value);
+    }
+
+  g_free (pspecs);
+
+  pads = gegl_node_list_input_pads (node);
+
+  for (i = 0; pads && pads[i]; i++)
+    {
+      GeglNode *producer;
+      gchar    *producer_pad;
+
+      producer = gegl_node_get_producer (node, pads[i], &producer_pad);
+
+      if (producer)
+        {
+          const gchar *output_pad = producer_pad;
+          GeglNode    *output;
+
+          output = gimp_gegl_node_snapshot_output (snapshot, map,
+                                                   producer, &output_pad);
+
+          gegl_node_connect_to (output, output_pad,
+                                clone,  pads[i]);
+
+          g_free (producer_pad);
+        }
+    }
+
+  g_strfreev (pads);
+
+  return clone;
+}
+
+/*  returns the node, and sets *pad_name to the pad, of the snapshot
+ *  that corresponds to @node's output pad *pad_name.  graph nodes are
+ *  flattened: their input proxies are mapped to nops fed by the graph's
+ *  producers, and their output proxies are followed inwards.
+ */
+static GeglNode *
+gimp_gegl_node_snapshot_output (GeglNode     *snapshot,
+                                GHashTable   *map,
+                                GeglNode     *node,
+                                const gchar **pad_name)
+{
+  if (! gegl_node_get_gegl_operation (node))
+    {
+      gchar **pads = gegl_node_list_input_pads (node);
+      gint    i;
+
+      for (i = 0; pads && pads[i]; i++)
+        {
+          GeglNode *input = gegl_node_get_input_proxy (node, pads[i]);
+
+          if (! g_hash_table_contains (map, input))
+            {
+              GeglNode *clone;
+              GeglNode *producer;
+              gchar    *producer_pad;
+
+              clone = gegl_node_new_child (snapshot,
+                                           "operation", "gegl:nop",
+                                           NULL);
+
+              g_hash_table_insert (map, input, clone);
+
+              producer = gegl_node_get_producer (node, pads[i],
+                                                 &producer_pad);
+
+              if (producer)
+                {
+                  const gchar *output_pad = producer_pad;
+                  GeglNode    *output;
+
+                  output = gimp_gegl_node_snapshot_output (snapshot, map,
+                                                           producer,
+                                                           &output_pad);
+
+                  gegl_node_connect_to (output, output_pad,
+                                        clone,  "input");
+
+                  g_free (producer_pad);
+                }
+            }
+        }
+
+      g_strfreev (pads);
+
+      node      = gegl_node_get_output_proxy (node, *pad_name);
+      *pad_name = "output";
+    }
+
+  return gimp_gegl_node_snapshot_operation (snapshot, map, node);
+}
+
+/*  creates a graph which renders the same as @graph's "output" pad, but
+ *  consists of private copies of its nodes, so that it can be processed
+ *  by another thread while @graph is modified.  must be called on the
+ *  thread that owns @graph.
+ */
+GeglNode *
+gimp_gegl_node_snapshot (GeglNode *graph)
+{
+  GeglNode    *snapshot;
+  GHashTable  *map;
+  GeglNode    *output;
+  const gchar *pad_name = "output";
+
+  g_return_val_if_fail (GEGL_IS_NODE (graph), NULL);
+
+  snapshot = gegl_node_new ();
+  map      = g_hash_table_new (NULL, NULL);
+
+  output = gimp_gegl_node_snapshot_output (snapshot, map, graph, &pad_name);
+
+  gegl_node_connect_to (output,
+                        pad_name,
+                        gegl_node_get_output_proxy (snapshot, "output"),
+                        "input");
+
+  g_hash_table_unref (map);
+
+  return snapshot;
+}
+
 gboolean
 gimp_gegl_param_spec_has_key (GParamSpec  *pspec,
                               const gchar *key,
@@ -261,17 +451,31 @@ gimp_gegl_param_spec_has_key (GParamSpec  *pspec,
 GeglBuffer *
 gimp_gegl_buffer_dup (GeglBuffer *buffer)
 {
-  GeglBuffer          *new_buffer;
-  const GeglRectangle *extent;
-  const GeglRectangle *abyss;
-  GeglRectangle        rect;
-  gint                 shift_x;
-  gint                 shift_y;
-  gint                 tile_width;
-  gint                 tile_height;
+  GimpGeglBufferDupFunc  dup_func;
+  GeglBuffer            *new_buffer;
+  const GeglRectangle   *extent;
+  const GeglRectangle   *abyss;
+  GeglRectangle          rect;
+  gint                   shift_x;
+  gint                   shift_y;
+  gint                   tile_width;
+  gint                   tile_height;
 
   g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
 
+  dup_func = (GimpGeglBufferDupFunc)
+    g_object_get_data (G_OBJECT (buffer), "gimp-gegl-buffer-dup-func");
+
+  if (dup_func)
+    {
+      new_buffer = dup_func (buffer,
+                             g_object_get_data (G_OBJECT (buffer),
+                                                "gimp-gegl-buffer-dup-data"));
+
+      if (new_buffer)
+        return new_buffer;
+    }
+
   extent = gegl_buffer_get_extent (buffer);
   abyss  = gegl_buffer_get_abyss  (buffer);
 
@@ -307,6 +511,23 @@ gimp_gegl_buffer_dup (GeglBuffer *buffer)
   return new_buffer;
 }
 
+/* lets buffers whose tiles come from a custom backend be duplicated
+ * without reading all of their tiles.  'dup_func' may return NULL, in
+ * which case the buffer is copied as usual.
+ */
+void
+gimp_gegl_buffer_set_dup_func (GeglBuffer            *buffer,
+                               GimpGeglBufferDupFunc  dup_func,
+                               gpointer               user_data)
+{
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+
+  g_object_set_data (G_OBJECT (buffer),
+                     "gimp-gegl-buffer-dup-func", (gpointer) dup_func);
+  g_object_set_data (G_OBJECT (buffer),
+                     "gimp-gegl-buffer-dup-data", user_data);
+}
+
 gboolean
 gimp_gegl_buffer_set_extent (GeglBuffer          *buffer,
                              const GeglRectangle *extent)
@@ -22,6 +22,10 @@
 #define __GIMP_GEGL_UTILS_H__
 
 
+typedef GeglBuffer * (* GimpGeglBufferDupFunc) (GeglBuffer *buffer,
+                                                gpointer    user_data);
+
+
 GType         gimp_gegl_get_op_enum_type              (const gchar         *operation,
                                                        const gchar         *property);
 
@@ -48,11 +52,16 @@ void          gimp_gegl_node_set_underlying_operation (GeglNode           *node,
                                                        GeglNode           *operation);
 GeglNode    * gimp_gegl_node_get_underlying_operation (GeglNode           *node);
 
+GeglNode    * gimp_gegl_node_snapshot                 (GeglNode            *graph);
+
 gboolean      gimp_gegl_param_spec_has_key            (GParamSpec          *pspec,
                                                        const gchar         *key,
                                                        const gchar         *value);
 
 GeglBuffer  * gimp_gegl_buffer_dup                    (GeglBuffer          *buffer);
+void          gimp_gegl_buffer_set_dup_func           (GeglBuffer          *buffer,
+                                                       GimpGeglBufferDupFunc dup_func,
+                                                       gpointer             user_data);
 
 gboolean      gimp_gegl_buffer_set_extent             (GeglBuffer          *buffer,
                                                        const GeglRectangle *extent);
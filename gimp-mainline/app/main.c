@@ -127,6 +127,11 @@ static const gchar        *user_gimprc       = NULL;
 static const gchar        *session_name      = NULL;
 static const gchar        *batch_interpreter = NULL;
 static const gchar       **batch_commands    = NULL;
+static const gchar        *batch_files       = NULL;
+static const gchar       **batch_procedures  = NULL;
+static const gchar        *batch_output_dir  = NULL;
+static gint                batch_jobs        = 1;
+static const gchar        *batch_summary     = NULL;
 static const gchar       **filenames         = NULL;
 static gboolean            as_new            = FALSE;
 static gboolean            no_interface      = FALSE;
@@ -238,6 +243,34 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_STRING, &batch_interpreter,
     N_("The procedure to process batch commands with"), "<proc>"
   },
+  {
+    "batch-files", 0, 0,
+    G_OPTION_ARG_FILENAME, &batch_files,
+    N_("Process the images listed in a file, one per line (\"-\" for stdin)"),
+    "<filename>"
+  },
+  {
+    "batch-procedure", 0, 0,
+    G_OPTION_ARG_STRING_ARRAY, &batch_procedures,
+    N_("Procedure to run on each batch image (can be used multiple times)"),
+    "<proc>"
+  },
+  {
+    "batch-output-dir", 0, 0,
+    G_OPTION_ARG_FILENAME, &batch_output_dir,
+    N_("Save the processed batch images to this directory"), "<directory>"
+  },
+  {
+    "batch-jobs", 0, 0,
+    G_OPTION_ARG_INT, &batch_jobs,
+    N_("Number of batch images to process at the same time"), "<n>"
+  },
+  {
+    "batch-summary", 0, 0,
+    G_OPTION_ARG_FILENAME, &batch_summary,
+    N_("Write the batch summary to this file (\"-\" for stdout)"),
+    "<filename>"
+  },
   {
     "console-messages", 'c', 0,
     G_OPTION_ARG_NONE, &console_messages,
@@ -395,6 +428,7 @@ main (int    argc,
   GFile          *system_gimprc_file = NULL;
   GFile          *user_gimprc_file   = NULL;
   gchar          *backtrace_file     = NULL;
+  gint            status;
   gint            i;
 
 #ifdef ENABLE_WIN32_DEBUG_CONSOLE
@@ -601,10 +635,11 @@ main (int    argc,
       app_exit (EXIT_FAILURE);
     }
 
-  if (no_interface || be_verbose || console_messages || batch_commands != NULL)
+  if (no_interface || be_verbose || console_messages ||
+      batch_commands != NULL || batch_files != NULL)
     gimp_open_console_window ();
 
-  if (no_interface)
+  if (no_interface || batch_files)
     new_instance = TRUE;
 
 #ifndef GIMP_CONSOLE_COMPILATION
@@ -633,28 +668,33 @@ main (int    argc,
   if (user_gimprc)
     user_gimprc_file = g_file_new_for_commandline_arg (user_gimprc);
 
-  app_run (argv[0],
-           filenames,
-           system_gimprc_file,
-           user_gimprc_file,
-           session_name,
-           batch_interpreter,
-           batch_commands,
-           as_new,
-           no_interface,
-           no_data,
-           no_fonts,
-           no_splash,
-           be_verbose,
-           use_shm,
-           use_cpu_accel,
-           console_messages,
-           use_debug_handler,
-           show_playground,
-           show_debug_menu,
-           stack_trace_mode,
-           pdb_compat_mode,
-           backtrace_file);
+  status = app_run (argv[0],
+                    filenames,
+                    system_gimprc_file,
+                    user_gimprc_file,
+                    session_name,
+                    batch_interpreter,
+                    batch_commands,
+                    batch_files,
+                    batch_procedures,
+                    batch_output_dir,
+                    batch_jobs,
+                    batch_summary,
+                    as_new,
+                    no_interface,
+                    no_data,
+                    no_fonts,
+                    no_splash,
+                    be_verbose,
+                    use_shm,
+                    use_cpu_accel,
+                    console_messages,
+                    use_debug_handler,
+                    show_playground,
+                    show_debug_menu,
+                    stack_trace_mode,
+                    pdb_compat_mode,
+                    backtrace_file);
 
   if (backtrace_file)
     g_free (backtrace_file);
@@ -669,7 +709,7 @@ main (int    argc,
 
   g_option_context_free (context);
 
-  return EXIT_SUCCESS;
+  return status;
 }
 
 
@@ -55,6 +55,7 @@ gimp_operation_brightness_contrast_class_init (GimpOperationBrightnessContrastCl
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->set_property   = gimp_operation_point_filter_set_property;
   object_class->get_property   = gimp_operation_point_filter_get_property;
@@ -67,6 +68,8 @@ gimp_operation_brightness_contrast_class_init (GimpOperationBrightnessContrastCl
 
   point_class->process         = gimp_operation_brightness_contrast_process;
 
+  filter_class->per_component = TRUE;
+
   g_object_class_install_property (object_class,
                                    GIMP_OPERATION_POINT_FILTER_PROP_CONFIG,
                                    g_param_spec_object ("config",
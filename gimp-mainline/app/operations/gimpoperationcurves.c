@@ -57,6 +57,7 @@ gimp_operation_curves_class_init (GimpOperationCurvesClass *klass)
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->set_property   = gimp_operation_point_filter_set_property;
   object_class->get_property   = gimp_operation_point_filter_get_property;
@@ -69,6 +70,8 @@ gimp_operation_curves_class_init (GimpOperationCurvesClass *klass)
 
   point_class->process = gimp_operation_curves_process;
 
+  filter_class->per_component = TRUE;
+
   g_object_class_install_property (object_class,
                                    GIMP_OPERATION_POINT_FILTER_PROP_TRC,
                                    g_param_spec_enum ("trc",
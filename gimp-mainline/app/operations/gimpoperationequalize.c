@@ -71,6 +71,7 @@ gimp_operation_equalize_class_init (GimpOperationEqualizeClass *klass)
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->finalize       = gimp_operation_equalize_finalize;
   object_class->set_property   = gimp_operation_equalize_set_property;
@@ -84,6 +85,8 @@ gimp_operation_equalize_class_init (GimpOperationEqualizeClass *klass)
 
   point_class->process = gimp_operation_equalize_process;
 
+  filter_class->per_component = TRUE;
+
   g_object_class_install_property (object_class, PROP_HISTOGRAM,
                                    g_param_spec_object ("histogram",
                                                         "Histogram",
@@ -54,6 +54,7 @@ gimp_operation_levels_class_init (GimpOperationLevelsClass *klass)
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->set_property   = gimp_operation_point_filter_set_property;
   object_class->get_property   = gimp_operation_point_filter_get_property;
@@ -66,6 +67,8 @@ gimp_operation_levels_class_init (GimpOperationLevelsClass *klass)
 
   point_class->process = gimp_operation_levels_process;
 
+  filter_class->per_component = TRUE;
+
   g_object_class_install_property (object_class,
                                    GIMP_OPERATION_POINT_FILTER_PROP_TRC,
                                    g_param_spec_enum ("trc",
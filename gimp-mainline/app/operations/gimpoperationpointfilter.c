@@ -116,27 +116,45 @@ gimp_operation_point_filter_set_property (GObject      *object,
 static void
 gimp_operation_point_filter_prepare (GeglOperation *operation)
 {
-  GimpOperationPointFilter *self = GIMP_OPERATION_POINT_FILTER (operation);
+  GimpOperationPointFilter *self  = GIMP_OPERATION_POINT_FILTER (operation);
   const Babl               *space = gegl_operation_get_source_space (operation,
                                                                      "input");
   const Babl               *format;
 
-  switch (self->trc)
+  format = gimp_operation_point_filter_get_format (self, space);
+
+  gegl_operation_set_format (operation, "input",  format);
+  gegl_operation_set_format (operation, "output", format);
+}
+
+
+/*  public functions  */
+
+/* returns the format in which @filter processes pixels of @space, or NULL if
+ * the filter chooses its format on its own, by overriding prepare().
+ */
+const Babl *
+gimp_operation_point_filter_get_format (GimpOperationPointFilter *filter,
+                                        const Babl               *space)
+{
+  g_return_val_if_fail (GIMP_IS_OPERATION_POINT_FILTER (filter), NULL);
+
+  if (GEGL_OPERATION_GET_CLASS (filter)->prepare !=
+      gimp_operation_point_filter_prepare)
+    {
+      return NULL;
+    }
+
+  switch (filter->trc)
     {
     default:
     case GIMP_TRC_LINEAR:
-      format = babl_format_with_space ("RGBA float", space);
-      break;
+      return babl_format_with_space ("RGBA float", space);
 
     case GIMP_TRC_NON_LINEAR:
-      format = babl_format_with_space ("R'G'B'A float", space);
-      break;
+      return babl_format_with_space ("R'G'B'A float", space);
 
     case GIMP_TRC_PERCEPTUAL:
-      format = babl_format_with_space ("R~G~B~A float", space);
-      break;
+      return babl_format_with_space ("R~G~B~A float", space);
     }
-
-  gegl_operation_set_format (operation, "input",  format);
-  gegl_operation_set_format (operation, "output", format);
 }
@@ -55,19 +55,27 @@ struct _GimpOperationPointFilter
 struct _GimpOperationPointFilterClass
 {
   GeglOperationPointFilterClass  parent_class;
+
+  /* TRUE if each output component depends only on the corresponding input
+   * component, so that the filter can be tabulated per component.
+   */
+  gboolean                       per_component;
 };
 
 
-GType   gimp_operation_point_filter_get_type     (void) G_GNUC_CONST;
+GType        gimp_operation_point_filter_get_type     (void) G_GNUC_CONST;
+
+void         gimp_operation_point_filter_get_property (GObject                  *object,
+                                                       guint                     property_id,
+                                                       GValue                   *value,
+                                                       GParamSpec               *pspec);
+void         gimp_operation_point_filter_set_property (GObject                  *object,
+                                                       guint                     property_id,
+                                                       const GValue             *value,
+                                                       GParamSpec               *pspec);
 
-void    gimp_operation_point_filter_get_property (GObject      *object,
-                                                  guint         property_id,
-                                                  GValue       *value,
-                                                  GParamSpec   *pspec);
-void    gimp_operation_point_filter_set_property (GObject      *object,
-                                                  guint         property_id,
-                                                  const GValue *value,
-                                                  GParamSpec   *pspec);
+const Babl * gimp_operation_point_filter_get_format   (GimpOperationPointFilter *filter,
+                                                       const Babl               *space);
 
 
 #endif /* __GIMP_OPERATION_POINT_FILTER_H__ */
@@ -0,0 +1,363 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointfilterlut.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  runs a GimpOperationPointFilter operation.  when the filter is
+ *  per-component, and the input is 8- or 16-bit RGB(A), the filter is
+ *  tabulated into a lookup table, and the pixels are processed using a
+ *  single lookup per component.  otherwise, the filter's own process()
+ *  is used.
+ *
+ *  the wrapped node is not part of any graph, and changes to its
+ *  properties after the operation has been prepared are not tracked; it
+ *  is meant for one-shot application of a filter.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "operations-types.h"
+
+#include "gegl/gimp-babl.h"
+
+#include "gimpoperationpointfilter.h"
+#include "gimpoperationpointfilterlut.h"
+
+
+static void       gimp_operation_point_filter_lut_finalize (GObject             *object);
+
+static void       gimp_operation_point_filter_lut_prepare  (GeglOperation       *operation);
+static gboolean   gimp_operation_point_filter_lut_process  (GeglOperation       *operation,
+                                                            void                *in_buf,
+                                                            void                *out_buf,
+                                                            glong                samples,
+                                                            const GeglRectangle *roi,
+                                                            gint                 level);
+
+static const Babl * gimp_operation_point_filter_lut_get_lut_format
+                                                           (GimpOperationPointFilterLut *self,
+                                                            const Babl          *format,
+                                                            const Babl          *space);
+static void       gimp_operation_point_filter_lut_build_lut
+                                                           (GimpOperationPointFilterLut *self);
+
+
+G_DEFINE_TYPE (GimpOperationPointFilterLut, gimp_operation_point_filter_lut,
+               GEGL_TYPE_OPERATION_POINT_FILTER)
+
+#define parent_class gimp_operation_point_filter_lut_parent_class
+
+
+static void
+gimp_operation_point_filter_lut_class_init (GimpOperationPointFilterLutClass *klass)
+{
+  GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
+  GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
+  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+
+  object_class->finalize = gimp_operation_point_filter_lut_finalize;
+
+  gegl_operation_class_set_keys (operation_class,
+                                 "name",        "gimp:point-filter-lut",
+                                 "categories",  "hidden",
+                                 "description", "Run a point filter through a lookup table",
+                                 NULL);
+
+  operation_class->prepare = gimp_operation_point_filter_lut_prepare;
+
+  point_class->process     = gimp_operation_point_filter_lut_process;
+}
+
+static void
+gimp_operation_point_filter_lut_init (GimpOperationPointFilterLut *self)
+{
+}
+
+static void
+gimp_operation_point_filter_lut_finalize (GObject *object)
+{
+  GimpOperationPointFilterLut *self = GIMP_OPERATION_POINT_FILTER_LUT (object);
+
+  g_clear_object (&self->node);
+  g_clear_pointer (&self->lut, g_free);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_operation_point_filter_lut_prepare (GeglOperation *operation)
+{
+  GimpOperationPointFilterLut *self   = GIMP_OPERATION_POINT_FILTER_LUT (operation);
+  const Babl                  *space  = gegl_operation_get_source_space (operation,
+                                                                         "input");
+  const Babl                  *source = gegl_operation_get_source_format (operation,
+                                                                          "input");
+  GeglOperation               *filter;
+
+  g_return_if_fail (self->node != NULL);
+
+  filter = gegl_node_get_gegl_operation (self->node);
+
+  self->format = gimp_operation_point_filter_get_format (
+                   GIMP_OPERATION_POINT_FILTER (filter), space);
+
+  self->lut_format = gimp_operation_point_filter_lut_get_lut_format (self,
+                                                                     source,
+                                                                     space);
+
+  if (self->lut_format)
+    {
+      gimp_operation_point_filter_lut_build_lut (self);
+
+      gegl_operation_set_format (operation, "input", self->lut_format);
+    }
+  else
+    {
+      g_clear_pointer (&self->lut, g_free);
+      self->lut_size = 0;
+
+      gegl_operation_set_format (operation, "input", self->format);
+    }
+
+  gegl_operation_set_format (operation, "output", self->format);
+}
+
+static gboolean
+gimp_operation_point_filter_lut_process (GeglOperation       *operation,
+                                         void                *in_buf,
+                                         void                *out_buf,
+                                         glong                samples,
+                                         const GeglRectangle *roi,
+                                         gint                 level)
+{
+  GimpOperationPointFilterLut *self = GIMP_OPERATION_POINT_FILTER_LUT (operation);
+  gfloat                      *dest = out_buf;
+
+  if (self->lut_format)
+    {
+      const gfloat *lut = self->lut;
+      gint          n   = self->lut_size;
+
+      if (n == 256)
+        {
+          const guint8 *src = in_buf;
+
+          while (samples--)
+            {
+              dest[RED]   = lut[RED   * n + src[RED]];
+              dest[GREEN] = lut[GREEN * n + src[GREEN]];
+              dest[BLUE]  = lut[BLUE  * n + src[BLUE]];
+              dest[ALPHA] = lut[ALPHA * n + src[ALPHA]];
+
+              src  += 4;
+              dest += 4;
+            }
+        }
+      else
+        {
+          const guint16 *src = in_buf;
+
+          while (samples--)
+            {
+              dest[RED]   = lut[RED   * n + src[RED]];
+              dest[GREEN] = lut[GREEN * n + src[GREEN]];
+              dest[BLUE]  = lut[BLUE  * n + src[BLUE]];
+              dest[ALPHA] = lut[ALPHA * n + src[ALPHA]];
+
+              src  += 4;
+              dest += 4;
+            }
+        }
+    }
+  else
+    {
+      GeglOperation *filter = gegl_node_get_gegl_operation (self->node);
+
+      GEGL_OPERATION_POINT_FILTER_GET_CLASS (filter)->process (filter,
+                                                               in_buf, out_buf,
+                                                               samples,
+                                                               roi, level);
+    }
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+/* returns the integer format to use as input for the lookup table, or NULL
+ * if the filter can't be tabulated for @format.
+ */
+static const Babl *
+gimp_operation_point_filter_lut_get_lut_format (GimpOperationPointFilterLut *self,
+                                                const Babl                  *format,
+                                                const Babl                  *space)
+{
+  static const GimpTRCType trcs[] = { GIMP_TRC_LINEAR,
+                                      GIMP_TRC_NON_LINEAR,
+                                      GIMP_TRC_PERCEPTUAL };
+  GeglOperation            *filter;
+  const Babl               *type;
+  GimpComponentType         component;
+  gint                      i;
+
+  if (! format)
+    return NULL;
+
+  filter = gegl_node_get_gegl_operation (self->node);
+
+  if (! GIMP_OPERATION_POINT_FILTER_GET_CLASS (filter)->per_component)
+    return NULL;
+
+  type = babl_format_get_type (format, 0);
+
+  if (type == babl_type ("u8"))
+    component = GIMP_COMPONENT_TYPE_U8;
+  else if (type == babl_type ("u16"))
+    component = GIMP_COMPONENT_TYPE_U16;
+  else
+    return NULL;
+
+  /*  only plain RGB(A) formats can be tabulated per component; in
+   *  particular, premultiplied formats mix the alpha into the color
+   *  components.
+   */
+  for (i = 0; i < (gint) G_N_ELEMENTS (trcs); i++)
+    {
+      GimpPrecision precision = gimp_babl_precision (component, trcs[i]);
+
+      if (format == gimp_babl_format (GIMP_RGB, precision, FALSE, space) ||
+          format == gimp_babl_format (GIMP_RGB, precision, TRUE,  space))
+        {
+          return gimp_babl_format (GIMP_RGB, precision, TRUE, space);
+        }
+    }
+
+  return NULL;
+}
+
+/* tabulates the filter for all the values of each component of the lookup
+ * table format, so that the result is the same as running the filter on the
+ * converted input.
+ */
+static void
+gimp_operation_point_filter_lut_build_lut (GimpOperationPointFilterLut *self)
+{
+  GeglOperation *filter = gegl_node_get_gegl_operation (self->node);
+  GeglRectangle  roi;
+  gpointer       ramp;
+  gfloat        *values;
+  gint           n;
+  gint           i;
+  gint           c;
+
+  if (babl_format_get_type (self->lut_format, 0) == babl_type ("u8"))
+    n = 1 << 8;
+  else
+    n = 1 << 16;
+
+  if (n != self->lut_size)
+    {
+      g_free (self->lut);
+
+      self->lut      = g_new (gfloat, 4 * n);
+      self->lut_size = n;
+    }
+
+  ramp   = g_malloc (n * babl_format_get_bytes_per_pixel (self->lut_format));
+  values = g_new (gfloat, 4 * n);
+
+  if (n == 1 << 8)
+    {
+      guint8 *p = ramp;
+
+      for (i = 0; i < n; i++)
+        p[4 * i + 0] = p[4 * i + 1] = p[4 * i + 2] = p[4 * i + 3] = i;
+    }
+  else
+    {
+      guint16 *p = ramp;
+
+      for (i = 0; i < n; i++)
+        p[4 * i + 0] = p[4 * i + 1] = p[4 * i + 2] = p[4 * i + 3] = i;
+    }
+
+  babl_process (babl_fish (self->lut_format, self->format),
+                ramp, values, n);
+
+  roi = *GEGL_RECTANGLE (0, 0, n, 1);
+
+  GEGL_OPERATION_POINT_FILTER_GET_CLASS (filter)->process (filter,
+                                                           values, values, n,
+                                                           &roi, 0);
+
+  for (c = 0; c < 4; c++)
+    {
+      for (i = 0; i < n; i++)
+        self->lut[c * n + i] = values[4 * i + c];
+    }
+
+  g_free (values);
+  g_free (ramp);
+}
+
+
+/*  public functions  */
+
+/* returns TRUE if the operation of @node can be run through a point-filter
+ * lookup table.
+ */
+gboolean
+gimp_operation_point_filter_lut_can_wrap (GeglNode *node)
+{
+  GeglOperation *operation;
+
+  g_return_val_if_fail (GEGL_IS_NODE (node), FALSE);
+
+  operation = gegl_node_get_gegl_operation (node);
+
+  if (! GIMP_IS_OPERATION_POINT_FILTER (operation))
+    return FALSE;
+
+  return gimp_operation_point_filter_get_format (
+           GIMP_OPERATION_POINT_FILTER (operation), NULL) != NULL;
+}
+
+/* returns a new node running the operation of @node, through a lookup
+ * table when possible.  @node must satisfy
+ * gimp_operation_point_filter_lut_can_wrap().
+ */
+GeglNode *
+gimp_operation_point_filter_lut_new_node (GeglNode *node)
+{
+  GeglNode                    *lut_node;
+  GimpOperationPointFilterLut *self;
+
+  g_return_val_if_fail (gimp_operation_point_filter_lut_can_wrap (node), NULL);
+
+  lut_node = gegl_node_new_child (NULL,
+                                  "operation", "gimp:point-filter-lut",
+                                  NULL);
+
+  self = GIMP_OPERATION_POINT_FILTER_LUT (gegl_node_get_gegl_operation (lut_node));
+
+  self->node = g_object_ref (node);
+
+  return lut_node;
+}
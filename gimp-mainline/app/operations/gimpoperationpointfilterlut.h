@@ -0,0 +1,69 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointfilterlut.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_OPERATION_POINT_FILTER_LUT_H__
+#define __GIMP_OPERATION_POINT_FILTER_LUT_H__
+
+
+#include <gegl-plugin.h>
+#include <operation/gegl-operation-point-filter.h>
+
+
+#define GIMP_TYPE_OPERATION_POINT_FILTER_LUT            (gimp_operation_point_filter_lut_get_type ())
+#define GIMP_OPERATION_POINT_FILTER_LUT(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_OPERATION_POINT_FILTER_LUT, GimpOperationPointFilterLut))
+#define GIMP_OPERATION_POINT_FILTER_LUT_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GIMP_TYPE_OPERATION_POINT_FILTER_LUT, GimpOperationPointFilterLutClass))
+#define GIMP_IS_OPERATION_POINT_FILTER_LUT(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIMP_TYPE_OPERATION_POINT_FILTER_LUT))
+#define GIMP_IS_OPERATION_POINT_FILTER_LUT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GIMP_TYPE_OPERATION_POINT_FILTER_LUT))
+#define GIMP_OPERATION_POINT_FILTER_LUT_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GIMP_TYPE_OPERATION_POINT_FILTER_LUT, GimpOperationPointFilterLutClass))
+
+
+typedef struct _GimpOperationPointFilterLut      GimpOperationPointFilterLut;
+typedef struct _GimpOperationPointFilterLutClass GimpOperationPointFilterLutClass;
+
+struct _GimpOperationPointFilterLut
+{
+  GeglOperationPointFilter   parent_instance;
+
+  GeglNode                  *node;
+
+  /* the format the filter processes pixels in  */
+  const Babl                *format;
+
+  /* per-component lookup table, used for integer input formats when the
+   * filter is per-component.
+   */
+  const Babl                *lut_format;
+  gfloat                    *lut;
+  gint                       lut_size;
+};
+
+struct _GimpOperationPointFilterLutClass
+{
+  GeglOperationPointFilterClass  parent_class;
+};
+
+
+GType      gimp_operation_point_filter_lut_get_type (void) G_GNUC_CONST;
+
+gboolean   gimp_operation_point_filter_lut_can_wrap (GeglNode *node);
+
+GeglNode * gimp_operation_point_filter_lut_new_node (GeglNode *node);
+
+
+#endif /* __GIMP_OPERATION_POINT_FILTER_LUT_H__ */
@@ -71,12 +71,15 @@ gimp_operation_posterize_class_init (GimpOperationPosterizeClass *klass)
   GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+  GimpOperationPointFilterClass *filter_class    = GIMP_OPERATION_POINT_FILTER_CLASS (klass);
 
   object_class->set_property = gimp_operation_posterize_set_property;
   object_class->get_property = gimp_operation_posterize_get_property;
 
   point_class->process       = gimp_operation_posterize_process;
 
+  filter_class->per_component = TRUE;
+
   gegl_operation_class_set_keys (operation_class,
                                  "name",        "gimp:posterize",
                                  "categories",  "color",
@@ -0,0 +1,458 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-blend.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  these are vectorized versions of the separable blend functions in
+ *  gimpoperationlayermode-blend.c, processing two pixels at a time.
+ *
+ *  since the value of comp[RED..BLUE] is unconstrained when in[ALPHA] or
+ *  layer[ALPHA] are zero, all pixels are blended unconditionally.  for the
+ *  rest of the pixels, the result is bit-identical to the generic
+ *  functions: the operations are performed in the same order, and each
+ *  MIN(), MAX(), CLAMP() and conditional is replaced by a comparison and
+ *  a select with the same NaN behavior.  note that this file must not be
+ *  compiled with FMA enabled, since contracting the multiplications and
+ *  additions would change the rounding.
+ */
+
+
+#define EPSILON      1e-6f
+
+#define SAFE_DIV_MIN EPSILON
+#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+
+/* blend mask selecting the alpha components of both pixels */
+#define ALPHA_MASK   0x88
+
+
+typedef __m256 (* BlendFuncAVX2) (__m256 in,
+                                  __m256 layer);
+
+
+/*  local function prototypes  */
+
+static inline __m256   v_select     (__m256 cond,
+                                     __m256 a,
+                                     __m256 b);
+static inline __m256   v_min        (__m256 a,
+                                     __m256 b);
+static inline __m256   v_max        (__m256 a,
+                                     __m256 b);
+static inline __m256   v_abs        (__m256 a);
+static inline __m256   v_safe_div   (__m256 a,
+                                     __m256 b);
+
+static inline void     blend_avx2   (const gfloat  *in,
+                                     const gfloat  *layer,
+                                     gfloat        *comp,
+                                     gint           samples,
+                                     BlendFuncAVX2  func);
+
+
+/*  private functions  */
+
+
+#define V(x) _mm256_set1_ps (x)
+
+/* returns cond ? a : b */
+static inline __m256
+v_select (__m256 cond,
+          __m256 a,
+          __m256 b)
+{
+  return _mm256_blendv_ps (b, a, cond);
+}
+
+/* MIN (a, b), i.e., a < b ? a : b */
+static inline __m256
+v_min (__m256 a,
+       __m256 b)
+{
+  return _mm256_min_ps (a, b);
+}
+
+/* MAX (a, b), i.e., a > b ? a : b */
+static inline __m256
+v_max (__m256 a,
+       __m256 b)
+{
+  return _mm256_max_ps (a, b);
+}
+
+static inline __m256
+v_abs (__m256 a)
+{
+  return _mm256_andnot_ps (V (-0.0f), a);
+}
+
+/* see safe_div() in gimpoperationlayermode-blend-ops.h */
+static inline __m256
+v_safe_div (__m256 a,
+            __m256 b)
+{
+  __m256 result;
+
+  result = _mm256_div_ps (a, b);
+
+  /* CLAMP (result, -SAFE_DIV_MAX, SAFE_DIV_MAX) */
+  result = v_select (_mm256_cmp_ps (result, V (SAFE_DIV_MAX), _CMP_GT_OQ),
+                     V (SAFE_DIV_MAX),
+                     v_select (_mm256_cmp_ps (result, V (-SAFE_DIV_MAX),
+                                              _CMP_LT_OQ),
+                               V (-SAFE_DIV_MAX),
+                               result));
+
+  return v_select (_mm256_cmp_ps (v_abs (a), V (SAFE_DIV_MIN), _CMP_GT_OQ),
+                   result, _mm256_setzero_ps ());
+}
+
+static inline void
+blend_avx2 (const gfloat  *in,
+            const gfloat  *layer,
+            gfloat        *comp,
+            gint           samples,
+            BlendFuncAVX2  func)
+{
+  while (samples >= 2)
+    {
+      __m256 v_in    = _mm256_loadu_ps (in);
+      __m256 v_layer = _mm256_loadu_ps (layer);
+      __m256 v_comp;
+
+      v_comp = func (v_in, v_layer);
+      v_comp = _mm256_blend_ps (v_comp, v_layer, ALPHA_MASK);
+
+      _mm256_storeu_ps (comp, v_comp);
+
+      in      += 8;
+      layer   += 8;
+      comp    += 8;
+      samples -= 2;
+    }
+
+  if (samples)
+    {
+      __m256i v_mask = _mm256_setr_epi32 (-1, -1, -1, -1, 0, 0, 0, 0);
+      __m256  v_in    = _mm256_maskload_ps (in,    v_mask);
+      __m256  v_layer = _mm256_maskload_ps (layer, v_mask);
+      __m256  v_comp;
+
+      v_comp = func (v_in, v_layer);
+      v_comp = _mm256_blend_ps (v_comp, v_layer, ALPHA_MASK);
+
+      _mm256_maskstore_ps (comp, v_mask, v_comp);
+    }
+}
+
+
+/*  blend functions  */
+
+
+#define DEFINE_BLEND_FUNCTION(name)                                            \
+static void                                                                    \
+gimp_operation_layer_mode_blend_##name##_avx2 (GeglOperation *operation,       \
+                                               const gfloat  *in,              \
+                                               const gfloat  *layer,           \
+                                               gfloat        *comp,            \
+                                               gint           samples)         \
+{                                                                              \
+  blend_avx2 (in, layer, comp, samples, blend_##name);                         \
+}
+
+
+static inline __m256
+blend_addition (__m256 in,
+                __m256 layer)
+{
+  return in + layer;
+}
+
+static inline __m256
+blend_burn (__m256 in,
+            __m256 layer)
+{
+  return V (1.0f) - v_safe_div (V (1.0f) - in, layer);
+}
+
+static inline __m256
+blend_darken_only (__m256 in,
+                   __m256 layer)
+{
+  return v_min (in, layer);
+}
+
+static inline __m256
+blend_difference (__m256 in,
+                  __m256 layer)
+{
+  return v_abs (in - layer);
+}
+
+static inline __m256
+blend_divide (__m256 in,
+              __m256 layer)
+{
+  return v_safe_div (in, layer);
+}
+
+static inline __m256
+blend_dodge (__m256 in,
+             __m256 layer)
+{
+  return v_safe_div (in, V (1.0f) - layer);
+}
+
+static inline __m256
+blend_exclusion (__m256 in,
+                 __m256 layer)
+{
+  return V (0.5f) - V (2.0f) * (in - V (0.5f)) * (layer - V (0.5f));
+}
+
+static inline __m256
+blend_grain_extract (__m256 in,
+                     __m256 layer)
+{
+  return in - layer + V (0.5f);
+}
+
+static inline __m256
+blend_grain_merge (__m256 in,
+                   __m256 layer)
+{
+  return in + layer - V (0.5f);
+}
+
+static inline __m256
+blend_hard_mix (__m256 in,
+                __m256 layer)
+{
+  return v_select (_mm256_cmp_ps (in + layer, V (1.0f), _CMP_LT_OQ),
+                   V (0.0f), V (1.0f));
+}
+
+static inline __m256
+blend_hardlight (__m256 in,
+                 __m256 layer)
+{
+  __m256 high;
+  __m256 low;
+
+  high = (V (1.0f) - in) * (V (1.0f) - (layer - V (0.5f)) * V (2.0f));
+  high = v_min (V (1.0f) - high, V (1.0f));
+
+  low  = in * (layer * V (2.0f));
+  low  = v_min (low, V (1.0f));
+
+  return v_select (_mm256_cmp_ps (layer, V (0.5f), _CMP_GT_OQ), high, low);
+}
+
+static inline __m256
+blend_lighten_only (__m256 in,
+                    __m256 layer)
+{
+  return v_max (in, layer);
+}
+
+static inline __m256
+blend_linear_burn (__m256 in,
+                   __m256 layer)
+{
+  return in + layer - V (1.0f);
+}
+
+static inline __m256
+blend_linear_light (__m256 in,
+                    __m256 layer)
+{
+  return v_select (_mm256_cmp_ps (layer, V (0.5f), _CMP_LE_OQ),
+                   in + V (2.0f) * layer - V (1.0f),
+                   in + V (2.0f) * (layer - V (0.5f)));
+}
+
+static inline __m256
+blend_multiply (__m256 in,
+                __m256 layer)
+{
+  return in * layer;
+}
+
+static inline __m256
+blend_overlay (__m256 in,
+               __m256 layer)
+{
+  return v_select (_mm256_cmp_ps (in, V (0.5f), _CMP_LT_OQ),
+                   V (2.0f) * in * layer,
+                   V (1.0f) - V (2.0f) * (V (1.0f) - layer) * (V (1.0f) - in));
+}
+
+static inline __m256
+blend_pin_light (__m256 in,
+                 __m256 layer)
+{
+  return v_select (_mm256_cmp_ps (layer, V (0.5f), _CMP_GT_OQ),
+                   v_max (in, V (2.0f) * (layer - V (0.5f))),
+                   v_min (in, V (2.0f) * layer));
+}
+
+static inline __m256
+blend_screen (__m256 in,
+              __m256 layer)
+{
+  return V (1.0f) - (V (1.0f) - in) * (V (1.0f) - layer);
+}
+
+static inline __m256
+blend_softlight (__m256 in,
+                 __m256 layer)
+{
+  __m256 multiply = in * layer;
+  __m256 screen   = V (1.0f) - (V (1.0f) - in) * (V (1.0f) - layer);
+
+  return (V (1.0f) - in) * multiply + in * screen;
+}
+
+static inline __m256
+blend_subtract (__m256 in,
+                __m256 layer)
+{
+  return in - layer;
+}
+
+static inline __m256
+blend_vivid_light (__m256 in,
+                   __m256 layer)
+{
+  __m256 low;
+  __m256 high;
+
+  low  = V (1.0f) - v_safe_div (V (1.0f) - in, V (2.0f) * layer);
+  low  = v_max (low, V (0.0f));
+
+  high = v_safe_div (in, V (2.0f) * (V (1.0f) - layer));
+  high = v_min (high, V (1.0f));
+
+  return v_select (_mm256_cmp_ps (layer, V (0.5f), _CMP_LE_OQ), low, high);
+}
+
+#undef V
+
+
+DEFINE_BLEND_FUNCTION (addition)
+DEFINE_BLEND_FUNCTION (burn)
+DEFINE_BLEND_FUNCTION (darken_only)
+DEFINE_BLEND_FUNCTION (difference)
+DEFINE_BLEND_FUNCTION (divide)
+DEFINE_BLEND_FUNCTION (dodge)
+DEFINE_BLEND_FUNCTION (exclusion)
+DEFINE_BLEND_FUNCTION (grain_extract)
+DEFINE_BLEND_FUNCTION (grain_merge)
+DEFINE_BLEND_FUNCTION (hard_mix)
+DEFINE_BLEND_FUNCTION (hardlight)
+DEFINE_BLEND_FUNCTION (lighten_only)
+DEFINE_BLEND_FUNCTION (linear_burn)
+DEFINE_BLEND_FUNCTION (linear_light)
+DEFINE_BLEND_FUNCTION (multiply)
+DEFINE_BLEND_FUNCTION (overlay)
+DEFINE_BLEND_FUNCTION (pin_light)
+DEFINE_BLEND_FUNCTION (screen)
+DEFINE_BLEND_FUNCTION (softlight)
+DEFINE_BLEND_FUNCTION (subtract)
+DEFINE_BLEND_FUNCTION (vivid_light)
+
+#undef DEFINE_BLEND_FUNCTION
+
+
+/*  public functions  */
+
+
+/**
+ * gimp_operation_layer_mode_blend_get_avx2:
+ * @blend_function: a generic blend function
+ *
+ * Returns: the AVX2 version of @blend_function, or @blend_function
+ *          itself if it has no AVX2 version.  the caller is responsible
+ *          for checking that the CPU supports AVX2.
+ **/
+GimpLayerModeBlendFunc
+gimp_operation_layer_mode_blend_get_avx2 (GimpLayerModeBlendFunc blend_function)
+{
+#define BLEND_FUNCTION(name)                                                   \
+  { gimp_operation_layer_mode_blend_##name,                                    \
+    gimp_operation_layer_mode_blend_##name##_avx2 }
+
+  static const struct
+  {
+    GimpLayerModeBlendFunc generic;
+    GimpLayerModeBlendFunc avx2;
+  } blend_functions[] =
+  {
+    BLEND_FUNCTION (addition),
+    BLEND_FUNCTION (burn),
+    BLEND_FUNCTION (darken_only),
+    BLEND_FUNCTION (difference),
+    BLEND_FUNCTION (divide),
+    BLEND_FUNCTION (dodge),
+    BLEND_FUNCTION (exclusion),
+    BLEND_FUNCTION (grain_extract),
+    BLEND_FUNCTION (grain_merge),
+    BLEND_FUNCTION (hard_mix),
+    BLEND_FUNCTION (hardlight),
+    BLEND_FUNCTION (lighten_only),
+    BLEND_FUNCTION (linear_burn),
+    BLEND_FUNCTION (linear_light),
+    BLEND_FUNCTION (multiply),
+    BLEND_FUNCTION (overlay),
+    BLEND_FUNCTION (pin_light),
+    BLEND_FUNCTION (screen),
+    BLEND_FUNCTION (softlight),
+    BLEND_FUNCTION (subtract),
+    BLEND_FUNCTION (vivid_light)
+  };
+
+#undef BLEND_FUNCTION
+
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (blend_functions); i++)
+    {
+      if (blend_functions[i].generic == blend_function)
+        return blend_functions[i].avx2;
+    }
+
+  return blend_function;
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
@@ -0,0 +1,241 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-blend-ops.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_OPERATION_LAYER_MODE_BLEND_OPS_H__
+#define __GIMP_OPERATION_LAYER_MODE_BLEND_OPS_H__
+
+
+/*  the per-component operations of the separable blend functions, shared
+ *  by gimpoperationlayermode-blend.c and the fused pipeline in
+ *  gimpoperationlayermode-fused.cc.  the vectorized versions in
+ *  gimpoperationlayermode-blend-avx2.c must produce the same results.
+ */
+
+
+#define EPSILON      1e-6f
+
+#define SAFE_DIV_MIN EPSILON
+#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+
+
+/* returns a / b, clamped to [-SAFE_DIV_MAX, SAFE_DIV_MAX].
+ * if -SAFE_DIV_MIN <= a <= SAFE_DIV_MIN, returns 0.
+ */
+static inline gfloat
+safe_div (gfloat a,
+          gfloat b)
+{
+  gfloat result = 0.0f;
+
+  if (fabsf (a) > SAFE_DIV_MIN)
+    {
+      result = a / b;
+      result = CLAMP (result, -SAFE_DIV_MAX, SAFE_DIV_MAX);
+    }
+
+  return result;
+}
+
+static inline gfloat /* aka linear_dodge */
+blend_op_addition (gfloat in,
+                   gfloat layer)
+{
+  return in + layer;
+}
+
+static inline gfloat
+blend_op_burn (gfloat in,
+               gfloat layer)
+{
+  return 1.0f - safe_div (1.0f - in, layer);
+}
+
+static inline gfloat
+blend_op_darken_only (gfloat in,
+                      gfloat layer)
+{
+  return MIN (in, layer);
+}
+
+static inline gfloat
+blend_op_difference (gfloat in,
+                     gfloat layer)
+{
+  return fabsf (in - layer);
+}
+
+static inline gfloat
+blend_op_divide (gfloat in,
+                 gfloat layer)
+{
+  return safe_div (in, layer);
+}
+
+static inline gfloat
+blend_op_dodge (gfloat in,
+                gfloat layer)
+{
+  return safe_div (in, 1.0f - layer);
+}
+
+static inline gfloat
+blend_op_exclusion (gfloat in,
+                    gfloat layer)
+{
+  return 0.5f - 2.0f * (in - 0.5f) * (layer - 0.5f);
+}
+
+static inline gfloat
+blend_op_grain_extract (gfloat in,
+                        gfloat layer)
+{
+  return in - layer + 0.5f;
+}
+
+static inline gfloat
+blend_op_grain_merge (gfloat in,
+                      gfloat layer)
+{
+  return in + layer - 0.5f;
+}
+
+static inline gfloat
+blend_op_hard_mix (gfloat in,
+                   gfloat layer)
+{
+  return in + layer < 1.0f ? 0.0f : 1.0f;
+}
+
+static inline gfloat
+blend_op_hardlight (gfloat in,
+                    gfloat layer)
+{
+  gfloat val;
+
+  if (layer > 0.5f)
+    {
+      val = (1.0f - in) * (1.0f - (layer - 0.5f) * 2.0f);
+      val = MIN (1.0f - val, 1.0f);
+    }
+  else
+    {
+      val = in * (layer * 2.0f);
+      val = MIN (val, 1.0f);
+    }
+
+  return val;
+}
+
+static inline gfloat
+blend_op_lighten_only (gfloat in,
+                       gfloat layer)
+{
+  return MAX (in, layer);
+}
+
+static inline gfloat
+blend_op_linear_burn (gfloat in,
+                      gfloat layer)
+{
+  return in + layer - 1.0f;
+}
+
+static inline gfloat
+blend_op_linear_light (gfloat in,
+                       gfloat layer)
+{
+  if (layer <= 0.5f)
+    return in + 2.0f * layer - 1.0f;
+  else
+    return in + 2.0f * (layer - 0.5f);
+}
+
+static inline gfloat
+blend_op_multiply (gfloat in,
+                   gfloat layer)
+{
+  return in * layer;
+}
+
+static inline gfloat
+blend_op_overlay (gfloat in,
+                  gfloat layer)
+{
+  if (in < 0.5f)
+    return 2.0f * in * layer;
+  else
+    return 1.0f - 2.0f * (1.0f - layer) * (1.0f - in);
+}
+
+static inline gfloat
+blend_op_pin_light (gfloat in,
+                    gfloat layer)
+{
+  if (layer > 0.5f)
+    return MAX (in, 2.0f * (layer - 0.5f));
+  else
+    return MIN (in, 2.0f * layer);
+}
+
+static inline gfloat
+blend_op_screen (gfloat in,
+                 gfloat layer)
+{
+  return 1.0f - (1.0f - in) * (1.0f - layer);
+}
+
+static inline gfloat
+blend_op_softlight (gfloat in,
+                    gfloat layer)
+{
+  gfloat multiply = in * layer;
+  gfloat screen   = 1.0f - (1.0f - in) * (1.0f - layer);
+
+  return (1.0f - in) * multiply + in * screen;
+}
+
+static inline gfloat
+blend_op_subtract (gfloat in,
+                   gfloat layer)
+{
+  return in - layer;
+}
+
+static inline gfloat
+blend_op_vivid_light (gfloat in,
+                      gfloat layer)
+{
+  gfloat val;
+
+  if (layer <= 0.5f)
+    {
+      val = 1.0f - safe_div (1.0f - in, 2.0f * layer);
+      val = MAX (val, 0.0f);
+    }
+  else
+    {
+      val = safe_div (in, 2.0f * (1.0f - layer));
+      val = MIN (val, 1.0f);
+    }
+
+  return val;
+}
+
+
+#endif /* __GIMP_OPERATION_LAYER_MODE_BLEND_OPS_H__ */
@@ -33,39 +33,50 @@
 #include "../operations-types.h"
 
 #include "gimpoperationlayermode-blend.h"
-
-
-#define EPSILON      1e-6f
-
-#define SAFE_DIV_MIN EPSILON
-#define SAFE_DIV_MAX (1.0f / SAFE_DIV_MIN)
+#include "gimpoperationlayermode-blend-ops.h"
 
 
 /*  local function prototypes  */
 
-static inline gfloat   safe_div (gfloat a,
-                                 gfloat b);
+static inline void   blend_separable (const gfloat  *in,
+                                      const gfloat  *layer,
+                                      gfloat        *comp,
+                                      gint           samples,
+                                      gfloat       (* op) (gfloat in,
+                                                           gfloat layer));
 
 
 /*  private functions  */
 
 
-/* returns a / b, clamped to [-SAFE_DIV_MAX, SAFE_DIV_MAX].
- * if -SAFE_DIV_MIN <= a <= SAFE_DIV_MIN, returns 0.
+/* blends the color components of each pixel with 'op', from
+ * gimpoperationlayermode-blend-ops.h.  'op' is known at compile time in
+ * every call, so it gets inlined.
  */
-static inline gfloat
-safe_div (gfloat a,
-          gfloat b)
+static inline void
+blend_separable (const gfloat  *in,
+                 const gfloat  *layer,
+                 gfloat        *comp,
+                 gint           samples,
+                 gfloat       (* op) (gfloat in,
+                                      gfloat layer))
 {
-  gfloat result = 0.0f;
-
-  if (fabsf (a) > SAFE_DIV_MIN)
+  while (samples--)
     {
-      result = a / b;
-      result = CLAMP (result, -SAFE_DIV_MAX, SAFE_DIV_MAX);
-    }
+      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
+        {
+          gint c;
 
-  return result;
+          for (c = 0; c < 3; c++)
+            comp[c] = op (in[c], layer[c]);
+        }
+
+      comp[ALPHA] = layer[ALPHA];
+
+      comp  += 4;
+      layer += 4;
+      in    += 4;
+    }
 }
 
 
@@ -86,22 +97,7 @@ gimp_operation_layer_mode_blend_addition (GeglOperation *operation,
                                           gfloat        *comp,
                                           gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] + layer[c];
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_addition);
 }
 
 void
@@ -111,22 +107,7 @@ gimp_operation_layer_mode_blend_burn (GeglOperation *operation,
                                       gfloat        *comp,
                                       gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = 1.0f - safe_div (1.0f - in[c], layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_burn);
 }
 
 void
@@ -136,22 +117,7 @@ gimp_operation_layer_mode_blend_darken_only (GeglOperation *operation,
                                              gfloat        *comp,
                                              gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = MIN (in[c], layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_darken_only);
 }
 
 void
@@ -161,22 +127,7 @@ gimp_operation_layer_mode_blend_difference (GeglOperation *operation,
                                             gfloat        *comp,
                                             gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = fabsf (in[c] - layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_difference);
 }
 
 void
@@ -186,22 +137,7 @@ gimp_operation_layer_mode_blend_divide (GeglOperation *operation,
                                         gfloat        *comp,
                                         gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = safe_div (in[c], layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_divide);
 }
 
 void
@@ -211,22 +147,7 @@ gimp_operation_layer_mode_blend_dodge (GeglOperation *operation,
                                        gfloat        *comp,
                                        gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = safe_div (in[c], 1.0f - layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_dodge);
 }
 
 void
@@ -236,22 +157,7 @@ gimp_operation_layer_mode_blend_exclusion (GeglOperation *operation,
                                            gfloat        *comp,
                                            gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = 0.5f - 2.0f * (in[c] - 0.5f) * (layer[c] - 0.5f);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_exclusion);
 }
 
 void
@@ -261,22 +167,7 @@ gimp_operation_layer_mode_blend_grain_extract (GeglOperation *operation,
                                                gfloat        *comp,
                                                gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] - layer[c] + 0.5f;
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_grain_extract);
 }
 
 void
@@ -286,22 +177,7 @@ gimp_operation_layer_mode_blend_grain_merge (GeglOperation *operation,
                                              gfloat        *comp,
                                              gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] + layer[c] - 0.5f;
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_grain_merge);
 }
 
 void
@@ -311,22 +187,7 @@ gimp_operation_layer_mode_blend_hard_mix (GeglOperation *operation,
                                           gfloat        *comp,
                                           gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] + layer[c] < 1.0f ? 0.0f : 1.0f;
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_hard_mix);
 }
 
 void
@@ -336,36 +197,7 @@ gimp_operation_layer_mode_blend_hardlight (GeglOperation *operation,
                                            gfloat        *comp,
                                            gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat val;
-
-              if (layer[c] > 0.5f)
-                {
-                  val = (1.0f - in[c]) * (1.0f - (layer[c] - 0.5f) * 2.0f);
-                  val = MIN (1.0f - val, 1.0f);
-                }
-              else
-                {
-                  val = in[c] * (layer[c] * 2.0f);
-                  val = MIN (val, 1.0f);
-                }
-
-              comp[c] = val;
-            }
-        }
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_hardlight);
 }
 
 void
@@ -729,22 +561,7 @@ gimp_operation_layer_mode_blend_lighten_only (GeglOperation *operation,
                                               gfloat        *comp,
                                               gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = MAX (in[c], layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_lighten_only);
 }
 
 void
@@ -754,22 +571,7 @@ gimp_operation_layer_mode_blend_linear_burn (GeglOperation *operation,
                                              gfloat        *comp,
                                              gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] + layer[c] - 1.0f;
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_linear_burn);
 }
 
 /* added according to:
@@ -781,31 +583,7 @@ gimp_operation_layer_mode_blend_linear_light (GeglOperation *operation,
                                               gfloat        *comp,
                                               gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat val;
-
-              if (layer[c] <= 0.5f)
-                val = in[c] + 2.0f * layer[c] - 1.0f;
-              else
-                val = in[c] + 2.0f * (layer[c] - 0.5f);
-
-              comp[c] = val;
-            }
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_linear_light);
 }
 
 void
@@ -958,22 +736,7 @@ gimp_operation_layer_mode_blend_multiply (GeglOperation *operation,
                                           gfloat        *comp,
                                           gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] * layer[c];
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_multiply);
 }
 
 void
@@ -983,30 +746,7 @@ gimp_operation_layer_mode_blend_overlay (GeglOperation *operation,
                                          gfloat        *comp,
                                          gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat val;
-
-              if (in[c] < 0.5f)
-                val = 2.0f * in[c] * layer[c];
-              else
-                val = 1.0f - 2.0f * (1.0f - layer[c]) * (1.0f - in[c]);
-
-              comp[c] = val;
-            }
-        }
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_overlay);
 }
 
 /* added according to:
@@ -1018,31 +758,7 @@ gimp_operation_layer_mode_blend_pin_light (GeglOperation *operation,
                                            gfloat        *comp,
                                            gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat val;
-
-              if (layer[c] > 0.5f)
-                val = MAX(in[c], 2.0f * (layer[c] - 0.5f));
-              else
-                val = MIN(in[c], 2.0f * layer[c]);
-
-              comp[c] = val;
-            }
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_pin_light);
 }
 
 void
@@ -1052,22 +768,7 @@ gimp_operation_layer_mode_blend_screen (GeglOperation *operation,
                                         gfloat        *comp,
                                         gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = 1.0f - (1.0f - in[c])   * (1.0f - layer[c]);
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_screen);
 }
 
 void
@@ -1077,27 +778,7 @@ gimp_operation_layer_mode_blend_softlight (GeglOperation *operation,
                                            gfloat        *comp,
                                            gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat multiply = in[c] * layer[c];
-              gfloat screen   = 1.0f - (1.0f - in[c]) * (1.0f - layer[c]);
-              gfloat val      = (1.0f - in[c]) * multiply + in[c] * screen;
-
-              comp[c] = val;
-            }
-        }
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_softlight);
 }
 
 void
@@ -1107,22 +788,7 @@ gimp_operation_layer_mode_blend_subtract (GeglOperation *operation,
                                           gfloat        *comp,
                                           gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            comp[c] = in[c] - layer[c];
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_subtract);
 }
 
 /* added according to:
@@ -1134,37 +800,7 @@ gimp_operation_layer_mode_blend_vivid_light (GeglOperation *operation,
                                              gfloat        *comp,
                                              gint           samples)
 {
-  while (samples--)
-    {
-      if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
-        {
-          gint c;
-
-          for (c = 0; c < 3; c++)
-            {
-              gfloat val;
-
-              if (layer[c] <= 0.5f)
-                {
-                  val = 1.0f - safe_div (1.0f - in[c], 2.0f * layer[c]);
-                  val = MAX (val, 0.0f);
-                }
-              else
-                {
-                  val = safe_div (in[c], 2.0f * (1.0f - layer[c]));
-                  val = MIN (val, 1.0f);
-                }
-
-              comp[c] = val;
-            }
-        }
-
-      comp[ALPHA] = layer[ALPHA];
-
-      comp  += 4;
-      layer += 4;
-      in    += 4;
-    }
+  blend_separable (in, layer, comp, samples, blend_op_vivid_light);
 }
 
 
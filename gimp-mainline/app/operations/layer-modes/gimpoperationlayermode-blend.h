@@ -197,4 +197,11 @@ void gimp_operation_layer_mode_blend_color_erase       (GeglOperation *operation
                                                         gint           samples);
 
 
+#if COMPILE_AVX2_INTRINISICS
+
+GimpLayerModeBlendFunc gimp_operation_layer_mode_blend_get_avx2 (GimpLayerModeBlendFunc blend_function);
+
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+
 #endif /* __GIMP_OPERATION_LAYER_MODE_BLEND_H__ */
@@ -0,0 +1,232 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-composite-avx2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+#include <cairo.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "../operations-types.h"
+
+#include "gimpoperationlayermode-composite.h"
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+/* AVX2 */
+#include <immintrin.h>
+
+
+/*  these are vectorized versions of the non-subtractive compositing
+ *  functions in gimpoperationlayermode-composite.c, processing two pixels
+ *  at a time.  all the cases of the generic functions are evaluated, and
+ *  the right one is selected per pixel, so that the result is
+ *  bit-identical.  like the blend functions, this file must not be compiled
+ *  with FMA enabled.
+ */
+
+
+/* blend mask selecting the alpha components of both pixels */
+#define ALPHA_MASK 0x88
+
+
+#define V(x) _mm256_set1_ps (x)
+
+/* returns cond ? a : b */
+#define SELECT(cond, a, b) _mm256_blendv_ps ((b), (a), (cond))
+
+/* broadcasts the alpha component of each pixel to all its components */
+#define V_ALPHA(v)         _mm256_permute_ps ((v), _MM_SHUFFLE (3, 3, 3, 3))
+
+#define IS_ZERO(v)         _mm256_cmp_ps ((v), _mm256_setzero_ps (), _CMP_EQ_OQ)
+
+
+#define COMPOSITE_LOOP(body)                                                   \
+  G_STMT_START                                                                 \
+    {                                                                          \
+      const __m256i v_tail_mask = _mm256_setr_epi32 (-1, -1, -1, -1,           \
+                                                      0,  0,  0,  0);          \
+      const __m256  v_opacity   = V (opacity);                                 \
+                                                                               \
+      while (samples > 0)                                                      \
+        {                                                                      \
+          __m256 v_in, v_layer, v_comp, v_mask, v_out;                         \
+                                                                               \
+          if (samples >= 2)                                                    \
+            {                                                                  \
+              v_in    = _mm256_loadu_ps (in);                                  \
+              v_layer = _mm256_loadu_ps (layer);                               \
+              v_comp  = _mm256_loadu_ps (comp);                                \
+                                                                               \
+              if (mask)                                                        \
+                v_mask = _mm256_setr_ps (mask[0], mask[0], mask[0], mask[0],   \
+                                         mask[1], mask[1], mask[1], mask[1]);  \
+              else                                                             \
+                v_mask = V (1.0f);                                             \
+            }                                                                  \
+          else                                                                 \
+            {                                                                  \
+              v_in    = _mm256_maskload_ps (in,    v_tail_mask);               \
+              v_layer = _mm256_maskload_ps (layer, v_tail_mask);               \
+              v_comp  = _mm256_maskload_ps (comp,  v_tail_mask);               \
+                                                                               \
+              if (mask)                                                        \
+                v_mask = V (mask[0]);                                          \
+              else                                                             \
+                v_mask = V (1.0f);                                             \
+            }                                                                  \
+                                                                               \
+          body                                                                 \
+                                                                               \
+          if (samples >= 2)                                                    \
+            _mm256_storeu_ps (out, v_out);                                     \
+          else                                                                 \
+            _mm256_maskstore_ps (out, v_tail_mask, v_out);                     \
+                                                                               \
+          in    += 8;                                                          \
+          layer += 8;                                                          \
+          comp  += 8;                                                          \
+          out   += 8;                                                          \
+                                                                               \
+          if (mask)                                                            \
+            mask += 2;                                                         \
+                                                                               \
+          samples -= 2;                                                        \
+        }                                                                      \
+    }                                                                          \
+  G_STMT_END
+
+
+void
+gimp_operation_layer_mode_composite_union_avx2 (const gfloat *in,
+                                                const gfloat *layer,
+                                                const gfloat *comp,
+                                                const gfloat *mask,
+                                                gfloat        opacity,
+                                                gfloat       *out,
+                                                gint          samples)
+{
+  COMPOSITE_LOOP (
+    {
+      __m256 in_alpha    = V_ALPHA (v_in);
+      __m256 layer_alpha = V_ALPHA (v_layer) * v_opacity;
+      __m256 new_alpha;
+      __m256 ratio;
+
+      if (mask)
+        layer_alpha *= v_mask;
+
+      new_alpha = layer_alpha + (V (1.0f) - layer_alpha) * in_alpha;
+
+      ratio = layer_alpha / new_alpha;
+
+      v_out = ratio * (in_alpha * (v_comp - v_layer) + v_layer - v_in) + v_in;
+
+      v_out = SELECT (IS_ZERO (in_alpha), v_layer, v_out);
+      v_out = SELECT (_mm256_or_ps (IS_ZERO (layer_alpha),
+                                    IS_ZERO (new_alpha)),
+                      v_in, v_out);
+
+      v_out = _mm256_blend_ps (v_out, new_alpha, ALPHA_MASK);
+    });
+}
+
+void
+gimp_operation_layer_mode_composite_clip_to_backdrop_avx2 (const gfloat *in,
+                                                           const gfloat *layer,
+                                                           const gfloat *comp,
+                                                           const gfloat *mask,
+                                                           gfloat        opacity,
+                                                           gfloat       *out,
+                                                           gint          samples)
+{
+  /* 'layer' is not used by this mode, but is still advanced by the loop */
+  layer = comp;
+
+  COMPOSITE_LOOP (
+    {
+      __m256 in_alpha    = V_ALPHA (v_in);
+      __m256 layer_alpha = V_ALPHA (v_comp) * v_opacity;
+
+      if (mask)
+        layer_alpha *= v_mask;
+
+      v_out = v_comp * layer_alpha + v_in * (V (1.0f) - layer_alpha);
+
+      v_out = SELECT (_mm256_or_ps (IS_ZERO (in_alpha),
+                                    IS_ZERO (layer_alpha)),
+                      v_in, v_out);
+
+      v_out = _mm256_blend_ps (v_out, v_in, ALPHA_MASK);
+    });
+}
+
+void
+gimp_operation_layer_mode_composite_clip_to_layer_avx2 (const gfloat *in,
+                                                        const gfloat *layer,
+                                                        const gfloat *comp,
+                                                        const gfloat *mask,
+                                                        gfloat        opacity,
+                                                        gfloat       *out,
+                                                        gint          samples)
+{
+  COMPOSITE_LOOP (
+    {
+      __m256 in_alpha    = V_ALPHA (v_in);
+      __m256 layer_alpha = V_ALPHA (v_layer) * v_opacity;
+
+      if (mask)
+        layer_alpha *= v_mask;
+
+      v_out = v_comp * in_alpha + v_layer * (V (1.0f) - in_alpha);
+
+      v_out = SELECT (IS_ZERO (in_alpha),    v_layer, v_out);
+      v_out = SELECT (IS_ZERO (layer_alpha), v_in,    v_out);
+
+      v_out = _mm256_blend_ps (v_out, layer_alpha, ALPHA_MASK);
+    });
+}
+
+void
+gimp_operation_layer_mode_composite_intersection_avx2 (const gfloat *in,
+                                                       const gfloat *layer,
+                                                       const gfloat *comp,
+                                                       const gfloat *mask,
+                                                       gfloat        opacity,
+                                                       gfloat       *out,
+                                                       gint          samples)
+{
+  /* 'layer' is not used by this mode, but is still advanced by the loop */
+  layer = comp;
+
+  COMPOSITE_LOOP (
+    {
+      __m256 new_alpha = V_ALPHA (v_in) * V_ALPHA (v_comp) * v_opacity;
+
+      if (mask)
+        new_alpha *= v_mask;
+
+      v_out = SELECT (IS_ZERO (new_alpha), v_in, v_comp);
+
+      v_out = _mm256_blend_ps (v_out, new_alpha, ALPHA_MASK);
+    });
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
@@ -0,0 +1,621 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-fused.cc
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <gegl-plugin.h>
+
+extern "C"
+{
+
+#include "../operations-types.h"
+
+#include "gimp-layer-modes.h"
+#include "gimpoperationlayermode-blend.h"
+#include "gimpoperationlayermode-blend-ops.h"
+#include "gimpoperationlayermode-fused.h"
+
+} /* extern "C" */
+
+
+/* the number of samples processed in one go when the blend and composite
+ * stages can't be fused per-pixel.  the intermediate buffers of such a block
+ * take up 1 KiB each, and therefore stay in L1, instead of being allocated
+ * for the entire processed area.
+ */
+#define BLOCK_SIZE   64
+
+
+/* gimp_operation_layer_mode_fused_process() performs the blend and composite
+ * stages of a layer mode in a single pass over the samples.  we statically
+ * generate a specialized process function for each combination of blend
+ * operation, color-space conversion, and composite mode, and dispatch to the
+ * right one at runtime, based on the layer mode and the other parameters.
+ *
+ * each specialization is composed of two components:
+ *
+ *   - A blend class, implementing the blend stage.  for the separable layer
+ *     modes, this is a SeparableBlend<> specialization, which blends
+ *     individual pixels using the operations of
+ *     gimpoperationlayermode-blend-ops.h; otherwise, it's the FunctionBlend
+ *     class, which calls the (possibly vectorized) blend function of the
+ *     layer mode.
+ *
+ *   - A composite class, implementing the composite stage.  this is either a
+ *     Composite<> specialization, which composites individual pixels, or the
+ *     FunctionComposite class, which calls the given (possibly vectorized, or
+ *     subtractive) composite function.
+ *
+ * when no color-space conversion is necessary, the separable, non-subtractive
+ * modes produce each composited pixel directly from the input pixels,
+ * without using an intermediate buffer.  otherwise, the samples are
+ * processed in blocks of BLOCK_SIZE samples, using small on-stack buffers
+ * for the intermediate results, and the vectorized functions where
+ * available.
+ *
+ * the per-pixel composite code below is equivalent to the corresponding
+ * functions in gimpoperationlayermode-composite.c, and the two must be kept
+ * in sync.
+ */
+
+
+using ProcessFunc = void (*) (const GimpLayerModeFusedParams *params,
+                              const gfloat                   *in,
+                              const gfloat                   *layer,
+                              const gfloat                   *mask,
+                              gfloat                         *out,
+                              gint                            samples);
+
+
+/*  blend classes  */
+
+
+template <gfloat (* op) (gfloat in,
+                         gfloat layer)>
+struct SeparableBlend
+{
+  static constexpr gboolean per_pixel = TRUE;
+
+  static inline void
+  blend_pixel (const gfloat *in,
+               const gfloat *layer,
+               gfloat       *comp)
+  {
+    if (in[ALPHA] != 0.0f && layer[ALPHA] != 0.0f)
+      {
+        gint c;
+
+        for (c = 0; c < 3; c++)
+          comp[c] = op (in[c], layer[c]);
+      }
+
+    comp[ALPHA] = layer[ALPHA];
+  }
+};
+
+struct FunctionBlend
+{
+  static constexpr gboolean per_pixel = FALSE;
+
+  static void
+  blend (const GimpLayerModeFusedParams *params,
+         const gfloat                   *in,
+         const gfloat                   *layer,
+         gfloat                         *comp,
+         gint                            samples)
+  {
+    params->blend_function (params->operation, in, layer, comp, samples);
+  }
+};
+
+
+/*  composite classes  */
+
+
+template <class Derived>
+struct CompositeBase
+{
+  static constexpr gboolean per_pixel = TRUE;
+
+  static void
+  composite (const GimpLayerModeFusedParams *params,
+             const gfloat                   *in,
+             const gfloat                   *layer,
+             const gfloat                   *comp,
+             const gfloat                   *mask,
+             gfloat                         *out,
+             gint                            samples)
+  {
+    const gfloat opacity = params->opacity;
+
+    while (samples--)
+      {
+        Derived::composite_pixel (in, layer, comp, mask, opacity, out);
+
+        in    += 4;
+        layer += 4;
+        comp  += 4;
+        out   += 4;
+
+        if (mask)
+          mask++;
+      }
+  }
+};
+
+template <GimpLayerCompositeMode composite_mode>
+struct Composite;
+
+template <>
+struct Composite<GIMP_LAYER_COMPOSITE_UNION> :
+  CompositeBase<Composite<GIMP_LAYER_COMPOSITE_UNION>>
+{
+  static inline void
+  composite_pixel (const gfloat *in,
+                   const gfloat *layer,
+                   const gfloat *comp,
+                   const gfloat *mask,
+                   gfloat        opacity,
+                   gfloat       *out)
+  {
+    gfloat new_alpha;
+    gfloat in_alpha    = in[ALPHA];
+    gfloat layer_alpha = layer[ALPHA] * opacity;
+
+    if (mask)
+      layer_alpha *= *mask;
+
+    new_alpha = layer_alpha + (1.0f - layer_alpha) * in_alpha;
+
+    if (layer_alpha == 0.0f || new_alpha == 0.0f)
+      {
+        out[RED]   = in[RED];
+        out[GREEN] = in[GREEN];
+        out[BLUE]  = in[BLUE];
+      }
+    else if (in_alpha == 0.0f)
+      {
+        out[RED]   = layer[RED];
+        out[GREEN] = layer[GREEN];
+        out[BLUE]  = layer[BLUE];
+      }
+    else
+      {
+        gfloat ratio = layer_alpha / new_alpha;
+        gint   b;
+
+        for (b = RED; b < ALPHA; b++)
+          out[b] = ratio * (in_alpha * (comp[b] - layer[b]) + layer[b] - in[b]) + in[b];
+      }
+
+    out[ALPHA] = new_alpha;
+  }
+};
+
+template <>
+struct Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP> :
+  CompositeBase<Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP>>
+{
+  static inline void
+  composite_pixel (const gfloat *in,
+                   const gfloat *layer,
+                   const gfloat *comp,
+                   const gfloat *mask,
+                   gfloat        opacity,
+                   gfloat       *out)
+  {
+    gfloat layer_alpha = comp[ALPHA] * opacity;
+
+    if (mask)
+      layer_alpha *= *mask;
+
+    if (in[ALPHA] == 0.0f || layer_alpha == 0.0f)
+      {
+        out[RED]   = in[RED];
+        out[GREEN] = in[GREEN];
+        out[BLUE]  = in[BLUE];
+      }
+    else
+      {
+        gint b;
+
+        for (b = RED; b < ALPHA; b++)
+          out[b] = comp[b] * layer_alpha + in[b] * (1.0f - layer_alpha);
+      }
+
+    out[ALPHA] = in[ALPHA];
+  }
+};
+
+template <>
+struct Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER> :
+  CompositeBase<Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER>>
+{
+  static inline void
+  composite_pixel (const gfloat *in,
+                   const gfloat *layer,
+                   const gfloat *comp,
+                   const gfloat *mask,
+                   gfloat        opacity,
+                   gfloat       *out)
+  {
+    gfloat layer_alpha = layer[ALPHA] * opacity;
+
+    if (mask)
+      layer_alpha *= *mask;
+
+    if (layer_alpha == 0.0f)
+      {
+        out[RED]   = in[RED];
+        out[GREEN] = in[GREEN];
+        out[BLUE]  = in[BLUE];
+      }
+    else if (in[ALPHA] == 0.0f)
+      {
+        out[RED]   = layer[RED];
+        out[GREEN] = layer[GREEN];
+        out[BLUE]  = layer[BLUE];
+      }
+    else
+      {
+        gint b;
+
+        for (b = RED; b < ALPHA; b++)
+          out[b] = comp[b] * in[ALPHA] + layer[b] * (1.0f - in[ALPHA]);
+      }
+
+    out[ALPHA] = layer_alpha;
+  }
+};
+
+template <>
+struct Composite<GIMP_LAYER_COMPOSITE_INTERSECTION> :
+  CompositeBase<Composite<GIMP_LAYER_COMPOSITE_INTERSECTION>>
+{
+  static inline void
+  composite_pixel (const gfloat *in,
+                   const gfloat *layer,
+                   const gfloat *comp,
+                   const gfloat *mask,
+                   gfloat        opacity,
+                   gfloat       *out)
+  {
+    gfloat new_alpha = in[ALPHA] * comp[ALPHA] * opacity;
+
+    if (mask)
+      new_alpha *= *mask;
+
+    if (new_alpha == 0.0f)
+      {
+        out[RED]   = in[RED];
+        out[GREEN] = in[GREEN];
+        out[BLUE]  = in[BLUE];
+      }
+    else
+      {
+        out[RED]   = comp[RED];
+        out[GREEN] = comp[GREEN];
+        out[BLUE]  = comp[BLUE];
+      }
+
+    out[ALPHA] = new_alpha;
+  }
+};
+
+struct FunctionComposite
+{
+  static constexpr gboolean per_pixel = FALSE;
+
+  static void
+  composite (const GimpLayerModeFusedParams *params,
+             const gfloat                   *in,
+             const gfloat                   *layer,
+             const gfloat                   *comp,
+             const gfloat                   *mask,
+             gfloat                         *out,
+             gint                            samples)
+  {
+    params->composite_function (in, layer, comp, mask, params->opacity,
+                                out, samples);
+  }
+};
+
+
+/*  process functions  */
+
+
+/* the generic version, processing the samples in blocks */
+template <class    Blend,
+          class    Composite,
+          gboolean convert,
+          gboolean fused = ! convert         &&
+                           Blend::per_pixel  &&
+                           Composite::per_pixel>
+struct Process
+{
+  static void
+  process (const GimpLayerModeFusedParams *params,
+           const gfloat                   *in,
+           const gfloat                   *layer,
+           const gfloat                   *mask,
+           gfloat                         *out,
+           gint                            samples)
+  {
+    gfloat blend_in[4 * BLOCK_SIZE];
+    gfloat blend_layer[4 * BLOCK_SIZE];
+    gfloat comp[4 * BLOCK_SIZE];
+
+    while (samples > 0)
+      {
+        gint size = MIN (samples, BLOCK_SIZE);
+
+        if (convert)
+          {
+            gint first;
+            gint last;
+            gint i;
+
+            /* samples whose source or destination alpha is zero are not
+             * blended, and therefore do not need to be converted.  only
+             * convert and blend the range between the first and last blended
+             * samples of the block, and make sure the alpha of the rest of
+             * the composite samples is 0.
+             */
+            for (first = 0; first < size; first++)
+              {
+                if (in[4 * first + ALPHA] != 0.0f &&
+                    layer[4 * first + ALPHA] != 0.0f)
+                  {
+                    break;
+                  }
+              }
+
+            for (last = size; last > first; last--)
+              {
+                if (in[4 * (last - 1) + ALPHA] != 0.0f &&
+                    layer[4 * (last - 1) + ALPHA] != 0.0f)
+                  {
+                    break;
+                  }
+              }
+
+            for (i = 0; i < first; i++)
+              comp[4 * i + ALPHA] = 0.0f;
+
+            for (i = last; i < size; i++)
+              comp[4 * i + ALPHA] = 0.0f;
+
+            if (first < last)
+              {
+                gint offset = 4 * first;
+                gint count  = last - first;
+
+                babl_process (params->composite_to_blend_fish,
+                              in + offset, blend_in + offset, count);
+                babl_process (params->composite_to_blend_fish,
+                              layer + offset, blend_layer + offset, count);
+
+                Blend::blend (params,
+                              blend_in + offset, blend_layer + offset,
+                              comp + offset, count);
+
+                babl_process (params->blend_to_composite_fish,
+                              comp + offset, comp + offset, count);
+              }
+          }
+        else
+          {
+            Blend::blend (params, in, layer, comp, size);
+          }
+
+        Composite::composite (params, in, layer, comp, mask, out, size);
+
+        in      += 4 * size;
+        layer   += 4 * size;
+        out     += 4 * size;
+
+        if (mask)
+          mask  += size;
+
+        samples -= size;
+      }
+  }
+};
+
+/* the fused version, producing each output pixel directly from the input
+ * pixels
+ */
+template <class    Blend,
+          class    Composite,
+          gboolean convert>
+struct Process<Blend, Composite, convert, TRUE>
+{
+  static void
+  process (const GimpLayerModeFusedParams *params,
+           const gfloat                   *in,
+           const gfloat                   *layer,
+           const gfloat                   *mask,
+           gfloat                         *out,
+           gint                            samples)
+  {
+    const gfloat opacity = params->opacity;
+
+    while (samples--)
+      {
+        gfloat comp[4];
+
+        Blend::blend_pixel (in, layer, comp);
+
+        Composite::composite_pixel (in, layer, comp, mask, opacity, out);
+
+        in    += 4;
+        layer += 4;
+        out   += 4;
+
+        if (mask)
+          mask++;
+      }
+  }
+};
+
+
+/*  dispatch functions  */
+
+
+/* the blocked version, for all modes */
+template <gboolean convert>
+static ProcessFunc
+dispatch_composite (const GimpLayerModeFusedParams *params)
+{
+  if (params->composite_function)
+    return Process<FunctionBlend, FunctionComposite, convert>::process;
+
+  switch (params->composite_mode)
+    {
+    case GIMP_LAYER_COMPOSITE_AUTO:
+    case GIMP_LAYER_COMPOSITE_UNION:
+      return Process<FunctionBlend,
+                     Composite<GIMP_LAYER_COMPOSITE_UNION>,
+                     convert>::process;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
+      return Process<FunctionBlend,
+                     Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP>,
+                     convert>::process;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
+      return Process<FunctionBlend,
+                     Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER>,
+                     convert>::process;
+
+    case GIMP_LAYER_COMPOSITE_INTERSECTION:
+      return Process<FunctionBlend,
+                     Composite<GIMP_LAYER_COMPOSITE_INTERSECTION>,
+                     convert>::process;
+    }
+
+  g_return_val_if_reached (NULL);
+}
+
+/* the fused version, for the separable modes.  the built-in per-pixel
+ * composite code is used even if a vectorized composite function is
+ * available, since it saves a pass over the samples.
+ */
+template <class Blend>
+static ProcessFunc
+dispatch_fused_composite (const GimpLayerModeFusedParams *params)
+{
+  switch (params->composite_mode)
+    {
+    case GIMP_LAYER_COMPOSITE_AUTO:
+    case GIMP_LAYER_COMPOSITE_UNION:
+      return Process<Blend,
+                     Composite<GIMP_LAYER_COMPOSITE_UNION>,
+                     FALSE>::process;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
+      return Process<Blend,
+                     Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP>,
+                     FALSE>::process;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
+      return Process<Blend,
+                     Composite<GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER>,
+                     FALSE>::process;
+
+    case GIMP_LAYER_COMPOSITE_INTERSECTION:
+      return Process<Blend,
+                     Composite<GIMP_LAYER_COMPOSITE_INTERSECTION>,
+                     FALSE>::process;
+    }
+
+  g_return_val_if_reached (NULL);
+}
+
+/* returns NULL if the blend stage of the layer mode isn't separable */
+static ProcessFunc
+dispatch_fused (const GimpLayerModeFusedParams *params)
+{
+  #define SEPARABLE_BLEND(mode, name)                                          \
+    case GIMP_LAYER_MODE_##mode:                                               \
+      return dispatch_fused_composite<SeparableBlend<blend_op_##name>> (params)
+
+  switch (params->layer_mode)
+    {
+    SEPARABLE_BLEND (ADDITION,      addition);
+    SEPARABLE_BLEND (BURN,          burn);
+    SEPARABLE_BLEND (DARKEN_ONLY,   darken_only);
+    SEPARABLE_BLEND (DIFFERENCE,    difference);
+    SEPARABLE_BLEND (DIVIDE,        divide);
+    SEPARABLE_BLEND (DODGE,         dodge);
+    SEPARABLE_BLEND (EXCLUSION,     exclusion);
+    SEPARABLE_BLEND (GRAIN_EXTRACT, grain_extract);
+    SEPARABLE_BLEND (GRAIN_MERGE,   grain_merge);
+    SEPARABLE_BLEND (HARD_MIX,      hard_mix);
+    SEPARABLE_BLEND (HARDLIGHT,     hardlight);
+    SEPARABLE_BLEND (LIGHTEN_ONLY,  lighten_only);
+    SEPARABLE_BLEND (LINEAR_BURN,   linear_burn);
+    SEPARABLE_BLEND (LINEAR_LIGHT,  linear_light);
+    SEPARABLE_BLEND (MULTIPLY,      multiply);
+    SEPARABLE_BLEND (OVERLAY,       overlay);
+    SEPARABLE_BLEND (PIN_LIGHT,     pin_light);
+    SEPARABLE_BLEND (SCREEN,        screen);
+    SEPARABLE_BLEND (SOFTLIGHT,     softlight);
+    SEPARABLE_BLEND (SUBTRACT,      subtract);
+    SEPARABLE_BLEND (VIVID_LIGHT,   vivid_light);
+
+    default:
+      return NULL;
+    }
+
+  #undef SEPARABLE_BLEND
+}
+
+
+/*  public functions  */
+
+
+void
+gimp_operation_layer_mode_fused_process (const GimpLayerModeFusedParams *params,
+                                         const gfloat                   *in,
+                                         const gfloat                   *layer,
+                                         const gfloat                   *mask,
+                                         gfloat                         *out,
+                                         gint                            samples)
+{
+  ProcessFunc process = NULL;
+
+  if (! params->composite_to_blend_fish &&
+      ! gimp_layer_mode_is_subtractive (params->layer_mode))
+    {
+      process = dispatch_fused (params);
+    }
+
+  if (! process)
+    {
+      if (params->composite_to_blend_fish)
+        process = dispatch_composite<TRUE> (params);
+      else
+        process = dispatch_composite<FALSE> (params);
+    }
+
+  process (params, in, layer, mask, out, samples);
+}
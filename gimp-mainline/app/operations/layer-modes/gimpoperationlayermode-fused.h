@@ -0,0 +1,68 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationlayermode-fused.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_OPERATION_LAYER_MODE_FUSED_H__
+#define __GIMP_OPERATION_LAYER_MODE_FUSED_H__
+
+
+typedef void (* GimpLayerModeCompositeFunc) (const gfloat *in,
+                                             const gfloat *layer,
+                                             const gfloat *comp,
+                                             const gfloat *mask,
+                                             gfloat        opacity,
+                                             gfloat       *out,
+                                             gint          samples);
+
+
+typedef struct
+{
+  GeglOperation              *operation;
+  gfloat                      opacity;
+
+  /* the separable modes are blended with the built-in per-pixel code,
+   * when possible.  other modes always use 'blend_function'.
+   */
+  GimpLayerMode               layer_mode;
+  GimpLayerModeBlendFunc      blend_function;
+
+  /* the conversion fishes between the composite and blend spaces, or NULL if
+   * both spaces are the same.
+   */
+  const Babl                 *composite_to_blend_fish;
+  const Babl                 *blend_to_composite_fish;
+
+  GimpLayerCompositeMode      composite_mode;
+
+  /* an explicit compositing function, used instead of the built-in
+   * compositing code when the samples are processed in blocks.  must be
+   * specified for subtractive modes; may be NULL otherwise.
+   */
+  GimpLayerModeCompositeFunc  composite_function;
+} GimpLayerModeFusedParams;
+
+
+void   gimp_operation_layer_mode_fused_process (const GimpLayerModeFusedParams *params,
+                                                const gfloat                   *in,
+                                                const gfloat                   *layer,
+                                                const gfloat                   *mask,
+                                                gfloat                         *out,
+                                                gint                            samples);
+
+
+#endif /* __GIMP_OPERATION_LAYER_MODE_FUSED_H__ */
@@ -31,21 +31,9 @@
 
 #include "gimp-layer-modes.h"
 #include "gimpoperationlayermode.h"
+#include "gimpoperationlayermode-blend.h"
 #include "gimpoperationlayermode-composite.h"
-
-
-/* the maximum number of samples to process in one go.  used to limit
- * the size of the buffers we allocate on the stack.
- */
-#define GIMP_COMPOSITE_BLEND_MAX_SAMPLES ((1 << 18) /* 256 KiB */  /      \
-                                          16 /* bytes per pixel */ /      \
-                                          2  /* max number of buffers */)
-
-/* number of consecutive unblended samples (whose source or destination alpha
- * is zero) above which to split the blending process, in order to avoid
- * performing too many unnecessary conversions.
- */
-#define GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD 32
+#include "gimpoperationlayermode-fused.h"
 
 
 enum
@@ -59,15 +47,6 @@ enum
 };
 
 
-typedef void (* CompositeFunc) (const gfloat *in,
-                                const gfloat *layer,
-                                const gfloat *comp,
-                                const gfloat *mask,
-                                float         opacity,
-                                gfloat       *out,
-                                gint          samples);
-
-
 static void            gimp_operation_layer_mode_set_property        (GObject                *object,
                                                                       guint                   property_id,
                                                                       const GValue           *value,
@@ -123,15 +102,17 @@ G_DEFINE_TYPE (GimpOperationLayerMode, gimp_operation_layer_mode,
 
 #define parent_class gimp_operation_layer_mode_parent_class
 
-static CompositeFunc composite_union                = gimp_operation_layer_mode_composite_union;
-static CompositeFunc composite_clip_to_backdrop     = gimp_operation_layer_mode_composite_clip_to_backdrop;
-static CompositeFunc composite_clip_to_layer        = gimp_operation_layer_mode_composite_clip_to_layer;
-static CompositeFunc composite_intersection         = gimp_operation_layer_mode_composite_intersection;
+static GimpLayerModeCompositeFunc composite_union                = gimp_operation_layer_mode_composite_union;
+static GimpLayerModeCompositeFunc composite_clip_to_backdrop     = gimp_operation_layer_mode_composite_clip_to_backdrop;
+static GimpLayerModeCompositeFunc composite_clip_to_layer        = gimp_operation_layer_mode_composite_clip_to_layer;
+static GimpLayerModeCompositeFunc composite_intersection         = gimp_operation_layer_mode_composite_intersection;
+
+static GimpLayerModeCompositeFunc composite_union_sub            = gimp_operation_layer_mode_composite_union_sub;
+static GimpLayerModeCompositeFunc composite_clip_to_backdrop_sub = gimp_operation_layer_mode_composite_clip_to_backdrop_sub;
+static GimpLayerModeCompositeFunc composite_clip_to_layer_sub    = gimp_operation_layer_mode_composite_clip_to_layer_sub;
+static GimpLayerModeCompositeFunc composite_intersection_sub     = gimp_operation_layer_mode_composite_intersection_sub;
 
-static CompositeFunc composite_union_sub            = gimp_operation_layer_mode_composite_union_sub;
-static CompositeFunc composite_clip_to_backdrop_sub = gimp_operation_layer_mode_composite_clip_to_backdrop_sub;
-static CompositeFunc composite_clip_to_layer_sub    = gimp_operation_layer_mode_composite_clip_to_layer_sub;
-static CompositeFunc composite_intersection_sub     = gimp_operation_layer_mode_composite_intersection_sub;
+static gboolean                   blend_avx2                     = FALSE;
 
 
 static void
@@ -202,6 +183,18 @@ gimp_operation_layer_mode_class_init (GimpOperationLayerModeClass *klass)
   if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
     composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_sse2;
 #endif
+
+#if COMPILE_AVX2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2)
+    {
+      composite_union            = gimp_operation_layer_mode_composite_union_avx2;
+      composite_clip_to_backdrop = gimp_operation_layer_mode_composite_clip_to_backdrop_avx2;
+      composite_clip_to_layer    = gimp_operation_layer_mode_composite_clip_to_layer_avx2;
+      composite_intersection     = gimp_operation_layer_mode_composite_intersection_avx2;
+
+      blend_avx2 = TRUE;
+    }
+#endif
 }
 
 static void
@@ -303,6 +296,14 @@ gimp_operation_layer_mode_prepare (GeglOperation *operation)
   self->function       = gimp_layer_mode_get_function       (self->layer_mode);
   self->blend_function = gimp_layer_mode_get_blend_function (self->layer_mode);
 
+#if COMPILE_AVX2_INTRINISICS
+  if (blend_avx2)
+    {
+      self->blend_function =
+        gimp_operation_layer_mode_blend_get_avx2 (self->blend_function);
+    }
+#endif
+
   input_extent = gegl_operation_source_get_bounding_box (operation, "input");
   mask_extent  = gegl_operation_source_get_bounding_box (operation, "aux2");
 
@@ -641,178 +642,33 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
                                         const GeglRectangle *roi,
                                         gint                 level)
 {
-  GimpOperationLayerMode *layer_mode              = (gpointer) operation;
-  gfloat                 *in                      = in_p;
-  gfloat                 *out                     = out_p;
-  gfloat                 *layer                   = layer_p;
-  gfloat                 *mask                    = mask_p;
-  gfloat                  opacity                 = layer_mode->opacity;
-  GimpLayerColorSpace     blend_space             = layer_mode->blend_space;
-  GimpLayerColorSpace     composite_space         = layer_mode->composite_space;
-  GimpLayerCompositeMode  composite_mode          = layer_mode->composite_mode;
-  GimpLayerModeBlendFunc  blend_function          = layer_mode->blend_function;
-  gboolean                composite_needs_in_color;
-  gfloat                 *blend_in;
-  gfloat                 *blend_layer;
-  gfloat                 *blend_out;
-  const Babl             *composite_to_blend_fish = NULL;
-  const Babl             *blend_to_composite_fish = NULL;
-
-  /* make sure we don't process more than GIMP_COMPOSITE_BLEND_MAX_SAMPLES
-   * at a time, so that we don't overflow the stack if we allocate buffers
-   * on it.  note that this has to be done with a nested function call,
-   * because alloca'd buffers remain for the duration of the stack frame.
-   */
-  while (samples > GIMP_COMPOSITE_BLEND_MAX_SAMPLES)
-    {
-      gimp_operation_layer_mode_real_process (operation,
-                                              in, layer, mask, out,
-                                              GIMP_COMPOSITE_BLEND_MAX_SAMPLES,
-                                              roi, level);
-
-      in      += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      layer   += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      if (mask)
-        mask  +=     GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-      out     += 4 * GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-
-      samples -= GIMP_COMPOSITE_BLEND_MAX_SAMPLES;
-    }
-
-  composite_needs_in_color =
-    composite_mode == GIMP_LAYER_COMPOSITE_UNION ||
-    composite_mode == GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP;
-
-  blend_in    = in;
-  blend_layer = layer;
-  blend_out   = out;
+  GimpOperationLayerMode     *layer_mode      = (gpointer) operation;
+  GimpLayerColorSpace         blend_space     = layer_mode->blend_space;
+  GimpLayerColorSpace         composite_space = layer_mode->composite_space;
+  GimpLayerCompositeMode      composite_mode  = layer_mode->composite_mode;
+  GimpLayerModeCompositeFunc  generic_function;
+  GimpLayerModeFusedParams    params;
+
+  params.operation               = operation;
+  params.opacity                 = layer_mode->opacity;
+  params.layer_mode              = layer_mode->layer_mode;
+  params.blend_function          = layer_mode->blend_function;
+  params.composite_to_blend_fish = NULL;
+  params.blend_to_composite_fish = NULL;
+  params.composite_mode          = composite_mode;
 
   if (blend_space != GIMP_LAYER_COLOR_SPACE_AUTO)
     {
       gimp_assert (composite_space >= 1 && composite_space < 4);
       gimp_assert (blend_space     >= 1 && blend_space     < 4);
 
-      composite_to_blend_fish = layer_mode->space_fish [composite_space - 1]
-                                                       [blend_space     - 1];
+      params.composite_to_blend_fish =
+        layer_mode->space_fish [composite_space - 1]
+                               [blend_space     - 1];
 
-      blend_to_composite_fish = layer_mode->space_fish [blend_space     - 1]
-                                                       [composite_space - 1];
-    }
-
-  /* if we need to convert the samples between the composite and blend
-   * spaces...
-   */
-  if (composite_to_blend_fish)
-    {
-      gint i;
-      gint end;
-
-      if (in != out || composite_needs_in_color)
-        {
-          /* don't convert input in-place if we're not doing in-place output,
-           * or if we're going to need the original input for compositing.
-           */
-          blend_in = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-      blend_layer  = g_alloca (sizeof (gfloat) * 4 * samples);
-
-      if (in == out) /* in-place detected, avoid clobbering since we need to
-                        read 'in' for the compositing stage  */
-        {
-          if (blend_layer != layer)
-            blend_out = blend_layer;
-          else
-            blend_out = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-
-      /* samples whose the source or destination alpha is zero are not blended,
-       * and therefore do not need to be converted.  while it's generally
-       * desirable to perform conversion and blending in bulk, when we have
-       * more than a certain number of consecutive unblended samples, the cost
-       * of converting them outweighs the cost of splitting the process around
-       * them to avoid the conversion.
-       */
-
-      i   = ALPHA;
-      end = 4 * samples + ALPHA;
-
-      while (TRUE)
-        {
-          gint first;
-          gint last;
-          gint count;
-
-          /* skip any unblended samples.  the color values of `blend_out` for
-           * these samples are unconstrained, in particular, they may be NaN,
-           * but the alpha values should generally be finite, and specifically
-           * 0 when the source alpha is 0.
-           */
-          while (i < end && (in[i] == 0.0f || layer[i] == 0.0f))
-            {
-              blend_out[i] = 0.0f;
-              i += 4;
-            }
-
-          /* stop if there are no more samples */
-          if (i == end)
-            break;
-
-          /* otherwise, keep scanning the samples until we find
-           * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD consecutive unblended
-           * samples.
-           */
-
-          first  = i;
-          i     += 4;
-          last   = i;
-
-          while (i < end && i - last < 4 * GIMP_COMPOSITE_BLEND_SPLIT_THRESHOLD)
-            {
-              gboolean blended;
-
-              blended = (in[i] != 0.0f && layer[i] != 0.0f);
-
-              i += 4;
-              if (blended)
-                last = i;
-            }
-
-          /* convert and blend the samples in the range [first, last) */
-
-          count  = (last - first) / 4;
-          first -= ALPHA;
-
-          babl_process (composite_to_blend_fish,
-                        in + first, blend_in + first, count);
-          babl_process (composite_to_blend_fish,
-                        layer + first, blend_layer + first, count);
-
-          blend_function (operation, blend_in + first, blend_layer + first,
-                          blend_out + first, count);
-
-          babl_process (blend_to_composite_fish,
-                        blend_out + first, blend_out + first, count);
-
-          /* make sure the alpha values of `blend_out` are valid for the
-           * trailing unblended samples.
-           */
-          for (; last < i; last += 4)
-            blend_out[last] = 0.0f;
-        }
-    }
-  else
-    {
-      /* if both blending and compositing use the same color space, things are
-       * much simpler.
-       */
-
-      if (in == out) /* in-place detected, avoid clobbering since we need to
-                        read 'in' for the compositing stage  */
-        {
-          blend_out = g_alloca (sizeof (gfloat) * 4 * samples);
-        }
-
-      blend_function (operation, blend_in, blend_layer, blend_out, samples);
+      params.blend_to_composite_fish =
+        layer_mode->space_fish [blend_space     - 1]
+                               [composite_space - 1];
     }
 
   if (! gimp_layer_mode_is_subtractive (layer_mode->layer_mode))
@@ -821,25 +677,34 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union (in, layer, blend_out, mask, opacity,
-                           out, samples);
+        default:
+          params.composite_function = composite_union;
+          generic_function          = gimp_operation_layer_mode_composite_union;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop (in, layer, blend_out, mask, opacity,
-                                      out, samples);
+          params.composite_function = composite_clip_to_backdrop;
+          generic_function          = gimp_operation_layer_mode_composite_clip_to_backdrop;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer (in, layer, blend_out, mask, opacity,
-                                   out, samples);
+          params.composite_function = composite_clip_to_layer;
+          generic_function          = gimp_operation_layer_mode_composite_clip_to_layer;
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection (in, layer, blend_out, mask, opacity,
-                                  out, samples);
+          params.composite_function = composite_intersection;
+          generic_function          = gimp_operation_layer_mode_composite_intersection;
           break;
         }
+
+      /* the fused pipeline has built-in equivalents of the generic
+       * non-subtractive composite functions, which can be combined with the
+       * blend stage per-pixel.  only use an explicit composite function if
+       * it's a vectorized version.
+       */
+      if (params.composite_function == generic_function)
+        params.composite_function = NULL;
     }
   else
     {
@@ -847,27 +712,33 @@ gimp_operation_layer_mode_real_process (GeglOperation       *operation,
         {
         case GIMP_LAYER_COMPOSITE_UNION:
         case GIMP_LAYER_COMPOSITE_AUTO:
-          composite_union_sub (in, layer, blend_out, mask, opacity,
-                               out, samples);
+        default:
+          params.composite_function = composite_union_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
-          composite_clip_to_backdrop_sub (in, layer, blend_out, mask, opacity,
-                                          out, samples);
+          params.composite_function = composite_clip_to_backdrop_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
-          composite_clip_to_layer_sub (in, layer, blend_out, mask, opacity,
-                                       out, samples);
+          params.composite_function = composite_clip_to_layer_sub;
           break;
 
         case GIMP_LAYER_COMPOSITE_INTERSECTION:
-          composite_intersection_sub (in, layer, blend_out, mask, opacity,
-                                      out, samples);
+          params.composite_function = composite_intersection_sub;
           break;
         }
     }
 
+  /* blend and composite the samples in a single pass, keeping the
+   * intermediate results in registers, or in small per-block buffers when
+   * the samples have to be converted between the composite and blend spaces.
+   * see gimpoperationlayermode-fused.cc.
+   */
+  gimp_operation_layer_mode_fused_process (&params,
+                                           in_p, layer_p, mask_p, out_p,
+                                           samples);
+
   return TRUE;
 }
 
@@ -224,6 +224,9 @@ gimp_brush_core_finalize (GObject *object)
 
   g_clear_pointer (&core->pressure_brush, gimp_temp_buf_unref);
 
+  g_clear_pointer (&core->transform_brush,  gimp_temp_buf_unref);
+  g_clear_pointer (&core->transform_pixmap, gimp_temp_buf_unref);
+
   for (i = 0; i < BRUSH_CORE_SOLID_SUBSAMPLE; i++)
     for (j = 0; j < BRUSH_CORE_SOLID_SUBSAMPLE; j++)
       g_clear_pointer (&core->solid_brushes[i][j], gimp_temp_buf_unref);
@@ -1052,7 +1055,7 @@ static const GimpTempBuf *
 gimp_brush_core_transform_mask (GimpBrushCore *core,
                                 GimpBrush     *brush)
 {
-  const GimpTempBuf *mask;
+  GimpTempBuf *mask;
 
   if (core->scale <= 0.0)
     return NULL;
@@ -1064,8 +1067,17 @@ gimp_brush_core_transform_mask (GimpBrushCore *core,
                                     gimp_brush_core_get_reflect (core),
                                     core->hardness);
 
-  if (mask == core->transform_brush)
-    return mask;
+  /*  keep our reference to the mask, so it stays valid, and can't be
+   *  mistaken for a new one, even if the brush cache drops it
+   */
+  if (mask && mask == core->transform_brush)
+    {
+      gimp_temp_buf_unref (mask);
+
+      return core->transform_brush;
+    }
+
+  g_clear_pointer (&core->transform_brush, gimp_temp_buf_unref);
 
   core->transform_brush         = mask;
   core->subsample_cache_invalid = TRUE;
@@ -1118,7 +1130,7 @@ gimp_brush_core_get_brush_mask (GimpBrushCore            *core,
 const GimpTempBuf *
 gimp_brush_core_get_brush_pixmap (GimpBrushCore *core)
 {
-  const GimpTempBuf *pixmap;
+  GimpTempBuf *pixmap;
 
   if (core->scale <= 0.0)
     return NULL;
@@ -1130,8 +1142,14 @@ gimp_brush_core_get_brush_pixmap (GimpBrushCore *core)
                                         gimp_brush_core_get_reflect (core),
                                         core->hardness);
 
-  if (pixmap == core->transform_pixmap)
-    return pixmap;
+  if (pixmap && pixmap == core->transform_pixmap)
+    {
+      gimp_temp_buf_unref (pixmap);
+
+      return core->transform_pixmap;
+    }
+
+  g_clear_pointer (&core->transform_pixmap, gimp_temp_buf_unref);
 
   core->transform_pixmap        = pixmap;
   core->subsample_cache_invalid = TRUE;
@@ -61,8 +61,8 @@ struct _GimpBrushCore
   const GimpTempBuf *last_solid_brush_mask;
   gboolean           solid_cache_invalid;
 
-  const GimpTempBuf *transform_brush;
-  const GimpTempBuf *transform_pixmap;
+  GimpTempBuf       *transform_brush;
+  GimpTempBuf       *transform_pixmap;
 
   GimpTempBuf       *subsample_brushes[BRUSH_CORE_SUBSAMPLE + 1][BRUSH_CORE_SUBSAMPLE + 1];
   const GimpTempBuf *last_subsample_brush_mask;
@@ -48,6 +48,7 @@
 #include "gimpplugin-message.h"
 #include "gimppluginmanager.h"
 #include "gimpplugindef.h"
+#include "gimppluginregion.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -63,6 +64,16 @@ static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
+static GeglBuffer *
+            gimp_plug_in_get_request_buffer      (GimpPlugIn      *plug_in,
+                                                  gint32           drawable_id,
+                                                  gboolean         shadow,
+                                                  gboolean         write);
+static void gimp_plug_in_handle_region_request   (GimpPlugIn      *plug_in,
+                                                  GPRegionReq     *request);
+static void gimp_plug_in_handle_tile_batch_request
+                                                 (GimpPlugIn      *plug_in,
+                                                  GPTileBatchReq  *request);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
@@ -160,6 +171,14 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_REGION_REQ:
+      gimp_plug_in_handle_region_request (plug_in, msg->data);
+      break;
+
+    case GP_TILE_BATCH_REQ:
+      gimp_plug_in_handle_tile_batch_request (plug_in, msg->data);
+      break;
     }
 }
 
@@ -169,6 +188,9 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
 static void
 gimp_plug_in_handle_quit (GimpPlugIn *plug_in)
 {
+  /*  the process is exiting, don't put it back into the pool  */
+  plug_in->resident = FALSE;
+
   gimp_plug_in_close (plug_in, FALSE);
 }
 
@@ -461,6 +483,338 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static GeglBuffer *
+gimp_plug_in_get_request_buffer (GimpPlugIn *plug_in,
+                                 gint32      drawable_id,
+                                 gboolean    shadow,
+                                 gboolean    write)
+{
+  GimpDrawable *drawable;
+
+  drawable = (GimpDrawable *) gimp_item_get_by_id (plug_in->manager->gimp,
+                                                   drawable_id);
+
+  if (! GIMP_IS_DRAWABLE (drawable))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried accessing invalid drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried accessing drawable %d which was removed "
+                    "from the image (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  if (shadow)
+    {
+      /*  see gimp_plug_in_handle_tile_put() about not checking for
+       *  locks and groups here
+       */
+      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
+
+      return gimp_drawable_get_shadow_buffer (drawable);
+    }
+
+  if (write && gimp_item_is_content_locked (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried writing to a locked drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (write && gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "tried writing to a group layer %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  return gimp_drawable_get_buffer (drawable);
+}
+
+static void
+gimp_plug_in_handle_region_request (GimpPlugIn  *plug_in,
+                                    GPRegionReq *request)
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  GeglRectangle  rect;
+  guint64        size;
+  guchar        *data;
+
+  g_return_if_fail (request != NULL);
+
+  if (! plug_in->region)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent a REGION_REQ message, but has no region "
+                    "memory (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  buffer = gimp_plug_in_get_request_buffer (plug_in,
+                                            request->drawable_id,
+                                            request->shadow,
+                                            request->write);
+  if (! buffer)
+    return;
+
+  format = gegl_buffer_get_format (buffer);
+
+  rect.x      = request->x;
+  rect.y      = request->y;
+  rect.width  = MIN (request->width,  G_MAXINT);
+  rect.height = MIN (request->height, G_MAXINT);
+
+  size = ((guint64) babl_format_get_bytes_per_pixel (format) *
+          rect.width * rect.height);
+
+  if (rect.width == 0 || rect.height == 0 ||
+      size > G_MAXSIZE                     ||
+      ! gegl_rectangle_contains (gegl_buffer_get_extent (buffer), &rect))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "requested invalid region %d,%d %ux%u of drawable %d "
+                    "(killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    request->x, request->y,
+                    request->width, request->height,
+                    request->drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  data = gimp_plug_in_region_map (plug_in->region, size);
+
+  if (! data)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "didn't provide enough region memory for %d,%d %ux%u "
+                    "of drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file),
+                    request->x, request->y,
+                    request->width, request->height,
+                    request->drawable_id);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (request->write)
+    {
+      gegl_buffer_set (buffer, &rect, 0, format,
+                       data, GEGL_AUTO_ROWSTRIDE);
+    }
+  else
+    {
+      gegl_buffer_get (buffer, &rect, 1.0, format,
+                       data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  if (! gp_tile_ack_write (plug_in->my_write, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+}
+
+
+static void
+gimp_plug_in_handle_tile_batch_request (GimpPlugIn     *plug_in,
+                                        GPTileBatchReq *request)
+{
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  gint           bpp;
+  GeglRectangle  tile_rects[GP_TILE_BATCH_MAX_TILES];
+  guint          i;
+
+  if (! request)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-in \"%s\"\n(%s)\n\n"
+                    "sent an invalid TILE_BATCH_REQ message (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_file_get_utf8_name (plug_in->file));
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  buffer = gimp_plug_in_get_request_buffer (plug_in,
+                                            request->drawable_id,
+                                            request->shadow,
+                                            request->write);
+  if (! buffer)
+    return;
+
+  format = gegl_buffer_get_format (buffer);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+
+  /*  validate the whole batch before transferring anything, so a bad
+   *  request never leaves half of it on the wire
+   */
+  for (i = 0; i < request->n_tiles; i++)
+    {
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            request->tile_nums[i],
+                                            &tile_rects[i]))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-in \"%s\"\n(%s)\n\n"
+                        "requested invalid tile #%d for %s (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_file_get_utf8_name (plug_in->file),
+                        request->tile_nums[i],
+                        request->write ? "writing" : "reading");
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+    }
+
+  if (request->write)
+    {
+      for (i = 0; i < request->n_tiles; i++)
+        {
+          GimpWireMessage  msg;
+          GPTileData      *tile_info;
+
+          if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+            {
+              gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            "%s: ERROR", G_STRFUNC);
+              gimp_plug_in_close (plug_in, TRUE);
+              return;
+            }
+
+          if (msg.type != GP_TILE_DATA)
+            {
+              gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            "expected tile data and received: %d", msg.type);
+              gimp_wire_destroy (&msg);
+              gimp_plug_in_close (plug_in, TRUE);
+              return;
+            }
+
+          tile_info = msg.data;
+
+          if (tile_info->drawable_id != request->drawable_id ||
+              tile_info->tile_num    != request->tile_nums[i] ||
+              tile_info->shadow      != request->shadow       ||
+              tile_info->bpp         != bpp                   ||
+              tile_info->width       != tile_rects[i].width   ||
+              tile_info->height      != tile_rects[i].height  ||
+              tile_info->use_shm)
+            {
+              gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            "Plug-in \"%s\"\n(%s)\n\n"
+                            "sent tile data not matching tile #%d of "
+                            "drawable %d (killing)",
+                            gimp_object_get_name (plug_in),
+                            gimp_file_get_utf8_name (plug_in->file),
+                            request->tile_nums[i],
+                            request->drawable_id);
+              gimp_wire_destroy (&msg);
+              gimp_plug_in_close (plug_in, TRUE);
+              return;
+            }
+
+          gegl_buffer_set (buffer, &tile_rects[i], 0, format,
+                           tile_info->data,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          gimp_wire_destroy (&msg);
+        }
+
+      if (! gp_tile_ack_write (plug_in->my_write, plug_in))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+    }
+  else
+    {
+      for (i = 0; i < request->n_tiles; i++)
+        {
+          GimpWireMessage msg;
+          GPTileData      tile_data;
+
+          tile_data.drawable_id = request->drawable_id;
+          tile_data.tile_num    = request->tile_nums[i];
+          tile_data.shadow      = request->shadow;
+          tile_data.bpp         = bpp;
+          tile_data.width       = tile_rects[i].width;
+          tile_data.height      = tile_rects[i].height;
+          tile_data.use_shm     = FALSE;
+          tile_data.data        = g_malloc (bpp *
+                                            tile_rects[i].width *
+                                            tile_rects[i].height);
+
+          gegl_buffer_get (buffer, &tile_rects[i], 1.0, format,
+                           tile_data.data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          msg.type = GP_TILE_DATA;
+          msg.data = &tile_data;
+
+          /*  the replies are flushed once, after the last tile  */
+          if (! gimp_wire_write_msg (plug_in->my_write, &msg, plug_in))
+            {
+              g_free (tile_data.data);
+
+              gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                            "%s: ERROR", G_STRFUNC);
+              gimp_plug_in_close (plug_in, TRUE);
+              return;
+            }
+
+          g_free (tile_data.data);
+        }
+
+      if (! gimp_wire_flush (plug_in->my_write, plug_in))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "%s: ERROR", G_STRFUNC);
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+    }
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
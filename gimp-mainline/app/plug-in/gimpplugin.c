@@ -90,6 +90,8 @@
 #include "gimppluginmanager.h"
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
+#include "gimppluginmanager-pool.h"
+#include "gimppluginregion.h"
 #include "gimptemporaryprocedure.h"
 
 #include "gimp-intl.h"
@@ -107,6 +109,10 @@ static gboolean   gimp_plug_in_write         (GIOChannel   *channel,
 static gboolean   gimp_plug_in_flush         (GIOChannel   *channel,
                                               gpointer      data);
 
+static void       gimp_plug_in_attach        (GimpPlugIn         *plug_in,
+                                              GimpPlugInCallMode  call_mode,
+                                              gboolean            synchronous);
+
 #if defined G_OS_WIN32 && defined WIN32_32BIT_DLL_FOLDER
 static void       gimp_plug_in_set_dll_directory (const gchar *path);
 #endif
@@ -142,7 +148,9 @@ gimp_plug_in_init (GimpPlugIn *plug_in)
   plug_in->call_mode          = GIMP_PLUG_IN_CALL_NONE;
   plug_in->open               = FALSE;
   plug_in->hup                = FALSE;
+  plug_in->resident           = FALSE;
   plug_in->pid                = 0;
+  plug_in->n_calls            = 0;
 
   plug_in->my_read            = NULL;
   plug_in->my_write           = NULL;
@@ -330,6 +338,34 @@ gimp_plug_in_flush (GIOChannel *channel,
   return TRUE;
 }
 
+static void
+gimp_plug_in_attach (GimpPlugIn         *plug_in,
+                     GimpPlugInCallMode  call_mode,
+                     gboolean            synchronous)
+{
+  if (! synchronous)
+    {
+      GSource *source;
+
+      source = g_io_create_watch (plug_in->my_read,
+                                  G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
+
+      g_source_set_callback (source,
+                             (GSourceFunc) gimp_plug_in_recv_message, plug_in,
+                             NULL);
+
+      g_source_set_can_recurse (source, TRUE);
+
+      plug_in->input_id = g_source_attach (source, NULL);
+      g_source_unref (source);
+    }
+
+  plug_in->open      = TRUE;
+  plug_in->call_mode = call_mode;
+
+  gimp_plug_in_manager_add_open_plug_in (plug_in->manager, plug_in);
+}
+
 #if defined G_OS_WIN32 && defined WIN32_32BIT_DLL_FOLDER
 static void
 gimp_plug_in_set_dll_directory (const gchar *path)
@@ -429,10 +465,19 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
   gboolean      debug;
   guint         debug_flag;
   guint         spawn_flags;
+  gboolean      spawned;
 
   g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
   g_return_val_if_fail (plug_in->call_mode == GIMP_PLUG_IN_CALL_NONE, FALSE);
 
+  if (plug_in->resident &&
+      gimp_plug_in_manager_pool_acquire (plug_in->manager, plug_in))
+    {
+      gimp_plug_in_attach (plug_in, call_mode, synchronous);
+
+      return TRUE;
+    }
+
   /* Open two pipes. (Bidirectional communication).
    */
   if ((pipe (my_read) == -1) || (pipe (my_write) == -1))
@@ -504,7 +549,7 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
       break;
 
     case GIMP_PLUG_IN_CALL_RUN:
-      mode = "-run";
+      mode = plug_in->resident ? "-run-resident" : "-run";
       debug_flag = GIMP_DEBUG_WRAP_RUN;
       break;
 
@@ -567,7 +612,22 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
 #if defined G_OS_WIN32 && defined WIN32_32BIT_DLL_FOLDER
   gimp_plug_in_set_dll_directory (argv[0]);
 #endif
-  if (! gimp_spawn_async (argv, envp, spawn_flags, &plug_in->pid, &error))
+
+  /* only the plug-in we spawn now may inherit its region memory */
+  if (call_mode == GIMP_PLUG_IN_CALL_RUN)
+    {
+      plug_in->region = gimp_plug_in_region_new ();
+
+      if (plug_in->region)
+        gimp_plug_in_region_set_inherit (plug_in->region, TRUE);
+    }
+
+  spawned = gimp_spawn_async (argv, envp, spawn_flags, &plug_in->pid, &error);
+
+  if (plug_in->region)
+    gimp_plug_in_region_set_inherit (plug_in->region, FALSE);
+
+  if (! spawned)
     {
       gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
                     "Unable to run plug-in \"%s\"\n(%s)\n\n%s",
@@ -575,33 +635,14 @@ gimp_plug_in_open (GimpPlugIn         *plug_in,
                     gimp_file_get_utf8_name (plug_in->file),
                     error->message);
       g_clear_error (&error);
+      g_clear_pointer (&plug_in->region, gimp_plug_in_region_free);
       goto cleanup;
     }
 
   g_clear_pointer (&plug_in->his_read,  g_io_channel_unref);
   g_clear_pointer (&plug_in->his_write, g_io_channel_unref);
 
-  if (! synchronous)
-    {
-      GSource *source;
-
-      source = g_io_create_watch (plug_in->my_read,
-                                  G_IO_IN  | G_IO_PRI | G_IO_ERR | G_IO_HUP);
-
-      g_source_set_callback (source,
-                             (GSourceFunc) gimp_plug_in_recv_message, plug_in,
-                             NULL);
-
-      g_source_set_can_recurse (source, TRUE);
-
-      plug_in->input_id = g_source_attach (source, NULL);
-      g_source_unref (source);
-    }
-
-  plug_in->open      = TRUE;
-  plug_in->call_mode = call_mode;
-
-  gimp_plug_in_manager_add_open_plug_in (plug_in->manager, plug_in);
+  gimp_plug_in_attach (plug_in, call_mode, synchronous);
 
  cleanup:
 
@@ -631,6 +672,20 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
 
   plug_in->open = FALSE;
 
+  /*  a resident plug-in which returned from its procedure waits for
+   *  the next call in the pool, instead of exiting
+   */
+  if (plug_in->resident && ! kill_it && ! plug_in->hup)
+    {
+      if (plug_in->input_id)
+        {
+          g_source_remove (plug_in->input_id);
+          plug_in->input_id = 0;
+        }
+
+      gimp_plug_in_manager_pool_release (plug_in->manager, plug_in);
+    }
+
   if (plug_in->pid)
     {
 #ifndef G_OS_WIN32
@@ -719,6 +774,8 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
   g_clear_pointer (&plug_in->his_read,  g_io_channel_unref);
   g_clear_pointer (&plug_in->his_write, g_io_channel_unref);
 
+  g_clear_pointer (&plug_in->region, gimp_plug_in_region_free);
+
   gimp_wire_clear_error ();
 
   while (plug_in->temp_proc_frames)
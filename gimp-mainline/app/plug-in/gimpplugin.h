@@ -47,13 +47,17 @@ struct _GimpPlugIn
   GimpPlugInCallMode   call_mode;       /*  QUERY, INIT or RUN                */
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
+  guint                resident : 1;    /*  Process outlives the call         */
   GPid                 pid;             /*  Plug-in's process id              */
+  gint                 n_calls;         /*  Calls the process already ran     */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
   GIOChannel          *my_write;
   GIOChannel          *his_read;        /*  Plug-in's read and write channels */
   GIOChannel          *his_write;
 
+  GimpPlugInRegion    *region;          /*  Shared memory for GP_REGION_REQ   */
+
   guint                input_id;        /*  Id of input proc                  */
 
   gchar                write_buffer[WRITE_BUFFER_SIZE]; /* Buffer for writing */
@@ -49,6 +49,8 @@
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
 #include "gimppluginmanager-call.h"
+#include "gimppluginmanager-pool.h"
+#include "gimppluginregion.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -179,6 +181,13 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       GObject           *monitor;
       GFile             *icon_theme_dir;
 
+      /*  extensions keep running anyway, only plain procedures can
+       *  share a pooled process
+       */
+      plug_in->resident =
+        (GIMP_PROCEDURE (procedure)->proc_type == GIMP_PDB_PROC_TYPE_PLUGIN &&
+         gimp_plug_in_manager_pool_is_enabled (manager));
+
       if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
           const gchar *name  = gimp_object_get_name (plug_in);
@@ -205,6 +214,9 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       config.shm_id               = (manager->shm ?
                                      gimp_plug_in_shm_get_id (manager->shm) :
                                      -1);
+      config.region_fd            = (plug_in->region ?
+                                     gimp_plug_in_region_get_fd (plug_in->region) :
+                                     -1);
       config.check_size           = display_config->transparency_size;
       config.check_type           = display_config->transparency_type;
       config.show_help_button     = (gui_config->use_help &&
@@ -0,0 +1,258 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-pool.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <signal.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "plug-in-types.h"
+
+#include "config/gimpcoreconfig.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugin.h"
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-pool.h"
+#include "gimppluginregion.h"
+
+
+/*  A pooled plug-in process, started with "-run-resident", which ran
+ *  at least one procedure and now waits for the next GP_CONFIG and
+ *  GP_PROC_RUN on its pipes.
+ */
+
+typedef struct _GimpPlugInPoolHost GimpPlugInPoolHost;
+
+struct _GimpPlugInPoolHost
+{
+  GFile            *file;
+  GPid              pid;
+  GIOChannel       *my_read;
+  GIOChannel       *my_write;
+  GimpPlugInRegion *region;
+  gint              n_calls;
+};
+
+
+static gboolean   gimp_plug_in_pool_host_is_alive (GimpPlugInPoolHost *host);
+static void       gimp_plug_in_pool_host_free     (GimpPlugInPoolHost *host);
+
+
+/*  public functions  */
+
+void
+gimp_plug_in_manager_pool_exit (GimpPlugInManager *manager)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+
+  g_slist_free_full (manager->plug_in_pool,
+                     (GDestroyNotify) gimp_plug_in_pool_host_free);
+  manager->plug_in_pool = NULL;
+}
+
+gboolean
+gimp_plug_in_manager_pool_is_enabled (GimpPlugInManager *manager)
+{
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), FALSE);
+
+#ifdef G_OS_WIN32
+  /*  we can't check on idle processes without reaping them here  */
+  return FALSE;
+#else
+  return manager->gimp->config->plug_in_pool_size > 0;
+#endif
+}
+
+gboolean
+gimp_plug_in_manager_pool_acquire (GimpPlugInManager *manager,
+                                   GimpPlugIn        *plug_in)
+{
+  GSList *list;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), FALSE);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
+  g_return_val_if_fail (plug_in->pid == 0, FALSE);
+
+  list = manager->plug_in_pool;
+
+  while (list)
+    {
+      GimpPlugInPoolHost *host = list->data;
+
+      list = g_slist_next (list);
+
+      if (! g_file_equal (host->file, plug_in->file))
+        continue;
+
+      manager->plug_in_pool = g_slist_remove (manager->plug_in_pool, host);
+
+      /*  a process that crashed or quit while idle is simply dropped  */
+      if (! gimp_plug_in_pool_host_is_alive (host))
+        {
+          gimp_plug_in_pool_host_free (host);
+          continue;
+        }
+
+      plug_in->pid      = host->pid;
+      plug_in->my_read  = host->my_read;
+      plug_in->my_write = host->my_write;
+      plug_in->region   = host->region;
+      plug_in->n_calls  = host->n_calls;
+
+      g_object_unref (host->file);
+      g_slice_free (GimpPlugInPoolHost, host);
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+void
+gimp_plug_in_manager_pool_release (GimpPlugInManager *manager,
+                                   GimpPlugIn        *plug_in)
+{
+  GimpCoreConfig     *config;
+  GimpPlugInPoolHost *host;
+  GSList             *list;
+  gint                n_idle = 0;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->input_id == 0);
+
+  if (! plug_in->pid)
+    return;
+
+  config = manager->gimp->config;
+
+  host = g_slice_new0 (GimpPlugInPoolHost);
+
+  host->file     = g_object_ref (plug_in->file);
+  host->pid      = plug_in->pid;
+  host->my_read  = plug_in->my_read;
+  host->my_write = plug_in->my_write;
+  host->region   = plug_in->region;
+  host->n_calls  = plug_in->n_calls + 1;
+
+  plug_in->pid      = 0;
+  plug_in->my_read  = NULL;
+  plug_in->my_write = NULL;
+  plug_in->region   = NULL;
+  plug_in->n_calls  = 0;
+
+  for (list = manager->plug_in_pool; list; list = g_slist_next (list))
+    {
+      GimpPlugInPoolHost *idle = list->data;
+
+      if (g_file_equal (idle->file, host->file))
+        n_idle++;
+    }
+
+  /*  recycle processes after a number of calls, so whatever a
+   *  plug-in leaks or leaves behind doesn't pile up forever
+   */
+  if (! gimp_plug_in_manager_pool_is_enabled (manager) ||
+      n_idle >= config->plug_in_pool_size               ||
+      host->n_calls >= config->plug_in_pool_max_calls)
+    {
+      if (manager->gimp->be_verbose)
+        g_print ("Retiring pooled plug-in: '%s' (%d calls)\n",
+                 gimp_file_get_utf8_name (host->file), host->n_calls);
+
+      gimp_plug_in_pool_host_free (host);
+
+      return;
+    }
+
+  manager->plug_in_pool = g_slist_prepend (manager->plug_in_pool, host);
+}
+
+
+/*  private functions  */
+
+static gboolean
+gimp_plug_in_pool_host_is_alive (GimpPlugInPoolHost *host)
+{
+#ifndef G_OS_WIN32
+  gint status;
+
+  if (waitpid (host->pid, &status, WNOHANG) != 0)
+    {
+      /*  the process is gone and reaped now  */
+      g_spawn_close_pid (host->pid);
+      host->pid = 0;
+
+      return FALSE;
+    }
+#endif
+
+  return TRUE;
+}
+
+static void
+gimp_plug_in_pool_host_free (GimpPlugInPoolHost *host)
+{
+  /*  closing the pipes makes the plug-in's resident loop return, and
+   *  the plug-in exit
+   */
+  g_clear_pointer (&host->my_read,  g_io_channel_unref);
+  g_clear_pointer (&host->my_write, g_io_channel_unref);
+
+  g_clear_pointer (&host->region, gimp_plug_in_region_free);
+
+  if (host->pid)
+    {
+#ifndef G_OS_WIN32
+      gint status;
+
+      if (waitpid (host->pid, &status, WNOHANG) == 0)
+        {
+          /*  give the plug-in some time (10 ms)  */
+          g_usleep (10000);
+
+          if (waitpid (host->pid, &status, WNOHANG) == 0)
+            {
+              kill (host->pid, SIGKILL);
+              waitpid (host->pid, &status, 0);
+            }
+        }
+#endif
+
+      g_spawn_close_pid (host->pid);
+    }
+
+  g_object_unref (host->file);
+
+  g_slice_free (GimpPlugInPoolHost, host);
+}
@@ -0,0 +1,37 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-pool.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PLUG_IN_MANAGER_POOL_H__
+#define __GIMP_PLUG_IN_MANAGER_POOL_H__
+
+
+void       gimp_plug_in_manager_pool_exit       (GimpPlugInManager *manager);
+
+gboolean   gimp_plug_in_manager_pool_is_enabled (GimpPlugInManager *manager);
+
+/* Give a resident plug-in the process of an earlier call, if any */
+gboolean   gimp_plug_in_manager_pool_acquire    (GimpPlugInManager *manager,
+                                                 GimpPlugIn        *plug_in);
+
+/* Take the process of a resident plug-in whose call returned */
+void       gimp_plug_in_manager_pool_release    (GimpPlugInManager *manager,
+                                                 GimpPlugIn        *plug_in);
+
+
+#endif /* __GIMP_PLUG_IN_MANAGER_POOL_H__ */
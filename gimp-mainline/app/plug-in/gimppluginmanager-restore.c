@@ -48,40 +48,43 @@
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
 
 #include "gimp-intl.h"
 
 
-static void    gimp_plug_in_manager_search            (GimpPlugInManager    *manager,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
-                                                       GFile                *directory);
-static GFile * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
-                                                       GFile                *file,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_run_extensions    (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpInitStatusFunc    status_callback);
-static void    gimp_plug_in_manager_bind_text_domains (GimpPlugInManager    *manager);
-static void    gimp_plug_in_manager_add_from_file     (GimpPlugInManager    *manager,
-                                                       GFile                *file,
-                                                       guint64               mtime);
-static void    gimp_plug_in_manager_add_from_rc       (GimpPlugInManager    *manager,
-                                                       GimpPlugInDef        *plug_in_def);
-static void    gimp_plug_in_manager_add_to_db         (GimpPlugInManager    *manager,
-                                                       GimpContext          *context,
-                                                       GimpPlugInProcedure  *proc);
-static void    gimp_plug_in_manager_sort_file_procs   (GimpPlugInManager    *manager);
-static gint    gimp_plug_in_manager_file_proc_compare (gconstpointer         a,
-                                                       gconstpointer         b,
-                                                       gpointer              data);
+static void      gimp_plug_in_manager_search            (GimpPlugInManager    *manager,
+                                                         GimpInitStatusFunc    status_callback);
+static void      gimp_plug_in_manager_search_directory  (GimpPlugInManager    *manager,
+                                                         GFile                *directory);
+static GFile   * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager    *manager);
+static GFile   * gimp_plug_in_manager_get_rc_cache      (GFile                *pluginrc);
+static gboolean  gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager    *manager,
+                                                         GFile                *file,
+                                                         GFile                *rc_cache,
+                                                         GimpInitStatusFunc    status_callback);
+static void      gimp_plug_in_manager_query_new         (GimpPlugInManager    *manager,
+                                                         GimpContext          *context,
+                                                         GimpInitStatusFunc    status_callback);
+static void      gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager    *manager,
+                                                         GimpContext          *context,
+                                                         GimpInitStatusFunc    status_callback);
+static void      gimp_plug_in_manager_run_extensions    (GimpPlugInManager    *manager,
+                                                         GimpContext          *context,
+                                                         GimpInitStatusFunc    status_callback);
+static void      gimp_plug_in_manager_bind_text_domains (GimpPlugInManager    *manager);
+static void      gimp_plug_in_manager_add_from_file     (GimpPlugInManager    *manager,
+                                                         GFile                *file,
+                                                         guint64               mtime);
+static void      gimp_plug_in_manager_add_from_rc       (GimpPlugInManager    *manager,
+                                                         GimpPlugInDef        *plug_in_def);
+static void      gimp_plug_in_manager_add_to_db         (GimpPlugInManager    *manager,
+                                                         GimpContext          *context,
+                                                         GimpPlugInProcedure  *proc);
+static void      gimp_plug_in_manager_sort_file_procs   (GimpPlugInManager    *manager);
+static gint      gimp_plug_in_manager_file_proc_compare (gconstpointer         a,
+                                                         gconstpointer         b,
+                                                         gpointer              data);
 
 
 
@@ -90,10 +93,12 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                               GimpContext        *context,
                               GimpInitStatusFunc  status_callback)
 {
-  Gimp   *gimp;
-  GFile  *pluginrc;
-  GSList *list;
-  GError *error = NULL;
+  Gimp     *gimp;
+  GFile    *pluginrc;
+  GFile    *rc_cache;
+  gboolean  rc_cache_valid;
+  GSList   *list;
+  GError   *error = NULL;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -109,8 +114,11 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 
   /* read the pluginrc file for cached data */
   pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  rc_cache = gimp_plug_in_manager_get_rc_cache (pluginrc);
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+  rc_cache_valid = gimp_plug_in_manager_read_pluginrc (manager,
+                                                       pluginrc, rc_cache,
+                                                       status_callback);
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -136,7 +144,11 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
       if (gimp->be_verbose)
         g_print ("Writing '%s'\n", gimp_file_get_utf8_name (pluginrc));
 
-      if (! plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+      if (plug_in_rc_write (manager->plug_in_defs, pluginrc, &error))
+        {
+          rc_cache_valid = FALSE;
+        }
+      else
         {
           gimp_message_literal (gimp,
                                 NULL, GIMP_MESSAGE_ERROR, error->message);
@@ -146,6 +158,25 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
       manager->write_pluginrc = FALSE;
     }
 
+  /* (re)create the binary cache unless it's what we just loaded; it
+   * is only an optimization, so failures are not worth a message
+   */
+  if (! rc_cache_valid)
+    {
+      if (gimp->be_verbose)
+        g_print ("Writing '%s'\n", gimp_file_get_utf8_name (rc_cache));
+
+      if (! plug_in_rc_cache_write (manager->plug_in_defs, rc_cache, pluginrc,
+                                    &error))
+        {
+          if (gimp->be_verbose)
+            g_print ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
+    }
+
+  g_object_unref (rc_cache);
   g_object_unref (pluginrc);
 
   /* create locale and help domain lists */
@@ -418,22 +449,64 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
-/* read the pluginrc file for cached data */
-static void
+static GFile *
+gimp_plug_in_manager_get_rc_cache (GFile *pluginrc)
+{
+  GFile *parent   = g_file_get_parent (pluginrc);
+  gchar *basename = g_file_get_basename (pluginrc);
+  gchar *name     = g_strconcat (basename, ".cache", NULL);
+  GFile *rc_cache;
+
+  rc_cache = g_file_get_child (parent, name);
+
+  g_free (name);
+  g_free (basename);
+  g_object_unref (parent);
+
+  return rc_cache;
+}
+
+/* read the pluginrc file for cached data, preferring its binary cache;
+ * returns TRUE if the cache was used
+ */
+static gboolean
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
                                     GFile              *pluginrc,
+                                    GFile              *rc_cache,
                                     GimpInitStatusFunc  status_callback)
 {
-  GSList *rc_defs;
-  GError *error = NULL;
+  GSList   *rc_defs;
+  gboolean  from_cache = FALSE;
+  GError   *error      = NULL;
 
   status_callback (_("Resource configuration"),
                    gimp_file_get_utf8_name (pluginrc), 0.0);
 
   if (manager->gimp->be_verbose)
-    g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+    g_print ("Loading '%s'\n", gimp_file_get_utf8_name (rc_cache));
+
+  rc_defs = plug_in_rc_cache_parse (manager->gimp, rc_cache, pluginrc,
+                                    &error);
+
+  if (rc_defs)
+    {
+      from_cache = TRUE;
+    }
+  else
+    {
+      if (error)
+        {
+          if (manager->gimp->be_verbose)
+            g_print ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
 
-  rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+      if (manager->gimp->be_verbose)
+        g_print ("Parsing '%s'\n", gimp_file_get_utf8_name (pluginrc));
+
+      rc_defs = plug_in_rc_parse (manager->gimp, pluginrc, &error);
+    }
 
   if (rc_defs)
     {
@@ -452,6 +525,8 @@ gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
 
       g_clear_error (&error);
     }
+
+  return from_cache;
 }
 
 /* query any plug-ins that changed since we last wrote out pluginrc */
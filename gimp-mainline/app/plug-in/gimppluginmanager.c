@@ -48,6 +48,7 @@
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-menu-branch.h"
+#include "gimppluginmanager-pool.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 
@@ -265,6 +266,8 @@ gimp_plug_in_manager_exit (GimpPlugInManager *manager)
   while (manager->open_plug_ins)
     gimp_plug_in_close (manager->open_plug_ins->data, TRUE);
 
+  gimp_plug_in_manager_pool_exit (manager);
+
   /*  need to detach from shared memory, we can't rely on exit()
    *  cleaning up behind us (see bug #609026)
    */
@@ -61,6 +61,7 @@ struct _GimpPlugInManager
   GimpPlugIn        *current_plug_in;
   GSList            *open_plug_ins;
   GSList            *plug_in_stack;
+  GSList            *plug_in_pool;
 
   GimpPlugInShm     *shm;
   GimpInterpreterDB *interpreter_db;
@@ -0,0 +1,183 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginregion.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  /* for memfd_create() */
+
+#include "config.h"
+
+#include <sys/types.h>
+
+#include <errno.h>
+
+#ifdef HAVE_MEMFD_CREATE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "plug-in-types.h"
+
+#include "gimppluginregion.h"
+
+#include "gimp-log.h"
+
+
+/* a plug-in's region memory is an anonymous file it inherits when it's
+ * spawned.  the plug-in grows the file to fit each rectangle it
+ * transfers, and both sides map it at the size they need, so a whole
+ * rectangle crosses the pipe as a single GP_REGION_REQ.
+ */
+struct _GimpPlugInRegion
+{
+  gint    fd;
+  guchar *addr;
+  gsize   size;   /* of the mapping */
+};
+
+
+GimpPlugInRegion *
+gimp_plug_in_region_new (void)
+{
+#ifdef HAVE_MEMFD_CREATE
+
+  GimpPlugInRegion *region;
+  gint              fd;
+
+  fd = memfd_create ("gimp-plug-in-region", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+  if (fd == -1)
+    {
+      GIMP_LOG (SHM, "memfd_create() failed: %s", g_strerror (errno));
+
+      return NULL;
+    }
+
+  /* the plug-in may grow the file, but not pull the pages we map from
+   * under our feet
+   */
+  fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK);
+
+  region = g_slice_new0 (GimpPlugInRegion);
+
+  region->fd = fd;
+
+  return region;
+
+#else
+
+  return NULL;
+
+#endif
+}
+
+void
+gimp_plug_in_region_free (GimpPlugInRegion *region)
+{
+  g_return_if_fail (region != NULL);
+
+#ifdef HAVE_MEMFD_CREATE
+
+  if (region->addr)
+    munmap (region->addr, region->size);
+
+  close (region->fd);
+
+#endif
+
+  g_slice_free (GimpPlugInRegion, region);
+}
+
+gint
+gimp_plug_in_region_get_fd (GimpPlugInRegion *region)
+{
+  g_return_val_if_fail (region != NULL, -1);
+
+  return region->fd;
+}
+
+/* the file is only inherited by the plug-in spawned while 'inherit' is
+ * set, not by any other
+ */
+void
+gimp_plug_in_region_set_inherit (GimpPlugInRegion *region,
+                                 gboolean          inherit)
+{
+  g_return_if_fail (region != NULL);
+
+#ifdef HAVE_MEMFD_CREATE
+
+  fcntl (region->fd, F_SETFD, inherit ? 0 : FD_CLOEXEC);
+
+#endif
+}
+
+/* returns the start of the region memory, mapped at least 'size' bytes
+ * long, or NULL if the plug-in didn't make the file that large
+ */
+guchar *
+gimp_plug_in_region_map (GimpPlugInRegion *region,
+                         gsize             size)
+{
+  g_return_val_if_fail (region != NULL, NULL);
+
+#ifdef HAVE_MEMFD_CREATE
+
+  if (size > region->size)
+    {
+      struct stat st;
+      gpointer    addr;
+
+      if (fstat (region->fd, &st) == -1 || (gsize) st.st_size < size)
+        return NULL;
+
+      if (region->addr)
+        {
+          munmap (region->addr, region->size);
+
+          region->addr = NULL;
+          region->size = 0;
+        }
+
+      addr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   region->fd, 0);
+
+      if (addr == MAP_FAILED)
+        {
+          GIMP_LOG (SHM, "mmap() of %" G_GSIZE_FORMAT " bytes failed: %s",
+                    size, g_strerror (errno));
+
+          return NULL;
+        }
+
+      region->addr = addr;
+      region->size = size;
+    }
+
+  return region->addr;
+
+#else
+
+  return NULL;
+
+#endif
+}
@@ -0,0 +1,35 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginregion.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PLUG_IN_REGION_H__
+#define __GIMP_PLUG_IN_REGION_H__
+
+
+GimpPlugInRegion * gimp_plug_in_region_new         (void);
+void               gimp_plug_in_region_free        (GimpPlugInRegion *region);
+
+gint               gimp_plug_in_region_get_fd      (GimpPlugInRegion *region);
+void               gimp_plug_in_region_set_inherit (GimpPlugInRegion *region,
+                                                    gboolean          inherit);
+
+guchar           * gimp_plug_in_region_map         (GimpPlugInRegion *region,
+                                                    gsize             size);
+
+
+#endif /* __GIMP_PLUG_IN_REGION_H__ */
@@ -0,0 +1,946 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*  A binary companion of pluginrc.  It holds exactly what pluginrc
+ *  holds, but as length-prefixed little-endian fields, so it can be
+ *  mapped and decoded without running the GScanner over it.  Strings
+ *  are stored NUL-terminated and are used directly from the mapping
+ *  wherever the consumer copies them anyway.
+ *
+ *  The cache is only trusted while the pluginrc it was written
+ *  alongside is unchanged (same size and modification time), so
+ *  editing or deleting pluginrc still forces a full re-read.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "libgimp/gimpgpparams.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-cache.h"
+
+#include "gimp-intl.h"
+
+
+/*  bump whenever the record layout below or PLUG_IN_RC_FILE_VERSION
+ *  changes
+ */
+#define PLUG_IN_RC_CACHE_VERSION   1
+
+#define PLUG_IN_RC_CACHE_MAGIC     "GIMPPRC\0"
+#define PLUG_IN_RC_CACHE_MAGIC_LEN 8
+
+#define PLUG_IN_RC_CACHE_NO_STRING G_MAXUINT32
+
+
+typedef struct _PlugInRcCacheReader PlugInRcCacheReader;
+
+struct _PlugInRcCacheReader
+{
+  const guint8 *data;
+  gsize         size;
+  gsize         offset;
+  gboolean      error;
+};
+
+
+static gboolean              plug_in_rc_cache_get_stamp       (GFile               *pluginrc,
+                                                               guint64             *size,
+                                                               guint64             *mtime,
+                                                               guint32             *mtime_usec,
+                                                               GError             **error);
+
+static GimpPlugInDef       * plug_in_rc_cache_read_def        (PlugInRcCacheReader *reader);
+static GimpPlugInProcedure * plug_in_rc_cache_read_procedure  (PlugInRcCacheReader *reader,
+                                                               GFile               *file);
+static void                  plug_in_rc_cache_read_proc_arg   (PlugInRcCacheReader *reader,
+                                                               GimpProcedure       *procedure,
+                                                               gboolean             return_value);
+
+static const guint8        * cache_read_bytes                 (PlugInRcCacheReader *reader,
+                                                               gsize                n_bytes);
+static guint32               cache_read_uint32                (PlugInRcCacheReader *reader);
+static guint64               cache_read_uint64                (PlugInRcCacheReader *reader);
+static gdouble               cache_read_double                (PlugInRcCacheReader *reader);
+static const gchar         * cache_read_string                (PlugInRcCacheReader *reader);
+
+static void                  plug_in_rc_cache_write_procedure (GByteArray          *array,
+                                                               GimpPlugInProcedure *proc);
+static void                  plug_in_rc_cache_write_proc_arg  (GByteArray          *array,
+                                                               GParamSpec          *pspec);
+
+static void                  cache_write_uint32               (GByteArray          *array,
+                                                               guint32              value);
+static void                  cache_write_uint32_at            (GByteArray          *array,
+                                                               gsize                offset,
+                                                               guint32              value);
+static void                  cache_write_uint64               (GByteArray          *array,
+                                                               guint64              value);
+static void                  cache_write_double               (GByteArray          *array,
+                                                               gdouble              value);
+static void                  cache_write_string               (GByteArray          *array,
+                                                               const gchar         *value);
+
+
+/*  public functions  */
+
+GSList *
+plug_in_rc_cache_parse (Gimp    *gimp,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  GMappedFile         *mapped;
+  PlugInRcCacheReader  reader       = { 0, };
+  GSList              *plug_in_defs = NULL;
+  gchar               *path;
+  guint64              size;
+  guint64              mtime;
+  guint32              mtime_usec;
+  guint32              n_defs;
+  guint32              i;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (! plug_in_rc_cache_get_stamp (pluginrc, &size, &mtime, &mtime_usec,
+                                    error))
+    return NULL;
+
+  path = g_file_get_path (file);
+
+  if (! path)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_OPEN,
+                   _("Skipping '%s': not a local file."),
+                   gimp_file_get_utf8_name (file));
+      return NULL;
+    }
+
+  mapped = g_mapped_file_new (path, FALSE, error);
+  g_free (path);
+
+  if (! mapped)
+    return NULL;
+
+  reader.data = (const guint8 *) g_mapped_file_get_contents (mapped);
+  reader.size = g_mapped_file_get_length (mapped);
+
+  if (reader.size < PLUG_IN_RC_CACHE_MAGIC_LEN ||
+      memcmp (reader.data,
+              PLUG_IN_RC_CACHE_MAGIC, PLUG_IN_RC_CACHE_MAGIC_LEN) != 0)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   _("Skipping '%s': not a pluginrc cache."),
+                   gimp_file_get_utf8_name (file));
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  reader.offset = PLUG_IN_RC_CACHE_MAGIC_LEN;
+
+  if (cache_read_uint32 (&reader) != PLUG_IN_RC_CACHE_VERSION ||
+      cache_read_uint32 (&reader) != GIMP_PROTOCOL_VERSION)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': wrong pluginrc cache version."),
+                   gimp_file_get_utf8_name (file));
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  if (cache_read_uint64 (&reader) != size  ||
+      cache_read_uint64 (&reader) != mtime ||
+      cache_read_uint32 (&reader) != mtime_usec)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': out of date with '%s'."),
+                   gimp_file_get_utf8_name (file),
+                   gimp_file_get_utf8_name (pluginrc));
+      g_mapped_file_unref (mapped);
+      return NULL;
+    }
+
+  n_defs = cache_read_uint32 (&reader);
+
+  for (i = 0; i < n_defs && ! reader.error; i++)
+    {
+      GimpPlugInDef *plug_in_def = plug_in_rc_cache_read_def (&reader);
+
+      if (plug_in_def)
+        plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  if (reader.error)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+                   _("Skipping '%s': file is corrupt."),
+                   gimp_file_get_utf8_name (file));
+
+      g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+      plug_in_defs = NULL;
+    }
+
+  g_mapped_file_unref (mapped);
+
+  return g_slist_reverse (plug_in_defs);
+}
+
+gboolean
+plug_in_rc_cache_write (GSList  *plug_in_defs,
+                        GFile   *file,
+                        GFile   *pluginrc,
+                        GError **error)
+{
+  GByteArray *array;
+  GSList     *list;
+  guint64     size;
+  guint64     mtime;
+  guint32     mtime_usec;
+  gsize       n_defs_offset;
+  guint32     n_defs = 0;
+  gboolean    success;
+
+  g_return_val_if_fail (G_IS_FILE (file), FALSE);
+  g_return_val_if_fail (G_IS_FILE (pluginrc), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! plug_in_rc_cache_get_stamp (pluginrc, &size, &mtime, &mtime_usec,
+                                    error))
+    return FALSE;
+
+  array = g_byte_array_new ();
+
+  g_byte_array_append (array,
+                       (const guint8 *) PLUG_IN_RC_CACHE_MAGIC,
+                       PLUG_IN_RC_CACHE_MAGIC_LEN);
+  cache_write_uint32 (array, PLUG_IN_RC_CACHE_VERSION);
+  cache_write_uint32 (array, GIMP_PROTOCOL_VERSION);
+  cache_write_uint64 (array, size);
+  cache_write_uint64 (array, mtime);
+  cache_write_uint32 (array, mtime_usec);
+
+  n_defs_offset = array->len;
+  cache_write_uint32 (array, 0);
+
+  for (list = plug_in_defs; list; list = list->next)
+    {
+      GimpPlugInDef *plug_in_def = list->data;
+      GSList        *list2;
+      gchar         *path;
+      gsize          n_procs_offset;
+      guint32        n_procs = 0;
+
+      if (! plug_in_def->procedures)
+        continue;
+
+      path = gimp_file_get_config_path (plug_in_def->file, NULL);
+      if (! path)
+        continue;
+
+      cache_write_string (array, path);
+      cache_write_uint64 (array, plug_in_def->mtime);
+
+      g_free (path);
+
+      n_procs_offset = array->len;
+      cache_write_uint32 (array, 0);
+
+      for (list2 = plug_in_def->procedures; list2; list2 = list2->next)
+        {
+          GimpPlugInProcedure *proc = list2->data;
+
+          if (proc->installed_during_init)
+            continue;
+
+          plug_in_rc_cache_write_procedure (array, proc);
+          n_procs++;
+        }
+
+      cache_write_uint32_at (array, n_procs_offset, n_procs);
+
+      cache_write_string (array, plug_in_def->locale_domain_name);
+
+      path = NULL;
+      if (plug_in_def->locale_domain_name && plug_in_def->locale_domain_path)
+        path = gimp_config_path_unexpand (plug_in_def->locale_domain_path,
+                                          TRUE, NULL);
+
+      cache_write_string (array, path);
+      g_free (path);
+
+      cache_write_string (array, plug_in_def->help_domain_name);
+      cache_write_string (array,
+                          plug_in_def->help_domain_name ?
+                          plug_in_def->help_domain_uri : NULL);
+
+      cache_write_uint32 (array, plug_in_def->has_init);
+
+      n_defs++;
+    }
+
+  cache_write_uint32_at (array, n_defs_offset, n_defs);
+
+  success = g_file_replace_contents (file,
+                                     (const gchar *) array->data, array->len,
+                                     NULL, FALSE, G_FILE_CREATE_NONE,
+                                     NULL, NULL, error);
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static gboolean
+plug_in_rc_cache_get_stamp (GFile    *pluginrc,
+                            guint64  *size,
+                            guint64  *mtime,
+                            guint32  *mtime_usec,
+                            GError  **error)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (pluginrc,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, error);
+  if (! info)
+    return FALSE;
+
+  *size       = g_file_info_get_size (info);
+  *mtime      = g_file_info_get_attribute_uint64 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  *mtime_usec = g_file_info_get_attribute_uint32 (info,
+                                                  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+static GimpPlugInDef *
+plug_in_rc_cache_read_def (PlugInRcCacheReader *reader)
+{
+  GimpPlugInDef *plug_in_def;
+  const gchar   *path;
+  const gchar   *domain_name;
+  const gchar   *domain_path;
+  GFile         *file;
+  guint32        n_procs;
+  guint32        i;
+
+  path = cache_read_string (reader);
+
+  if (! (path && *path))
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  file = gimp_file_new_for_config_path (path, NULL);
+
+  if (! file)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  plug_in_def = gimp_plug_in_def_new (file);
+  g_object_unref (file);
+
+  plug_in_def->mtime = (gint64) cache_read_uint64 (reader);
+
+  n_procs = cache_read_uint32 (reader);
+
+  for (i = 0; i < n_procs && ! reader->error; i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = plug_in_rc_cache_read_procedure (reader, plug_in_def->file);
+
+      if (proc)
+        {
+          if (! reader->error)
+            gimp_plug_in_def_add_procedure (plug_in_def, proc);
+
+          g_object_unref (proc);
+        }
+    }
+
+  domain_name = cache_read_string (reader);
+  domain_path = cache_read_string (reader);
+
+  if (domain_name && ! reader->error)
+    {
+      gchar *expanded_path = NULL;
+
+      if (domain_path)
+        expanded_path = gimp_config_path_expand (domain_path, TRUE, NULL);
+
+      gimp_plug_in_def_set_locale_domain (plug_in_def,
+                                          domain_name, expanded_path);
+
+      g_free (expanded_path);
+    }
+
+  domain_name = cache_read_string (reader);
+  domain_path = cache_read_string (reader);
+
+  if (domain_name && ! reader->error)
+    gimp_plug_in_def_set_help_domain (plug_in_def, domain_name, domain_path);
+
+  if (cache_read_uint32 (reader))
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  if (reader->error)
+    {
+      g_object_unref (plug_in_def);
+      return NULL;
+    }
+
+  return plug_in_def;
+}
+
+static GimpPlugInProcedure *
+plug_in_rc_cache_read_procedure (PlugInRcCacheReader *reader,
+                                 GFile               *file)
+{
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  const gchar         *name;
+  const gchar         *str;
+  gint                 proc_type;
+  GimpIconType         icon_type;
+  gint                 icon_data_length;
+  guint8              *icon_data = NULL;
+  guint32              n_menu_paths;
+  guint32              n_args;
+  guint32              n_return_vals;
+  guint32              i;
+
+  name      = cache_read_string (reader);
+  proc_type = (gint32) cache_read_uint32 (reader);
+
+  if (reader->error || ! (name && *name) ||
+      (proc_type != GIMP_PDB_PROC_TYPE_PLUGIN &&
+       proc_type != GIMP_PDB_PROC_TYPE_EXTENSION))
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, file);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_set_name (GIMP_OBJECT (procedure), name);
+
+  procedure->blurb     = g_strdup (cache_read_string (reader));
+  procedure->help      = g_strdup (cache_read_string (reader));
+  procedure->authors   = g_strdup (cache_read_string (reader));
+  procedure->copyright = g_strdup (cache_read_string (reader));
+  procedure->date      = g_strdup (cache_read_string (reader));
+  proc->menu_label     = g_strdup (cache_read_string (reader));
+
+  n_menu_paths = cache_read_uint32 (reader);
+
+  for (i = 0; i < n_menu_paths && ! reader->error; i++)
+    {
+      str = cache_read_string (reader);
+
+      if (str)
+        proc->menu_paths = g_list_append (proc->menu_paths, g_strdup (str));
+    }
+
+  icon_type        = (gint32) cache_read_uint32 (reader);
+  icon_data_length = (gint32) cache_read_uint32 (reader);
+
+  switch (icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      icon_data_length = -1;
+      icon_data        = (guint8 *) g_strdup (cache_read_string (reader));
+      break;
+
+    case GIMP_ICON_TYPE_PIXBUF:
+      if (icon_data_length >= 0)
+        {
+          const guint8 *data = cache_read_bytes (reader, icon_data_length);
+
+          if (data)
+            icon_data = g_memdup (data, icon_data_length);
+        }
+      else
+        {
+          reader->error = TRUE;
+        }
+      break;
+
+    default:
+      reader->error = TRUE;
+      break;
+    }
+
+  if (reader->error)
+    {
+      g_free (icon_data);
+      return proc;
+    }
+
+  gimp_plug_in_procedure_take_icon (proc, icon_type,
+                                    icon_data, icon_data_length,
+                                    NULL);
+
+  if (cache_read_uint32 (reader))
+    {
+      gint priority;
+
+      proc->file_proc = TRUE;
+
+      g_free (proc->extensions);
+      proc->extensions = g_strdup (cache_read_string (reader));
+
+      g_free (proc->prefixes);
+      proc->prefixes = g_strdup (cache_read_string (reader));
+
+      g_free (proc->magics);
+      proc->magics = g_strdup (cache_read_string (reader));
+
+      priority = (gint32) cache_read_uint32 (reader);
+      if (priority)
+        gimp_plug_in_procedure_set_priority (proc, priority);
+
+      str = cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_mime_types (proc, str);
+
+      if (cache_read_uint32 (reader))
+        gimp_plug_in_procedure_set_handles_remote (proc);
+
+      if (cache_read_uint32 (reader))
+        gimp_plug_in_procedure_set_handles_raw (proc);
+
+      str = cache_read_string (reader);
+      if (str)
+        gimp_plug_in_procedure_set_thumb_loader (proc, str);
+    }
+
+  str = cache_read_string (reader);
+  gimp_plug_in_procedure_set_image_types (proc, str);
+
+  n_args        = cache_read_uint32 (reader);
+  n_return_vals = cache_read_uint32 (reader);
+
+  for (i = 0; i < n_args && ! reader->error; i++)
+    plug_in_rc_cache_read_proc_arg (reader, procedure, FALSE);
+
+  for (i = 0; i < n_return_vals && ! reader->error; i++)
+    plug_in_rc_cache_read_proc_arg (reader, procedure, TRUE);
+
+  return proc;
+}
+
+static void
+plug_in_rc_cache_read_proc_arg (PlugInRcCacheReader *reader,
+                                GimpProcedure       *procedure,
+                                gboolean             return_value)
+{
+  GPParamDef  param_def = { 0, };
+  GParamSpec *pspec;
+
+  /*  all strings point into the mapped file, the param spec
+   *  constructors copy whatever they keep
+   */
+  param_def.param_def_type  = cache_read_uint32 (reader);
+  param_def.type_name       = (gchar *) cache_read_string (reader);
+  param_def.value_type_name = (gchar *) cache_read_string (reader);
+  param_def.name            = (gchar *) cache_read_string (reader);
+  param_def.nick            = (gchar *) cache_read_string (reader);
+  param_def.blurb           = (gchar *) cache_read_string (reader);
+  param_def.flags           = cache_read_uint32 (reader);
+
+  switch (param_def.param_def_type)
+    {
+    case GP_PARAM_DEF_TYPE_DEFAULT:
+      break;
+
+    case GP_PARAM_DEF_TYPE_INT:
+      param_def.meta.m_int.min_val     = cache_read_uint64 (reader);
+      param_def.meta.m_int.max_val     = cache_read_uint64 (reader);
+      param_def.meta.m_int.default_val = cache_read_uint64 (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_UNIT:
+      param_def.meta.m_unit.allow_pixels  = cache_read_uint32 (reader);
+      param_def.meta.m_unit.allow_percent = cache_read_uint32 (reader);
+      param_def.meta.m_unit.default_val   = cache_read_uint32 (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ENUM:
+      param_def.meta.m_enum.default_val = cache_read_uint32 (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_BOOLEAN:
+      param_def.meta.m_boolean.default_val = cache_read_uint32 (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_FLOAT:
+      param_def.meta.m_float.min_val     = cache_read_double (reader);
+      param_def.meta.m_float.max_val     = cache_read_double (reader);
+      param_def.meta.m_float.default_val = cache_read_double (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_STRING:
+      param_def.meta.m_string.default_val =
+        (gchar *) cache_read_string (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_COLOR:
+      param_def.meta.m_color.has_alpha     = cache_read_uint32 (reader);
+      param_def.meta.m_color.default_val.r = cache_read_double (reader);
+      param_def.meta.m_color.default_val.g = cache_read_double (reader);
+      param_def.meta.m_color.default_val.b = cache_read_double (reader);
+      param_def.meta.m_color.default_val.a = cache_read_double (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID:
+      param_def.meta.m_id.none_ok = cache_read_uint32 (reader);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID_ARRAY:
+      param_def.meta.m_id_array.type_name =
+        (gchar *) cache_read_string (reader);
+      break;
+
+    default:
+      reader->error = TRUE;
+      break;
+    }
+
+  if (reader->error || ! param_def.type_name || ! param_def.name)
+    {
+      reader->error = TRUE;
+      return;
+    }
+
+  pspec = _gimp_gp_param_def_to_param_spec (&param_def);
+
+  if (return_value)
+    gimp_procedure_add_return_value (procedure, pspec);
+  else
+    gimp_procedure_add_argument (procedure, pspec);
+}
+
+static const guint8 *
+cache_read_bytes (PlugInRcCacheReader *reader,
+                  gsize                n_bytes)
+{
+  const guint8 *bytes;
+
+  if (reader->error || n_bytes > reader->size - reader->offset)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  bytes = reader->data + reader->offset;
+  reader->offset += n_bytes;
+
+  return bytes;
+}
+
+static guint32
+cache_read_uint32 (PlugInRcCacheReader *reader)
+{
+  const guint8 *bytes = cache_read_bytes (reader, sizeof (guint32));
+  guint32       value;
+
+  if (! bytes)
+    return 0;
+
+  memcpy (&value, bytes, sizeof (guint32));
+
+  return GUINT32_FROM_LE (value);
+}
+
+static guint64
+cache_read_uint64 (PlugInRcCacheReader *reader)
+{
+  const guint8 *bytes = cache_read_bytes (reader, sizeof (guint64));
+  guint64       value;
+
+  if (! bytes)
+    return 0;
+
+  memcpy (&value, bytes, sizeof (guint64));
+
+  return GUINT64_FROM_LE (value);
+}
+
+static gdouble
+cache_read_double (PlugInRcCacheReader *reader)
+{
+  union
+  {
+    guint64 u;
+    gdouble d;
+  } value;
+
+  value.u = cache_read_uint64 (reader);
+
+  return value.d;
+}
+
+static const gchar *
+cache_read_string (PlugInRcCacheReader *reader)
+{
+  const guint8 *bytes;
+  guint32       length;
+
+  length = cache_read_uint32 (reader);
+
+  if (reader->error || length == PLUG_IN_RC_CACHE_NO_STRING)
+    return NULL;
+
+  bytes = cache_read_bytes (reader, (gsize) length + 1);
+
+  if (! bytes)
+    return NULL;
+
+  if (bytes[length] != '\0')
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  return (const gchar *) bytes;
+}
+
+static void
+plug_in_rc_cache_write_procedure (GByteArray          *array,
+                                  GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  gint           i;
+
+  cache_write_string (array, gimp_object_get_name (procedure));
+  cache_write_uint32 (array, procedure->proc_type);
+
+  cache_write_string (array, procedure->blurb);
+  cache_write_string (array, procedure->help);
+  cache_write_string (array, procedure->authors);
+  cache_write_string (array, procedure->copyright);
+  cache_write_string (array, procedure->date);
+  cache_write_string (array, proc->menu_label);
+
+  cache_write_uint32 (array, g_list_length (proc->menu_paths));
+  for (list = proc->menu_paths; list; list = list->next)
+    cache_write_string (array, list->data);
+
+  cache_write_uint32 (array, proc->icon_type);
+  cache_write_uint32 (array, proc->icon_data_length);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_ICON_NAME:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      cache_write_string (array, (const gchar *) proc->icon_data);
+      break;
+
+    case GIMP_ICON_TYPE_PIXBUF:
+      g_byte_array_append (array, proc->icon_data, proc->icon_data_length);
+      break;
+    }
+
+  cache_write_uint32 (array, proc->file_proc);
+
+  if (proc->file_proc)
+    {
+      cache_write_string (array, proc->extensions);
+      cache_write_string (array, proc->prefixes);
+      cache_write_string (array, proc->magics);
+      cache_write_uint32 (array, proc->priority);
+      cache_write_string (array, proc->mime_types);
+      cache_write_uint32 (array, proc->handles_remote);
+      cache_write_uint32 (array, proc->handles_raw && ! proc->image_types);
+      cache_write_string (array, proc->thumb_loader);
+    }
+
+  cache_write_string (array, proc->image_types);
+
+  cache_write_uint32 (array, procedure->num_args);
+  cache_write_uint32 (array, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args; i++)
+    plug_in_rc_cache_write_proc_arg (array, procedure->args[i]);
+
+  for (i = 0; i < procedure->num_values; i++)
+    plug_in_rc_cache_write_proc_arg (array, procedure->values[i]);
+}
+
+static void
+plug_in_rc_cache_write_proc_arg (GByteArray *array,
+                                 GParamSpec *pspec)
+{
+  GPParamDef param_def = { 0, };
+
+  _gimp_param_spec_to_gp_param_def (pspec, &param_def);
+
+  cache_write_uint32 (array, param_def.param_def_type);
+  cache_write_string (array, param_def.type_name);
+  cache_write_string (array, param_def.value_type_name);
+  cache_write_string (array, g_param_spec_get_name (pspec));
+  cache_write_string (array, g_param_spec_get_nick (pspec));
+  cache_write_string (array, g_param_spec_get_blurb (pspec));
+  cache_write_uint32 (array, pspec->flags);
+
+  switch (param_def.param_def_type)
+    {
+    case GP_PARAM_DEF_TYPE_DEFAULT:
+      break;
+
+    case GP_PARAM_DEF_TYPE_INT:
+      cache_write_uint64 (array, param_def.meta.m_int.min_val);
+      cache_write_uint64 (array, param_def.meta.m_int.max_val);
+      cache_write_uint64 (array, param_def.meta.m_int.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_UNIT:
+      cache_write_uint32 (array, param_def.meta.m_unit.allow_pixels);
+      cache_write_uint32 (array, param_def.meta.m_unit.allow_percent);
+      cache_write_uint32 (array, param_def.meta.m_unit.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ENUM:
+      cache_write_uint32 (array, param_def.meta.m_enum.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_BOOLEAN:
+      cache_write_uint32 (array, param_def.meta.m_boolean.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_FLOAT:
+      cache_write_double (array, param_def.meta.m_float.min_val);
+      cache_write_double (array, param_def.meta.m_float.max_val);
+      cache_write_double (array, param_def.meta.m_float.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_STRING:
+      cache_write_string (array, param_def.meta.m_string.default_val);
+      break;
+
+    case GP_PARAM_DEF_TYPE_COLOR:
+      cache_write_uint32 (array, param_def.meta.m_color.has_alpha);
+      cache_write_double (array, param_def.meta.m_color.default_val.r);
+      cache_write_double (array, param_def.meta.m_color.default_val.g);
+      cache_write_double (array, param_def.meta.m_color.default_val.b);
+      cache_write_double (array, param_def.meta.m_color.default_val.a);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID:
+      cache_write_uint32 (array, param_def.meta.m_id.none_ok);
+      break;
+
+    case GP_PARAM_DEF_TYPE_ID_ARRAY:
+      cache_write_string (array, param_def.meta.m_id_array.type_name);
+      break;
+    }
+}
+
+static void
+cache_write_uint32 (GByteArray *array,
+                    guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (guint32));
+}
+
+static void
+cache_write_uint32_at (GByteArray *array,
+                       gsize       offset,
+                       guint32     value)
+{
+  value = GUINT32_TO_LE (value);
+
+  memcpy (array->data + offset, &value, sizeof (guint32));
+}
+
+static void
+cache_write_uint64 (GByteArray *array,
+                    guint64     value)
+{
+  value = GUINT64_TO_LE (value);
+
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (guint64));
+}
+
+static void
+cache_write_double (GByteArray *array,
+                    gdouble     value)
+{
+  union
+  {
+    guint64 u;
+    gdouble d;
+  } v;
+
+  v.d = value;
+
+  cache_write_uint64 (array, v.u);
+}
+
+static void
+cache_write_string (GByteArray  *array,
+                    const gchar *value)
+{
+  if (value)
+    {
+      gsize length = strlen (value);
+
+      cache_write_uint32 (array, length);
+      g_byte_array_append (array, (const guint8 *) value, length + 1);
+    }
+  else
+    {
+      cache_write_uint32 (array, PLUG_IN_RC_CACHE_NO_STRING);
+    }
+}
@@ -34,6 +34,7 @@ typedef struct _GimpPlugInDef        GimpPlugInDef;
 typedef struct _GimpPlugInManager    GimpPlugInManager;
 typedef struct _GimpPlugInMenuBranch GimpPlugInMenuBranch;
 typedef struct _GimpPlugInProcFrame  GimpPlugInProcFrame;
+typedef struct _GimpPlugInRegion     GimpPlugInRegion;
 typedef struct _GimpPlugInShm        GimpPlugInShm;
 
 
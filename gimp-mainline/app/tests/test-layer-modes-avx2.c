@@ -0,0 +1,311 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "operations/operations-types.h"
+
+#include "operations/layer-modes/gimpoperationlayermode-blend.h"
+#include "operations/layer-modes/gimpoperationlayermode-composite.h"
+
+
+/*  an odd number of pixels, so that the single-pixel tail of the AVX2
+ *  functions, which process two pixels at a time, is covered too
+ */
+#define N_PIXELS     1023
+#define N_ITERATIONS 16
+
+#define ADD_BLEND_TEST(name)                                             \
+  g_test_add_data_func ("/layer-modes-avx2/blend/" #name,                \
+                        gimp_operation_layer_mode_blend_##name,          \
+                        test_blend)
+
+#define ADD_COMPOSITE_TEST(name)                                         \
+  g_test_add_data_func ("/layer-modes-avx2/composite/" #name,            \
+                        &composite_functions[COMPOSITE_##name],          \
+                        test_composite)
+
+
+#if COMPILE_AVX2_INTRINISICS
+
+typedef void (* CompositeFunc) (const gfloat *in,
+                                const gfloat *layer,
+                                const gfloat *comp,
+                                const gfloat *mask,
+                                gfloat        opacity,
+                                gfloat       *out,
+                                gint          samples);
+
+typedef struct
+{
+  CompositeFunc generic;
+  CompositeFunc avx2;
+} CompositeFuncs;
+
+enum
+{
+  COMPOSITE_union,
+  COMPOSITE_clip_to_backdrop,
+  COMPOSITE_clip_to_layer,
+  COMPOSITE_intersection
+};
+
+static const CompositeFuncs composite_functions[] =
+{
+  { gimp_operation_layer_mode_composite_union,
+    gimp_operation_layer_mode_composite_union_avx2 },
+  { gimp_operation_layer_mode_composite_clip_to_backdrop,
+    gimp_operation_layer_mode_composite_clip_to_backdrop_avx2 },
+  { gimp_operation_layer_mode_composite_clip_to_layer,
+    gimp_operation_layer_mode_composite_clip_to_layer_avx2 },
+  { gimp_operation_layer_mode_composite_intersection,
+    gimp_operation_layer_mode_composite_intersection_avx2 }
+};
+
+
+/*  mostly values in the [0, 1] range, with the edge cases the generic
+ *  functions branch on, and some out-of-range values
+ */
+static gfloat
+random_value (void)
+{
+  switch (g_test_rand_int_range (0, 16))
+    {
+    case 0:  return 0.0f;
+    case 1:  return 0.5f;
+    case 2:  return 1.0f;
+    case 3:  return g_test_rand_double_range (-0.5, 0.0);
+    case 4:  return g_test_rand_double_range (1.0, 1.5);
+    default: return g_test_rand_double_range (0.0, 1.0);
+    }
+}
+
+static void
+random_pixels (gfloat *pixels,
+               gint    n_components)
+{
+  gint i;
+
+  for (i = 0; i < N_PIXELS * n_components; i++)
+    pixels[i] = random_value ();
+
+  /*  alpha is never out of range  */
+  if (n_components == 4)
+    {
+      for (i = 0; i < N_PIXELS; i++)
+        pixels[4 * i + 3] = CLAMP (pixels[4 * i + 3], 0.0f, 1.0f);
+    }
+}
+
+/*  compares the bits of the two buffers, except that any NaN is equal
+ *  to any other NaN.  if @in and @layer are given, the color of pixels
+ *  where either of their alpha values is 0 is unconstrained, and not
+ *  compared.
+ */
+static void
+assert_pixels_equal (const gfloat *generic,
+                     const gfloat *avx2,
+                     const gfloat *in,
+                     const gfloat *layer)
+{
+  gint i;
+
+  for (i = 0; i < N_PIXELS * 4; i++)
+    {
+      gint alpha = i - i % 4 + 3;
+
+      if (in && i != alpha && (in[alpha] == 0.0f || layer[alpha] == 0.0f))
+        continue;
+
+      if (isnan (generic[i]) && isnan (avx2[i]))
+        continue;
+
+      if (memcmp (&generic[i], &avx2[i], sizeof (gfloat)))
+        {
+          g_test_message ("pixel %d, component %d: "
+                          "generic %.9g, AVX2 %.9g",
+                          i / 4, i % 4, generic[i], avx2[i]);
+          g_test_fail ();
+
+          return;
+        }
+    }
+}
+
+static gboolean
+have_avx2 (void)
+{
+  if (! (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_AVX2))
+    {
+      g_test_skip ("the CPU doesn't support AVX2");
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * test_blend:
+ * @data: the generic blend function
+ *
+ * Test that the AVX2 version of a blend function gives the same result
+ * as the generic function, on the same random pixels.
+ **/
+static void
+test_blend (gconstpointer data)
+{
+  GimpLayerModeBlendFunc  generic = (GimpLayerModeBlendFunc) data;
+  GimpLayerModeBlendFunc  avx2;
+  gfloat                 *in;
+  gfloat                 *layer;
+  gfloat                 *comp_generic;
+  gfloat                 *comp_avx2;
+  gint                    i;
+
+  if (! have_avx2 ())
+    return;
+
+  avx2 = gimp_operation_layer_mode_blend_get_avx2 (generic);
+
+  g_assert_true (avx2 != generic);
+
+  in           = g_new (gfloat, N_PIXELS * 4);
+  layer        = g_new (gfloat, N_PIXELS * 4);
+  comp_generic = g_new0 (gfloat, N_PIXELS * 4);
+  comp_avx2    = g_new0 (gfloat, N_PIXELS * 4);
+
+  for (i = 0; i < N_ITERATIONS && ! g_test_failed (); i++)
+    {
+      random_pixels (in,    4);
+      random_pixels (layer, 4);
+
+      generic (NULL, in, layer, comp_generic, N_PIXELS);
+      avx2    (NULL, in, layer, comp_avx2,    N_PIXELS);
+
+      assert_pixels_equal (comp_generic, comp_avx2, in, layer);
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (comp_generic);
+  g_free (comp_avx2);
+}
+
+/**
+ * test_composite:
+ * @data: the #CompositeFuncs to compare
+ *
+ * Test that the AVX2 version of a composite function gives the same
+ * result as the generic function, on the same random pixels, with and
+ * without a mask.
+ **/
+static void
+test_composite (gconstpointer data)
+{
+  const CompositeFuncs *funcs = data;
+  gfloat               *in;
+  gfloat               *layer;
+  gfloat               *comp;
+  gfloat               *mask;
+  gfloat               *out_generic;
+  gfloat               *out_avx2;
+  gint                  i;
+
+  if (! have_avx2 ())
+    return;
+
+  in          = g_new (gfloat, N_PIXELS * 4);
+  layer       = g_new (gfloat, N_PIXELS * 4);
+  comp        = g_new (gfloat, N_PIXELS * 4);
+  mask        = g_new (gfloat, N_PIXELS);
+  out_generic = g_new (gfloat, N_PIXELS * 4);
+  out_avx2    = g_new (gfloat, N_PIXELS * 4);
+
+  for (i = 0; i < N_ITERATIONS && ! g_test_failed (); i++)
+    {
+      const gfloat *m       = (i % 2) ? mask : NULL;
+      gfloat        opacity = (i % 4 < 2) ? 1.0f :
+                                            g_test_rand_double_range (0.0, 1.0);
+
+      random_pixels (in,    4);
+      random_pixels (layer, 4);
+      random_pixels (comp,  4);
+      random_pixels (mask,  1);
+
+      funcs->generic (in, layer, comp, m, opacity, out_generic, N_PIXELS);
+      funcs->avx2    (in, layer, comp, m, opacity, out_avx2,    N_PIXELS);
+
+      assert_pixels_equal (out_generic, out_avx2, NULL, NULL);
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (comp);
+  g_free (mask);
+  g_free (out_generic);
+  g_free (out_avx2);
+}
+
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+int
+main (int    argc,
+      char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+#if COMPILE_AVX2_INTRINISICS
+  ADD_BLEND_TEST (addition);
+  ADD_BLEND_TEST (burn);
+  ADD_BLEND_TEST (darken_only);
+  ADD_BLEND_TEST (difference);
+  ADD_BLEND_TEST (divide);
+  ADD_BLEND_TEST (dodge);
+  ADD_BLEND_TEST (exclusion);
+  ADD_BLEND_TEST (grain_extract);
+  ADD_BLEND_TEST (grain_merge);
+  ADD_BLEND_TEST (hard_mix);
+  ADD_BLEND_TEST (hardlight);
+  ADD_BLEND_TEST (lighten_only);
+  ADD_BLEND_TEST (linear_burn);
+  ADD_BLEND_TEST (linear_light);
+  ADD_BLEND_TEST (multiply);
+  ADD_BLEND_TEST (overlay);
+  ADD_BLEND_TEST (pin_light);
+  ADD_BLEND_TEST (screen);
+  ADD_BLEND_TEST (softlight);
+  ADD_BLEND_TEST (subtract);
+  ADD_BLEND_TEST (vivid_light);
+
+  ADD_COMPOSITE_TEST (union);
+  ADD_COMPOSITE_TEST (clip_to_backdrop);
+  ADD_COMPOSITE_TEST (clip_to_layer);
+  ADD_COMPOSITE_TEST (intersection);
+#endif /* COMPILE_AVX2_INTRINISICS */
+
+  /* Run the tests and return status */
+  return g_test_run ();
+}
@@ -0,0 +1,418 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "operations/operations-types.h"
+
+#include "operations/layer-modes/gimp-layer-modes.h"
+#include "operations/layer-modes/gimpoperationlayermode-composite.h"
+#include "operations/layer-modes/gimpoperationlayermode-fused.h"
+
+
+/*  more than a few blocks of the fused pipeline, and an odd number, so
+ *  that a partial block is covered too
+ */
+#define N_PIXELS     1023
+#define N_ITERATIONS 16
+
+/*  the samples are converted between the composite and blend spaces in
+ *  different runs by the two pipelines, and babl may process a sample
+ *  differently depending on where it falls in a run
+ */
+#define EPSILON      1e-5
+
+
+typedef struct
+{
+  GimpLayerColorSpace blend_space;
+  GimpLayerColorSpace composite_space;
+} SpaceCombination;
+
+
+static const SpaceCombination space_combinations[] =
+{
+  { GIMP_LAYER_COLOR_SPACE_AUTO,           GIMP_LAYER_COLOR_SPACE_AUTO           },
+  { GIMP_LAYER_COLOR_SPACE_RGB_LINEAR,     GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL },
+  { GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL, GIMP_LAYER_COLOR_SPACE_RGB_LINEAR     },
+  { GIMP_LAYER_COLOR_SPACE_LAB,            GIMP_LAYER_COLOR_SPACE_RGB_LINEAR     },
+  { GIMP_LAYER_COLOR_SPACE_LAB,            GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL }
+};
+
+static const GimpLayerCompositeMode composite_modes[] =
+{
+  GIMP_LAYER_COMPOSITE_UNION,
+  GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP,
+  GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER,
+  GIMP_LAYER_COMPOSITE_INTERSECTION
+};
+
+/*  the blend functions only use the operation to look up the source space,
+ *  which is NULL for an unconnected node, the same as the space of the
+ *  fishes below
+ */
+static GeglNode *node;
+
+
+static const Babl *
+get_space_format (GimpLayerColorSpace space)
+{
+  switch (space)
+    {
+    case GIMP_LAYER_COLOR_SPACE_RGB_LINEAR:
+      return babl_format ("RGBA float");
+
+    case GIMP_LAYER_COLOR_SPACE_RGB_PERCEPTUAL:
+      return babl_format ("R'G'B'A float");
+
+    case GIMP_LAYER_COLOR_SPACE_LAB:
+      return babl_format ("CIE Lab alpha float");
+
+    default:
+      g_return_val_if_reached (NULL);
+    }
+}
+
+static GimpLayerModeCompositeFunc
+get_composite_function (GimpLayerMode          mode,
+                        GimpLayerCompositeMode composite_mode)
+{
+  gboolean subtractive = gimp_layer_mode_is_subtractive (mode);
+
+  switch (composite_mode)
+    {
+    case GIMP_LAYER_COMPOSITE_UNION:
+      return subtractive ? gimp_operation_layer_mode_composite_union_sub :
+                           gimp_operation_layer_mode_composite_union;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_BACKDROP:
+      return subtractive ? gimp_operation_layer_mode_composite_clip_to_backdrop_sub :
+                           gimp_operation_layer_mode_composite_clip_to_backdrop;
+
+    case GIMP_LAYER_COMPOSITE_CLIP_TO_LAYER:
+      return subtractive ? gimp_operation_layer_mode_composite_clip_to_layer_sub :
+                           gimp_operation_layer_mode_composite_clip_to_layer;
+
+    case GIMP_LAYER_COMPOSITE_INTERSECTION:
+      return subtractive ? gimp_operation_layer_mode_composite_intersection_sub :
+                           gimp_operation_layer_mode_composite_intersection;
+
+    default:
+      g_return_val_if_reached (NULL);
+    }
+}
+
+/*  mostly values in the [0, 1] range, with the edge cases the blend and
+ *  composite functions branch on, and some out-of-range values
+ */
+static gfloat
+random_value (void)
+{
+  switch (g_test_rand_int_range (0, 16))
+    {
+    case 0:  return 0.0f;
+    case 1:  return 0.5f;
+    case 2:  return 1.0f;
+    case 3:  return g_test_rand_double_range (-0.5, 0.0);
+    case 4:  return g_test_rand_double_range (1.0, 1.5);
+    default: return g_test_rand_double_range (0.0, 1.0);
+    }
+}
+
+static void
+random_pixels (gfloat *pixels,
+               gint    n_components)
+{
+  gint i;
+
+  for (i = 0; i < N_PIXELS * n_components; i++)
+    pixels[i] = random_value ();
+
+  /*  alpha is never out of range  */
+  if (n_components == 4)
+    {
+      for (i = 0; i < N_PIXELS; i++)
+        pixels[4 * i + 3] = CLAMP (pixels[4 * i + 3], 0.0f, 1.0f);
+    }
+}
+
+/*  runs the blend and composite stages one after the other, over all the
+ *  samples, the way gimp_operation_layer_mode_real_process() did before
+ *  the stages were fused
+ */
+static void
+reference_process (const GimpLayerModeFusedParams *params,
+                   GimpLayerModeCompositeFunc      composite_function,
+                   const gfloat                   *in,
+                   const gfloat                   *layer,
+                   const gfloat                   *mask,
+                   gfloat                         *out,
+                   gint                            samples)
+{
+  gfloat *comp = g_new (gfloat, 4 * samples);
+
+  if (params->composite_to_blend_fish)
+    {
+      gfloat *blend_in    = g_new (gfloat, 4 * samples);
+      gfloat *blend_layer = g_new (gfloat, 4 * samples);
+
+      babl_process (params->composite_to_blend_fish, in,    blend_in,    samples);
+      babl_process (params->composite_to_blend_fish, layer, blend_layer, samples);
+
+      params->blend_function (params->operation,
+                              blend_in, blend_layer, comp, samples);
+
+      babl_process (params->blend_to_composite_fish, comp, comp, samples);
+
+      g_free (blend_in);
+      g_free (blend_layer);
+    }
+  else
+    {
+      params->blend_function (params->operation, in, layer, comp, samples);
+    }
+
+  composite_function (in, layer, comp, mask, params->opacity, out, samples);
+
+  g_free (comp);
+}
+
+/*  compares the two buffers, allowing for a small relative error.  any
+ *  NaN is equal to any other NaN.
+ */
+static void
+assert_pixels_equal (const gfloat *reference,
+                     const gfloat *fused,
+                     const gchar  *description)
+{
+  gint i;
+
+  for (i = 0; i < N_PIXELS * 4; i++)
+    {
+      if (reference[i] == fused[i])
+        continue;
+
+      if (isnan (reference[i]) && isnan (fused[i]))
+        continue;
+
+      if (fabs (reference[i] - fused[i]) <=
+          EPSILON * MAX (1.0, fabs (reference[i])))
+        {
+          continue;
+        }
+
+      g_test_message ("%s, pixel %d, component %d: "
+                      "reference %.9g, fused %.9g",
+                      description, i / 4, i % 4, reference[i], fused[i]);
+      g_test_fail ();
+
+      return;
+    }
+}
+
+/**
+ * test_layer_mode:
+ * @data: the #GimpLayerMode to test
+ *
+ * Test that the fused pipeline gives the same result as running the blend
+ * and composite stages separately, for all the composite modes, and for
+ * blending with and without conversion between the composite and blend
+ * spaces, on the same random pixels.
+ **/
+static void
+test_layer_mode (gconstpointer data)
+{
+  GimpLayerMode  mode = GPOINTER_TO_INT (data);
+  gfloat        *in;
+  gfloat        *layer;
+  gfloat        *mask;
+  gfloat        *out_reference;
+  gfloat        *out_fused;
+  gint           s;
+  gint           c;
+  gint           i;
+
+  in            = g_new (gfloat, N_PIXELS * 4);
+  layer         = g_new (gfloat, N_PIXELS * 4);
+  mask          = g_new (gfloat, N_PIXELS);
+  out_reference = g_new (gfloat, N_PIXELS * 4);
+  out_fused     = g_new (gfloat, N_PIXELS * 4);
+
+  for (s = 0; s < (gint) G_N_ELEMENTS (space_combinations) && ! g_test_failed (); s++)
+    {
+      const SpaceCombination   *spaces = &space_combinations[s];
+      GimpLayerModeFusedParams  params = { 0, };
+
+      params.operation      = gegl_node_get_gegl_operation (node);
+      params.layer_mode     = mode;
+      params.blend_function = gimp_layer_mode_get_blend_function (mode);
+
+      if (spaces->blend_space != GIMP_LAYER_COLOR_SPACE_AUTO)
+        {
+          const Babl *composite_format;
+          const Babl *blend_format;
+
+          composite_format = get_space_format (spaces->composite_space);
+          blend_format     = get_space_format (spaces->blend_space);
+
+          params.composite_to_blend_fish = babl_fish (composite_format,
+                                                      blend_format);
+          params.blend_to_composite_fish = babl_fish (blend_format,
+                                                      composite_format);
+        }
+
+      for (c = 0; c < (gint) G_N_ELEMENTS (composite_modes) && ! g_test_failed (); c++)
+        {
+          GimpLayerModeCompositeFunc composite_function;
+
+          composite_function = get_composite_function (mode,
+                                                       composite_modes[c]);
+
+          params.composite_mode = composite_modes[c];
+
+          /*  the fused pipeline has built-in equivalents of the
+           *  non-subtractive composite functions, which
+           *  gimp_operation_layer_mode_real_process() uses instead of the
+           *  generic functions
+           */
+          if (gimp_layer_mode_is_subtractive (mode))
+            params.composite_function = composite_function;
+          else
+            params.composite_function = NULL;
+
+          for (i = 0; i < N_ITERATIONS && ! g_test_failed (); i++)
+            {
+              const gfloat *m        = (i & 1) ? mask : NULL;
+              gboolean      in_place = (i & 4) != 0;
+              gchar        *description;
+
+              params.opacity = (i & 2) ? g_test_rand_double_range (0.0, 1.0) :
+                                         1.0f;
+
+              random_pixels (in,    4);
+              random_pixels (layer, 4);
+              random_pixels (mask,  1);
+
+              /*  runs of unblended samples, so that blocks of the fused
+               *  pipeline start and end with samples that are not converted
+               */
+              if (i & 8)
+                {
+                  gint j;
+
+                  for (j = 0; j < N_PIXELS; j++)
+                    {
+                      if ((j / 48) % 2 == 0)
+                        layer[4 * j + 3] = 0.0f;
+                    }
+                }
+
+              reference_process (&params, composite_function,
+                                 in, layer, m, out_reference, N_PIXELS);
+
+              if (in_place)
+                {
+                  memcpy (out_fused, in, N_PIXELS * 4 * sizeof (gfloat));
+
+                  gimp_operation_layer_mode_fused_process (&params,
+                                                           out_fused, layer, m,
+                                                           out_fused,
+                                                           N_PIXELS);
+                }
+              else
+                {
+                  gimp_operation_layer_mode_fused_process (&params,
+                                                           in, layer, m,
+                                                           out_fused,
+                                                           N_PIXELS);
+                }
+
+              description = g_strdup_printf ("blend space %d, "
+                                             "composite space %d, "
+                                             "composite mode %d, "
+                                             "iteration %d",
+                                             spaces->blend_space,
+                                             spaces->composite_space,
+                                             composite_modes[c],
+                                             i);
+
+              assert_pixels_equal (out_reference, out_fused, description);
+
+              g_free (description);
+            }
+        }
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (mask);
+  g_free (out_reference);
+  g_free (out_fused);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GEnumClass *enum_class;
+  gint        i;
+  int         result;
+
+  g_test_init (&argc, &argv, NULL);
+  gegl_init (&argc, &argv);
+
+  node = gegl_node_new_child (NULL,
+                              "operation", "gegl:nop",
+                              NULL);
+
+  enum_class = g_type_class_ref (GIMP_TYPE_LAYER_MODE);
+
+  /*  all the modes with a blend stage go through the fused pipeline  */
+  for (i = 0; i < enum_class->n_values; i++)
+    {
+      gint   mode = enum_class->values[i].value;
+      gchar *path;
+
+      if (mode < 0 || ! gimp_layer_mode_get_blend_function (mode))
+        continue;
+
+      path = g_strdup_printf ("/layer-modes-fused/%s",
+                              enum_class->values[i].value_nick);
+
+      g_test_add_data_func (path, GINT_TO_POINTER (mode), test_layer_mode);
+
+      g_free (path);
+    }
+
+  /* Run the tests and return status */
+  result = g_test_run ();
+
+  g_type_class_unref (enum_class);
+  g_object_unref (node);
+
+  gegl_exit ();
+
+  return result;
+}
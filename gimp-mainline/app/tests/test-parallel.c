@@ -0,0 +1,227 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "widgets/widgets-types.h"
+
+#include "core/gimp.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpasync.h"
+#include "core/gimpcancelable.h"
+#include "core/gimpwaitable.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-parallel/" #function, gimp, function);
+
+/*  small enough to be summed directly, and deep enough for the children
+ *  to outnumber the threads many times over
+ */
+#define SUM_LEAF_SIZE 16
+#define SUM_SIZE      (1 << 16)
+
+
+typedef struct
+{
+  gint   start;
+  gint   end;
+  gint64 sum;
+} SumData;
+
+
+static void sum_func (GimpAsync *async,
+                      SumData   *data);
+
+
+/*  sums the range in two halves, the first one in a child task  */
+static void
+sum_range (GimpAsync *async,
+           SumData   *data)
+{
+  if (data->end - data->start <= SUM_LEAF_SIZE)
+    {
+      gint i;
+
+      for (i = data->start; i < data->end; i++)
+        data->sum += i;
+    }
+  else
+    {
+      gint       middle = (data->start + data->end) / 2;
+      SumData    left   = { data->start, middle,    0 };
+      SumData    right  = { middle,      data->end, 0 };
+      GimpAsync *child;
+
+      child = gimp_parallel_run_async_child (async,
+                                             (GimpRunAsyncFunc) sum_func,
+                                             &left);
+
+      sum_range (async, &right);
+
+      gimp_parallel_run_async_child_wait (child);
+
+      g_assert_true (gimp_async_is_finished (child));
+
+      g_object_unref (child);
+
+      data->sum = left.sum + right.sum;
+    }
+}
+
+static void
+sum_func (GimpAsync *async,
+          SumData   *data)
+{
+  sum_range (async, data);
+
+  gimp_async_finish (async, NULL);
+}
+
+/**
+ * child_wait:
+ * @data:
+ *
+ * Test that tasks which recursively spawn children, and wait for them,
+ * run to completion, however many more children there are than threads.
+ **/
+static void
+child_wait (gconstpointer data)
+{
+  Gimp      *gimp     = GIMP (data);
+  SumData    sum_data = { 0, SUM_SIZE, 0 };
+  GimpAsync *async;
+  gint       n_threads;
+
+  for (n_threads = 1; n_threads <= 8; n_threads *= 2)
+    {
+      g_object_set (gimp->config,
+                    "num-processors", n_threads,
+                    NULL);
+
+      sum_data.sum = 0;
+
+      async = gimp_parallel_run_async (
+        (GimpRunAsyncFunc) sum_func,
+        &sum_data);
+
+      gimp_waitable_wait (GIMP_WAITABLE (async));
+
+      g_assert_true (gimp_async_is_finished (async));
+      g_assert_cmpint (sum_data.sum, ==,
+                       (gint64) SUM_SIZE * (SUM_SIZE - 1) / 2);
+
+      g_object_unref (async);
+    }
+}
+
+/**
+ * child_wait_without_parent:
+ * @data:
+ *
+ * Test that a thread which doesn't run a task of its own can spawn
+ * children, and wait for them.
+ **/
+static void
+child_wait_without_parent (gconstpointer data)
+{
+  SumData    sum_data = { 0, SUM_SIZE, 0 };
+  GimpAsync *child;
+
+  child = gimp_parallel_run_async_child (NULL,
+                                         (GimpRunAsyncFunc) sum_func,
+                                         &sum_data);
+
+  gimp_parallel_run_async_child_wait (child);
+
+  g_assert_true (gimp_async_is_finished (child));
+  g_assert_cmpint (sum_data.sum, ==,
+                   (gint64) SUM_SIZE * (SUM_SIZE - 1) / 2);
+
+  g_object_unref (child);
+}
+
+/**
+ * child_of_canceled_parent:
+ * @data:
+ *
+ * Test that the children of a canceled task are aborted, instead of
+ * being run.
+ **/
+static void
+child_of_canceled_parent (gconstpointer data)
+{
+  SumData    sum_data = { 0, SUM_SIZE, 0 };
+  GimpAsync *parent;
+  GimpAsync *child;
+
+  parent = gimp_async_new ();
+
+  gimp_cancelable_cancel (GIMP_CANCELABLE (parent));
+
+  child = gimp_parallel_run_async_child (parent,
+                                         (GimpRunAsyncFunc) sum_func,
+                                         &sum_data);
+
+  gimp_parallel_run_async_child_wait (child);
+
+  g_assert_true (gimp_async_is_stopped (child));
+  g_assert_false (gimp_async_is_finished (child));
+  g_assert_cmpint (sum_data.sum, ==, 0);
+
+  g_object_unref (child);
+
+  gimp_async_abort (parent);
+  g_object_unref (parent);
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  ADD_TEST (child_wait);
+  ADD_TEST (child_wait_without_parent);
+  ADD_TEST (child_of_canceled_parent);
+
+  /* Run the tests and return status */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp3_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -78,7 +78,7 @@ static void   gimp_brush_tool_set_brush       (GimpBrushCore     *brush_core,
                                                GimpBrush         *brush,
                                                GimpBrushTool     *brush_tool);
 
-static const GimpBezierDesc *
+static GimpBezierDesc *
                  gimp_brush_tool_get_boundary (GimpBrushTool     *brush_tool,
                                                gint              *width,
                                                gint              *height);
@@ -242,19 +242,16 @@ gimp_brush_tool_options_notify (GimpTool         *tool,
 static void
 gimp_brush_tool_paint_start (GimpPaintTool *paint_tool)
 {
-  GimpBrushTool        *brush_tool = GIMP_BRUSH_TOOL (paint_tool);
-  GimpBrushCore        *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
-  const GimpBezierDesc *boundary;
+  GimpBrushTool *brush_tool = GIMP_BRUSH_TOOL (paint_tool);
+  GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
 
   if (GIMP_PAINT_TOOL_CLASS (parent_class)->paint_start)
     GIMP_PAINT_TOOL_CLASS (parent_class)->paint_start (paint_tool);
 
-  boundary = gimp_brush_tool_get_boundary (brush_tool,
-                                           &brush_tool->boundary_width,
-                                           &brush_tool->boundary_height);
-
-  if (boundary)
-    brush_tool->boundary = gimp_bezier_desc_copy (boundary);
+  brush_tool->boundary =
+    gimp_brush_tool_get_boundary (brush_tool,
+                                  &brush_tool->boundary_width,
+                                  &brush_tool->boundary_height);
 
   brush_tool->boundary_scale        = brush_core->scale;
   brush_tool->boundary_aspect_ratio = brush_core->aspect_ratio;
@@ -277,9 +274,8 @@ gimp_brush_tool_paint_end (GimpPaintTool *paint_tool)
 static void
 gimp_brush_tool_paint_flush (GimpPaintTool *paint_tool)
 {
-  GimpBrushTool        *brush_tool = GIMP_BRUSH_TOOL (paint_tool);
-  GimpBrushCore        *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
-  const GimpBezierDesc *boundary;
+  GimpBrushTool *brush_tool = GIMP_BRUSH_TOOL (paint_tool);
+  GimpBrushCore *brush_core = GIMP_BRUSH_CORE (paint_tool->core);
 
   if (GIMP_PAINT_TOOL_CLASS (parent_class)->paint_flush)
     GIMP_PAINT_TOOL_CLASS (parent_class)->paint_flush (paint_tool);
@@ -292,12 +288,10 @@ gimp_brush_tool_paint_flush (GimpPaintTool *paint_tool)
     {
       g_clear_pointer (&brush_tool->boundary, gimp_bezier_desc_free);
 
-      boundary = gimp_brush_tool_get_boundary (brush_tool,
-                                               &brush_tool->boundary_width,
-                                               &brush_tool->boundary_height);
-
-      if (boundary)
-        brush_tool->boundary = gimp_bezier_desc_copy (boundary);
+      brush_tool->boundary =
+        gimp_brush_tool_get_boundary (brush_tool,
+                                      &brush_tool->boundary_width,
+                                      &brush_tool->boundary_height);
 
       brush_tool->boundary_scale        = brush_core->scale;
       brush_tool->boundary_aspect_ratio = brush_core->aspect_ratio;
@@ -347,9 +341,11 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
 {
   GimpTool             *tool;
   GimpDisplayShell     *shell;
-  const GimpBezierDesc *boundary = NULL;
-  gint                  width    = 0;
-  gint                  height   = 0;
+  const GimpBezierDesc *boundary      = NULL;
+  GimpBezierDesc       *boundary_copy = NULL;
+  GimpCanvasItem       *item          = NULL;
+  gint                  width         = 0;
+  gint                  height        = 0;
 
   g_return_val_if_fail (GIMP_IS_BRUSH_TOOL (brush_tool), NULL);
   g_return_val_if_fail (GIMP_IS_DISPLAY (display), NULL);
@@ -362,7 +358,9 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
     }
   else
     {
-      boundary = gimp_brush_tool_get_boundary (brush_tool, &width, &height);
+      boundary_copy = gimp_brush_tool_get_boundary (brush_tool,
+                                                    &width, &height);
+      boundary      = boundary_copy;
     }
 
   if (! boundary)
@@ -391,11 +389,14 @@ gimp_brush_tool_create_outline (GimpBrushTool *brush_tool,
 #undef EPSILON
         }
 
-      return gimp_canvas_path_new (shell, boundary, x, y, FALSE,
+      item = gimp_canvas_path_new (shell, boundary, x, y, FALSE,
                                    GIMP_PATH_STYLE_OUTLINE);
     }
 
-  return NULL;
+  if (boundary_copy)
+    gimp_bezier_desc_free (boundary_copy);
+
+  return item;
 }
 
 static void
@@ -430,7 +431,7 @@ gimp_brush_tool_set_brush (GimpBrushCore *brush_core,
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (brush_tool));
 }
 
-static const GimpBezierDesc *
+static GimpBezierDesc *
 gimp_brush_tool_get_boundary (GimpBrushTool *brush_tool,
                               gint          *width,
                               gint          *height)
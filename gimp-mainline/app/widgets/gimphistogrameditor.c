@@ -74,7 +74,15 @@ static void     gimp_histogram_editor_frozen_update (GimpHistogramEditor *editor
                                                      const GParamSpec    *pspec);
 static void     gimp_histogram_editor_buffer_update (GimpHistogramEditor *editor,
                                                      const GParamSpec    *pspec);
+static void     gimp_histogram_editor_drawable_update
+                                                    (GimpDrawable        *drawable,
+                                                     gint                 x,
+                                                     gint                 y,
+                                                     gint                 width,
+                                                     gint                 height,
+                                                     GimpHistogramEditor *editor);
 static void     gimp_histogram_editor_update        (GimpHistogramEditor *editor);
+static void     gimp_histogram_editor_queue_update  (GimpHistogramEditor *editor);
 
 static gboolean gimp_histogram_editor_idle_update   (GimpHistogramEditor *editor);
 static gboolean gimp_histogram_menu_sensitivity     (gint                 value,
@@ -410,7 +418,7 @@ gimp_histogram_editor_layer_changed (GimpImage           *image,
                                             gimp_histogram_editor_menu_update,
                                             editor);
       g_signal_handlers_disconnect_by_func (editor->drawable,
-                                            gimp_histogram_editor_update,
+                                            gimp_histogram_editor_drawable_update,
                                             editor);
       g_signal_handlers_disconnect_by_func (editor->drawable,
                                             gimp_histogram_editor_buffer_update,
@@ -435,8 +443,8 @@ gimp_histogram_editor_layer_changed (GimpImage           *image,
                                G_CALLBACK (gimp_histogram_editor_buffer_update),
                                editor, G_CONNECT_SWAPPED);
       g_signal_connect_object (editor->drawable, "update",
-                               G_CALLBACK (gimp_histogram_editor_update),
-                               editor, G_CONNECT_SWAPPED);
+                               G_CALLBACK (gimp_histogram_editor_drawable_update),
+                               editor, 0);
       g_signal_connect_object (editor->drawable, "alpha-changed",
                                G_CALLBACK (gimp_histogram_editor_menu_update),
                                editor, G_CONNECT_SWAPPED);
@@ -479,7 +487,7 @@ gimp_histogram_editor_calculate_async_callback (GimpAsync           *async,
   editor->bg_pending = FALSE;
 
   if (editor->update_pending)
-    gimp_histogram_editor_update (editor);
+    gimp_histogram_editor_queue_update (editor);
 }
 
 static gboolean
@@ -499,7 +507,7 @@ gimp_histogram_editor_validate (GimpHistogramEditor *editor)
            */
           gimp_item_is_attached (GIMP_ITEM (editor->drawable)))
         {
-          GimpAsync *async;
+          GimpAsync *async = NULL;
 
           if (! editor->histogram)
             {
@@ -507,6 +515,8 @@ gimp_histogram_editor_validate (GimpHistogramEditor *editor)
 
               editor->histogram = gimp_histogram_new (editor->trc);
 
+              gimp_histogram_set_incremental (editor->histogram, TRUE);
+
               gimp_histogram_clear_values (
                 editor->histogram,
                 babl_format_get_n_components (
@@ -514,10 +524,21 @@ gimp_histogram_editor_validate (GimpHistogramEditor *editor)
 
               gimp_histogram_view_set_histogram (view, editor->histogram);
             }
+          else if (! editor->update_all)
+            {
+              /*  only the drawable's pixels changed, try folding just
+               *  the changed area into the histogram
+               */
+              async = gimp_drawable_update_histogram_async (
+                editor->drawable, editor->histogram, TRUE,
+                &editor->update_rect);
+            }
 
-          async = gimp_drawable_calculate_histogram_async (editor->drawable,
-                                                           editor->histogram,
-                                                           TRUE);
+          if (! async)
+            {
+              async = gimp_drawable_calculate_histogram_async (
+                editor->drawable, editor->histogram, TRUE);
+            }
 
           editor->calculate_async = async;
 
@@ -535,7 +556,9 @@ gimp_histogram_editor_validate (GimpHistogramEditor *editor)
           gimp_histogram_editor_info_update (editor);
         }
 
-      editor->recompute = FALSE;
+      editor->recompute   = FALSE;
+      editor->update_all  = FALSE;
+      editor->update_rect = *GEGL_RECTANGLE (0, 0, 0, 0);
 
       if (editor->idle_id)
         {
@@ -612,8 +635,31 @@ gimp_histogram_editor_buffer_update (GimpHistogramEditor *editor,
                 NULL);
 }
 
+static void
+gimp_histogram_editor_drawable_update (GimpDrawable        *drawable,
+                                       gint                 x,
+                                       gint                 y,
+                                       gint                 width,
+                                       gint                 height,
+                                       GimpHistogramEditor *editor)
+{
+  gegl_rectangle_bounding_box (&editor->update_rect,
+                               &editor->update_rect,
+                               GEGL_RECTANGLE (x, y, width, height));
+
+  gimp_histogram_editor_queue_update (editor);
+}
+
 static void
 gimp_histogram_editor_update (GimpHistogramEditor *editor)
+{
+  editor->update_all = TRUE;
+
+  gimp_histogram_editor_queue_update (editor);
+}
+
+static void
+gimp_histogram_editor_queue_update (GimpHistogramEditor *editor)
 {
   if (editor->bg_pending)
     {
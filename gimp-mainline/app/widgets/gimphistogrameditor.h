@@ -44,6 +44,8 @@ struct _GimpHistogramEditor
 
   guint                 idle_id;
   gboolean              recompute;
+  gboolean              update_all;
+  GeglRectangle         update_rect;
 
   GimpAsync            *calculate_async;
   gboolean              bg_pending;
@@ -0,0 +1,310 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "config/gimpcoreconfig.h"
+
+#include "core/gimp.h"
+#include "core/gimpasync.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpimage.h"
+
+#include "xcf.h"
+#include "xcf-autosave.h"
+
+
+/* every few minutes, the images changed since the last autosave are
+ * saved in the background to "autosave/<image id>.xcf" in the user's
+ * gimp directory.  the copy is deleted once the image is clean again, or
+ * closed, so only images lost to a crash leave one behind.
+ */
+
+
+static void       xcf_autosave_interval_notify (GimpCoreConfig   *config,
+                                                const GParamSpec *pspec,
+                                                Gimp             *gimp);
+static gboolean   xcf_autosave_timeout         (Gimp             *gimp);
+
+static void       xcf_autosave_image_dirty     (GimpImage        *image,
+                                                GimpDirtyMask     dirty_mask,
+                                                Gimp             *gimp);
+static void       xcf_autosave_image_remove    (GimpContainer    *container,
+                                                GimpImage        *image,
+                                                Gimp             *gimp);
+
+static GFile    * xcf_autosave_get_file        (GimpImage        *image);
+static void       xcf_autosave_save            (Gimp             *gimp,
+                                                GimpImage        *image);
+static void       xcf_autosave_delete          (GimpImage        *image);
+static void       xcf_autosave_delete_file     (GimpAsync        *async,
+                                                GFile            *file);
+
+
+static guint       autosave_timeout_id = 0;
+static GQuark      autosave_dirty_handler_id = 0;
+static GQuark      autosave_clean_handler_id = 0;
+
+/* the images changed since they were last autosaved */
+static GHashTable *autosave_changed = NULL;
+
+/* the images that have an autosave file */
+static GHashTable *autosave_saved   = NULL;
+
+
+/*  public functions  */
+
+void
+xcf_autosave_init (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  autosave_changed = g_hash_table_new (g_direct_hash, g_direct_equal);
+  autosave_saved   = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  autosave_dirty_handler_id =
+    gimp_container_add_handler (gimp->images, "dirty",
+                                G_CALLBACK (xcf_autosave_image_dirty),
+                                gimp);
+  autosave_clean_handler_id =
+    gimp_container_add_handler (gimp->images, "clean",
+                                G_CALLBACK (xcf_autosave_image_dirty),
+                                gimp);
+
+  g_signal_connect (gimp->images, "remove",
+                    G_CALLBACK (xcf_autosave_image_remove),
+                    gimp);
+
+  g_signal_connect (gimp->config, "notify::xcf-autosave-interval",
+                    G_CALLBACK (xcf_autosave_interval_notify),
+                    gimp);
+
+  xcf_autosave_interval_notify (gimp->config, NULL, gimp);
+}
+
+void
+xcf_autosave_exit (Gimp *gimp)
+{
+  GList *images;
+  GList *list;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  if (! autosave_saved)
+    return;
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        xcf_autosave_interval_notify,
+                                        gimp);
+  g_signal_handlers_disconnect_by_func (gimp->images,
+                                        xcf_autosave_image_remove,
+                                        gimp);
+
+  gimp_container_remove_handler (gimp->images, autosave_dirty_handler_id);
+  gimp_container_remove_handler (gimp->images, autosave_clean_handler_id);
+
+  autosave_dirty_handler_id = 0;
+  autosave_clean_handler_id = 0;
+
+  /* the images left are being discarded */
+  images = g_hash_table_get_keys (autosave_saved);
+
+  for (list = images; list; list = g_list_next (list))
+    xcf_autosave_delete (list->data);
+
+  g_list_free (images);
+
+  if (autosave_timeout_id)
+    {
+      g_source_remove (autosave_timeout_id);
+      autosave_timeout_id = 0;
+    }
+
+  g_clear_pointer (&autosave_changed, g_hash_table_unref);
+  g_clear_pointer (&autosave_saved,   g_hash_table_unref);
+}
+
+
+/*  private functions  */
+
+static void
+xcf_autosave_interval_notify (GimpCoreConfig   *config,
+                              const GParamSpec *pspec,
+                              Gimp             *gimp)
+{
+  if (autosave_timeout_id)
+    {
+      g_source_remove (autosave_timeout_id);
+      autosave_timeout_id = 0;
+    }
+
+  if (config->xcf_autosave_interval > 0)
+    {
+      autosave_timeout_id =
+        g_timeout_add_seconds (config->xcf_autosave_interval * 60,
+                               (GSourceFunc) xcf_autosave_timeout,
+                               gimp);
+    }
+}
+
+static gboolean
+xcf_autosave_timeout (Gimp *gimp)
+{
+  GList *list;
+
+  for (list = gimp_get_image_iter (gimp); list; list = g_list_next (list))
+    {
+      GimpImage *image = list->data;
+
+      /* images being saved are handled next time */
+      if (! g_hash_table_contains (autosave_changed, image) ||
+          xcf_save_get_async (image))
+        continue;
+
+      if (gimp_image_is_dirty (image))
+        xcf_autosave_save (gimp, image);
+      else
+        xcf_autosave_delete (image);
+
+      g_hash_table_remove (autosave_changed, image);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+xcf_autosave_image_dirty (GimpImage     *image,
+                          GimpDirtyMask  dirty_mask,
+                          Gimp          *gimp)
+{
+  g_hash_table_add (autosave_changed, image);
+}
+
+static void
+xcf_autosave_image_remove (GimpContainer *container,
+                           GimpImage     *image,
+                           Gimp          *gimp)
+{
+  xcf_autosave_delete (image);
+
+  g_hash_table_remove (autosave_changed, image);
+}
+
+static GFile *
+xcf_autosave_get_file (GimpImage *image)
+{
+  GFile *file;
+  gchar *basename;
+
+  basename = g_strdup_printf ("%d.xcf", gimp_image_get_id (image));
+
+  file = gimp_directory_file ("autosave", basename, NULL);
+
+  g_free (basename);
+
+  return file;
+}
+
+static void
+xcf_autosave_save (Gimp      *gimp,
+                   GimpImage *image)
+{
+  GFile         *file;
+  GFile         *dir;
+  GOutputStream *output;
+  GError        *error = NULL;
+
+  file = xcf_autosave_get_file (image);
+  dir  = g_file_get_parent (file);
+
+  if (! g_file_make_directory_with_parents (dir, NULL, &error) &&
+      ! g_error_matches (error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+    {
+      g_printerr ("xcf: failed to create autosave folder: %s\n",
+                  error->message);
+    }
+
+  g_clear_error (&error);
+  g_object_unref (dir);
+
+  output = G_OUTPUT_STREAM (g_file_replace (file,
+                                            NULL, FALSE, G_FILE_CREATE_NONE,
+                                            NULL, &error));
+
+  if (output)
+    {
+      GimpAsync *async;
+
+      /* the image keeps copying its tiles from the file it was actually
+       * saved to
+       */
+      async = xcf_save_stream_async (gimp, image, output, file, FALSE, NULL);
+
+      g_hash_table_add (autosave_saved, image);
+
+      g_object_unref (async);
+      g_object_unref (output);
+    }
+  else
+    {
+      g_printerr ("xcf: failed to autosave '%s': %s\n",
+                  gimp_file_get_utf8_name (file), error->message);
+
+      g_clear_error (&error);
+    }
+
+  g_object_unref (file);
+}
+
+static void
+xcf_autosave_delete (GimpImage *image)
+{
+  GimpAsync *async;
+  GFile     *file;
+
+  if (! g_hash_table_remove (autosave_saved, image))
+    return;
+
+  file = xcf_autosave_get_file (image);
+
+  /* a pending autosave would only put the file back */
+  async = xcf_save_get_async (image);
+
+  if (async)
+    gimp_async_add_callback (async,
+                             (GimpAsyncCallback) xcf_autosave_delete_file,
+                             file);
+  else
+    xcf_autosave_delete_file (NULL, file);
+}
+
+static void
+xcf_autosave_delete_file (GimpAsync *async,
+                          GFile     *file)
+{
+  g_file_delete (file, NULL, NULL);
+
+  g_object_unref (file);
+}
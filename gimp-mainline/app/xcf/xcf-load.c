@@ -33,8 +33,11 @@
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-tile-compat.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpasync.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpdrawable-private.h" /* eek */
 #include "core/gimpgrid.h"
@@ -57,6 +60,7 @@
 #include "core/gimpselection.h"
 #include "core/gimpsymmetry.h"
 #include "core/gimptemplate.h"
+#include "core/gimpwaitable.h"
 
 #include "operations/layer-modes/gimp-layer-modes.h"
 
@@ -73,7 +77,10 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-seek.h"
+#include "xcf-tile-backend.h"
+#include "xcf-tile-index.h"
 #include "xcf-utils.h"
+#include "xcf-zstd.h"
 
 #include "gimp-log.h"
 #include "gimp-intl.h"
@@ -83,6 +90,28 @@
 
 /* #define GIMP_XCF_PATH_DEBUG */
 
+/* the number of tiles decoded together on worker threads, while the
+ * next batch is being read
+ */
+#define XCF_LOAD_BATCH_SIZE 64
+
+/* more levels than any drawable within GIMP_MAX_IMAGE_SIZE can have */
+#define XCF_MAX_LEVELS 32
+
+
+typedef struct
+{
+  XcfInfo    *info;
+  GeglBuffer *buffer;
+  const Babl *format;
+  gint        first_tile;
+  gint        n_tiles;
+  guchar     *data;     /* the on-disk data of the tiles            */
+  gsize      *offsets;  /* the offset of each tile's data in 'data' */
+  gint       *lengths;  /* the length of each tile's data           */
+  gint        failed;   /* set when decoding a tile fails           */
+} XcfLoadBatch;
+
 
 static void            xcf_load_add_masks     (GimpImage     *image);
 static gboolean        xcf_load_image_props   (XcfInfo       *info,
@@ -114,23 +143,69 @@ static GimpChannel   * xcf_load_channel       (XcfInfo       *info,
 static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
                                                GimpImage     *image);
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
+                                               GimpDrawable  *drawable);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
-static gboolean        xcf_load_tile          (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format);
-static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
                                                GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
-static gboolean        xcf_load_tile_zlib     (XcfInfo       *info,
+                                               goffset        level_end,
+                                               GeglTileBackend **lazy_backend,
+                                               XcfTileIndex **index);
+static gboolean        xcf_load_reduced_level (XcfInfo       *info,
                                                GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
+                                               gint           level,
+                                               goffset        level_end,
+                                               GeglTileBackend *lazy_backend,
+                                               XcfTileIndex  *index);
+static gboolean        xcf_load_tile_offsets  (XcfInfo       *info,
+                                               gint           ntiles,
+                                               goffset        offset,
+                                               goffset        max_data_length,
+                                               goffset        level_end,
+                                               goffset      **offset_table,
+                                               gint         **lengths);
+static GeglBuffer    * xcf_load_lazy_buffer_new
+                                              (XcfTileBackend      *backend);
+static GeglBuffer    * xcf_load_lazy_buffer_dup
+                                              (GeglBuffer          *buffer,
+                                               XcfTileBackend      *backend);
+static void            xcf_load_lazy_buffer_changed
+                                              (GeglBuffer          *buffer,
+                                               const GeglRectangle *rect,
+                                               XcfTileBackend      *backend);
+static gboolean        xcf_load_batch_read    (XcfInfo       *info,
+                                               XcfLoadBatch  *batch,
+                                               const goffset *offset_table,
+                                               const gint    *lengths);
+static void            xcf_load_batch_decode_range
+                                              (gsize          offset,
+                                               gsize          size,
+                                               XcfLoadBatch  *batch);
+static void            xcf_load_batch_decode  (GimpAsync     *async,
+                                               XcfLoadBatch  *batch);
+static gboolean        xcf_load_tile          (const Babl    *format,
+                                               gint           n_pixels,
+                                               guchar        *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gboolean      *empty);
+static gboolean        xcf_load_tile_rle      (const Babl    *format,
+                                               gint           n_pixels,
+                                               guchar        *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gboolean      *empty);
+static gboolean        xcf_load_tile_zlib     (const Babl    *format,
+                                               gint           n_pixels,
+                                               guchar        *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gboolean      *empty);
+static gboolean        xcf_load_tile_zstd     (XcfZstdDict   *zstd_dict,
                                                const Babl    *format,
-                                               gint           data_length);
+                                               gint           n_pixels,
+                                               guchar        *xcfdata,
+                                               gint           data_length,
+                                               guchar        *tile_data,
+                                               gboolean      *empty);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -721,6 +796,61 @@ xcf_load_image (Gimp     *gimp,
   return NULL;
 }
 
+/* decodes the 'data_length' bytes of on-disk data of a tile of 'n_pixels'
+ * pixels into 'tile_data', using 'zstd_dict' for zstd compressed tiles.
+ * sets 'empty' to TRUE if the tile contains only zeros, in which case
+ * 'tile_data' doesn't need to be stored.  doesn't touch the file, so it
+ * can be called from any thread.
+ */
+gboolean
+xcf_load_tile_data (XcfCompressionType  compression,
+                    XcfZstdDict        *zstd_dict,
+                    gint                file_version,
+                    const Babl         *format,
+                    gint                n_pixels,
+                    guchar             *xcfdata,
+                    gint                data_length,
+                    guchar             *tile_data,
+                    gboolean           *empty)
+{
+  gboolean success = FALSE;
+
+  *empty = TRUE;
+
+  switch (compression)
+    {
+    case COMPRESS_NONE:
+      success = xcf_load_tile (format, n_pixels,
+                               xcfdata, data_length, tile_data, empty);
+      break;
+    case COMPRESS_RLE:
+      success = xcf_load_tile_rle (format, n_pixels,
+                                   xcfdata, data_length, tile_data, empty);
+      break;
+    case COMPRESS_ZLIB:
+      success = xcf_load_tile_zlib (format, n_pixels,
+                                    xcfdata, data_length, tile_data, empty);
+      break;
+    case COMPRESS_ZSTD:
+      success = xcf_load_tile_zstd (zstd_dict, format, n_pixels,
+                                    xcfdata, data_length, tile_data, empty);
+      break;
+    default:
+      break;
+    }
+
+  if (success && ! *empty && file_version >= 12)
+    {
+      gint bpp          = babl_format_get_bytes_per_pixel (format);
+      gint n_components = babl_format_get_n_components (format);
+
+      xcf_read_from_be (bpp / n_components, tile_data,
+                        n_pixels * n_components);
+    }
+
+  return success;
+}
+
 static void
 xcf_load_add_masks (GimpImage *image)
 {
@@ -843,7 +973,8 @@ xcf_load_image_props (XcfInfo   *info,
             if ((compression != COMPRESS_NONE) &&
                 (compression != COMPRESS_RLE) &&
                 (compression != COMPRESS_ZLIB) &&
-                (compression != COMPRESS_FRACTAL))
+                (compression != COMPRESS_FRACTAL) &&
+                (compression != COMPRESS_ZSTD))
               {
                 gimp_message (info->gimp, G_OBJECT (info->progress),
                               GIMP_MESSAGE_ERROR,
@@ -861,6 +992,49 @@ xcf_load_image_props (XcfInfo   *info,
           }
           break;
 
+        case PROP_ZSTD_DICTIONARY:
+          {
+            XcfZstdDict *dict;
+            guint8      *data;
+
+            if (prop_size > XCF_ZSTD_MAX_DICT_SIZE)
+              {
+                gimp_message (info->gimp, G_OBJECT (info->progress),
+                              GIMP_MESSAGE_ERROR,
+                              "Invalid zstd dictionary size: %u",
+                              prop_size);
+                return FALSE;
+              }
+
+            data = g_malloc (prop_size);
+
+            xcf_read_int8 (info, data, prop_size);
+
+            dict = xcf_zstd_dict_new (data, prop_size);
+
+            g_free (data);
+
+            if (! dict)
+              {
+                gimp_message_literal (info->gimp, G_OBJECT (info->progress),
+                                      GIMP_MESSAGE_ERROR,
+                                      "Invalid zstd dictionary in XCF file");
+                return FALSE;
+              }
+
+            /* keep the dictionary with the image, so saving it again
+             * can copy the tiles compressed with it
+             */
+            xcf_zstd_dict_attach (dict, image);
+
+            g_clear_pointer (&info->zstd_dict, xcf_zstd_dict_unref);
+            info->zstd_dict = dict;
+
+            GIMP_LOG (XCF, "prop zstd dictionary size=%u id=%u",
+                      prop_size, xcf_zstd_dict_get_id (dict));
+          }
+          break;
+
         case PROP_GUIDES:
           {
             GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
@@ -2021,8 +2195,7 @@ xcf_load_layer (XcfInfo    *info,
 
       GIMP_LOG (XCF, "loading buffer");
 
-      if (! xcf_load_buffer (info,
-                             gimp_drawable_get_buffer (GIMP_DRAWABLE (layer))))
+      if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer)))
         goto error;
 
       GIMP_LOG (XCF, "buffer loaded");
@@ -2127,8 +2300,7 @@ xcf_load_channel (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (channel))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (channel)))
     goto error;
 
   xcf_progress_update (info);
@@ -2200,8 +2372,7 @@ xcf_load_layer_mask (XcfInfo   *info,
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (! xcf_load_buffer (info,
-                         gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask))))
+  if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer_mask)))
     goto error;
 
   xcf_progress_update (info);
@@ -2225,14 +2396,19 @@ xcf_load_layer_mask (XcfInfo   *info,
 }
 
 static gboolean
-xcf_load_buffer (XcfInfo    *info,
-                 GeglBuffer *buffer)
+xcf_load_buffer (XcfInfo      *info,
+                 GimpDrawable *drawable)
 {
-  const Babl *format;
-  goffset     offset;
-  gint        width;
-  gint        height;
-  gint        bpp;
+  GeglBuffer      *buffer       = gimp_drawable_get_buffer (drawable);
+  GeglTileBackend *lazy_backend = NULL;
+  XcfTileIndex    *index        = NULL;
+  const Babl      *format;
+  goffset          level_offsets[XCF_MAX_LEVELS + 1] = { 0, };
+  gint             n_levels;
+  gint             width;
+  gint             height;
+  gint             bpp;
+  gint             i;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -2248,40 +2424,100 @@ xcf_load_buffer (XcfInfo    *info,
       bpp    != babl_format_get_bytes_per_pixel (format))
     return FALSE;
 
-  xcf_read_offset (info, &offset, 1); /* top level */
+  /* read the level offsets, up to the terminating '0'.  each level is
+   * stored right after the previous one's tiles, which tells us where
+   * the previous level's last tile ends.
+   */
+  for (n_levels = 0; n_levels < XCF_MAX_LEVELS; n_levels++)
+    {
+      xcf_read_offset (info, &level_offsets[n_levels], 1);
+
+      if (level_offsets[n_levels] == 0)
+        break;
+    }
+
+  level_offsets[n_levels] = 0;
 
   /* seek to the level offset */
-  if (! xcf_seek_pos (info, offset, NULL))
+  if (! xcf_seek_pos (info, level_offsets[0], NULL))
     return FALSE;
 
   /* read in the level */
-  if (! xcf_load_level (info, buffer))
+  if (! xcf_load_level (info, buffer, level_offsets[1],
+                        &lazy_backend, &index))
     return FALSE;
 
-  /* discard levels below first.
+  /* version 15 files also store the reduced-resolution levels, which
+   * the lazy tile backend serves when zooming out, and which saving can
+   * copy as long as the drawable doesn't change.  they are optional,
+   * stop at the first one we can't use.
    */
+  if (info->file_version >= 15 && (lazy_backend || index))
+    {
+      for (i = 1; i < n_levels; i++)
+        {
+          if (! xcf_seek_pos (info, level_offsets[i], NULL) ||
+              ! xcf_load_reduced_level (info, buffer, i, level_offsets[i + 1],
+                                        lazy_backend, index))
+            break;
+        }
+    }
+
+  /* a lazily loaded level comes with its own buffer, reading the
+   * tiles from the file on demand
+   */
+  if (lazy_backend)
+    {
+      GeglBuffer *lazy_buffer;
+
+      lazy_buffer = xcf_load_lazy_buffer_new (XCF_TILE_BACKEND (lazy_backend));
+
+      gimp_drawable_set_buffer_full (drawable, FALSE, NULL,
+                                     lazy_buffer, NULL, FALSE);
+      g_object_unref (lazy_buffer);
+      g_object_unref (lazy_backend);
+    }
+
+  /* remember where the tiles are, so saving the image again can copy
+   * them as long as the drawable stays unchanged
+   */
+  if (index)
+    {
+      if (! xcf_tile_index_update_file (index) ||
+          ! xcf_tile_index_attach (index, drawable))
+        {
+          xcf_tile_index_free (index);
+        }
+    }
 
   return TRUE;
 }
 
 
 static gboolean
-xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+xcf_load_level (XcfInfo          *info,
+                GeglBuffer       *buffer,
+                goffset           level_end,
+                GeglTileBackend **lazy_backend,
+                XcfTileIndex    **index)
 {
-  const Babl *format;
-  gint        bpp;
-  goffset     saved_pos;
-  goffset     offset;
-  goffset     offset2;
-  goffset     max_data_length;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        width;
-  gint        height;
-  gint        i;
-  gint        fail;
+  const Babl   *format;
+  gint          bpp;
+  goffset       offset;
+  goffset      *offset_table;
+  gint         *lengths;
+  goffset       max_data_length;
+  gint          n_tile_rows;
+  gint          n_tile_cols;
+  guint         ntiles;
+  gint          width;
+  gint          height;
+  XcfLoadBatch  batches[2];
+  XcfLoadBatch *pending = NULL;
+  GimpAsync    *async   = NULL;
+  gint          first_tile;
+  gint          i;
+  gboolean      success = TRUE;
 
   format = gegl_buffer_get_format (buffer);
   bpp    = babl_format_get_bytes_per_pixel (format);
@@ -2308,161 +2544,519 @@ xcf_load_level (XcfInfo    *info,
   if (offset == 0)
     return TRUE;
 
+  switch (info->compression)
+    {
+    case COMPRESS_NONE:
+    case COMPRESS_RLE:
+    case COMPRESS_ZLIB:
+    case COMPRESS_ZSTD:
+      break;
+    case COMPRESS_FRACTAL:
+      g_printerr ("xcf: fractal compression unimplemented. "
+                  "Possibly corrupt XCF file.");
+      return FALSE;
+    default:
+      g_printerr ("xcf: unknown compression. "
+                  "Possibly corrupt XCF file.");
+      return FALSE;
+    }
+
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
+
+  if (! xcf_load_tile_offsets (info, ntiles, offset, max_data_length,
+                               level_end, &offset_table, &lengths))
+    return FALSE;
+
+  /* when loading lazily, we're done as soon as we know where the tiles
+   * are.  they are decoded from the mapped file on first access.
+   */
+  if (info->mapped_file)
+    {
+      *lazy_backend = xcf_tile_backend_new (info->gimp,
+                                            info->file,
+                                            info->mapped_file,
+                                            info->compression,
+                                            info->zstd_dict,
+                                            info->file_version,
+                                            format, width, height,
+                                            offset_table, lengths);
+
+      *index = xcf_tile_index_new (info, buffer, offset_table, lengths);
+
+      g_free (offset_table);
+      g_free (lengths);
+
+      return TRUE;
+    }
+
+  /* the tile data is read in batches on this thread, while the previous
+   * batch is being decoded on worker threads.
+   */
+  for (i = 0; i < 2; i++)
+    {
+      gint n_tiles = MIN (ntiles, XCF_LOAD_BATCH_SIZE);
+
+      batches[i].info       = info;
+      batches[i].buffer     = buffer;
+      batches[i].format     = format;
+      batches[i].first_tile = 0;
+      batches[i].n_tiles    = 0;
+      batches[i].data       = g_malloc (n_tiles * max_data_length);
+      batches[i].offsets    = g_new (gsize, n_tiles);
+      batches[i].lengths    = g_new (gint, n_tiles);
+      batches[i].failed     = FALSE;
+    }
+
+  for (first_tile = 0, i = 0;
+       first_tile < ntiles;
+       first_tile += batches[i].n_tiles, i = ! i)
+    {
+      XcfLoadBatch *batch = &batches[i];
+
+      batch->first_tile = first_tile;
+      batch->n_tiles    = MIN (ntiles - first_tile, XCF_LOAD_BATCH_SIZE);
+      batch->failed     = FALSE;
+
+      GIMP_LOG (XCF, "loading tiles %d-%d/%d",
+                first_tile + 1, first_tile + batch->n_tiles, ntiles);
+
+      if (! xcf_load_batch_read (info, batch, offset_table, lengths))
+        {
+          success = FALSE;
+          break;
+        }
+
+      if (async)
+        {
+          gimp_waitable_wait (GIMP_WAITABLE (async));
+          g_clear_object (&async);
+
+          if (pending->failed)
+            {
+              success = FALSE;
+              break;
+            }
+        }
+
+      async = gimp_parallel_run_async_full (
+        +1,
+        (GimpRunAsyncFunc) xcf_load_batch_decode,
+        batch,
+        NULL);
+      pending = batch;
+    }
+
+  /* don't free the batches while a worker is still decoding them */
+  if (async)
+    {
+      gimp_waitable_wait (GIMP_WAITABLE (async));
+      g_clear_object (&async);
+
+      if (pending->failed)
+        success = FALSE;
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      g_free (batches[i].data);
+      g_free (batches[i].offsets);
+      g_free (batches[i].lengths);
+    }
+
+  if (success)
+    *index = xcf_tile_index_new (info, buffer, offset_table, lengths);
+
+  g_free (offset_table);
+  g_free (lengths);
+
+  return success;
+}
+
+/* reads the tile offsets of the reduced-resolution 'level', and adds
+ * them to 'lazy_backend' and 'index'.  the tiles themselves are only
+ * read on demand.
+ */
+static gboolean
+xcf_load_reduced_level (XcfInfo         *info,
+                        GeglBuffer      *buffer,
+                        gint             level,
+                        goffset          level_end,
+                        GeglTileBackend *lazy_backend,
+                        XcfTileIndex    *index)
+{
+  const Babl *format = gegl_buffer_get_format (buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  goffset     offset;
+  goffset    *offset_table;
+  gint       *lengths;
+  goffset     max_data_length;
+  guint       ntiles;
+  gint        width;
+  gint        height;
+
+  xcf_read_int32 (info, (guint32 *) &width,  1);
+  xcf_read_int32 (info, (guint32 *) &height, 1);
+
+  if (width  != xcf_get_level_size (gegl_buffer_get_width (buffer),  level) ||
+      height != xcf_get_level_size (gegl_buffer_get_height (buffer), level))
+    return FALSE;
+
+  max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
+                    XCF_TILE_MAX_DATA_LENGTH_FACTOR;
+
+  xcf_read_offset (info, &offset, 1);
+  if (offset == 0)
+    return FALSE;
+
+  ntiles = ((height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT) *
+           ((width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH);
+
+  if (! xcf_load_tile_offsets (info, ntiles, offset, max_data_length,
+                               level_end, &offset_table, &lengths))
+    return FALSE;
+
+  if (lazy_backend)
+    {
+      xcf_tile_backend_add_level (XCF_TILE_BACKEND (lazy_backend),
+                                  width, height, offset_table, lengths);
+    }
+
+  if (index)
+    xcf_tile_index_add_level (index, ntiles, offset_table, lengths);
+
+  g_free (offset_table);
+  g_free (lengths);
+
+  return TRUE;
+}
+
+/* reads the rest of a level's tile offset table, whose first entry is
+ * 'offset', and works out the length of each tile's data.  the offset
+ * of the last tile is followed by a '0'.
+ */
+static gboolean
+xcf_load_tile_offsets (XcfInfo  *info,
+                       gint      ntiles,
+                       goffset   offset,
+                       goffset   max_data_length,
+                       goffset   level_end,
+                       goffset **offset_table,
+                       gint    **lengths)
+{
+  goffset  *offsets;
+  gint     *lens;
+  gint      i;
+  gboolean  success = TRUE;
+
+  /* read in the whole table up front, so we know where all the tiles
+   * are before reading any of them
+   */
+  offsets = g_new0 (goffset, ntiles + 1);
+  offsets[0] = offset;
+
+  for (i = 1; i <= ntiles; i += XCF_LOAD_BATCH_SIZE)
+    {
+      gint n = MIN (ntiles + 1 - i, XCF_LOAD_BATCH_SIZE);
+
+      if (xcf_read_offset (info, &offsets[i], n) !=
+          n * info->bytes_per_offset)
+        {
+          memset (&offsets[i], 0, n * sizeof (goffset));
+          break;
+        }
+    }
+
+  lens = g_new (gint, ntiles);
+
   for (i = 0; i < ntiles; i++)
     {
-      GeglRectangle rect;
+      goffset offset2;
 
-      fail = FALSE;
+      offset  = offsets[i];
+      offset2 = offsets[i + 1];
 
       if (offset == 0)
         {
           gimp_message_literal (info->gimp, G_OBJECT (info->progress),
                                 GIMP_MESSAGE_ERROR,
                                 "not enough tiles found in level");
-          return FALSE;
+          success = FALSE;
+          break;
         }
 
-      /* save the current position as it is where the
-       *  next tile offset is stored.
-       */
-      saved_pos = info->cp;
-
-      /* read in the offset of the next tile so we can calculate the amount
-       * of data needed for this tile
-       */
-      xcf_read_offset (info, &offset2, 1);
-
       /* if the offset is 0 then we need to read in the maximum possible
        * allowing for negative compression
        */
       if (offset2 == 0)
         offset2 = offset + max_data_length;
 
-      /* seek to the tile offset */
-      if (! xcf_seek_pos (info, offset, NULL))
-        return FALSE;
-
       if (offset2 < offset || offset2 - offset > max_data_length)
         {
           gimp_message (info->gimp, G_OBJECT (info->progress),
                         GIMP_MESSAGE_ERROR,
                         "invalid tile data length: %" G_GOFFSET_FORMAT,
                         offset2 - offset);
-          return FALSE;
-        }
-
-      /* get buffer rectangle to write to */
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
-
-      GIMP_LOG (XCF, "loading tile %d/%d", i + 1, ntiles);
-
-      /* read in the tile */
-      switch (info->compression)
-        {
-        case COMPRESS_NONE:
-          if (! xcf_load_tile (info, buffer, &rect, format))
-            fail = TRUE;
-          break;
-        case COMPRESS_RLE:
-          if (! xcf_load_tile_rle (info, buffer, &rect, format,
-                                   offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_ZLIB:
-          if (! xcf_load_tile_zlib (info, buffer, &rect, format,
-                                    offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_FRACTAL:
-          g_printerr ("xcf: fractal compression unimplemented. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
-          break;
-        default:
-          g_printerr ("xcf: unknown compression. "
-                      "Possibly corrupt XCF file.");
-          fail = TRUE;
+          success = FALSE;
           break;
         }
 
-      if (fail)
-        return FALSE;
-
-      GIMP_LOG (XCF, "loaded tile %d/%d", i + 1, ntiles);
-
-      /* restore the saved position so we'll be ready to
-       *  read the next offset.
-       */
-      if (!xcf_seek_pos (info, saved_pos, NULL))
-        return FALSE;
+      lens[i] = offset2 - offset;
+    }
 
-      /* read in the offset of the next tile */
-      xcf_read_offset (info, &offset, 1);
+  /* we don't know the length of the last tile, but if the level is
+   * followed by another one, it can't extend past it
+   */
+  if (success                            &&
+      level_end > offsets[ntiles - 1]    &&
+      level_end - offsets[ntiles - 1] < lens[ntiles - 1])
+    {
+      lens[ntiles - 1] = level_end - offsets[ntiles - 1];
     }
 
-  if (offset != 0)
+  if (success && offsets[ntiles] != 0)
     {
       gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
                     "encountered garbage after reading level: %" G_GOFFSET_FORMAT,
-                    offset);
+                    offsets[ntiles]);
+      success = FALSE;
+    }
+
+  if (! success)
+    {
+      g_free (offsets);
+      g_free (lens);
+
       return FALSE;
     }
 
+  *offset_table = offsets;
+  *lengths      = lens;
+
   return TRUE;
 }
 
-static gboolean
-xcf_load_tile (XcfInfo       *info,
-               GeglBuffer    *buffer,
-               GeglRectangle *tile_rect,
-               const Babl    *format)
+static GeglBuffer *
+xcf_load_lazy_buffer_new (XcfTileBackend *backend)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
+  GeglBuffer *buffer;
+
+  buffer = gegl_buffer_new_for_backend (NULL, GEGL_TILE_BACKEND (backend));
 
-  if (info->file_version <= 11)
+  if (backend->n_levels > 1)
     {
-      xcf_read_int8 (info, tile_data, tile_size);
+      gegl_buffer_signal_connect (buffer, "changed",
+                                  G_CALLBACK (xcf_load_lazy_buffer_changed),
+                                  backend);
     }
-  else
+
+  gimp_gegl_buffer_set_dup_func (buffer,
+                                 (GimpGeglBufferDupFunc) xcf_load_lazy_buffer_dup,
+                                 backend);
+
+  return buffer;
+}
+
+/* duplicating a lazily loaded drawable, like when snapshotting the
+ * image for saving, shouldn't decode all of its tiles.  the duplicate
+ * reads the same file instead.
+ */
+static GeglBuffer *
+xcf_load_lazy_buffer_dup (GeglBuffer     *buffer,
+                          XcfTileBackend *backend)
+{
+  GeglTileBackend *new_backend;
+  GeglBuffer      *new_buffer;
+
+  /* the tiles only line up with the file while the buffer keeps the
+   * extent it was loaded with
+   */
+  if (! gegl_rectangle_equal (gegl_buffer_get_extent (buffer),
+                              GEGL_RECTANGLE (0, 0,
+                                              backend->levels[0].width,
+                                              backend->levels[0].height)))
     {
-      gint n_components = babl_format_get_n_components (format);
+      return NULL;
+    }
+
+  /* store the modified tiles still in the buffer's cache in the
+   * backend, so the duplicate gets them too
+   */
+  gegl_buffer_flush (buffer);
+
+  new_backend = xcf_tile_backend_dup (backend);
+  new_buffer  = xcf_load_lazy_buffer_new (XCF_TILE_BACKEND (new_backend));
+
+  g_object_unref (new_backend);
+
+  return new_buffer;
+}
+
+/* the reduced-resolution levels stored in the file no longer match the
+ * parts of a lazily loaded drawable that change
+ */
+static void
+xcf_load_lazy_buffer_changed (GeglBuffer          *buffer,
+                              const GeglRectangle *rect,
+                              XcfTileBackend      *backend)
+{
+  xcf_tile_backend_invalidate (backend, rect);
+}
+
+/* reads the on-disk data of the tiles of 'batch'.  tiles stored back to
+ * back, which is how xcf_save_level() writes them, are read in a single
+ * go.
+ */
+static gboolean
+xcf_load_batch_read (XcfInfo       *info,
+                     XcfLoadBatch  *batch,
+                     const goffset *offset_table,
+                     const gint    *lengths)
+{
+  gsize pos = 0;
+  gint  i   = 0;
 
-      xcf_read_component (info, bpp / n_components, tile_data,
-                          tile_size / bpp * n_components);
+  while (i < batch->n_tiles)
+    {
+      goffset start = offset_table[batch->first_tile + i];
+      goffset end   = start;
+      gsize   bytes_read;
+      gint    j;
+
+      for (j = i;
+           j < batch->n_tiles && offset_table[batch->first_tile + j] == end;
+           j++)
+        {
+          end += lengths[batch->first_tile + j];
+        }
+
+      if (! xcf_seek_pos (info, start, NULL))
+        return FALSE;
+
+      /* we have to read directly instead of xcf_read_* because we may be
+       * reading past the end of the file here
+       */
+      g_input_stream_read_all (info->input, batch->data + pos, end - start,
+                               &bytes_read, NULL, NULL);
+      info->cp += bytes_read;
+
+      for (; i < j; i++)
+        {
+          goffset tile_start = offset_table[batch->first_tile + i] - start;
+
+          batch->offsets[i] = pos + tile_start;
+
+          if ((goffset) bytes_read > tile_start)
+            {
+              batch->lengths[i] = MIN (lengths[batch->first_tile + i],
+                                       bytes_read - tile_start);
+            }
+          else
+            {
+              batch->lengths[i] = 0;
+            }
+        }
+
+      pos += end - start;
     }
 
-  if (! xcf_data_is_zero (tile_data, tile_size))
+  return TRUE;
+}
+
+static void
+xcf_load_batch_decode_range (gsize         offset,
+                             gsize         size,
+                             XcfLoadBatch *batch)
+{
+  gint    bpp = babl_format_get_bytes_per_pixel (batch->format);
+  guchar *tile_data;
+  gsize   i;
+
+  /* scratch space for the decoded tile pixels */
+  tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+  for (i = offset; i < offset + size; i++)
     {
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+      GeglRectangle  rect;
+      guchar        *xcfdata     = batch->data + batch->offsets[i];
+      gint           data_length = batch->lengths[i];
+      gboolean       empty;
+      gboolean       success;
+
+      gimp_gegl_buffer_get_tile_rect (batch->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      batch->first_tile + i, &rect);
+
+      success = xcf_load_tile_data (batch->info->compression,
+                                    batch->info->zstd_dict,
+                                    batch->info->file_version,
+                                    batch->format,
+                                    rect.width * rect.height,
+                                    xcfdata, data_length,
+                                    tile_data, &empty);
+
+      if (! success)
+        {
+          g_atomic_int_set (&batch->failed, TRUE);
+          break;
+        }
+
+      if (! empty)
+        {
+          gegl_buffer_set (batch->buffer, &rect, 0, batch->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
     }
 
+  g_free (tile_data);
+}
+
+static void
+xcf_load_batch_decode (GimpAsync    *async,
+                       XcfLoadBatch *batch)
+{
+  gegl_parallel_distribute_range (
+    batch->n_tiles, 1,
+    (GeglParallelDistributeRangeFunc) xcf_load_batch_decode_range,
+    batch);
+
+  gimp_async_finish (async, NULL);
+}
+
+static gboolean
+xcf_load_tile (const Babl *format,
+               gint        n_pixels,
+               guchar     *xcfdata,
+               gint        data_length,
+               guchar     *tile_data,
+               gboolean   *empty)
+{
+  gint tile_size = babl_format_get_bytes_per_pixel (format) * n_pixels;
+
+  /* a truncated tile is zero-filled */
+  data_length = CLAMP (data_length, 0, tile_size);
+
+  memcpy (tile_data, xcfdata, data_length);
+  memset (tile_data + data_length, 0, tile_size - data_length);
+
+  *empty = xcf_data_is_zero (tile_data, tile_size);
+
   return TRUE;
 }
 
 static gboolean
-xcf_load_tile_rle (XcfInfo       *info,
-                   GeglBuffer    *buffer,
-                   GeglRectangle *tile_rect,
-                   const Babl    *format,
-                   gint           data_length)
+xcf_load_tile_rle (const Babl *format,
+                   gint        n_pixels,
+                   guchar     *xcfdata,
+                   gint        data_length,
+                   guchar     *tile_data,
+                   gboolean   *empty)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  guchar  nonzero   = FALSE;
-  gsize   bytes_read;
+  gint    bpp     = babl_format_get_bytes_per_pixel (format);
+  guchar  nonzero = FALSE;
   gint    i;
-  guchar *xcfdata;
-  guchar *xcfodata;
   guchar *xcfdatalimit;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
@@ -2474,24 +3068,12 @@ xcf_load_tile_rle (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = xcfodata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
-
-  xcfdatalimit = &xcfodata[bytes_read - 1];
+  xcfdatalimit = &xcfdata[data_length - 1];
 
   for (i = 0; i < bpp; i++)
     {
       guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
+      gint    size  = n_pixels;
       gint    count = 0;
       guchar  val;
       gint    length;
@@ -2580,19 +3162,7 @@ xcf_load_tile_rle (XcfInfo       *info,
         }
     }
 
-  if (nonzero)
-    {
-      if (info->file_version >= 12)
-        {
-          gint n_components = babl_format_get_n_components (format);
-
-          xcf_read_from_be (bpp / n_components, tile_data,
-                            tile_size / bpp * n_components);
-        }
-
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
-    }
+  *empty = ! nonzero;
 
   return TRUE;
 
@@ -2601,20 +3171,17 @@ xcf_load_tile_rle (XcfInfo       *info,
 }
 
 static gboolean
-xcf_load_tile_zlib (XcfInfo       *info,
-                    GeglBuffer    *buffer,
-                    GeglRectangle *tile_rect,
-                    const Babl    *format,
-                    gint           data_length)
+xcf_load_tile_zlib (const Babl *format,
+                    gint        n_pixels,
+                    guchar     *xcfdata,
+                    gint        data_length,
+                    guchar     *tile_data,
+                    gboolean   *empty)
 {
   z_stream  strm;
   int       action;
   int       status;
-  gint      bpp       = babl_format_get_bytes_per_pixel (format);
-  gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  gsize     bytes_read;
-  guchar   *xcfdata;
+  gint      tile_size = babl_format_get_bytes_per_pixel (format) * n_pixels;
 
   /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
    * this tile (return TRUE without storing data) as if it did not
@@ -2625,18 +3192,6 @@ xcf_load_tile_zlib (XcfInfo       *info,
   if (data_length <= 0)
     return TRUE;
 
-  xcfdata = g_alloca (data_length);
-
-  /* we have to read directly instead of xcf_read_* because we may be
-   * reading past the end of the file here
-   */
-  g_input_stream_read_all (info->input, xcfdata, data_length,
-                           &bytes_read, NULL, NULL);
-  info->cp += bytes_read;
-
-  if (bytes_read == 0)
-    return TRUE;
-
   strm.next_out  = tile_data;
   strm.avail_out = tile_size;
 
@@ -2644,7 +3199,7 @@ xcf_load_tile_zlib (XcfInfo       *info,
   strm.zfree     = Z_NULL;
   strm.opaque    = Z_NULL;
   strm.next_in   = xcfdata;
-  strm.avail_in  = bytes_read;
+  strm.avail_in  = data_length;
 
   /* Initialize the stream decompression. */
   status = inflateInit (&strm);
@@ -2681,21 +3236,36 @@ xcf_load_tile_zlib (XcfInfo       *info,
         }
     }
 
-  if (! xcf_data_is_zero (tile_data, tile_size))
-    {
-      if (info->file_version >= 12)
-        {
-          gint n_components = babl_format_get_n_components (format);
+  *empty = xcf_data_is_zero (tile_data, tile_size);
 
-          xcf_read_from_be (bpp / n_components, tile_data,
-                            tile_size / bpp * n_components);
-        }
+  inflateEnd (&strm);
+
+  return TRUE;
+}
+
+static gboolean
+xcf_load_tile_zstd (XcfZstdDict *zstd_dict,
+                    const Babl  *format,
+                    gint         n_pixels,
+                    guchar      *xcfdata,
+                    gint         data_length,
+                    guchar      *tile_data,
+                    gboolean    *empty)
+{
+  gint tile_size = babl_format_get_bytes_per_pixel (format) * n_pixels;
+
+  /* skip tiles without data, as xcf_load_tile_zlib() does */
+  if (data_length <= 0)
+    return TRUE;
 
-      gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                       GEGL_AUTO_ROWSTRIDE);
+  if (! xcf_zstd_decompress (zstd_dict, xcfdata, data_length,
+                             tile_data, tile_size))
+    {
+      g_printerr ("xcf: zstd tile decompression failed.");
+      return FALSE;
     }
 
-  inflateEnd (&strm);
+  *empty = xcf_data_is_zero (tile_data, tile_size);
 
   return TRUE;
 }
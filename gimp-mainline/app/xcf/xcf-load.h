@@ -19,9 +19,19 @@
 #define __XCF_LOAD_H__
 
 
-GimpImage * xcf_load_image (Gimp     *gimp,
-                            XcfInfo  *info,
-                            GError  **error);
+GimpImage * xcf_load_image     (Gimp                *gimp,
+                                XcfInfo             *info,
+                                GError             **error);
+
+gboolean    xcf_load_tile_data (XcfCompressionType   compression,
+                                XcfZstdDict         *zstd_dict,
+                                gint                 file_version,
+                                const Babl          *format,
+                                gint                 n_pixels,
+                                guchar              *xcfdata,
+                                gint                 data_length,
+                                guchar              *tile_data,
+                                gboolean            *empty);
 
 
 #endif  /* __XCF_LOAD_H__ */
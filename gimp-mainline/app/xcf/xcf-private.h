@@ -65,14 +65,16 @@ typedef enum
   PROP_BLEND_SPACE        = 37,
   PROP_FLOAT_COLOR        = 38,
   PROP_SAMPLE_POINTS      = 39,
+  PROP_ZSTD_DICTIONARY    = 40,
 } PropType;
 
 typedef enum
 {
   COMPRESS_NONE              =  0,
   COMPRESS_RLE               =  1,
-  COMPRESS_ZLIB              =  2,  /* unused */
-  COMPRESS_FRACTAL           =  3   /* unused */
+  COMPRESS_ZLIB              =  2,
+  COMPRESS_FRACTAL           =  3,  /* unused */
+  COMPRESS_ZSTD              =  4
 } XcfCompressionType;
 
 typedef enum
@@ -92,12 +94,14 @@ typedef enum
   XCF_GROUP_ITEM_EXPANDED      = 1
 } XcfGroupItemFlagsType;
 
-typedef struct _XcfInfo  XcfInfo;
+typedef struct _XcfInfo      XcfInfo;
+typedef struct _XcfZstdDict  XcfZstdDict;
 
 struct _XcfInfo
 {
   Gimp               *gimp;
   GimpProgress       *progress;
+  gint                progress_value; /* per mille, polled by async saves */
   GInputStream       *input;
   GOutputStream      *output;
   GSeekable          *seekable;
@@ -111,7 +115,13 @@ struct _XcfInfo
   GimpLayer          *floating_sel;
   goffset             floating_sel_offset;
   XcfCompressionType  compression;
+  XcfZstdDict        *zstd_dict;     /* the dictionary of zstd tiles      */
+  gint                zstd_level;
   gint                file_version;
+  GMappedFile        *mapped_file;  /* set when loading pixels lazily  */
+  GFile              *tile_source_file;
+  GInputStream       *tile_source;  /* the file tiles are copied from   */
+  GList              *saved_tile_indices;
 };
 
 
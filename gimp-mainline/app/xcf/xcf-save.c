@@ -29,10 +29,14 @@
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "gegl/gimp-babl-compat.h"
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpasync.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
@@ -68,11 +72,40 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 #include "xcf-seek.h"
+#include "xcf-tile-index.h"
+#include "xcf-utils.h"
 #include "xcf-write.h"
+#include "xcf-zstd.h"
 
 #include "gimp-intl.h"
 
 
+/* the number of tiles encoded together on worker threads, while the
+ * previous batch is being written
+ */
+#define XCF_SAVE_BATCH_SIZE 64
+
+/* the number of tiles a zstd dictionary is trained on */
+#define XCF_SAVE_DICT_SAMPLES 64
+
+
+typedef struct
+{
+  XcfInfo    *info;
+  GeglBuffer *buffer;
+  const Babl *format;
+  gint        max_data_length;
+  gint        first_tile;
+  gint        n_tiles;
+  guchar     *data;   /* 'n_tiles' slots of 'max_data_length' bytes  */
+  gint       *sizes;  /* the encoded size of each tile, or -1         */
+} XcfSaveBatch;
+
+
+static XcfZstdDict * xcf_save_get_zstd_dict
+                                       (XcfInfo           *info,
+                                        GimpImage         *image,
+                                        GList             *drawables);
 static gboolean xcf_save_image_props   (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
@@ -98,27 +131,74 @@ static gboolean xcf_save_channel       (XcfInfo           *info,
                                         GimpChannel       *channel,
                                         GError           **error);
 static gboolean xcf_save_buffer        (XcfInfo           *info,
+                                        GimpDrawable      *drawable,
+                                        GError           **error);
+static gboolean xcf_save_levels        (XcfInfo           *info,
                                         GeglBuffer        *buffer,
+                                        gint               nlevels,
+                                        XcfTileIndex      *reuse,
+                                        XcfTileIndex     **index,
                                         GError           **error);
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
+                                        gint               level,
+                                        XcfTileIndex      *reuse,
+                                        XcfTileIndex     **index,
+                                        GError           **error);
+static GeglBuffer * xcf_save_get_level_buffer
+                                       (GeglBuffer        *buffer,
+                                        gint               level,
+                                        gint               width,
+                                        gint               height);
+static gboolean xcf_save_level_copy    (XcfInfo           *info,
+                                        XcfTileIndex      *reuse,
+                                        gint               level,
+                                        gint               ntiles,
+                                        goffset           *offset_table,
+                                        gint              *lengths,
+                                        goffset            max_data_length,
+                                        GError           **error);
+static gboolean xcf_save_level_encode  (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        gint               ntiles,
+                                        goffset           *offset_table,
+                                        gint              *lengths,
+                                        goffset            max_data_length,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
+static void     xcf_save_batch_encode_range
+                                       (gsize              offset,
+                                        gsize              size,
+                                        XcfSaveBatch      *batch);
+static void     xcf_save_batch_encode  (GimpAsync         *async,
+                                        XcfSaveBatch      *batch);
+static gint     xcf_save_tile          (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
+                                        guchar            *tile_data,
+                                        guchar            *data,
+                                        gint               max_data_length);
+static gint     xcf_save_tile_rle      (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
+                                        guchar            *tile_data,
                                         guchar            *rlebuf,
-                                        GError           **error);
-static gboolean xcf_save_tile_zlib     (XcfInfo           *info,
+                                        gint               max_data_length);
+static gint     xcf_save_tile_zlib     (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GeglRectangle     *tile_rect,
                                         const Babl        *format,
-                                        GError           **error);
+                                        guchar            *tile_data,
+                                        guchar            *data,
+                                        gint               max_data_length);
+static gint     xcf_save_tile_zstd     (XcfInfo           *info,
+                                        GeglBuffer        *buffer,
+                                        GeglRectangle     *tile_rect,
+                                        const Babl        *format,
+                                        guchar            *tile_data,
+                                        guchar            *data,
+                                        gint               max_data_length);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
                                         GError           **error);
@@ -213,6 +293,8 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
     if (info->progress)                         \
       gimp_progress_set_value (info->progress,  \
                                (gdouble) progress / (gdouble) max_progress); \
+    g_atomic_int_set (&info->progress_value,    \
+                      1000 * progress / max_progress); \
   } G_STMT_END
 
 
@@ -278,6 +360,13 @@ xcf_save_image (XcfInfo    *info,
 
   max_progress = 1 + n_layers + n_channels;
 
+  /* zstd compressed high bit-depth tiles can share a dictionary, which
+   * is stored with the image properties
+   */
+  list = g_list_concat (g_list_copy (all_layers), g_list_copy (all_channels));
+  info->zstd_dict = xcf_save_get_zstd_dict (info, image, list);
+  g_list_free (list);
+
   /* write the property information for the image */
   xcf_check_error (xcf_save_image_props (info, image, error));
 
@@ -353,6 +442,107 @@ xcf_save_image (XcfInfo    *info,
   return ! g_output_stream_is_closed (info->output);
 }
 
+/* returns the dictionary to compress the tiles of 'image' with, if any.
+ * a dictionary the image got from its last load or save is reused, so
+ * unchanged tiles can still be copied; otherwise a new one is trained on
+ * tiles spread evenly over 'drawables'.
+ */
+static XcfZstdDict *
+xcf_save_get_zstd_dict (XcfInfo   *info,
+                        GimpImage *image,
+                        GList     *drawables)
+{
+  XcfZstdDict *dict;
+  GByteArray  *samples;
+  gsize        sample_sizes[XCF_SAVE_DICT_SAMPLES];
+  GList       *list;
+  gint         n_samples = 0;
+  gint         n_tiles   = 0;
+  gint         step;
+  gint         tile;
+
+  /* dictionaries only pay off for high bit-depth tiles, which compress
+   * poorly on their own
+   */
+  if (info->compression != COMPRESS_ZSTD              ||
+      ! info->gimp->config->xcf_zstd_dictionary       ||
+      gimp_image_get_component_type (image) == GIMP_COMPONENT_TYPE_U8)
+    {
+      return NULL;
+    }
+
+  dict = xcf_zstd_dict_get_attached (image);
+
+  if (dict)
+    return xcf_zstd_dict_ref (dict);
+
+  for (list = drawables; list; list = g_list_next (list))
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (list->data);
+
+      n_tiles += gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT) *
+                 gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
+    }
+
+  step = MAX (1, n_tiles / XCF_SAVE_DICT_SAMPLES);
+
+  samples = g_byte_array_new ();
+
+  /* 'tile' runs over the tiles of all drawables, in order */
+  for (list = drawables, tile = 0;
+       list && n_samples < XCF_SAVE_DICT_SAMPLES;
+       list = g_list_next (list))
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (list->data);
+      const Babl *format = gegl_buffer_get_format (buffer);
+      gint        bpp    = babl_format_get_bytes_per_pixel (format);
+      gint        buffer_tiles;
+      guchar     *data;
+
+      buffer_tiles =
+        gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT) *
+        gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
+
+      data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+      for (;
+           tile < buffer_tiles && n_samples < XCF_SAVE_DICT_SAMPLES;
+           tile += step)
+        {
+          GeglRectangle rect;
+          gint          size;
+
+          gimp_gegl_buffer_get_tile_rect (buffer,
+                                          XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                          tile, &rect);
+
+          /* sample the tiles exactly as they are compressed */
+          size = xcf_save_tile (info, buffer, &rect, format, NULL, data,
+                                XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
+
+          if (size > 0)
+            {
+              g_byte_array_append (samples, data, size);
+              sample_sizes[n_samples++] = size;
+            }
+        }
+
+      tile -= buffer_tiles;
+
+      g_free (data);
+    }
+
+  /* fails if there are too few tiles to train on */
+  dict = xcf_zstd_dict_train (samples->data, sample_sizes, n_samples);
+
+  g_byte_array_free (samples, TRUE);
+
+  if (dict)
+    xcf_zstd_dict_attach (dict, image);
+
+  return dict;
+}
+
 static gboolean
 xcf_save_image_props (XcfInfo    *info,
                       GimpImage  *image,
@@ -379,6 +569,11 @@ xcf_save_image_props (XcfInfo    *info,
     xcf_check_error (xcf_save_prop (info, image, PROP_COMPRESSION, error,
                                     info->compression));
 
+  /* the dictionary must come before any tile compressed with it */
+  if (info->zstd_dict)
+    xcf_check_error (xcf_save_prop (info, image, PROP_ZSTD_DICTIONARY, error,
+                                    info->zstd_dict));
+
   if (gimp_image_get_guides (image))
     xcf_check_error (xcf_save_prop (info, image, PROP_GUIDES, error,
                                     gimp_image_get_guides (image)));
@@ -1029,6 +1224,23 @@ xcf_save_prop (XcfInfo    *info,
       }
       break;
 
+    case PROP_ZSTD_DICTIONARY:
+      {
+        XcfZstdDict  *dict = va_arg (args, XcfZstdDict *);
+        const guint8 *data;
+        gsize         dict_size;
+
+        data = xcf_zstd_dict_get_data (dict, &dict_size);
+
+        size = dict_size;
+
+        xcf_write_prop_type_check_error (info, prop_type);
+        xcf_write_int32_check_error (info, &size, 1);
+
+        xcf_write_int8_check_error (info, data, size);
+      }
+      break;
+
     case PROP_GUIDES:
       {
         GList *guides   = va_arg (args, GList *);
@@ -1400,9 +1612,7 @@ xcf_save_layer (XcfInfo    *info,
   /* write a zero layer mask offset */
   xcf_write_zero_offset_check_error (info, 1);
 
-  xcf_check_error (xcf_save_buffer (info,
-                                    gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                    error));
+  xcf_check_error (xcf_save_buffer (info, GIMP_DRAWABLE (layer), error));
 
   offset = info->cp;
 
@@ -1463,9 +1673,7 @@ xcf_save_channel (XcfInfo      *info,
   offset = info->cp + info->bytes_per_offset;
   xcf_write_offset_check_error (info, &offset, 1);
 
-  xcf_check_error (xcf_save_buffer (info,
-                                    gimp_drawable_get_buffer (GIMP_DRAWABLE (channel)),
-                                    error));
+  xcf_check_error (xcf_save_buffer (info, GIMP_DRAWABLE (channel), error));
 
   return TRUE;
 }
@@ -1488,20 +1696,20 @@ xcf_calc_levels (gint size,
 
 
 static gboolean
-xcf_save_buffer (XcfInfo     *info,
-                 GeglBuffer  *buffer,
-                 GError     **error)
+xcf_save_buffer (XcfInfo       *info,
+                 GimpDrawable  *drawable,
+                 GError       **error)
 {
-  const Babl *format;
-  goffset     saved_pos;
-  goffset     offset;
-  guint32     width;
-  guint32     height;
-  guint32     bpp;
-  gint        i;
-  gint        nlevels;
-  gint        tmp1, tmp2;
-  GError     *tmp_error = NULL;
+  GeglBuffer   *buffer = gimp_drawable_get_buffer (drawable);
+  XcfTileIndex *reuse;
+  XcfTileIndex *index  = NULL;
+  const Babl   *format;
+  guint32       width;
+  guint32       height;
+  guint32       bpp;
+  gint          nlevels;
+  gint          tmp1, tmp2;
+  GError       *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1517,6 +1725,58 @@ xcf_save_buffer (XcfInfo     *info,
   tmp2 = xcf_calc_levels (height, XCF_TILE_HEIGHT);
   nlevels = MAX (tmp1, tmp2);
 
+  /* the tiles of an unchanged drawable are copied from the last XCF it
+   * was loaded from or saved to
+   */
+  reuse = xcf_tile_index_get_reusable (drawable, info);
+
+  if (! xcf_save_levels (info, buffer, nlevels, reuse, &index, error))
+    {
+      if (index)
+        xcf_tile_index_free (index);
+
+      return FALSE;
+    }
+
+  /* remember where the tiles went, so the next save can copy them if
+   * the drawable doesn't change.  the index is only usable once the
+   * file is complete.
+   */
+  if (index)
+    {
+      if (xcf_tile_index_attach (index, drawable))
+        {
+          info->saved_tile_indices =
+            g_list_prepend (info->saved_tile_indices, index);
+        }
+      else
+        {
+          xcf_tile_index_free (index);
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+xcf_save_levels (XcfInfo       *info,
+                 GeglBuffer    *buffer,
+                 gint           nlevels,
+                 XcfTileIndex  *reuse,
+                 XcfTileIndex **index,
+                 GError       **error)
+{
+  goffset  saved_pos;
+  goffset  offset;
+  guint32  width;
+  guint32  height;
+  gint     i;
+  gint     tmp1;
+  GError  *tmp_error = NULL;
+
+  width  = gegl_buffer_get_width (buffer);
+  height = gegl_buffer_get_height (buffer);
+
   /* 'saved_pos' is the next slot in the offset table */
   saved_pos = info->cp;
 
@@ -1540,10 +1800,15 @@ xcf_save_buffer (XcfInfo     *info,
       /* seek to the level offset and save the level */
       xcf_check_error (xcf_seek_pos (info, offset, error));
 
-      if (i == 0)
+      if (i == 0 ||
+          (info->file_version >= 15 &&
+           info->gimp->config->xcf_save_pyramid))
         {
-          /* write out the level. */
-          xcf_check_error (xcf_save_level (info, buffer, error));
+          /* write out the level.  the reduced-resolution levels are
+           * only stored when asked for, in version 15 files or later.
+           */
+          xcf_check_error (xcf_save_level (info, buffer, i, reuse, index,
+                                           error));
         }
       else
         {
@@ -1558,11 +1823,13 @@ xcf_save_buffer (XcfInfo     *info,
            * since there are already 64-bit-offsets XCFs out there in
            * which this field is 32-bit, and since it's not actually
            * being used, we're going to keep this field 32-bit for the
-           * dummy levels, to remain consistent.  if we ever make use
-           * of levels above the first, we should turn this field into
-           * an offset, and bump the xcf version.
+           * dummy levels, to remain consistent.  version 15 files,
+           * which can store real levels, read it as an offset.
            */
-          xcf_write_int32_check_error (info, (guint32 *) &tmp1,   1);
+          if (info->file_version >= 15)
+            xcf_write_zero_offset_check_error (info, 1);
+          else
+            xcf_write_int32_check_error (info, (guint32 *) &tmp1, 1);
         }
 
       /* the next level's offset if after the level we just wrote */
@@ -1577,13 +1844,16 @@ xcf_save_buffer (XcfInfo     *info,
 }
 
 static gboolean
-xcf_save_level (XcfInfo     *info,
-                GeglBuffer  *buffer,
-                GError     **error)
+xcf_save_level (XcfInfo       *info,
+                GeglBuffer    *buffer,
+                gint           level,
+                XcfTileIndex  *reuse,
+                XcfTileIndex **index,
+                GError       **error)
 {
   const Babl *format;
   goffset    *offset_table;
-  goffset    *next_offset;
+  gint       *lengths;
   goffset     saved_pos;
   goffset     offset;
   goffset     max_data_length;
@@ -1593,14 +1863,13 @@ xcf_save_level (XcfInfo     *info,
   gint        n_tile_rows;
   gint        n_tile_cols;
   guint       ntiles;
-  gint        i;
-  guchar     *rlebuf    = NULL;
+  gboolean    success;
   GError     *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
-  width  = gegl_buffer_get_width (buffer);
-  height = gegl_buffer_get_height (buffer);
+  width  = xcf_get_level_size (gegl_buffer_get_width (buffer),  level);
+  height = xcf_get_level_size (gegl_buffer_get_height (buffer), level);
   bpp    = babl_format_get_bytes_per_pixel (format);
 
   xcf_write_int32_check_error (info, (guint32 *) &width,  1);
@@ -1615,14 +1884,14 @@ xcf_save_level (XcfInfo     *info,
   max_data_length = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp *
                     XCF_TILE_MAX_DATA_LENGTH_FACTOR /* = 1.5, currently */;
 
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
-   */
-  if (info->compression == COMPRESS_RLE)
-    rlebuf = g_alloca (max_data_length);
+  if (info->compression == COMPRESS_FRACTAL)
+    {
+      g_warning ("xcf: fractal compression unimplemented");
+      return FALSE;
+    }
 
-  n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
-  n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
+  n_tile_rows = (height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT;
+  n_tile_cols = (width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH;
 
   ntiles = n_tile_rows * n_tile_cols;
 
@@ -1632,7 +1901,6 @@ xcf_save_level (XcfInfo     *info,
    */
   offset_table = g_alloca ((ntiles + 1) * sizeof (goffset));
   memset (offset_table, 0, (ntiles + 1) * sizeof (goffset));
-  next_offset = offset_table;
 
   /* 'saved_pos' is the offset of the tile offset table  */
   saved_pos = info->cp;
@@ -1640,108 +1908,392 @@ xcf_save_level (XcfInfo     *info,
   /* write an empty offset table */
   xcf_write_zero_offset_check_error (info, ntiles + 1);
 
-  /* 'offset' is where we will write the next tile */
+  lengths = g_new0 (gint, ntiles);
+
+  if (reuse && level < reuse->n_levels)
+    {
+      /* the drawable didn't change since it was last loaded from or
+       * saved to an XCF, copy its tiles from there as they are
+       */
+      success = xcf_save_level_copy (info, reuse, level, ntiles,
+                                     offset_table, lengths,
+                                     max_data_length, error);
+    }
+  else if (level == 0)
+    {
+      success = xcf_save_level_encode (info, buffer, ntiles,
+                                       offset_table, lengths,
+                                       max_data_length, error);
+    }
+  else
+    {
+      GeglBuffer *level_buffer;
+
+      level_buffer = xcf_save_get_level_buffer (buffer, level,
+                                                width, height);
+
+      success = xcf_save_level_encode (info, level_buffer, ntiles,
+                                       offset_table, lengths,
+                                       max_data_length, error);
+
+      g_object_unref (level_buffer);
+    }
+
+  if (success)
+    {
+      if (level == 0)
+        *index = xcf_tile_index_new (info, buffer, offset_table, lengths);
+      else if (*index)
+        xcf_tile_index_add_level (*index, ntiles, offset_table, lengths);
+    }
+
+  g_free (lengths);
+
+  if (! success)
+    return FALSE;
+
+  /* 'offset' is the end of the level */
   offset = info->cp;
 
+  /* seek back to the offset table and write it  */
+  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
+  xcf_write_offset_check_error (info, offset_table, ntiles + 1);
+
+  /* seek to the end of the file */
+  xcf_check_error (xcf_seek_pos (info, offset, error));
+
+  return TRUE;
+}
+
+/* returns a buffer holding the pixels of the reduced-resolution 'level'
+ * of 'buffer'.  they are read from the buffer's own mipmap, so they match
+ * what GEGL renders when zooming out.
+ */
+static GeglBuffer *
+xcf_save_get_level_buffer (GeglBuffer *buffer,
+                           gint        level,
+                           gint        width,
+                           gint        height)
+{
+  const Babl *format = gegl_buffer_get_format (buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  GeglBuffer *level_buffer;
+  guchar     *data;
+  gint        y;
+
+  level_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
+                                  format);
+
+  data = g_malloc ((gsize) width * XCF_TILE_HEIGHT * bpp);
+
+  for (y = 0; y < height; y += XCF_TILE_HEIGHT)
+    {
+      GeglRectangle rect = { 0, y, width, MIN (XCF_TILE_HEIGHT, height - y) };
+
+      gegl_buffer_get (buffer, &rect, 1.0 / (1 << level), format, data,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+      gegl_buffer_set (level_buffer, &rect, 0, format, data,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (data);
+
+  return level_buffer;
+}
+
+static gboolean
+xcf_save_level_copy (XcfInfo       *info,
+                     XcfTileIndex  *reuse,
+                     gint           level,
+                     gint           ntiles,
+                     goffset       *offset_table,
+                     gint          *lengths,
+                     goffset        max_data_length,
+                     GError       **error)
+{
+  guchar   *data;
+  gint      i;
+  gboolean  success   = TRUE;
+  GError   *tmp_error = NULL;
+
+  data = g_malloc (max_data_length);
+
   for (i = 0; i < ntiles; i++)
     {
-      GeglRectangle rect;
+      gint size = xcf_tile_index_read_tile (reuse, info, level, i,
+                                            data, max_data_length, error);
+
+      if (size < 0)
+        {
+          success = FALSE;
+          break;
+        }
+
+      /* store the offset and length in the tables */
+      offset_table[i] = info->cp;
+      lengths[i]      = size;
+
+      xcf_write_int8 (info, data, size, &tmp_error);
+
+      if (tmp_error)
+        {
+          g_propagate_error (error, tmp_error);
+
+          success = FALSE;
+          break;
+        }
+    }
+
+  g_free (data);
+
+  return success;
+}
+
+static gboolean
+xcf_save_level_encode (XcfInfo       *info,
+                       GeglBuffer    *buffer,
+                       gint           ntiles,
+                       goffset       *offset_table,
+                       gint          *lengths,
+                       goffset        max_data_length,
+                       GError       **error)
+{
+  XcfSaveBatch  batches[2];
+  GimpAsync    *async     = NULL;
+  gint          first_tile;
+  gint          i;
+  gboolean      success   = TRUE;
+  GError       *tmp_error = NULL;
+
+  /* the tiles are encoded in batches on worker threads, while the
+   * previous batch is written out in order on this thread.  this thread
+   * is the main thread, or the thread of an asynchronous save, so the
+   * batches are waited for as child tasks, which works on either.
+   */
+  for (i = 0; i < 2; i++)
+    {
+      gint n_tiles = MIN (ntiles, XCF_SAVE_BATCH_SIZE);
+
+      batches[i].info            = info;
+      batches[i].buffer          = buffer;
+      batches[i].format          = gegl_buffer_get_format (buffer);
+      batches[i].max_data_length = max_data_length;
+      batches[i].first_tile      = 0;
+      batches[i].n_tiles         = 0;
+      batches[i].data            = g_malloc (n_tiles * max_data_length);
+      batches[i].sizes           = g_new (gint, n_tiles);
+    }
+
+  if (ntiles > 0)
+    {
+      batches[0].n_tiles = MIN (ntiles, XCF_SAVE_BATCH_SIZE);
+
+      async = gimp_parallel_run_async_child (
+        NULL,
+        (GimpRunAsyncFunc) xcf_save_batch_encode,
+        &batches[0]);
+    }
+
+  for (first_tile = 0, i = 0;
+       success && first_tile < ntiles;
+       first_tile += batches[i].n_tiles, i = ! i)
+    {
+      XcfSaveBatch *batch = &batches[i];
+      XcfSaveBatch *next  = &batches[! i];
+      gint          j;
+
+      gimp_parallel_run_async_child_wait (async);
+      g_clear_object (&async);
+
+      /* start encoding the next batch while we write this one */
+      if (first_tile + batch->n_tiles < ntiles)
+        {
+          next->first_tile = first_tile + batch->n_tiles;
+          next->n_tiles    = MIN (ntiles - next->first_tile,
+                                  XCF_SAVE_BATCH_SIZE);
+
+          async = gimp_parallel_run_async_child (
+            NULL,
+            (GimpRunAsyncFunc) xcf_save_batch_encode,
+            next);
+        }
+
+      for (j = 0; j < batch->n_tiles; j++)
+        {
+          gint size = batch->sizes[j];
+
+          if (size < 0)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Failed to encode the pixel data of tile %d"),
+                           first_tile + j);
+
+              success = FALSE;
+              break;
+            }
+
+          /* make sure the on-disk tile data didn't end up being too big.
+           * xcf_load_level() would refuse to load the file if it did.
+           */
+          if (size > max_data_length)
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                           _("Invalid tile data length: %d"),
+                           size);
+
+              success = FALSE;
+              break;
+            }
+
+          /* store the offset and length in the tables */
+          offset_table[first_tile + j] = info->cp;
+          lengths[first_tile + j]      = size;
+
+          xcf_write_int8 (info,
+                          batch->data + (gsize) j * max_data_length, size,
+                          &tmp_error);
+
+          if (tmp_error)
+            {
+              g_propagate_error (error, tmp_error);
+
+              success = FALSE;
+              break;
+            }
+        }
+    }
+
+  /* don't free the batches while a worker is still encoding into them */
+  if (async)
+    {
+      gimp_parallel_run_async_child_wait (async);
+      g_object_unref (async);
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      g_free (batches[i].data);
+      g_free (batches[i].sizes);
+    }
+
+  return success;
+}
+
+static void
+xcf_save_batch_encode_range (gsize         offset,
+                             gsize         size,
+                             XcfSaveBatch *batch)
+{
+  gint    bpp = babl_format_get_bytes_per_pixel (batch->format);
+  guchar *tile_data;
+  gsize   i;
+
+  /* scratch space for the raw tile pixels */
+  tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
 
-      /* store the offset in the table and increment the next pointer */
-      *next_offset++ = offset;
+  for (i = offset; i < offset + size; i++)
+    {
+      GeglRectangle  rect;
+      guchar        *data = batch->data + i * batch->max_data_length;
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
+      gimp_gegl_buffer_get_tile_rect (batch->buffer,
                                       XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+                                      batch->first_tile + i, &rect);
 
-      /* write out the tile. */
-      switch (info->compression)
+      switch (batch->info->compression)
         {
         case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
+          batch->sizes[i] = xcf_save_tile (batch->info, batch->buffer,
+                                           &rect, batch->format,
+                                           tile_data, data,
+                                           batch->max_data_length);
           break;
         case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
+          batch->sizes[i] = xcf_save_tile_rle (batch->info, batch->buffer,
+                                               &rect, batch->format,
+                                               tile_data, data,
+                                               batch->max_data_length);
           break;
         case COMPRESS_ZLIB:
-          xcf_check_error (xcf_save_tile_zlib (info, buffer, &rect, format,
-                                               error));
+          batch->sizes[i] = xcf_save_tile_zlib (batch->info, batch->buffer,
+                                                &rect, batch->format,
+                                                tile_data, data,
+                                                batch->max_data_length);
+          break;
+        case COMPRESS_ZSTD:
+          batch->sizes[i] = xcf_save_tile_zstd (batch->info, batch->buffer,
+                                                &rect, batch->format,
+                                                tile_data, data,
+                                                batch->max_data_length);
+          break;
+        default:
+          batch->sizes[i] = -1;
           break;
-        case COMPRESS_FRACTAL:
-          g_warning ("xcf: fractal compression unimplemented");
-          return FALSE;
-        }
-
-      /* make sure the on-disk tile data didn't end up being too big.
-       * xcf_load_level() would refuse to load the file if it did.
-       */
-      if (info->cp < offset || info->cp - offset > max_data_length)
-        {
-          g_message ("xcf: invalid tile data length: %" G_GOFFSET_FORMAT,
-                     info->cp - offset);
-          return FALSE;
         }
-
-      /* the next tile's offset is after the tile we just wrote */
-      offset = info->cp;
     }
 
-  /* seek back to the offset table and write it  */
-  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_offset_check_error (info, offset_table, ntiles + 1);
+  g_free (tile_data);
+}
 
-  /* seek to the end of the file */
-  xcf_check_error (xcf_seek_pos (info, offset, error));
+static void
+xcf_save_batch_encode (GimpAsync    *async,
+                       XcfSaveBatch *batch)
+{
+  gegl_parallel_distribute_range (
+    batch->n_tiles, 1,
+    (GeglParallelDistributeRangeFunc) xcf_save_batch_encode_range,
+    batch);
 
-  return TRUE;
+  gimp_async_finish (async, NULL);
 }
 
-static gboolean
+/* the tile encoders below read the pixels of 'tile_rect' into 'tile_data',
+ * and encode them into 'data', which is 'max_data_length' bytes long.
+ * they only touch their arguments, so they can run on any thread, and
+ * return the encoded length, or -1 on failure.
+ */
+static gint
 xcf_save_tile (XcfInfo        *info,
                GeglBuffer     *buffer,
                GeglRectangle  *tile_rect,
                const Babl     *format,
-               GError        **error)
+               guchar         *tile_data,
+               guchar         *data,
+               gint            max_data_length)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+  if (tile_size > max_data_length)
+    return -1;
+
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, data,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-  if (info->file_version <= 11)
-    {
-      xcf_write_int8_check_error (info, tile_data, tile_size);
-    }
-  else
+  if (info->file_version >= 12)
     {
       gint n_components = babl_format_get_n_components (format);
 
-      xcf_write_component_check_error (info, bpp / n_components, tile_data,
-                                       tile_size / bpp * n_components);
+      xcf_write_to_be (bpp / n_components, data,
+                       tile_size / bpp * n_components);
     }
 
-  return TRUE;
+  return tile_size;
 }
 
-static gboolean
+static gint
 xcf_save_tile_rle (XcfInfo        *info,
                    GeglBuffer     *buffer,
                    GeglRectangle  *tile_rect,
                    const Babl     *format,
+                   guchar         *tile_data,
                    guchar         *rlebuf,
-                   GError        **error)
+                   gint            max_data_length)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gint    len       = 0;
-  gint    i, j;
-  GError *tmp_error  = NULL;
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
+  gint len       = 0;
+  gint i, j;
 
   gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
@@ -1853,30 +2405,26 @@ xcf_save_tile_rle (XcfInfo        *info,
             }
         }
 
+      /* this runs on a worker thread, let the caller report it */
       if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
+        return -1;
     }
 
-  xcf_write_int8_check_error (info, rlebuf, len);
-
-  return TRUE;
+  return len;
 }
 
-static gboolean
+static gint
 xcf_save_tile_zlib (XcfInfo        *info,
                     GeglBuffer     *buffer,
                     GeglRectangle  *tile_rect,
                     const Babl     *format,
-                    GError        **error)
+                    guchar         *tile_data,
+                    guchar         *data,
+                    gint            max_data_length)
 {
   gint      bpp       = babl_format_get_bytes_per_pixel (format);
   gint      tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar   *tile_data = g_alloca (tile_size);
-  /* The buffer for compressed data. */
-  guchar   *buf       = g_alloca (tile_size);
-  GError   *tmp_error = NULL;
   z_stream  strm;
-  int       action;
   int       status;
 
   gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
@@ -1897,45 +2445,69 @@ xcf_save_tile_zlib (XcfInfo        *info,
 
   status = deflateInit (&strm, Z_DEFAULT_COMPRESSION);
   if (status != Z_OK)
-    return FALSE;
+    return -1;
 
   strm.next_in   = tile_data;
   strm.avail_in  = tile_size;
-  strm.next_out  = buf;
-  strm.avail_out = tile_size;
+  strm.next_out  = data;
+  strm.avail_out = max_data_length;
+
+  /* the whole tile is available, so finish the encoding in one go.  if
+   * the output doesn't fit in 'data', the tile would be too big for
+   * xcf_load_level() anyway.
+   */
+  do
+    {
+      status = deflate (&strm, Z_FINISH);
+    }
+  while (status == Z_OK && strm.avail_out > 0);
 
-  action = Z_NO_FLUSH;
+  deflateEnd (&strm);
 
-  while (status == Z_OK || status == Z_BUF_ERROR)
+  if (status != Z_STREAM_END)
     {
-      if (strm.avail_in == 0)
-        {
-          /* Finish the encoding. */
-          action = Z_FINISH;
-        }
+      g_printerr ("xcf: tile compression failed: %s", zError (status));
+      return -1;
+    }
 
-      status = deflate (&strm, action);
+  return max_data_length - strm.avail_out;
+}
 
-      if (status == Z_STREAM_END || status == Z_BUF_ERROR)
-        {
-          size_t write_size = tile_size - strm.avail_out;
+static gint
+xcf_save_tile_zstd (XcfInfo        *info,
+                    GeglBuffer     *buffer,
+                    GeglRectangle  *tile_rect,
+                    const Babl     *format,
+                    guchar         *tile_data,
+                    guchar         *data,
+                    gint            max_data_length)
+{
+  gint bpp       = babl_format_get_bytes_per_pixel (format);
+  gint tile_size = bpp * tile_rect->width * tile_rect->height;
+  gint size;
 
-          xcf_write_int8_check_error (info, buf, write_size);
+  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-          /* Reset next_out and avail_out. */
-          strm.next_out  = buf;
-          strm.avail_out = tile_size;
-        }
-      else if (status != Z_OK)
-        {
-          g_printerr ("xcf: tile compression failed: %s", zError (status));
-          deflateEnd (&strm);
-          return FALSE;
-        }
+  if (info->file_version >= 12)
+    {
+      gint n_components = babl_format_get_n_components (format);
+
+      xcf_write_to_be (bpp / n_components, tile_data,
+                       tile_size / bpp * n_components);
     }
 
-  deflateEnd (&strm);
-  return TRUE;
+  /* as with zlib, a tile that doesn't fit in 'data' would be too big for
+   * xcf_load_level() anyway
+   */
+  size = xcf_zstd_compress (info->zstd_dict, info->zstd_level,
+                            tile_data, tile_size,
+                            data, max_data_length);
+
+  if (size < 0)
+    g_printerr ("xcf: zstd tile compression failed");
+
+  return size;
 }
 
 static gboolean
@@ -0,0 +1,661 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "xcf-private.h"
+#include "xcf-load.h"
+#include "xcf-tile-backend.h"
+#include "xcf-zstd.h"
+
+#include "gimp-intl.h"
+
+
+static void       xcf_tile_backend_finalize   (GObject             *object);
+
+static gpointer   xcf_tile_backend_command    (GeglTileSource      *tile_store,
+                                               GeglTileCommand      command,
+                                               gint                 x,
+                                               gint                 y,
+                                               gint                 z,
+                                               gpointer             data);
+
+static GeglTile * xcf_tile_backend_read       (XcfTileBackend      *backend,
+                                               gint                 x,
+                                               gint                 y,
+                                               gint                 z);
+
+static void       xcf_tile_backend_level_init (XcfTileBackendLevel *level,
+                                               gint                 width,
+                                               gint                 height,
+                                               const goffset       *offsets,
+                                               const gint          *lengths);
+
+static gboolean   xcf_tile_backend_decode_failed_idle
+                                              (XcfTileBackend      *backend);
+
+
+G_DEFINE_TYPE (XcfTileBackend, xcf_tile_backend, GEGL_TYPE_TILE_BACKEND)
+
+#define parent_class xcf_tile_backend_parent_class
+
+
+static void
+xcf_tile_backend_class_init (XcfTileBackendClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xcf_tile_backend_finalize;
+}
+
+static void
+xcf_tile_backend_init (XcfTileBackend *backend)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (backend);
+
+  source->command = xcf_tile_backend_command;
+
+  g_mutex_init (&backend->mutex);
+}
+
+static void
+xcf_tile_backend_finalize (GObject *object)
+{
+  XcfTileBackend *backend = XCF_TILE_BACKEND (object);
+  gint            i;
+
+  for (i = 0; i < backend->n_levels; i++)
+    {
+      g_free (backend->levels[i].offsets);
+      g_free (backend->levels[i].lengths);
+      g_free (backend->levels[i].stale);
+    }
+
+  g_clear_pointer (&backend->levels,      g_free);
+  g_clear_pointer (&backend->states,      g_free);
+  g_clear_object  (&backend->tiles);
+  g_clear_object  (&backend->file);
+  g_clear_pointer (&backend->mapped_file, g_mapped_file_unref);
+  g_clear_pointer (&backend->zstd_dict,   xcf_zstd_dict_unref);
+
+  g_mutex_clear (&backend->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gpointer
+xcf_tile_backend_command (GeglTileSource  *tile_store,
+                          GeglTileCommand  command,
+                          gint             x,
+                          gint             y,
+                          gint             z,
+                          gpointer         data)
+{
+  XcfTileBackend      *backend = XCF_TILE_BACKEND (tile_store);
+  XcfTileBackendLevel *level;
+  GeglRectangle        rect;
+  const Babl          *format;
+  gint                 index;
+  gpointer             result  = NULL;
+
+  /* mipmap levels which aren't stored in the file are rendered by the
+   * buffer itself, and there are no tiles outside of the drawable
+   */
+  if (z < 0 || z >= backend->n_levels            ||
+      x < 0 || x >= backend->levels[z].n_tile_cols ||
+      y < 0 || y >= backend->levels[z].n_tile_rows)
+    {
+      switch (command)
+        {
+        case GEGL_TILE_SET:
+          gegl_tile_mark_as_stored (data);
+          return NULL;
+
+        case GEGL_TILE_GET:
+        case GEGL_TILE_VOID:
+        case GEGL_TILE_EXIST:
+          return NULL;
+
+        default:
+          return gegl_tile_backend_command (GEGL_TILE_BACKEND (tile_store),
+                                            command, x, y, z, data);
+        }
+    }
+
+  level = &backend->levels[z];
+  index = y * level->n_tile_cols + x;
+
+  /* the stored mipmap levels are only read, and only while the part of
+   * the top level they cover is unchanged.  the buffer renders them
+   * itself otherwise.
+   */
+  if (z > 0)
+    {
+      gboolean stale;
+
+      switch (command)
+        {
+        case GEGL_TILE_GET:
+          g_mutex_lock (&backend->mutex);
+
+          stale = level->stale[index];
+
+          g_mutex_unlock (&backend->mutex);
+
+          if (! stale)
+            result = xcf_tile_backend_read (backend, x, y, z);
+          break;
+
+        case GEGL_TILE_SET:
+          gegl_tile_mark_as_stored (data);
+          break;
+
+        case GEGL_TILE_VOID:
+          g_mutex_lock (&backend->mutex);
+
+          level->stale[index] = TRUE;
+
+          g_mutex_unlock (&backend->mutex);
+          break;
+
+        case GEGL_TILE_EXIST:
+          g_mutex_lock (&backend->mutex);
+
+          result = GINT_TO_POINTER (! level->stale[index]);
+
+          g_mutex_unlock (&backend->mutex);
+          break;
+
+        case GEGL_TILE_FLUSH:
+          break;
+
+        default:
+          result = gegl_tile_backend_command (GEGL_TILE_BACKEND (tile_store),
+                                              command, x, y, z, data);
+          break;
+        }
+
+      return result;
+    }
+
+  rect.x      = x * XCF_TILE_WIDTH;
+  rect.y      = y * XCF_TILE_HEIGHT;
+  rect.width  = XCF_TILE_WIDTH;
+  rect.height = XCF_TILE_HEIGHT;
+
+  format = gegl_tile_backend_get_format (GEGL_TILE_BACKEND (backend));
+
+  switch (command)
+    {
+    case GEGL_TILE_GET:
+      g_mutex_lock (&backend->mutex);
+
+      switch (backend->states[index])
+        {
+        case XCF_TILE_IN_FILE:
+          g_mutex_unlock (&backend->mutex);
+
+          result = xcf_tile_backend_read (backend, x, y, z);
+          break;
+
+        case XCF_TILE_WRITTEN:
+          result = gegl_tile_new (gegl_tile_backend_get_tile_size (
+                                    GEGL_TILE_BACKEND (backend)));
+
+          gegl_buffer_get (backend->tiles, &rect, 1.0, format,
+                           gegl_tile_get_data (result),
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          g_mutex_unlock (&backend->mutex);
+
+          gegl_tile_mark_as_stored (result);
+          break;
+
+        case XCF_TILE_VOID:
+          g_mutex_unlock (&backend->mutex);
+          break;
+        }
+      break;
+
+    case GEGL_TILE_SET:
+      /* copy-on-write: store the written tile in a buffer of our own,
+       * instead of touching the file.  that buffer's tiles go to swap
+       * like any other's, so editing a large lazily loaded drawable
+       * doesn't keep all of it in memory.
+       */
+      g_mutex_lock (&backend->mutex);
+
+      if (! backend->tiles)
+        {
+          backend->tiles =
+            gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                             level->n_tile_cols * XCF_TILE_WIDTH,
+                                             level->n_tile_rows * XCF_TILE_HEIGHT),
+                             format);
+        }
+
+      gegl_buffer_set (backend->tiles, &rect, 0, format,
+                       gegl_tile_get_data (data), GEGL_AUTO_ROWSTRIDE);
+
+      backend->states[index] = XCF_TILE_WRITTEN;
+
+      g_mutex_unlock (&backend->mutex);
+
+      gegl_tile_mark_as_stored (data);
+      break;
+
+    case GEGL_TILE_VOID:
+      g_mutex_lock (&backend->mutex);
+
+      backend->states[index] = XCF_TILE_VOID;
+
+      g_mutex_unlock (&backend->mutex);
+      break;
+
+    case GEGL_TILE_EXIST:
+      g_mutex_lock (&backend->mutex);
+
+      switch (backend->states[index])
+        {
+        case XCF_TILE_IN_FILE:
+          result = GINT_TO_POINTER (level->lengths[index] > 0);
+          break;
+
+        case XCF_TILE_WRITTEN:
+          result = GINT_TO_POINTER (TRUE);
+          break;
+
+        case XCF_TILE_VOID:
+          result = GINT_TO_POINTER (FALSE);
+          break;
+        }
+
+      g_mutex_unlock (&backend->mutex);
+      break;
+
+    case GEGL_TILE_FLUSH:
+      break;
+
+    default:
+      result = gegl_tile_backend_command (GEGL_TILE_BACKEND (tile_store),
+                                          command, x, y, z, data);
+      break;
+    }
+
+  return result;
+}
+
+/* decodes a tile straight from the mapped file.  this only reads the
+ * mapping, so it only needs the mutex when the tile fails to decode.
+ */
+static GeglTile *
+xcf_tile_backend_read (XcfTileBackend *backend,
+                       gint            x,
+                       gint            y,
+                       gint            z)
+{
+  GeglTileBackend     *tile_backend = GEGL_TILE_BACKEND (backend);
+  const Babl          *format       = gegl_tile_backend_get_format (tile_backend);
+  gint                 bpp          = babl_format_get_bytes_per_pixel (format);
+  gint                 tile_size    = gegl_tile_backend_get_tile_size (tile_backend);
+  XcfTileBackendLevel *level        = &backend->levels[z];
+  gint                 i            = y * level->n_tile_cols + x;
+  guchar              *contents;
+  gsize                size;
+  GeglTile            *tile;
+  guchar              *tile_data;
+  guchar              *xcf_tile_data;
+  gint                 data_length;
+  gint                 ewidth;
+  gint                 eheight;
+  gboolean             empty;
+
+  contents = (guchar *) g_mapped_file_get_contents (backend->mapped_file);
+  size     = g_mapped_file_get_length (backend->mapped_file);
+
+  /* tiles reaching past the end of the file are truncated, the same
+   * as when reading them from a stream
+   */
+  if (level->offsets[i] >= (goffset) size)
+    return NULL;
+
+  data_length = MIN (level->lengths[i],
+                     (goffset) size - level->offsets[i]);
+
+  ewidth  = MIN (XCF_TILE_WIDTH,  level->width  - x * XCF_TILE_WIDTH);
+  eheight = MIN (XCF_TILE_HEIGHT, level->height - y * XCF_TILE_HEIGHT);
+
+  tile      = gegl_tile_new (tile_size);
+  tile_data = gegl_tile_get_data (tile);
+
+  /* edge tiles are stored without padding in the file, decode them
+   * separately and copy their rows into the tile afterwards
+   */
+  xcf_tile_data = tile_data;
+
+  if (ewidth != XCF_TILE_WIDTH || eheight != XCF_TILE_HEIGHT)
+    xcf_tile_data = g_malloc (ewidth * eheight * bpp);
+
+  if (! xcf_load_tile_data (backend->compression, backend->zstd_dict,
+                            backend->file_version,
+                            format, ewidth * eheight,
+                            contents + level->offsets[i], data_length,
+                            xcf_tile_data, &empty))
+    {
+      if (xcf_tile_data != tile_data)
+        g_free (xcf_tile_data);
+
+      gegl_tile_unref (tile);
+
+      g_mutex_lock (&backend->mutex);
+
+      if (z > 0)
+        {
+          /* a missing mipmap tile is rendered from the level below, so
+           * there's nothing lost.  don't try to read it again.
+           */
+          level->stale[i] = TRUE;
+        }
+      else if (! backend->decode_failed)
+        {
+          /* the tile's pixels are lost, and it stays empty.  tell the
+           * user, but only once per drawable.
+           */
+          backend->decode_failed = TRUE;
+
+          g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                           (GSourceFunc) xcf_tile_backend_decode_failed_idle,
+                           g_object_ref (backend),
+                           (GDestroyNotify) g_object_unref);
+        }
+
+      g_mutex_unlock (&backend->mutex);
+
+      return NULL;
+    }
+
+  if (xcf_tile_data != tile_data)
+    {
+      if (! empty)
+        {
+          gint row;
+
+          memset (tile_data, 0, tile_size);
+
+          for (row = 0; row < eheight; row++)
+            {
+              memcpy (tile_data     + row * XCF_TILE_WIDTH * bpp,
+                      xcf_tile_data + row * ewidth * bpp,
+                      ewidth * bpp);
+            }
+        }
+
+      g_free (xcf_tile_data);
+    }
+
+  if (empty)
+    {
+      /* an empty top level tile is simply missing, but an empty mipmap
+       * tile would be rendered from the level below, return it cleared
+       * instead
+       */
+      if (z == 0)
+        {
+          gegl_tile_unref (tile);
+
+          return NULL;
+        }
+
+      memset (tile_data, 0, tile_size);
+    }
+
+  /* the tile matches what's in the file, there's no need to store it
+   * back when it's evicted from the cache
+   */
+  gegl_tile_mark_as_stored (tile);
+
+  return tile;
+}
+
+static void
+xcf_tile_backend_level_init (XcfTileBackendLevel *level,
+                             gint                 width,
+                             gint                 height,
+                             const goffset       *offsets,
+                             const gint          *lengths)
+{
+  gint n_tiles;
+
+  level->width       = width;
+  level->height      = height;
+  level->n_tile_rows = (height + XCF_TILE_HEIGHT - 1) / XCF_TILE_HEIGHT;
+  level->n_tile_cols = (width  + XCF_TILE_WIDTH  - 1) / XCF_TILE_WIDTH;
+
+  n_tiles = level->n_tile_rows * level->n_tile_cols;
+
+  level->offsets = g_memdup (offsets, n_tiles * sizeof (goffset));
+  level->lengths = g_memdup (lengths, n_tiles * sizeof (gint));
+  level->stale   = g_new0 (gboolean, n_tiles);
+}
+
+static gboolean
+xcf_tile_backend_decode_failed_idle (XcfTileBackend *backend)
+{
+  gimp_message (backend->gimp, NULL, GIMP_MESSAGE_ERROR,
+                _("Some of the pixel data in '%s' could not be read, the "
+                  "file may be damaged.  The affected parts of the image "
+                  "are left empty."),
+                gimp_file_get_utf8_name (backend->file));
+
+  return G_SOURCE_REMOVE;
+}
+
+
+/*  public functions  */
+
+GeglTileBackend *
+xcf_tile_backend_new (Gimp               *gimp,
+                      GFile              *file,
+                      GMappedFile        *mapped_file,
+                      XcfCompressionType  compression,
+                      XcfZstdDict        *zstd_dict,
+                      gint                file_version,
+                      const Babl         *format,
+                      gint                width,
+                      gint                height,
+                      const goffset      *offsets,
+                      const gint         *lengths)
+{
+  XcfTileBackend *backend;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (mapped_file != NULL, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (lengths != NULL, NULL);
+
+  backend = g_object_new (XCF_TYPE_TILE_BACKEND,
+                          "tile-width",  XCF_TILE_WIDTH,
+                          "tile-height", XCF_TILE_HEIGHT,
+                          "format",      format,
+                          NULL);
+
+  backend->gimp         = gimp;
+  backend->file         = g_object_ref (file);
+  backend->mapped_file  = g_mapped_file_ref (mapped_file);
+  backend->compression  = compression;
+  backend->zstd_dict    = zstd_dict ? xcf_zstd_dict_ref (zstd_dict) : NULL;
+  backend->file_version = file_version;
+
+  xcf_tile_backend_add_level (backend, width, height, offsets, lengths);
+
+  backend->states = g_new0 (XcfTileState,
+                            backend->levels[0].n_tile_rows *
+                            backend->levels[0].n_tile_cols);
+
+  gegl_tile_backend_set_extent (GEGL_TILE_BACKEND (backend),
+                                GEGL_RECTANGLE (0, 0, width, height));
+
+  return GEGL_TILE_BACKEND (backend);
+}
+
+/* returns a new backend reading the same file, and starting out with
+ * the tiles written to 'backend' so far.  the written tiles are shared
+ * copy-on-write, so this doesn't decode anything.
+ */
+GeglTileBackend *
+xcf_tile_backend_dup (XcfTileBackend *backend)
+{
+  XcfTileBackend      *new_backend;
+  XcfTileBackendLevel *level;
+  gint                 z;
+
+  g_return_val_if_fail (XCF_IS_TILE_BACKEND (backend), NULL);
+
+  new_backend = XCF_TILE_BACKEND (
+    xcf_tile_backend_new (backend->gimp,
+                          backend->file,
+                          backend->mapped_file,
+                          backend->compression,
+                          backend->zstd_dict,
+                          backend->file_version,
+                          gegl_tile_backend_get_format (
+                            GEGL_TILE_BACKEND (backend)),
+                          backend->levels[0].width,
+                          backend->levels[0].height,
+                          backend->levels[0].offsets,
+                          backend->levels[0].lengths));
+
+  for (z = 1; z < backend->n_levels; z++)
+    {
+      xcf_tile_backend_add_level (new_backend,
+                                  backend->levels[z].width,
+                                  backend->levels[z].height,
+                                  backend->levels[z].offsets,
+                                  backend->levels[z].lengths);
+    }
+
+  g_mutex_lock (&backend->mutex);
+
+  for (z = 1; z < backend->n_levels; z++)
+    {
+      level = &backend->levels[z];
+
+      memcpy (new_backend->levels[z].stale, level->stale,
+              level->n_tile_rows * level->n_tile_cols * sizeof (gboolean));
+    }
+
+  level = &backend->levels[0];
+
+  memcpy (new_backend->states, backend->states,
+          level->n_tile_rows * level->n_tile_cols * sizeof (XcfTileState));
+
+  if (backend->tiles)
+    new_backend->tiles = gegl_buffer_dup (backend->tiles);
+
+  /* the duplicate reads the same broken tiles, the user knows */
+  new_backend->decode_failed = backend->decode_failed;
+
+  g_mutex_unlock (&backend->mutex);
+
+  return GEGL_TILE_BACKEND (new_backend);
+}
+
+/* adds the next reduced-resolution level stored in the file, which is
+ * then used as the buffer's mipmap level.  levels must be added in
+ * order, and before the backend is used.
+ */
+void
+xcf_tile_backend_add_level (XcfTileBackend *backend,
+                            gint            width,
+                            gint            height,
+                            const goffset  *offsets,
+                            const gint     *lengths)
+{
+  g_return_if_fail (XCF_IS_TILE_BACKEND (backend));
+  g_return_if_fail (width > 0 && height > 0);
+  g_return_if_fail (offsets != NULL);
+  g_return_if_fail (lengths != NULL);
+
+  backend->levels = g_renew (XcfTileBackendLevel, backend->levels,
+                             backend->n_levels + 1);
+
+  xcf_tile_backend_level_init (&backend->levels[backend->n_levels++],
+                               width, height, offsets, lengths);
+}
+
+/* stops using the stored mipmap tiles covering 'rect' of the top level,
+ * after it changed.  this may be called from any thread.
+ */
+void
+xcf_tile_backend_invalidate (XcfTileBackend      *backend,
+                             const GeglRectangle *rect)
+{
+  GeglRectangle area;
+  gint          z;
+
+  g_return_if_fail (XCF_IS_TILE_BACKEND (backend));
+  g_return_if_fail (rect != NULL);
+
+  if (! gegl_rectangle_intersect (&area, rect,
+                                  GEGL_RECTANGLE (0, 0,
+                                                  backend->levels[0].width,
+                                                  backend->levels[0].height)))
+    {
+      return;
+    }
+
+  g_mutex_lock (&backend->mutex);
+
+  for (z = 1; z < backend->n_levels; z++)
+    {
+      XcfTileBackendLevel *level = &backend->levels[z];
+      gint                 x1    = (area.x >> z) / XCF_TILE_WIDTH;
+      gint                 y1    = (area.y >> z) / XCF_TILE_HEIGHT;
+      gint                 x2    = ((area.x + area.width  - 1) >> z) /
+                                   XCF_TILE_WIDTH;
+      gint                 y2    = ((area.y + area.height - 1) >> z) /
+                                   XCF_TILE_HEIGHT;
+      gint                 x;
+      gint                 y;
+
+      x2 = MIN (x2, level->n_tile_cols - 1);
+      y2 = MIN (y2, level->n_tile_rows - 1);
+
+      for (y = y1; y <= y2; y++)
+        {
+          for (x = x1; x <= x2; x++)
+            level->stale[y * level->n_tile_cols + x] = TRUE;
+        }
+    }
+
+  g_mutex_unlock (&backend->mutex);
+}
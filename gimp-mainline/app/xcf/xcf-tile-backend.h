@@ -0,0 +1,122 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_BACKEND_H__
+#define __XCF_TILE_BACKEND_H__
+
+
+#include <gegl-buffer-backend.h>
+
+
+#define XCF_TYPE_TILE_BACKEND            (xcf_tile_backend_get_type ())
+#define XCF_TILE_BACKEND(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XCF_TYPE_TILE_BACKEND, XcfTileBackend))
+#define XCF_TILE_BACKEND_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  XCF_TYPE_TILE_BACKEND, XcfTileBackendClass))
+#define XCF_IS_TILE_BACKEND(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XCF_TYPE_TILE_BACKEND))
+#define XCF_IS_TILE_BACKEND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  XCF_TYPE_TILE_BACKEND))
+#define XCF_TILE_BACKEND_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  XCF_TYPE_TILE_BACKEND, XcfTileBackendClass))
+
+
+typedef enum
+{
+  XCF_TILE_IN_FILE, /* read from the file on demand          */
+  XCF_TILE_WRITTEN, /* written since loading, in 'tiles'     */
+  XCF_TILE_VOID     /* removed since loading                 */
+} XcfTileState;
+
+
+typedef struct _XcfTileBackendLevel XcfTileBackendLevel;
+typedef struct _XcfTileBackend      XcfTileBackend;
+typedef struct _XcfTileBackendClass XcfTileBackendClass;
+
+struct _XcfTileBackendLevel
+{
+  gint                 width;
+  gint                 height;
+  gint                 n_tile_rows;
+  gint                 n_tile_cols;
+
+  /* the location of each tile's data in 'mapped_file'  */
+  goffset             *offsets;
+  gint                *lengths;
+
+  /* the tiles of a reduced-resolution level which no longer match the
+   * top level
+   */
+  gboolean            *stale;
+};
+
+struct _XcfTileBackend
+{
+  GeglTileBackend      parent_instance;
+
+  Gimp                *gimp;
+  GFile               *file;
+  GMappedFile         *mapped_file;
+  XcfCompressionType   compression;
+  XcfZstdDict         *zstd_dict;
+  gint                 file_version;
+
+  /* the top level, followed by the stored reduced-resolution levels  */
+  gint                 n_levels;
+  XcfTileBackendLevel *levels;
+
+  /* the state of each top level tile, and the tiles written since
+   * loading, which live in swap-backed storage rather than in memory.
+   * the file itself is never written to.
+   */
+  GMutex               mutex;
+  XcfTileState        *states;
+  GeglBuffer          *tiles;
+
+  /* set once a top level tile failed to decode, which is reported to
+   * the user on the main thread
+   */
+  gboolean             decode_failed;
+};
+
+struct _XcfTileBackendClass
+{
+  GeglTileBackendClass  parent_class;
+};
+
+
+GType             xcf_tile_backend_get_type   (void) G_GNUC_CONST;
+
+GeglTileBackend * xcf_tile_backend_new        (Gimp                *gimp,
+                                               GFile               *file,
+                                               GMappedFile         *mapped_file,
+                                               XcfCompressionType   compression,
+                                               XcfZstdDict         *zstd_dict,
+                                               gint                 file_version,
+                                               const Babl          *format,
+                                               gint                 width,
+                                               gint                 height,
+                                               const goffset       *offsets,
+                                               const gint          *lengths);
+
+GeglTileBackend * xcf_tile_backend_dup        (XcfTileBackend      *backend);
+
+void              xcf_tile_backend_add_level  (XcfTileBackend      *backend,
+                                               gint                 width,
+                                               gint                 height,
+                                               const goffset       *offsets,
+                                               const gint          *lengths);
+void              xcf_tile_backend_invalidate (XcfTileBackend      *backend,
+                                               const GeglRectangle *rect);
+
+
+#endif  /* __XCF_TILE_BACKEND_H__ */
@@ -0,0 +1,380 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core/core-types.h"
+
+#include "gegl/gimp-gegl-tile-compat.h"
+
+#include "core/gimpdrawable.h"
+
+#include "xcf-private.h"
+#include "xcf-tile-index.h"
+#include "xcf-zstd.h"
+
+
+#define XCF_TILE_INDEX_KEY "gimp-xcf-tile-index"
+
+
+static gboolean       xcf_tile_index_supports   (GimpDrawable       *drawable);
+static XcfTileIndex * xcf_tile_index_copy       (const XcfTileIndex *index);
+static gboolean       xcf_tile_index_query_file (GFile              *file,
+                                                 guint64            *size,
+                                                 guint64            *mtime);
+
+
+/*  public functions  */
+
+XcfTileIndex *
+xcf_tile_index_new (XcfInfo       *info,
+                    GeglBuffer    *buffer,
+                    const goffset *offsets,
+                    const gint    *lengths)
+{
+  XcfTileIndex *index;
+
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (lengths != NULL, NULL);
+
+  /* there is nothing to reuse from a memory stream */
+  if (! info->file)
+    return NULL;
+
+  index = g_slice_new0 (XcfTileIndex);
+
+  index->file         = g_object_ref (info->file);
+  index->file_version = info->file_version;
+  index->compression  = info->compression;
+  index->zstd_dict_id = xcf_zstd_dict_get_id (info->zstd_dict);
+  index->format       = gegl_buffer_get_format (buffer);
+  index->width        = gegl_buffer_get_width  (buffer);
+  index->height       = gegl_buffer_get_height (buffer);
+
+  xcf_tile_index_add_level (
+    index,
+    gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT) *
+    gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH),
+    offsets, lengths);
+
+  return index;
+}
+
+void
+xcf_tile_index_free (XcfTileIndex *index)
+{
+  gint i;
+
+  g_return_if_fail (index != NULL);
+
+  for (i = 0; i < index->n_levels; i++)
+    {
+      g_free (index->levels[i].offsets);
+      g_free (index->levels[i].lengths);
+    }
+
+  g_object_unref (index->file);
+  g_free (index->levels);
+
+  g_slice_free (XcfTileIndex, index);
+}
+
+/* adds the next level to 'index'.  levels must be added in order,
+ * starting with the top level.
+ */
+void
+xcf_tile_index_add_level (XcfTileIndex  *index,
+                          gint           n_tiles,
+                          const goffset *offsets,
+                          const gint    *lengths)
+{
+  XcfTileIndexLevel *level;
+
+  g_return_if_fail (index != NULL);
+  g_return_if_fail (n_tiles > 0);
+  g_return_if_fail (offsets != NULL);
+  g_return_if_fail (lengths != NULL);
+
+  index->levels = g_renew (XcfTileIndexLevel, index->levels,
+                           index->n_levels + 1);
+
+  level = &index->levels[index->n_levels++];
+
+  level->n_tiles = n_tiles;
+  level->offsets = g_memdup (offsets, n_tiles * sizeof (goffset));
+  level->lengths = g_memdup (lengths, n_tiles * sizeof (gint));
+}
+
+/* remembers the size and modification time of the index' file, which
+ * must not change for the index to stay valid.  call this once the file
+ * is complete.
+ */
+gboolean
+xcf_tile_index_update_file (XcfTileIndex *index)
+{
+  g_return_val_if_fail (index != NULL, FALSE);
+
+  if (! xcf_tile_index_query_file (index->file,
+                                   &index->file_size, &index->file_mtime))
+    {
+      index->file_size  = 0;
+      index->file_mtime = 0;
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* attaches 'index' to 'drawable', replacing any previous index, and
+ * takes ownership of it.  the index only stays reusable as long as the
+ * drawable's pixels don't change.  returns FALSE, leaving 'index' to
+ * the caller, if 'drawable' can't keep an index.
+ */
+gboolean
+xcf_tile_index_attach (XcfTileIndex *index,
+                       GimpDrawable *drawable)
+{
+  g_return_val_if_fail (index != NULL, FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+
+  if (! xcf_tile_index_supports (drawable))
+    return FALSE;
+
+  index->generation = gimp_drawable_get_dirty_generation (drawable);
+
+  g_object_set_data_full (G_OBJECT (drawable), XCF_TILE_INDEX_KEY,
+                          index, (GDestroyNotify) xcf_tile_index_free);
+
+  return TRUE;
+}
+
+/* attaches a copy of the index attached to 'src', if 'src' didn't change
+ * since, to 'dest', which has the same pixels as 'src' had at its dirty
+ * 'dest_generation'.  this carries indices between an image and the
+ * snapshot it is saved from.
+ */
+void
+xcf_tile_index_copy_attached (GimpDrawable *src,
+                              GimpDrawable *dest,
+                              guint         dest_generation)
+{
+  XcfTileIndex *index;
+
+  g_return_if_fail (GIMP_IS_DRAWABLE (src));
+  g_return_if_fail (GIMP_IS_DRAWABLE (dest));
+
+  if (! xcf_tile_index_supports (dest))
+    return;
+
+  index = g_object_get_data (G_OBJECT (src), XCF_TILE_INDEX_KEY);
+
+  if (! index || index->file_size == 0 ||
+      index->generation != gimp_drawable_get_dirty_generation (src))
+    {
+      return;
+    }
+
+  index = xcf_tile_index_copy (index);
+
+  index->generation = dest_generation;
+
+  g_object_set_data_full (G_OBJECT (dest), XCF_TILE_INDEX_KEY,
+                          index, (GDestroyNotify) xcf_tile_index_free);
+}
+
+/* returns the index attached to 'drawable', if its tiles can be copied
+ * as they are into the file described by 'info', or NULL otherwise.
+ */
+XcfTileIndex *
+xcf_tile_index_get_reusable (GimpDrawable *drawable,
+                             XcfInfo      *info)
+{
+  XcfTileIndex *index;
+  GeglBuffer   *buffer;
+  guint64       size;
+  guint64       mtime;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+
+  if (! xcf_tile_index_supports (drawable))
+    return NULL;
+
+  index = g_object_get_data (G_OBJECT (drawable), XCF_TILE_INDEX_KEY);
+
+  if (! index || index->file_size == 0)
+    return NULL;
+
+  buffer = gimp_drawable_get_buffer (drawable);
+
+  /* the pixels must be unchanged, and encoded the same way the new file
+   * would encode them
+   */
+  if (index->generation  != gimp_drawable_get_dirty_generation (drawable) ||
+      index->format      != gegl_buffer_get_format (buffer)              ||
+      index->width       != gegl_buffer_get_width  (buffer)              ||
+      index->height      != gegl_buffer_get_height (buffer)              ||
+      index->compression != info->compression                            ||
+      index->zstd_dict_id != xcf_zstd_dict_get_id (info->zstd_dict)      ||
+      (index->file_version >= 12) != (info->file_version >= 12))
+    {
+      return NULL;
+    }
+
+  /* and the file must still be the one we indexed */
+  if (! xcf_tile_index_query_file (index->file, &size, &mtime) ||
+      size  != index->file_size                                ||
+      mtime != index->file_mtime)
+    {
+      return NULL;
+    }
+
+  return index;
+}
+
+/* reads the on-disk data of 'tile' of 'level' into 'data', and returns
+ * its length, or -1 on error.  the file is kept open in 'info' across
+ * calls.
+ */
+gint
+xcf_tile_index_read_tile (XcfTileIndex  *index,
+                          XcfInfo       *info,
+                          gint           level,
+                          gint           tile,
+                          guchar        *data,
+                          gint           max_data_length,
+                          GError       **error)
+{
+  XcfTileIndexLevel *index_level;
+  gsize              bytes_read;
+  gint               length;
+
+  g_return_val_if_fail (index != NULL, -1);
+  g_return_val_if_fail (info != NULL, -1);
+  g_return_val_if_fail (level >= 0 && level < index->n_levels, -1);
+
+  index_level = &index->levels[level];
+
+  g_return_val_if_fail (tile >= 0 && tile < index_level->n_tiles, -1);
+
+  if (! info->tile_source_file ||
+      ! g_file_equal (info->tile_source_file, index->file))
+    {
+      g_clear_object (&info->tile_source);
+      g_clear_object (&info->tile_source_file);
+
+      info->tile_source = G_INPUT_STREAM (g_file_read (index->file,
+                                                       NULL, error));
+
+      if (! info->tile_source)
+        return -1;
+
+      info->tile_source_file = g_object_ref (index->file);
+    }
+
+  if (! g_seekable_seek (G_SEEKABLE (info->tile_source),
+                         index_level->offsets[tile], G_SEEK_SET,
+                         NULL, error))
+    {
+      return -1;
+    }
+
+  length = MIN (index_level->lengths[tile], max_data_length);
+
+  /* the last tile's length may reach past the end of the file */
+  if (! g_input_stream_read_all (info->tile_source, data, length,
+                                 &bytes_read, NULL, error))
+    {
+      return -1;
+    }
+
+  return bytes_read;
+}
+
+
+/*  private functions  */
+
+/* the pixels of drawables with children, i.e. group layers, are rendered
+ * from the children into the drawable's buffer, which doesn't count as a
+ * change of the drawable.  their tiles are never reused.
+ */
+static gboolean
+xcf_tile_index_supports (GimpDrawable *drawable)
+{
+  return gimp_viewable_get_children (GIMP_VIEWABLE (drawable)) == NULL;
+}
+
+static XcfTileIndex *
+xcf_tile_index_copy (const XcfTileIndex *index)
+{
+  XcfTileIndex *copy;
+  gint          i;
+
+  copy = g_slice_dup (XcfTileIndex, index);
+
+  copy->file   = g_object_ref (index->file);
+  copy->levels = g_memdup (index->levels,
+                           index->n_levels * sizeof (XcfTileIndexLevel));
+
+  for (i = 0; i < index->n_levels; i++)
+    {
+      XcfTileIndexLevel *level = &copy->levels[i];
+
+      level->offsets = g_memdup (level->offsets,
+                                 level->n_tiles * sizeof (goffset));
+      level->lengths = g_memdup (level->lengths,
+                                 level->n_tiles * sizeof (gint));
+    }
+
+  return copy;
+}
+
+static gboolean
+xcf_tile_index_query_file (GFile   *file,
+                           guint64 *size,
+                           guint64 *mtime)
+{
+  GFileInfo *info;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE,
+                            NULL, NULL);
+
+  if (! info)
+    return FALSE;
+
+  *size  = g_file_info_get_size (info);
+  *mtime = g_file_info_get_attribute_uint64 (info,
+                                             G_FILE_ATTRIBUTE_TIME_MODIFIED) *
+           G_USEC_PER_SEC +
+           g_file_info_get_attribute_uint32 (info,
+                                             G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+
+  g_object_unref (info);
+
+  return *size > 0;
+}
@@ -0,0 +1,86 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_INDEX_H__
+#define __XCF_TILE_INDEX_H__
+
+
+/* where the tiles of a drawable's levels are stored in an XCF file, so
+ * a later save can copy them instead of encoding them again.
+ */
+typedef struct _XcfTileIndexLevel XcfTileIndexLevel;
+typedef struct _XcfTileIndex      XcfTileIndex;
+
+struct _XcfTileIndexLevel
+{
+  gint                n_tiles;
+  goffset            *offsets;
+  gint               *lengths;
+};
+
+struct _XcfTileIndex
+{
+  GFile              *file;
+  guint64             file_size;   /* 0 until the file is complete  */
+  guint64             file_mtime;
+  guint               generation;  /* the drawable's dirty generation  */
+
+  gint                file_version;
+  XcfCompressionType  compression;
+  guint               zstd_dict_id;
+  const Babl         *format;
+  gint                width;
+  gint                height;
+
+  /* the top level, followed by the stored reduced-resolution levels  */
+  gint                n_levels;
+  XcfTileIndexLevel  *levels;
+};
+
+
+XcfTileIndex * xcf_tile_index_new          (XcfInfo        *info,
+                                            GeglBuffer     *buffer,
+                                            const goffset  *offsets,
+                                            const gint     *lengths);
+void           xcf_tile_index_free         (XcfTileIndex   *index);
+
+void           xcf_tile_index_add_level    (XcfTileIndex   *index,
+                                            gint            n_tiles,
+                                            const goffset  *offsets,
+                                            const gint     *lengths);
+
+gboolean       xcf_tile_index_update_file  (XcfTileIndex   *index);
+
+gboolean       xcf_tile_index_attach       (XcfTileIndex   *index,
+                                            GimpDrawable   *drawable);
+void           xcf_tile_index_copy_attached
+                                           (GimpDrawable   *src,
+                                            GimpDrawable   *dest,
+                                            guint           dest_generation);
+XcfTileIndex * xcf_tile_index_get_reusable (GimpDrawable   *drawable,
+                                            XcfInfo        *info);
+
+gint           xcf_tile_index_read_tile    (XcfTileIndex   *index,
+                                            XcfInfo        *info,
+                                            gint            level,
+                                            gint            tile,
+                                            guchar         *data,
+                                            gint            max_data_length,
+                                            GError        **error);
+
+
+#endif  /* __XCF_TILE_INDEX_H__ */
@@ -51,3 +51,14 @@ xcf_data_is_zero (const void *data,
 
   return TRUE;
 }
+
+/* returns the width or height of the reduced-resolution 'level' of a
+ * drawable of 'size'.  each level halves the previous one, rounding up,
+ * the same as GEGL's mipmap levels.
+ */
+gint
+xcf_get_level_size (gint size,
+                    gint level)
+{
+  return (size + (1 << level) - 1) >> level;
+}
@@ -19,8 +19,11 @@
 #define __XCF_UTILS_H__
 
 
-gboolean   xcf_data_is_zero (const void *data,
-                             gint        size);
+gboolean   xcf_data_is_zero   (const void *data,
+                               gint        size);
+
+gint       xcf_get_level_size (gint        size,
+                               gint        level);
 
 
 #endif  /* __XCF_UTILS_H__ */
@@ -0,0 +1,370 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <zstd.h>
+#include <zdict.h>
+
+#include <cairo.h>
+#include <gegl.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include "core/core-types.h"
+
+#include "core/gimpimage.h"
+
+#include "xcf-private.h"
+#include "xcf-zstd.h"
+
+
+#define XCF_ZSTD_DICT_KEY        "gimp-xcf-zstd-dict"
+#define XCF_ZSTD_TRAIN_DICT_SIZE (32 * 1024)
+
+
+struct _XcfZstdDict
+{
+  gint        ref_count;
+
+  GBytes     *data;
+  guint       id;
+  ZSTD_DDict *ddict;
+
+  /* the dictionary digested for each compression level it was used with */
+  GMutex      mutex;
+  GHashTable *cdicts;
+};
+
+
+static ZSTD_CCtx  * xcf_zstd_get_cctx       (void);
+static ZSTD_DCtx  * xcf_zstd_get_dctx       (void);
+static ZSTD_CDict * xcf_zstd_dict_get_cdict (XcfZstdDict *dict,
+                                             gint         level);
+
+
+/* zstd contexts are expensive to create, but can't be shared between
+ * threads, so each thread keeps its own
+ */
+static GPrivate cctx_private = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeCCtx);
+static GPrivate dctx_private = G_PRIVATE_INIT ((GDestroyNotify) ZSTD_freeDCtx);
+
+
+/*  public functions  */
+
+/* returns a dictionary made of the 'size' bytes of 'data', or NULL if
+ * they aren't a valid zstd dictionary
+ */
+XcfZstdDict *
+xcf_zstd_dict_new (const guint8 *data,
+                   gsize         size)
+{
+  XcfZstdDict *dict;
+  ZSTD_DDict  *ddict;
+  guint        id;
+
+  g_return_val_if_fail (data != NULL || size == 0, NULL);
+
+  if (size == 0 || size > XCF_ZSTD_MAX_DICT_SIZE)
+    return NULL;
+
+  id = ZDICT_getDictID (data, size);
+
+  if (id == 0)
+    return NULL;
+
+  ddict = ZSTD_createDDict (data, size);
+
+  if (! ddict)
+    return NULL;
+
+  dict = g_slice_new0 (XcfZstdDict);
+
+  dict->ref_count = 1;
+  dict->data      = g_bytes_new (data, size);
+  dict->id        = id;
+  dict->ddict     = ddict;
+
+  g_mutex_init (&dict->mutex);
+
+  dict->cdicts = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                        NULL,
+                                        (GDestroyNotify) ZSTD_freeCDict);
+
+  return dict;
+}
+
+/* trains a dictionary on 'n_samples' samples, stored back to back in
+ * 'samples'.  returns NULL if there isn't enough data to train on.
+ */
+XcfZstdDict *
+xcf_zstd_dict_train (const guint8 *samples,
+                     const gsize  *sample_sizes,
+                     gint          n_samples)
+{
+  XcfZstdDict *dict;
+  guint8      *data;
+  gsize        size;
+
+  g_return_val_if_fail (samples != NULL, NULL);
+  g_return_val_if_fail (sample_sizes != NULL, NULL);
+
+  if (n_samples <= 0)
+    return NULL;
+
+  data = g_malloc (XCF_ZSTD_TRAIN_DICT_SIZE);
+
+  size = ZDICT_trainFromBuffer (data, XCF_ZSTD_TRAIN_DICT_SIZE,
+                                samples, sample_sizes, n_samples);
+
+  if (ZDICT_isError (size))
+    {
+      g_free (data);
+
+      return NULL;
+    }
+
+  dict = xcf_zstd_dict_new (data, size);
+
+  g_free (data);
+
+  return dict;
+}
+
+XcfZstdDict *
+xcf_zstd_dict_ref (XcfZstdDict *dict)
+{
+  g_return_val_if_fail (dict != NULL, NULL);
+
+  g_atomic_int_inc (&dict->ref_count);
+
+  return dict;
+}
+
+void
+xcf_zstd_dict_unref (XcfZstdDict *dict)
+{
+  g_return_if_fail (dict != NULL);
+
+  if (g_atomic_int_dec_and_test (&dict->ref_count))
+    {
+      g_hash_table_unref (dict->cdicts);
+      g_mutex_clear (&dict->mutex);
+
+      ZSTD_freeDDict (dict->ddict);
+      g_bytes_unref (dict->data);
+
+      g_slice_free (XcfZstdDict, dict);
+    }
+}
+
+const guint8 *
+xcf_zstd_dict_get_data (XcfZstdDict *dict,
+                        gsize       *size)
+{
+  g_return_val_if_fail (dict != NULL, NULL);
+  g_return_val_if_fail (size != NULL, NULL);
+
+  return g_bytes_get_data (dict->data, size);
+}
+
+/* returns the id stored in the dictionary, or 0 for no dictionary.
+ * tiles compressed with one dictionary can be decompressed with any
+ * dictionary of the same id.
+ */
+guint
+xcf_zstd_dict_get_id (XcfZstdDict *dict)
+{
+  return dict ? dict->id : 0;
+}
+
+/* keeps 'dict' with 'image', so the next save can reuse it, and can
+ * copy the tiles compressed with it.  replaces any previous dictionary.
+ */
+void
+xcf_zstd_dict_attach (XcfZstdDict *dict,
+                      GimpImage   *image)
+{
+  g_return_if_fail (dict != NULL);
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  g_object_set_data_full (G_OBJECT (image), XCF_ZSTD_DICT_KEY,
+                          xcf_zstd_dict_ref (dict),
+                          (GDestroyNotify) xcf_zstd_dict_unref);
+}
+
+XcfZstdDict *
+xcf_zstd_dict_get_attached (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+
+  return g_object_get_data (G_OBJECT (image), XCF_ZSTD_DICT_KEY);
+}
+
+/* compresses the 'src_size' bytes of 'src' into 'dest', using 'dict' if
+ * it's not NULL.  returns the compressed length, or -1 if it failed or
+ * didn't fit in 'max_dest_size' bytes.  may be called from any thread.
+ */
+gint
+xcf_zstd_compress (XcfZstdDict  *dict,
+                   gint          level,
+                   const guchar *src,
+                   gint          src_size,
+                   guchar       *dest,
+                   gint          max_dest_size)
+{
+  ZSTD_CCtx *cctx = xcf_zstd_get_cctx ();
+  gsize      size;
+
+  if (! cctx)
+    return -1;
+
+  if (dict)
+    {
+      ZSTD_CDict *cdict = xcf_zstd_dict_get_cdict (dict, level);
+
+      if (! cdict)
+        return -1;
+
+      size = ZSTD_compress_usingCDict (cctx,
+                                       dest, max_dest_size,
+                                       src,  src_size,
+                                       cdict);
+    }
+  else
+    {
+      size = ZSTD_compressCCtx (cctx,
+                                dest, max_dest_size,
+                                src,  src_size,
+                                level);
+    }
+
+  if (ZSTD_isError (size))
+    return -1;
+
+  return size;
+}
+
+/* decompresses the frame at the start of the 'src_size' bytes of 'src'
+ * into the 'dest_size' bytes of 'dest'.  'src' may contain trailing data
+ * after the frame.  returns FALSE unless the frame was exactly 'dest_size'
+ * bytes long.  may be called from any thread.
+ */
+gboolean
+xcf_zstd_decompress (XcfZstdDict  *dict,
+                     const guchar *src,
+                     gint          src_size,
+                     guchar       *dest,
+                     gint          dest_size)
+{
+  ZSTD_DCtx *dctx = xcf_zstd_get_dctx ();
+  gsize      frame_size;
+  gsize      size;
+
+  if (! dctx || src_size <= 0)
+    return FALSE;
+
+  frame_size = ZSTD_findFrameCompressedSize (src, src_size);
+
+  if (ZSTD_isError (frame_size))
+    return FALSE;
+
+  if (dict)
+    {
+      size = ZSTD_decompress_usingDDict (dctx,
+                                         dest, dest_size,
+                                         src,  frame_size,
+                                         dict->ddict);
+    }
+  else
+    {
+      size = ZSTD_decompressDCtx (dctx,
+                                  dest, dest_size,
+                                  src,  frame_size);
+    }
+
+  if (ZSTD_isError (size))
+    {
+      g_printerr ("xcf: tile decompression failed: %s",
+                  ZSTD_getErrorName (size));
+      return FALSE;
+    }
+
+  return size == dest_size;
+}
+
+
+/*  private functions  */
+
+static ZSTD_CCtx *
+xcf_zstd_get_cctx (void)
+{
+  ZSTD_CCtx *cctx = g_private_get (&cctx_private);
+
+  if (! cctx)
+    {
+      cctx = ZSTD_createCCtx ();
+
+      g_private_set (&cctx_private, cctx);
+    }
+
+  return cctx;
+}
+
+static ZSTD_DCtx *
+xcf_zstd_get_dctx (void)
+{
+  ZSTD_DCtx *dctx = g_private_get (&dctx_private);
+
+  if (! dctx)
+    {
+      dctx = ZSTD_createDCtx ();
+
+      g_private_set (&dctx_private, dctx);
+    }
+
+  return dctx;
+}
+
+static ZSTD_CDict *
+xcf_zstd_dict_get_cdict (XcfZstdDict *dict,
+                         gint         level)
+{
+  ZSTD_CDict *cdict;
+
+  g_mutex_lock (&dict->mutex);
+
+  cdict = g_hash_table_lookup (dict->cdicts, GINT_TO_POINTER (level));
+
+  if (! cdict)
+    {
+      const guint8 *data;
+      gsize         size;
+
+      data = g_bytes_get_data (dict->data, &size);
+
+      cdict = ZSTD_createCDict (data, size, level);
+
+      if (cdict)
+        {
+          g_hash_table_insert (dict->cdicts, GINT_TO_POINTER (level), cdict);
+        }
+    }
+
+  g_mutex_unlock (&dict->mutex);
+
+  return cdict;
+}
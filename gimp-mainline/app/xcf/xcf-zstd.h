@@ -0,0 +1,56 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_ZSTD_H__
+#define __XCF_ZSTD_H__
+
+
+/* the largest dictionary we accept from a file */
+#define XCF_ZSTD_MAX_DICT_SIZE (1 << 20)
+
+
+XcfZstdDict  * xcf_zstd_dict_new          (const guint8  *data,
+                                           gsize          size);
+XcfZstdDict  * xcf_zstd_dict_train        (const guint8  *samples,
+                                           const gsize   *sample_sizes,
+                                           gint           n_samples);
+
+XcfZstdDict  * xcf_zstd_dict_ref          (XcfZstdDict   *dict);
+void           xcf_zstd_dict_unref        (XcfZstdDict   *dict);
+
+const guint8 * xcf_zstd_dict_get_data     (XcfZstdDict   *dict,
+                                           gsize         *size);
+guint          xcf_zstd_dict_get_id       (XcfZstdDict   *dict);
+
+void           xcf_zstd_dict_attach       (XcfZstdDict   *dict,
+                                           GimpImage     *image);
+XcfZstdDict  * xcf_zstd_dict_get_attached (GimpImage     *image);
+
+gint           xcf_zstd_compress          (XcfZstdDict   *dict,
+                                           gint           level,
+                                           const guchar  *src,
+                                           gint           src_size,
+                                           guchar        *dest,
+                                           gint           max_dest_size);
+gboolean       xcf_zstd_decompress        (XcfZstdDict   *dict,
+                                           const guchar  *src,
+                                           gint           src_size,
+                                           guchar        *dest,
+                                           gint           dest_size);
+
+
+#endif  /* __XCF_ZSTD_H__ */
@@ -29,11 +29,23 @@
 
 #include "core/core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "core/gimp.h"
+#include "core/gimp-gui.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpasync.h"
+#include "core/gimpasyncset.h"
+#include "core/gimpchannel.h"
+#include "core/gimpcontainer.h"
 #include "core/gimpimage.h"
+#include "core/gimpimage-duplicate.h"
 #include "core/gimpdrawable.h"
+#include "core/gimplayer.h"
+#include "core/gimplayermask.h"
 #include "core/gimpparamspecs.h"
 #include "core/gimpprogress.h"
+#include "core/gimpuncancelablewaitable.h"
 
 #include "plug-in/gimppluginmanager.h"
 #include "plug-in/gimppluginprocedure.h"
@@ -43,27 +55,83 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-tile-index.h"
+#include "xcf-zstd.h"
 
 #include "gimp-intl.h"
 
 
+#define XCF_SAVE_ASYNC_KEY         "gimp-xcf-save-async"
+#define XCF_SAVE_PROGRESS_INTERVAL 100 /* milliseconds */
+
+
 typedef GimpImage * GimpXcfLoaderFunc (Gimp     *gimp,
                                        XcfInfo  *info,
                                        GError  **error);
 
+typedef struct _XcfSaveJob XcfSaveJob;
+
+struct _XcfSaveJob
+{
+  XcfInfo        info;
+
+  GimpImage     *image;
+  GimpImage     *snapshot;
+  GOutputStream *output;
+
+  /* whether 'image' copies its tiles from the new file when saved
+   * again, which autosaves don't want
+   */
+  gboolean       remember_tiles;
+
+  GimpProgress  *progress;    /* weak pointer */
+  guint          progress_id;
+
+  /* the drawables of 'image' and 'snapshot', pairwise, and the dirty
+   * generations of the former when the snapshot was taken
+   */
+  GList         *drawables;
+  GList         *snapshot_drawables;
+  GArray        *generations;
+
+  GError        *error;
+};
+
 
-static GimpValueArray * xcf_load_invoker (GimpProcedure         *procedure,
-                                          Gimp                  *gimp,
-                                          GimpContext           *context,
-                                          GimpProgress          *progress,
-                                          const GimpValueArray  *args,
-                                          GError               **error);
-static GimpValueArray * xcf_save_invoker (GimpProcedure         *procedure,
-                                          Gimp                  *gimp,
-                                          GimpContext           *context,
-                                          GimpProgress          *progress,
-                                          const GimpValueArray  *args,
-                                          GError               **error);
+static GimpValueArray * xcf_load_invoker        (GimpProcedure         *procedure,
+                                                 Gimp                  *gimp,
+                                                 GimpContext           *context,
+                                                 GimpProgress          *progress,
+                                                 const GimpValueArray  *args,
+                                                 GError               **error);
+static GimpValueArray * xcf_save_invoker        (GimpProcedure         *procedure,
+                                                 Gimp                  *gimp,
+                                                 GimpContext           *context,
+                                                 GimpProgress          *progress,
+                                                 const GimpValueArray  *args,
+                                                 GError               **error);
+static void             xcf_save_invoker_done   (GimpAsync             *async,
+                                                 GimpImage             *image);
+
+static const gchar    * xcf_get_filename        (GFile                 *file);
+
+static void             xcf_save_info_init      (XcfInfo               *info,
+                                                 Gimp                  *gimp,
+                                                 GimpImage             *image,
+                                                 GOutputStream         *output,
+                                                 GFile                 *output_file,
+                                                 GimpProgress          *progress);
+static gboolean         xcf_save_info_run       (XcfInfo               *info,
+                                                 GimpImage             *image,
+                                                 GError               **error);
+
+static GList          * xcf_save_get_drawables  (GimpImage             *image);
+
+static void             xcf_save_async_func     (GimpAsync             *async,
+                                                 XcfSaveJob            *job);
+static gboolean         xcf_save_async_progress (XcfSaveJob            *job);
+static void             xcf_save_async_callback (GimpAsync             *async,
+                                                 XcfSaveJob            *job);
 
 
 static GimpXcfLoaderFunc * const xcf_loaders[] =
@@ -82,9 +150,13 @@ static GimpXcfLoaderFunc * const xcf_loaders[] =
   xcf_load_image,   /* version 11 */
   xcf_load_image,   /* version 12 */
   xcf_load_image,   /* version 13 */
-  xcf_load_image    /* version 14 */
+  xcf_load_image,   /* version 14 */
+  xcf_load_image,   /* version 15 */
+  xcf_load_image    /* version 16 */
 };
 
+static GimpAsyncSet *xcf_save_async_set = NULL;
+
 
 void
 xcf_init (Gimp *gimp)
@@ -228,12 +300,16 @@ xcf_init (Gimp *gimp)
                                                           GIMP_PARAM_READWRITE));
   gimp_plug_in_manager_add_procedure (gimp->plug_in_manager, proc);
   g_object_unref (procedure);
+
+  xcf_save_async_set = gimp_async_set_new ();
 }
 
 void
 xcf_exit (Gimp *gimp)
 {
   g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_clear_object (&xcf_save_async_set);
 }
 
 GimpImage *
@@ -301,8 +377,24 @@ xcf_load_stream (Gimp          *gimp,
       if (info.file_version >= 0 &&
           info.file_version < G_N_ELEMENTS (xcf_loaders))
         {
+          if (gimp->config->xcf_lazy_load && input_file)
+            {
+              gchar *path = g_file_get_path (input_file);
+
+              /* the pixels are then decoded from a mapping of the file,
+               * when they are first accessed
+               */
+              if (path)
+                info.mapped_file = g_mapped_file_new (path, FALSE, NULL);
+
+              g_free (path);
+            }
+
           image = (*(xcf_loaders[info.file_version])) (gimp, &info, error);
 
+          g_clear_pointer (&info.mapped_file, g_mapped_file_unref);
+          g_clear_pointer (&info.zstd_dict,   xcf_zstd_dict_unref);
+
           if (! image)
             success = FALSE;
 
@@ -331,11 +423,8 @@ xcf_save_stream (Gimp           *gimp,
                  GimpProgress   *progress,
                  GError        **error)
 {
-  XcfInfo       info     = { 0, };
-  const gchar  *filename;
-  gboolean      success  = FALSE;
-  GError       *my_error = NULL;
-  GCancellable *cancellable;
+  XcfInfo   info = { 0, };
+  gboolean  success;
 
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
   g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
@@ -344,64 +433,169 @@ xcf_save_stream (Gimp           *gimp,
   g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
   g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-  if (output_file)
-    filename = gimp_file_get_utf8_name (output_file);
-  else
-    filename = _("Memory Stream");
+  xcf_save_info_init (&info, gimp, image, output, output_file, progress);
 
-  info.gimp             = gimp;
-  info.output           = output;
-  info.seekable         = G_SEEKABLE (output);
-  info.bytes_per_offset = 4;
-  info.progress         = progress;
-  info.file             = output_file;
+  if (progress)
+    gimp_progress_start (progress, FALSE, _("Saving '%s'"),
+                         xcf_get_filename (output_file));
 
-  if (gimp_image_get_xcf_compression (image))
-    info.compression = COMPRESS_ZLIB;
-  else
-    info.compression = COMPRESS_RLE;
+  success = xcf_save_info_run (&info, image, error);
 
-  info.file_version = gimp_image_get_xcf_version (image,
-                                                  info.compression ==
-                                                  COMPRESS_ZLIB,
-                                                  NULL, NULL, NULL);
+  if (progress)
+    gimp_progress_end (progress);
 
-  if (info.file_version >= 11)
-    info.bytes_per_offset = 8;
+  return success;
+}
 
-  if (progress)
-    gimp_progress_start (progress, FALSE, _("Saving '%s'"), filename);
+/* saves 'image' like xcf_save_stream(), but writes the file on a worker
+ * thread, so the image can be edited meanwhile.  the image is
+ * snapshotted before returning, and it's the snapshot that gets saved.
+ * the returned async finishes once the file is complete, or aborts if
+ * saving failed, in which case an error message has been shown.
+ * 'remember_tiles' makes later saves of the image copy unchanged tiles
+ * from this file, rather than the one the image was saved to before.
+ */
+GimpAsync *
+xcf_save_stream_async (Gimp          *gimp,
+                       GimpImage     *image,
+                       GOutputStream *output,
+                       GFile         *output_file,
+                       gboolean       remember_tiles,
+                       GimpProgress  *progress)
+{
+  XcfSaveJob  *job;
+  GimpAsync   *async;
+  XcfZstdDict *zstd_dict;
+  GList       *list;
+  GList       *snapshot_list;
 
-  success = xcf_save_image (&info, image, &my_error);
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+  g_return_val_if_fail (G_IS_OUTPUT_STREAM (output), NULL);
+  g_return_val_if_fail (output_file == NULL || G_IS_FILE (output_file), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
 
-  cancellable = g_cancellable_new ();
-  if (success)
+  /* the previous save of the image has to finish first, so the tile
+   * indices it leaves behind are the ones this save copies from
+   */
+  async = xcf_save_get_async (image);
+
+  if (async)
     {
-      if (progress)
-        gimp_progress_set_text (progress, _("Closing '%s'"), filename);
+      GimpWaitable *waitable;
+
+      waitable = gimp_uncancelable_waitable_new (GIMP_WAITABLE (async));
+
+      gimp_wait (gimp, waitable, _("Saving '%s'"),
+                 gimp_image_get_display_name (image));
+
+      g_object_unref (waitable);
     }
-  else
+
+  job = g_slice_new0 (XcfSaveJob);
+
+  job->image          = g_object_ref (image);
+  job->output         = g_object_ref (output);
+  job->remember_tiles = remember_tiles;
+
+  /* the snapshot's buffers share their tiles with the image's until
+   * either is modified, lazily loaded ones keep reading the file they
+   * were loaded from
+   */
+  job->snapshot = gimp_image_duplicate_snapshot (image);
+
+  gimp_image_set_xcf_compression (job->snapshot,
+                                  gimp_image_get_xcf_compression (image));
+
+  job->drawables          = xcf_save_get_drawables (image);
+  job->snapshot_drawables = xcf_save_get_drawables (job->snapshot);
+  job->generations        = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  /* let the snapshot copy unchanged tiles from the file the image was
+   * last saved to, like the image itself would
+   */
+  for (list = job->drawables, snapshot_list = job->snapshot_drawables;
+       list && snapshot_list;
+       list = g_list_next (list), snapshot_list = g_list_next (snapshot_list))
     {
-      /* When closing the stream, the image will be actually saved,
-       * unless we properly cancel it with a GCancellable.
-       * Not closing the stream is not an option either, as this will
-       * happen anyway when finalizing the output.
-       * So let's make sure now that we don't overwrite the XCF file
-       * when an error occurred.
-       */
-      g_cancellable_cancel (cancellable);
+      GimpDrawable *drawable          = list->data;
+      GimpDrawable *snapshot_drawable = snapshot_list->data;
+      guint         generation;
+
+      generation = gimp_drawable_get_dirty_generation (drawable);
+
+      g_array_append_val (job->generations, generation);
+
+      xcf_tile_index_copy_attached (
+        drawable, snapshot_drawable,
+        gimp_drawable_get_dirty_generation (snapshot_drawable));
     }
-  success = g_output_stream_close (info.output, cancellable, &my_error);
-  g_object_unref (cancellable);
 
-  if (! success && my_error)
-    g_propagate_prefixed_error (error, my_error,
-                                _("Error writing '%s': "), filename);
+  zstd_dict = xcf_zstd_dict_get_attached (image);
 
-  if (progress)
-    gimp_progress_end (progress);
+  if (zstd_dict)
+    xcf_zstd_dict_attach (zstd_dict, job->snapshot);
 
-  return success;
+  xcf_save_info_init (&job->info, gimp, image, output, output_file, NULL);
+
+  if (progress &&
+      gimp_progress_start (progress, FALSE, _("Saving '%s'"),
+                           xcf_get_filename (output_file)))
+    {
+      job->progress = progress;
+      g_object_add_weak_pointer (G_OBJECT (progress),
+                                 (gpointer) &job->progress);
+
+      job->progress_id = g_timeout_add (XCF_SAVE_PROGRESS_INTERVAL,
+                                        (GSourceFunc) xcf_save_async_progress,
+                                        job);
+    }
+
+  async = gimp_parallel_run_async_independent_full (
+    +1,
+    (GimpRunAsyncFunc) xcf_save_async_func,
+    job);
+
+  gimp_async_add_callback (async,
+                           (GimpAsyncCallback) xcf_save_async_callback,
+                           job);
+
+  gimp_async_set_add (xcf_save_async_set, async);
+
+  g_object_set_data_full (G_OBJECT (image), XCF_SAVE_ASYNC_KEY,
+                          g_object_ref (async),
+                          (GDestroyNotify) g_object_unref);
+
+  return async;
+}
+
+/* returns the pending asynchronous save of 'image', if any */
+GimpAsync *
+xcf_save_get_async (GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+
+  return g_object_get_data (G_OBJECT (image), XCF_SAVE_ASYNC_KEY);
+}
+
+/* waits for all pending asynchronous saves to finish */
+void
+xcf_save_wait (Gimp *gimp)
+{
+  GimpWaitable *waitable;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  if (! xcf_save_async_set || gimp_async_set_is_empty (xcf_save_async_set))
+    return;
+
+  /* don't allow cancellation, the files would be left incomplete */
+  waitable = gimp_uncancelable_waitable_new (
+    GIMP_WAITABLE (xcf_save_async_set));
+
+  gimp_wait (gimp, waitable, _("Saving images"));
+
+  g_object_unref (waitable);
 }
 
 
@@ -460,6 +654,7 @@ xcf_save_invoker (GimpProcedure         *procedure,
                   GError               **error)
 {
   GimpValueArray *return_vals;
+  GimpRunMode     run_mode;
   GimpImage      *image;
   GFile          *file;
   GOutputStream  *output;
@@ -468,8 +663,9 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   gimp_set_busy (gimp);
 
-  image = g_value_get_object (gimp_value_array_index (args, 1));
-  file  = g_value_get_object (gimp_value_array_index (args, 4));
+  run_mode = g_value_get_enum   (gimp_value_array_index (args, 0));
+  image    = g_value_get_object (gimp_value_array_index (args, 1));
+  file     = g_value_get_object (gimp_value_array_index (args, 4));
 
   output = G_OUTPUT_STREAM (g_file_replace (file,
                                             NULL, FALSE, G_FILE_CREATE_NONE,
@@ -477,7 +673,30 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   if (output)
     {
-      success = xcf_save_stream (gimp, image, output, file, progress, error);
+      /* scripts expect the file to be there when the call returns */
+      if (run_mode != GIMP_RUN_NONINTERACTIVE &&
+          gimp->config->xcf_save_async)
+        {
+          GimpAsync *async;
+
+          async = xcf_save_stream_async (gimp, image, output, file, TRUE,
+                                         progress);
+
+          gimp_async_add_callback_for_object (
+            async,
+            (GimpAsyncCallback) xcf_save_invoker_done,
+            image,
+            image);
+
+          g_object_unref (async);
+
+          success = TRUE;
+        }
+      else
+        {
+          success = xcf_save_stream (gimp, image, output, file, progress,
+                                     error);
+        }
 
       g_object_unref (output);
     }
@@ -495,3 +714,242 @@ xcf_save_invoker (GimpProcedure         *procedure,
 
   return return_vals;
 }
+
+/* the image was marked clean when the save was started, which turned
+ * out to be premature
+ */
+static void
+xcf_save_invoker_done (GimpAsync *async,
+                       GimpImage *image)
+{
+  if (! gimp_async_is_finished (async))
+    gimp_image_dirty (image, GIMP_DIRTY_IMAGE);
+}
+
+static const gchar *
+xcf_get_filename (GFile *file)
+{
+  if (file)
+    return gimp_file_get_utf8_name (file);
+  else
+    return _("Memory Stream");
+}
+
+static void
+xcf_save_info_init (XcfInfo       *info,
+                    Gimp          *gimp,
+                    GimpImage     *image,
+                    GOutputStream *output,
+                    GFile         *output_file,
+                    GimpProgress  *progress)
+{
+  info->gimp             = gimp;
+  info->output           = output;
+  info->seekable         = G_SEEKABLE (output);
+  info->bytes_per_offset = 4;
+  info->progress         = progress;
+  info->file             = output_file;
+
+  if (! gimp_image_get_xcf_compression (image))
+    info->compression = COMPRESS_RLE;
+  else if (gimp->config->xcf_zstd_compression)
+    info->compression = COMPRESS_ZSTD;
+  else
+    info->compression = COMPRESS_ZLIB;
+
+  info->zstd_level = gimp->config->xcf_zstd_level;
+
+  info->file_version = gimp_image_get_xcf_version (image,
+                                                   info->compression >=
+                                                   COMPRESS_ZLIB,
+                                                   NULL, NULL, NULL);
+
+  if (info->file_version >= 11)
+    info->bytes_per_offset = 8;
+}
+
+/* writes 'image' and closes the output.  doesn't touch anything but
+ * 'image' and 'info', so it may run on any thread as long as nobody
+ * else uses 'image' meanwhile.
+ */
+static gboolean
+xcf_save_info_run (XcfInfo    *info,
+                   GimpImage  *image,
+                   GError    **error)
+{
+  const gchar  *filename = xcf_get_filename (info->file);
+  gboolean      success;
+  GError       *my_error = NULL;
+  GCancellable *cancellable;
+
+  success = xcf_save_image (info, image, &my_error);
+
+  /* done copying unchanged tiles from previously saved files */
+  g_clear_object (&info->tile_source);
+  g_clear_object (&info->tile_source_file);
+  g_clear_pointer (&info->zstd_dict, xcf_zstd_dict_unref);
+
+  cancellable = g_cancellable_new ();
+  if (success)
+    {
+      if (info->progress)
+        gimp_progress_set_text (info->progress, _("Closing '%s'"), filename);
+    }
+  else
+    {
+      /* When closing the stream, the image will be actually saved,
+       * unless we properly cancel it with a GCancellable.
+       * Not closing the stream is not an option either, as this will
+       * happen anyway when finalizing the output.
+       * So let's make sure now that we don't overwrite the XCF file
+       * when an error occurred.
+       */
+      g_cancellable_cancel (cancellable);
+    }
+  success = g_output_stream_close (info->output, cancellable, &my_error);
+  g_object_unref (cancellable);
+
+  /* the file is complete now, so the tiles saved to it can be copied by
+   * the next save
+   */
+  if (success)
+    g_list_foreach (info->saved_tile_indices,
+                    (GFunc) xcf_tile_index_update_file, NULL);
+
+  g_clear_pointer (&info->saved_tile_indices, g_list_free);
+
+  if (! success && my_error)
+    g_propagate_prefixed_error (error, my_error,
+                                _("Error writing '%s': "), filename);
+
+  return success;
+}
+
+/* returns the image's drawables in an order that pairs them up with
+ * the drawables of a duplicate of the image
+ */
+static GList *
+xcf_save_get_drawables (GimpImage *image)
+{
+  GList *drawables = NULL;
+  GList *items;
+  GList *list;
+
+  items = gimp_image_get_layer_list (image);
+
+  for (list = items; list; list = g_list_next (list))
+    {
+      GimpLayer *layer = list->data;
+
+      drawables = g_list_prepend (drawables, g_object_ref (layer));
+
+      if (gimp_layer_get_mask (layer))
+        drawables = g_list_prepend (drawables,
+                                    g_object_ref (gimp_layer_get_mask (layer)));
+    }
+
+  g_list_free (items);
+
+  items = gimp_image_get_channel_list (image);
+
+  for (list = items; list; list = g_list_next (list))
+    drawables = g_list_prepend (drawables, g_object_ref (list->data));
+
+  g_list_free (items);
+
+  drawables = g_list_prepend (drawables,
+                              g_object_ref (gimp_image_get_mask (image)));
+
+  return g_list_reverse (drawables);
+}
+
+static void
+xcf_save_async_func (GimpAsync  *async,
+                     XcfSaveJob *job)
+{
+  if (xcf_save_info_run (&job->info, job->snapshot, &job->error))
+    gimp_async_finish (async, NULL);
+  else
+    gimp_async_abort (async);
+}
+
+static gboolean
+xcf_save_async_progress (XcfSaveJob *job)
+{
+  if (job->progress)
+    gimp_progress_set_value (job->progress,
+                             g_atomic_int_get (&job->info.progress_value) /
+                             1000.0);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+xcf_save_async_callback (GimpAsync  *async,
+                         XcfSaveJob *job)
+{
+  Gimp *gimp = job->info.gimp;
+
+  if (job->progress_id)
+    {
+      g_source_remove (job->progress_id);
+      job->progress_id = 0;
+    }
+
+  if (job->progress)
+    {
+      gimp_progress_end (job->progress);
+
+      g_object_remove_weak_pointer (G_OBJECT (job->progress),
+                                    (gpointer) &job->progress);
+      job->progress = NULL;
+    }
+
+  if (job->error)
+    {
+      gimp_message (gimp, NULL, GIMP_MESSAGE_ERROR,
+                    _("Saving '%s' failed:\n\n%s"),
+                    gimp_image_get_display_name (job->image),
+                    job->error->message);
+    }
+  else if (gimp_async_is_finished (async) && job->remember_tiles)
+    {
+      XcfZstdDict *zstd_dict;
+      GList       *list;
+      GList       *snapshot_list;
+      gint         i;
+
+      /* the snapshot's drawables now know where their tiles are in the
+       * new file.  that's only true for the image's drawables if they
+       * haven't been modified since the snapshot was taken.
+       */
+      for (list = job->drawables, snapshot_list = job->snapshot_drawables,
+           i = 0;
+           list && snapshot_list;
+           list = g_list_next (list), snapshot_list = g_list_next (snapshot_list),
+           i++)
+        {
+          xcf_tile_index_copy_attached (snapshot_list->data, list->data,
+                                        g_array_index (job->generations,
+                                                       guint, i));
+        }
+
+      zstd_dict = xcf_zstd_dict_get_attached (job->snapshot);
+
+      if (zstd_dict)
+        xcf_zstd_dict_attach (zstd_dict, job->image);
+    }
+
+  if (xcf_save_get_async (job->image) == async)
+    g_object_set_data (G_OBJECT (job->image), XCF_SAVE_ASYNC_KEY, NULL);
+
+  g_clear_error (&job->error);
+  g_array_free (job->generations, TRUE);
+  g_list_free_full (job->snapshot_drawables, g_object_unref);
+  g_list_free_full (job->drawables, g_object_unref);
+  g_object_unref (job->output);
+  g_object_unref (job->snapshot);
+  g_object_unref (job->image);
+
+  g_slice_free (XcfSaveJob, job);
+}
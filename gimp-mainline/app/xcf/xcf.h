@@ -19,20 +19,29 @@
 #define __XCF_H__
 
 
-void        xcf_init        (Gimp           *gimp);
-void        xcf_exit        (Gimp           *gimp);
+void        xcf_init              (Gimp           *gimp);
+void        xcf_exit              (Gimp           *gimp);
 
-GimpImage * xcf_load_stream (Gimp           *gimp,
-                             GInputStream   *input,
-                             GFile          *input_file,
-                             GimpProgress   *progress,
-                             GError        **error);
+GimpImage * xcf_load_stream       (Gimp           *gimp,
+                                   GInputStream   *input,
+                                   GFile          *input_file,
+                                   GimpProgress   *progress,
+                                   GError        **error);
 
-gboolean    xcf_save_stream (Gimp           *gimp,
-                             GimpImage      *image,
-                             GOutputStream  *output,
-                             GFile          *output_file,
-                             GimpProgress   *progress,
-                             GError        **error);
+gboolean    xcf_save_stream       (Gimp           *gimp,
+                                   GimpImage      *image,
+                                   GOutputStream  *output,
+                                   GFile          *output_file,
+                                   GimpProgress   *progress,
+                                   GError        **error);
+
+GimpAsync * xcf_save_stream_async (Gimp           *gimp,
+                                   GimpImage      *image,
+                                   GOutputStream  *output,
+                                   GFile          *output_file,
+                                   gboolean        remember_tiles,
+                                   GimpProgress   *progress);
+GimpAsync * xcf_save_get_async    (GimpImage      *image);
+void        xcf_save_wait         (Gimp           *gimp);
 
 #endif /* __XCF_H__ */
@@ -43,6 +43,12 @@
 
 #endif /* USE_POSIX_SHM */
 
+#ifdef HAVE_MEMFD_CREATE
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <glib.h>
 
 #if defined(G_OS_WIN32) || defined(G_WITH_CYGWIN)
@@ -77,6 +83,10 @@ static HANDLE  _shm_handle;
 static gint    _shm_ID   = -1;
 static guchar *_shm_addr = NULL;
 
+static gint    _region_fd   = -1;
+static guchar *_region_addr = NULL;
+static gsize   _region_size = 0;
+
 
 guchar *
 _gimp_shm_addr (void)
@@ -87,6 +97,10 @@ _gimp_shm_addr (void)
 void
 _gimp_shm_open (gint shm_ID)
 {
+  /*  a resident plug-in gets the same segment with every call  */
+  if (_shm_addr && shm_ID == _shm_ID)
+    return;
+
   _shm_ID = shm_ID;
 
   if (_shm_ID != -1)
@@ -194,3 +208,95 @@ _gimp_shm_close (void)
 
 #endif
 }
+
+/*  the region memory is a file the core lets us inherit.  we grow it to
+ *  fit each rectangle we transfer with GP_REGION_REQ, and the core maps
+ *  it at the same size.
+ */
+
+void
+_gimp_shm_region_open (gint fd)
+{
+  if (fd == _region_fd)
+    return;
+
+  _gimp_shm_region_close ();
+
+  _region_fd = fd;
+}
+
+void
+_gimp_shm_region_close (void)
+{
+#ifdef HAVE_MEMFD_CREATE
+
+  if (_region_addr)
+    munmap (_region_addr, _region_size);
+
+  if (_region_fd != -1)
+    close (_region_fd);
+
+#endif
+
+  _region_fd   = -1;
+  _region_addr = NULL;
+  _region_size = 0;
+}
+
+/*  returns the region memory, at least 'size' bytes long, or NULL if
+ *  there is no region memory
+ */
+guchar *
+_gimp_shm_region_map (gsize size)
+{
+#ifdef HAVE_MEMFD_CREATE
+
+  if (_region_fd == -1)
+    return NULL;
+
+  if (size > _region_size)
+    {
+      struct stat st;
+      gpointer    addr;
+
+      if (fstat (_region_fd, &st) == -1)
+        return NULL;
+
+      if ((gsize) st.st_size < size &&
+          ftruncate (_region_fd, size) == -1)
+        {
+          g_printerr ("ftruncate() failed: %s\n", g_strerror (errno));
+
+          return NULL;
+        }
+
+      if (_region_addr)
+        {
+          munmap (_region_addr, _region_size);
+
+          _region_addr = NULL;
+          _region_size = 0;
+        }
+
+      addr = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   _region_fd, 0);
+
+      if (addr == MAP_FAILED)
+        {
+          g_printerr ("mmap() failed: %s\n", g_strerror (errno));
+
+          return NULL;
+        }
+
+      _region_addr = addr;
+      _region_size = size;
+    }
+
+  return _region_addr;
+
+#else
+
+  return NULL;
+
+#endif
+}
@@ -24,10 +24,14 @@
 G_BEGIN_DECLS
 
 
-guchar * _gimp_shm_addr  (void);
+guchar * _gimp_shm_addr         (void);
 
-void     _gimp_shm_open  (gint shm_ID);
-void     _gimp_shm_close (void);
+void     _gimp_shm_open         (gint  shm_ID);
+void     _gimp_shm_close        (void);
+
+void     _gimp_shm_region_open  (gint  fd);
+void     _gimp_shm_region_close (void);
+guchar * _gimp_shm_region_map   (gsize size);
 
 
 G_END_DECLS
@@ -590,7 +590,10 @@ gimp_main (GType  plug_in_type,
   else if (_gimp_debug_flags () & GIMP_DEBUG_PID)
     g_log (G_LOG_DOMAIN, G_LOG_LEVEL_DEBUG, "Here I am!");
 
-  _gimp_plug_in_run (PLUG_IN);
+  if (strcmp (argv[ARG_MODE], "-run-resident") == 0)
+    _gimp_plug_in_run_resident (PLUG_IN);
+  else
+    _gimp_plug_in_run (PLUG_IN);
 
   gimp_close ();
 
@@ -1132,10 +1135,16 @@ _gimp_config (GPConfig *config)
   _export_xmp           = config->export_xmp       ? TRUE : FALSE;
   _export_iptc          = config->export_iptc      ? TRUE : FALSE;
   _default_display_id   = config->default_display_id;
-  _wm_class             = g_strdup (config->wm_class);
-  _display_name         = g_strdup (config->display_name);
   _monitor_number       = config->monitor_number;
   _timestamp            = config->timestamp;
+
+  /*  a resident plug-in is configured again for every call  */
+  g_free (_wm_class);
+  g_free (_display_name);
+  g_free (_icon_theme_dir);
+
+  _wm_class             = g_strdup (config->wm_class);
+  _display_name         = g_strdup (config->display_name);
   _icon_theme_dir       = g_strdup (config->icon_theme_dir);
 
   if (config->app_name)
@@ -1159,4 +1168,5 @@ _gimp_config (GPConfig *config)
   g_object_unref (file);
 
   _gimp_shm_open (config->shm_id);
+  _gimp_shm_region_open (config->region_fd);
 }
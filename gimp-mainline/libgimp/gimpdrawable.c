@@ -32,6 +32,10 @@ struct _GimpDrawablePrivate
 };
 
 
+static gboolean   gimp_drawable_region_is_valid (GimpDrawable        *drawable,
+                                                 const GeglRectangle *rect);
+
+
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (GimpDrawable, gimp_drawable, GIMP_TYPE_ITEM)
 
 #define parent_class gimp_drawable_parent_class
@@ -329,6 +333,115 @@ gimp_drawable_get_shadow_buffer (GimpDrawable *drawable)
   return NULL;
 }
 
+/**
+ * gimp_drawable_read_region:
+ * @drawable: the #GimpDrawable to read from.
+ * @shadow:   whether to read the drawable's shadow tiles.
+ * @rect:     the rectangle to read, within the drawable.
+ * @data: (array) (element-type guint8): the memory to read into.
+ *
+ * Reads the pixels of @rect into @data, in the drawable's format (see
+ * gimp_drawable_get_format()), row after row with no padding.
+ *
+ * Where the platform allows it, the whole rectangle is transferred
+ * through shared memory with a single request, which is much faster
+ * than reading a large rectangle from the buffer returned by
+ * gimp_drawable_get_buffer().
+ *
+ * Buffers returned by gimp_drawable_get_buffer() cache their tiles,
+ * and won't see pixels written with gimp_drawable_write_region() while
+ * they exist, and vice versa.
+ *
+ * Returns: %TRUE on success.
+ *
+ * See Also: gimp_drawable_write_region()
+ *
+ * Since: 3.0
+ */
+gboolean
+gimp_drawable_read_region (GimpDrawable        *drawable,
+                           gboolean             shadow,
+                           const GeglRectangle *rect,
+                           guchar              *data)
+{
+  GeglBuffer *buffer;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (rect != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  if (! gimp_item_is_valid (GIMP_ITEM (drawable)) ||
+      ! gimp_drawable_region_is_valid (drawable, rect))
+    return FALSE;
+
+  if (_gimp_tile_backend_plugin_transfer_region (drawable, shadow, FALSE,
+                                                 rect, data))
+    return TRUE;
+
+  if (shadow)
+    buffer = gimp_drawable_get_shadow_buffer (drawable);
+  else
+    buffer = gimp_drawable_get_buffer (drawable);
+
+  gegl_buffer_get (buffer, rect, 1.0, gimp_drawable_get_format (drawable),
+                   data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (buffer);
+
+  return TRUE;
+}
+
+/**
+ * gimp_drawable_write_region:
+ * @drawable: the #GimpDrawable to write to.
+ * @shadow:   whether to write the drawable's shadow tiles.
+ * @rect:     the rectangle to write, within the drawable.
+ * @data: (array) (element-type guint8): the pixels to write.
+ *
+ * Writes the pixels in @data to @rect, the counterpart of
+ * gimp_drawable_read_region(), which see.  Like when writing to the
+ * drawable's buffer, call gimp_drawable_update() afterwards, or
+ * gimp_drawable_merge_shadow() when writing shadow tiles.
+ *
+ * Returns: %TRUE on success.
+ *
+ * See Also: gimp_drawable_read_region()
+ *
+ * Since: 3.0
+ */
+gboolean
+gimp_drawable_write_region (GimpDrawable        *drawable,
+                            gboolean             shadow,
+                            const GeglRectangle *rect,
+                            const guchar        *data)
+{
+  GeglBuffer *buffer;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (rect != NULL, FALSE);
+  g_return_val_if_fail (data != NULL, FALSE);
+
+  if (! gimp_item_is_valid (GIMP_ITEM (drawable)) ||
+      ! gimp_drawable_region_is_valid (drawable, rect))
+    return FALSE;
+
+  if (_gimp_tile_backend_plugin_transfer_region (drawable, shadow, TRUE,
+                                                 rect, (guchar *) data))
+    return TRUE;
+
+  if (shadow)
+    buffer = gimp_drawable_get_shadow_buffer (drawable);
+  else
+    buffer = gimp_drawable_get_buffer (drawable);
+
+  gegl_buffer_set (buffer, rect, 0, gimp_drawable_get_format (drawable),
+                   data, GEGL_AUTO_ROWSTRIDE);
+
+  g_object_unref (buffer);
+
+  return TRUE;
+}
+
 /**
  * gimp_drawable_get_format:
  * @drawable: the ID of the #GimpDrawable to get the format for.
@@ -439,3 +552,16 @@ gimp_drawable_get_thumbnail_format (GimpDrawable *drawable)
 
   return format;
 }
+
+
+/* Private functions. */
+
+static gboolean
+gimp_drawable_region_is_valid (GimpDrawable        *drawable,
+                               const GeglRectangle *rect)
+{
+  return (rect->x >= 0 && rect->y >= 0 &&
+          rect->width > 0 && rect->height > 0 &&
+          rect->x + rect->width  <= gimp_drawable_width  (drawable) &&
+          rect->y + rect->height <= gimp_drawable_height (drawable));
+}
@@ -74,6 +74,15 @@ GimpDrawable * gimp_drawable_get_by_id              (gint32        drawable_id);
 GeglBuffer   * gimp_drawable_get_buffer             (GimpDrawable  *drawable);
 GeglBuffer   * gimp_drawable_get_shadow_buffer      (GimpDrawable  *drawable);
 
+gboolean       gimp_drawable_read_region            (GimpDrawable        *drawable,
+                                                     gboolean             shadow,
+                                                     const GeglRectangle *rect,
+                                                     guchar              *data);
+gboolean       gimp_drawable_write_region           (GimpDrawable        *drawable,
+                                                     gboolean             shadow,
+                                                     const GeglRectangle *rect,
+                                                     const guchar        *data);
+
 const Babl   * gimp_drawable_get_format             (GimpDrawable  *drawable);
 const Babl   * gimp_drawable_get_thumbnail_format   (GimpDrawable  *drawable);
 
@@ -31,6 +31,7 @@
 #include "gimppdb_pdb.h"
 #include "gimppdbprocedure.h"
 #include "gimpplugin-private.h"
+#include "gimptilebackendplugin.h"
 
 #include "libgimp-intl.h"
 
@@ -309,6 +310,11 @@ gimp_pdb_run_procedure_array (GimpPDB              *pdb,
   proc_run.n_params = gimp_value_array_length (arguments);
   proc_run.params   = _gimp_value_array_to_gp_params (arguments, FALSE);
 
+  /*  the procedure must see the pixels we wrote, and we must not keep
+   *  reading tiles it may change
+   */
+  _gimp_tile_backend_plugin_sync ();
+
   if (! gp_proc_run_write (_gimp_plug_in_get_write_channel (pdb->priv->plug_in),
                            &proc_run, pdb->priv->plug_in))
     gimp_quit ();
@@ -176,7 +176,7 @@ static gboolean   gimp_plug_in_io_error_handler  (GIOChannel      *channel,
                                                   GIOCondition     cond,
                                                   gpointer         data);
 
-static void       gimp_plug_in_loop              (GimpPlugIn      *plug_in);
+static gboolean   gimp_plug_in_loop              (GimpPlugIn      *plug_in);
 static void       gimp_plug_in_single_message    (GimpPlugIn      *plug_in);
 static void       gimp_plug_in_process_message   (GimpPlugIn      *plug_in,
                                                   GimpWireMessage *msg);
@@ -820,6 +820,24 @@ _gimp_plug_in_run (GimpPlugIn *plug_in)
   gimp_plug_in_loop (plug_in);
 }
 
+/* runs procedures until the core closes the pipe or sends GP_QUIT,
+ * the core keeps a pool of plug-in processes started this way and
+ * reuses them instead of starting a new process for each call
+ */
+void
+_gimp_plug_in_run_resident (GimpPlugIn *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  g_io_add_watch (plug_in->priv->read_channel,
+                  G_IO_ERR | G_IO_HUP,
+                  gimp_plug_in_io_error_handler,
+                  NULL);
+
+  while (gimp_plug_in_loop (plug_in))
+    ;
+}
+
 void
 _gimp_plug_in_quit (GimpPlugIn *plug_in)
 {
@@ -829,6 +847,7 @@ _gimp_plug_in_quit (GimpPlugIn *plug_in)
     GIMP_PLUG_IN_GET_CLASS (plug_in)->quit (plug_in);
 
   _gimp_shm_close ();
+  _gimp_shm_region_close ();
 
   gp_quit_write (plug_in->priv->write_channel, plug_in);
 }
@@ -1041,7 +1060,10 @@ gimp_plug_in_io_error_handler (GIOChannel   *channel,
   return TRUE;
 }
 
-static void
+/* returns TRUE after running a procedure, FALSE on GP_QUIT or when
+ * the pipe is closed
+ */
+static gboolean
 gimp_plug_in_loop (GimpPlugIn *plug_in)
 {
   while (TRUE)
@@ -1049,13 +1071,13 @@ gimp_plug_in_loop (GimpPlugIn *plug_in)
       GimpWireMessage msg;
 
       if (! gimp_wire_read_msg (plug_in->priv->read_channel, &msg, NULL))
-        return;
+        return FALSE;
 
       switch (msg.type)
         {
         case GP_QUIT:
           gimp_wire_destroy (&msg);
-          return;
+          return FALSE;
 
         case GP_CONFIG:
           _gimp_config (msg.data);
@@ -1064,13 +1086,15 @@ gimp_plug_in_loop (GimpPlugIn *plug_in)
         case GP_TILE_REQ:
         case GP_TILE_ACK:
         case GP_TILE_DATA:
+        case GP_REGION_REQ:
+        case GP_TILE_BATCH_REQ:
           g_warning ("unexpected tile message received (should not happen)");
           break;
 
         case GP_PROC_RUN:
           gimp_plug_in_proc_run (plug_in, msg.data);
           gimp_wire_destroy (&msg);
-          return;
+          return TRUE;
 
         case GP_PROC_RETURN:
           g_warning ("unexpected proc return message received (should not happen)");
@@ -1126,6 +1150,8 @@ gimp_plug_in_process_message (GimpPlugIn      *plug_in,
     case GP_TILE_REQ:
     case GP_TILE_ACK:
     case GP_TILE_DATA:
+    case GP_REGION_REQ:
+    case GP_TILE_BATCH_REQ:
       g_warning ("unexpected tile message received (should not happen)");
       break;
     case GP_PROC_RUN:
@@ -37,6 +37,12 @@
 #define TILE_WIDTH  gimp_tile_width()
 #define TILE_HEIGHT gimp_tile_height()
 
+/* the most tiles we read ahead of a sequential reader, or collect
+ * before sending them to the core in one batch
+ */
+#define MAX_READ_AHEAD   MIN (32, GP_TILE_BATCH_MAX_TILES)
+#define MAX_PENDING_PUTS MIN (32, GP_TILE_BATCH_MAX_TILES)
+
 
 typedef struct _GimpTile GimpTile;
 
@@ -53,16 +59,25 @@ struct _GimpTile
 
 struct _GimpTileBackendPluginPrivate
 {
-  gint32   drawable_id;
-  gboolean shadow;
-  gint     width;
-  gint     height;
-  gint     bpp;
-  gint     ntile_rows;
-  gint     ntile_cols;
+  gint32      drawable_id;
+  gboolean    shadow;
+  gint        width;
+  gint        height;
+  gint        bpp;
+  gint        ntile_rows;
+  gint        ntile_cols;
+
+  GHashTable *prefetched;    /* tile_num -> data read ahead of time */
+  guint       next_tile_num; /* the tile a sequential reader asks for next */
+  gint        read_ahead;
+
+  GimpTile    pending[MAX_PENDING_PUTS];
+  gint        n_pending;
 };
 
 
+static void       gimp_tile_backend_plugin_finalize (GObject        *object);
+
 static gpointer   gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
                                                     GeglTileCommand  command,
                                                     gint             x,
@@ -89,6 +104,12 @@ static void       gimp_tile_get   (GimpTileBackendPlugin *backend_plugin,
 static void       gimp_tile_put   (GimpTileBackendPlugin *backend_plugin,
                                    GimpTile              *tile);
 
+static void       gimp_tile_get_batch (GimpTileBackendPlugin *backend_plugin,
+                                       GimpTile              *tile,
+                                       gint                   n_tiles);
+static void       gimp_tile_put_batch (GimpTileBackendPlugin *backend_plugin);
+static void       gimp_tile_sync      (GimpTileBackendPlugin *backend_plugin);
+
 
 G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
                             GEGL_TYPE_TILE_BACKEND)
@@ -96,12 +117,16 @@ G_DEFINE_TYPE_WITH_PRIVATE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
 #define parent_class _gimp_tile_backend_plugin_parent_class
 
 
-static GMutex backend_plugin_mutex;
+static GMutex  backend_plugin_mutex;
+static GList  *backend_plugins = NULL;
 
 
 static void
 _gimp_tile_backend_plugin_class_init (GimpTileBackendPluginClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = gimp_tile_backend_plugin_finalize;
 }
 
 static void
@@ -111,7 +136,35 @@ _gimp_tile_backend_plugin_init (GimpTileBackendPlugin *backend)
 
   backend->priv = _gimp_tile_backend_plugin_get_instance_private (backend);
 
+  backend->priv->prefetched = g_hash_table_new_full (NULL, NULL,
+                                                     NULL, g_free);
+  backend->priv->read_ahead = 1;
+
   source->command = gimp_tile_backend_plugin_command;
+
+  g_mutex_lock (&backend_plugin_mutex);
+
+  backend_plugins = g_list_prepend (backend_plugins, backend);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+}
+
+static void
+gimp_tile_backend_plugin_finalize (GObject *object)
+{
+  GimpTileBackendPlugin *backend_plugin = GIMP_TILE_BACKEND_PLUGIN (object);
+
+  g_mutex_lock (&backend_plugin_mutex);
+
+  backend_plugins = g_list_remove (backend_plugins, backend_plugin);
+
+  gimp_tile_put_batch (backend_plugin);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+
+  g_clear_pointer (&backend_plugin->priv->prefetched, g_hash_table_unref);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static gpointer
@@ -156,6 +209,11 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
       break;
 
     case GEGL_TILE_FLUSH:
+      g_mutex_lock (&backend_plugin_mutex);
+
+      gimp_tile_sync (backend_plugin);
+
+      g_mutex_unlock (&backend_plugin_mutex);
       break;
 
     default:
@@ -202,6 +260,84 @@ _gimp_tile_backend_plugin_new (GimpDrawable *drawable,
   return backend;
 }
 
+/* sends all collected tile writes to the core and forgets all tiles
+ * read ahead, so that what the plug-in does next, like running a PDB
+ * procedure, sees and acts on the current pixels
+ */
+void
+_gimp_tile_backend_plugin_sync (void)
+{
+  GList *list;
+
+  g_mutex_lock (&backend_plugin_mutex);
+
+  for (list = backend_plugins; list; list = g_list_next (list))
+    gimp_tile_sync (list->data);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+}
+
+/* copies 'rect' of the drawable from or to 'data' with a single
+ * GP_REGION_REQ, through the region shared memory.  returns FALSE
+ * without doing anything if there is no region memory.
+ */
+gboolean
+_gimp_tile_backend_plugin_transfer_region (GimpDrawable        *drawable,
+                                           gboolean             shadow,
+                                           gboolean             write,
+                                           const GeglRectangle *rect,
+                                           guchar              *data)
+{
+  GimpPlugIn      *plug_in = gimp_get_plug_in ();
+  GPRegionReq      region_req;
+  GimpWireMessage  msg;
+  gsize            size;
+  guchar          *region;
+  GList           *list;
+
+  size = (gsize) gimp_drawable_bpp (drawable) * rect->width * rect->height;
+
+  g_mutex_lock (&backend_plugin_mutex);
+
+  for (list = backend_plugins; list; list = g_list_next (list))
+    gimp_tile_sync (list->data);
+
+  region = _gimp_shm_region_map (size);
+
+  if (! region)
+    {
+      g_mutex_unlock (&backend_plugin_mutex);
+
+      return FALSE;
+    }
+
+  region_req.drawable_id = gimp_item_get_id (GIMP_ITEM (drawable));
+  region_req.shadow      = shadow;
+  region_req.write       = write;
+  region_req.x           = rect->x;
+  region_req.y           = rect->y;
+  region_req.width       = rect->width;
+  region_req.height      = rect->height;
+
+  if (write)
+    memcpy (region, data, size);
+
+  if (! gp_region_req_write (_gimp_plug_in_get_write_channel (plug_in),
+                             &region_req, plug_in))
+    gimp_quit ();
+
+  _gimp_plug_in_read_expect_msg (plug_in, &msg, GP_TILE_ACK);
+
+  gimp_wire_destroy (&msg);
+
+  if (! write)
+    memcpy (data, region, size);
+
+  g_mutex_unlock (&backend_plugin_mutex);
+
+  return TRUE;
+}
+
 
 /*  private functions  */
 
@@ -224,7 +360,42 @@ gimp_tile_read (GimpTileBackendPlugin *backend_plugin,
   tile       = gegl_tile_new (tile_size);
   tile_data  = gegl_tile_get_data (tile);
 
-  gimp_tile_get (backend_plugin, &gimp_tile);
+  gimp_tile.data = g_hash_table_lookup (priv->prefetched,
+                                        GUINT_TO_POINTER (gimp_tile.tile_num));
+
+  if (gimp_tile.data)
+    {
+      g_hash_table_steal (priv->prefetched,
+                          GUINT_TO_POINTER (gimp_tile.tile_num));
+    }
+  else
+    {
+      gint n_tiles;
+
+      /*  a reader walking the drawable in scanline or tile-row order
+       *  asks for consecutive tile numbers, fetch ever more of them
+       *  per round trip as long as it keeps doing so
+       */
+      if (gimp_tile.tile_num == priv->next_tile_num)
+        priv->read_ahead = MIN (priv->read_ahead * 2, MAX_READ_AHEAD);
+      else
+        priv->read_ahead = 1;
+
+      n_tiles = MIN (priv->read_ahead,
+                     priv->ntile_rows * priv->ntile_cols - gimp_tile.tile_num);
+
+      /*  our own collected writes must reach the core before we read
+       *  anything back
+       */
+      gimp_tile_put_batch (backend_plugin);
+
+      if (n_tiles > 1)
+        gimp_tile_get_batch (backend_plugin, &gimp_tile, n_tiles);
+      else
+        gimp_tile_get (backend_plugin, &gimp_tile);
+    }
+
+  priv->next_tile_num = gimp_tile.tile_num + 1;
 
   if (gimp_tile.ewidth * gimp_tile.eheight * priv->bpp == tile_size)
     {
@@ -289,8 +460,14 @@ gimp_tile_write (GimpTileBackendPlugin *backend_plugin,
         }
     }
 
-  gimp_tile_put (backend_plugin, &gimp_tile);
-  gimp_tile_unset (backend_plugin, &gimp_tile);
+  /*  a tile read ahead is outdated now  */
+  g_hash_table_remove (priv->prefetched,
+                       GUINT_TO_POINTER (gimp_tile.tile_num));
+
+  if (priv->n_pending == MAX_PENDING_PUTS)
+    gimp_tile_put_batch (backend_plugin);
+
+  priv->pending[priv->n_pending++] = gimp_tile;
 
   return TRUE;
 }
@@ -455,3 +632,157 @@ gimp_tile_put (GimpTileBackendPlugin *backend_plugin,
 
   gimp_wire_destroy (&msg);
 }
+
+/* fetches 'n_tiles' consecutive tiles, starting with 'tile', in a
+ * single GP_TILE_BATCH_REQ, and keeps all but the first one around
+ * for the following gimp_tile_read() calls
+ */
+static void
+gimp_tile_get_batch (GimpTileBackendPlugin *backend_plugin,
+                     GimpTile              *tile,
+                     gint                   n_tiles)
+{
+  GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
+  GimpPlugIn                   *plug_in = gimp_get_plug_in ();
+  GPTileBatchReq                batch_req;
+  guint32                       tile_nums[GP_TILE_BATCH_MAX_TILES];
+  gint                          i;
+
+  for (i = 0; i < n_tiles; i++)
+    tile_nums[i] = tile->tile_num + i;
+
+  batch_req.drawable_id = priv->drawable_id;
+  batch_req.shadow      = priv->shadow;
+  batch_req.write       = FALSE;
+  batch_req.n_tiles     = n_tiles;
+  batch_req.tile_nums   = tile_nums;
+
+  if (! gp_tile_batch_req_write (_gimp_plug_in_get_write_channel (plug_in),
+                                 &batch_req, plug_in))
+    gimp_quit ();
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile         batch_tile;
+      GPTileData      *tile_data;
+      GimpWireMessage  msg;
+
+      gimp_tile_init (backend_plugin, &batch_tile,
+                      tile_nums[i] / priv->ntile_cols,
+                      tile_nums[i] % priv->ntile_cols);
+
+      _gimp_plug_in_read_expect_msg (plug_in, &msg, GP_TILE_DATA);
+
+      tile_data = msg.data;
+      if (tile_data->drawable_id != priv->drawable_id   ||
+          tile_data->tile_num    != batch_tile.tile_num ||
+          tile_data->shadow      != priv->shadow        ||
+          tile_data->width       != batch_tile.ewidth   ||
+          tile_data->height      != batch_tile.eheight  ||
+          tile_data->bpp         != priv->bpp           ||
+          tile_data->use_shm)
+        {
+          g_printerr ("received tile info did not match computed tile info");
+          gimp_quit ();
+        }
+
+      if (i == 0)
+        tile->data = tile_data->data;
+      else
+        g_hash_table_replace (priv->prefetched,
+                              GUINT_TO_POINTER (batch_tile.tile_num),
+                              tile_data->data);
+
+      tile_data->data = NULL;
+
+      gimp_wire_destroy (&msg);
+    }
+}
+
+/* sends all collected tile writes with a single GP_TILE_BATCH_REQ  */
+static void
+gimp_tile_put_batch (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv    = backend_plugin->priv;
+  GimpPlugIn                   *plug_in;
+  GIOChannel                   *channel;
+  GPTileBatchReq                batch_req;
+  guint32                       tile_nums[GP_TILE_BATCH_MAX_TILES];
+  GimpWireMessage               msg;
+  gint                          i;
+
+  if (priv->n_pending == 0)
+    return;
+
+  if (priv->n_pending == 1)
+    {
+      gimp_tile_put (backend_plugin, &priv->pending[0]);
+      gimp_tile_unset (backend_plugin, &priv->pending[0]);
+
+      priv->n_pending = 0;
+
+      return;
+    }
+
+  plug_in = gimp_get_plug_in ();
+  channel = _gimp_plug_in_get_write_channel (plug_in);
+
+  for (i = 0; i < priv->n_pending; i++)
+    tile_nums[i] = priv->pending[i].tile_num;
+
+  batch_req.drawable_id = priv->drawable_id;
+  batch_req.shadow      = priv->shadow;
+  batch_req.write       = TRUE;
+  batch_req.n_tiles     = priv->n_pending;
+  batch_req.tile_nums   = tile_nums;
+
+  msg.type = GP_TILE_BATCH_REQ;
+  msg.data = &batch_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, plug_in))
+    gimp_quit ();
+
+  for (i = 0; i < priv->n_pending; i++)
+    {
+      GimpTile   *tile = &priv->pending[i];
+      GPTileData  tile_data;
+
+      tile_data.drawable_id = priv->drawable_id;
+      tile_data.tile_num    = tile->tile_num;
+      tile_data.shadow      = priv->shadow;
+      tile_data.bpp         = priv->bpp;
+      tile_data.width       = tile->ewidth;
+      tile_data.height      = tile->eheight;
+      tile_data.use_shm     = FALSE;
+      tile_data.data        = tile->data;
+
+      msg.type = GP_TILE_DATA;
+      msg.data = &tile_data;
+
+      if (! gimp_wire_write_msg (channel, &msg, plug_in))
+        gimp_quit ();
+
+      gimp_tile_unset (backend_plugin, tile);
+    }
+
+  priv->n_pending = 0;
+
+  if (! gimp_wire_flush (channel, plug_in))
+    gimp_quit ();
+
+  _gimp_plug_in_read_expect_msg (plug_in, &msg, GP_TILE_ACK);
+
+  gimp_wire_destroy (&msg);
+}
+
+static void
+gimp_tile_sync (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+
+  gimp_tile_put_batch (backend_plugin);
+
+  g_hash_table_remove_all (priv->prefetched);
+
+  priv->read_ahead = 1;
+}
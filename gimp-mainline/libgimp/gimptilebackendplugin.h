@@ -55,6 +55,14 @@ GType             _gimp_tile_backend_plugin_get_type (void) G_GNUC_CONST;
 GeglTileBackend * _gimp_tile_backend_plugin_new      (GimpDrawable *drawable,
                                                       gint          shadow);
 
+void      _gimp_tile_backend_plugin_sync            (void);
+
+gboolean  _gimp_tile_backend_plugin_transfer_region (GimpDrawable        *drawable,
+                                                     gboolean             shadow,
+                                                     gboolean             write,
+                                                     const GeglRectangle *rect,
+                                                     guchar              *data);
+
 G_END_DECLS
 
 #endif /* __GIMP_TILE_BACKEND_PLUGIN_H__ */
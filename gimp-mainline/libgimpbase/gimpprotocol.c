@@ -144,6 +144,22 @@ static void _gp_has_init_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_has_init_destroy         (GimpWireMessage  *msg);
 
+static void _gp_region_req_read          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_req_write         (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_req_destroy       (GimpWireMessage  *msg);
+
+static void _gp_tile_batch_req_read      (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_req_write     (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tile_batch_req_destroy   (GimpWireMessage  *msg);
+
 
 
 void
@@ -201,6 +217,14 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_REGION_REQ,
+                      _gp_region_req_read,
+                      _gp_region_req_write,
+                      _gp_region_req_destroy);
+  gimp_wire_register (GP_TILE_BATCH_REQ,
+                      _gp_tile_batch_req_read,
+                      _gp_tile_batch_req_write,
+                      _gp_tile_batch_req_destroy);
 }
 
 /* public writing API */
@@ -448,6 +472,44 @@ gp_has_init_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_region_req_write (GIOChannel  *channel,
+                     GPRegionReq *region_req,
+                     gpointer     user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_REGION_REQ;
+  msg.data = region_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_tile_batch_req_write (GIOChannel     *channel,
+                         GPTileBatchReq *tile_batch_req,
+                         gpointer        user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILE_BATCH_REQ;
+  msg.data = tile_batch_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 /*  quit  */
 
 static void
@@ -487,6 +549,9 @@ _gp_config_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                (guint32 *) &config->shm_id, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &config->region_fd, 1, user_data))
+    goto cleanup;
   if (! _gimp_wire_read_int8 (channel,
                               (guint8 *) &config->check_size, 1, user_data))
     goto cleanup;
@@ -593,6 +658,10 @@ _gp_config_write (GIOChannel      *channel,
                                 (const guint32 *) &config->shm_id, 1,
                                 user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &config->region_fd, 1,
+                                user_data))
+    return;
   if (! _gimp_wire_write_int8 (channel,
                                (const guint8 *) &config->check_size, 1,
                                user_data))
@@ -1937,3 +2006,166 @@ static void
 _gp_has_init_destroy (GimpWireMessage *msg)
 {
 }
+
+/*  region_req  */
+
+static void
+_gp_region_req_read (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+  GPRegionReq *region_req = g_slice_new0 (GPRegionReq);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->drawable_id, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->write, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->x, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->y, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->width, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->height, 1, user_data))
+    goto cleanup;
+
+  msg->data = region_req;
+  return;
+
+ cleanup:
+  g_slice_free (GPRegionReq, region_req);
+  msg->data = NULL;
+}
+
+static void
+_gp_region_req_write (GIOChannel      *channel,
+                      GimpWireMessage *msg,
+                      gpointer         user_data)
+{
+  GPRegionReq *region_req = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->drawable_id, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->write, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->x, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->y, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->width, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->height, 1, user_data))
+    return;
+}
+
+static void
+_gp_region_req_destroy (GimpWireMessage *msg)
+{
+  GPRegionReq *region_req = msg->data;
+
+  if (region_req)
+    g_slice_free (GPRegionReq, region_req);
+}
+
+/*  tile_batch_req  */
+
+static void
+_gp_tile_batch_req_read (GIOChannel      *channel,
+                         GimpWireMessage *msg,
+                         gpointer         user_data)
+{
+  GPTileBatchReq *tile_batch_req = g_slice_new0 (GPTileBatchReq);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tile_batch_req->drawable_id, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->write, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tile_batch_req->n_tiles, 1, user_data))
+    goto cleanup;
+
+  if (tile_batch_req->n_tiles > GP_TILE_BATCH_MAX_TILES)
+    goto cleanup;
+
+  tile_batch_req->tile_nums = g_new (guint32, tile_batch_req->n_tiles);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               tile_batch_req->tile_nums,
+                               tile_batch_req->n_tiles,
+                               user_data))
+    goto cleanup;
+
+  msg->data = tile_batch_req;
+  return;
+
+ cleanup:
+  g_free (tile_batch_req->tile_nums);
+  g_slice_free (GPTileBatchReq, tile_batch_req);
+  msg->data = NULL;
+}
+
+static void
+_gp_tile_batch_req_write (GIOChannel      *channel,
+                          GimpWireMessage *msg,
+                          gpointer         user_data)
+{
+  GPTileBatchReq *tile_batch_req = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tile_batch_req->drawable_id,
+                                1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->write, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tile_batch_req->n_tiles, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                tile_batch_req->tile_nums,
+                                tile_batch_req->n_tiles, user_data))
+    return;
+}
+
+static void
+_gp_tile_batch_req_destroy (GimpWireMessage *msg)
+{
+  GPTileBatchReq *tile_batch_req = msg->data;
+
+  if (tile_batch_req)
+    {
+      g_free (tile_batch_req->tile_nums);
+      g_slice_free (GPTileBatchReq, tile_batch_req);
+    }
+}
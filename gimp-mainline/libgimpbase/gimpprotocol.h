@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x010E
+#define GIMP_PROTOCOL_VERSION  0x0110
 
 
 enum
@@ -43,7 +43,9 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_REGION_REQ,
+  GP_TILE_BATCH_REQ
 };
 
 typedef enum
@@ -79,6 +81,8 @@ typedef struct _GPConfig           GPConfig;
 typedef struct _GPTileReq          GPTileReq;
 typedef struct _GPTileAck          GPTileAck;
 typedef struct _GPTileData         GPTileData;
+typedef struct _GPRegionReq        GPRegionReq;
+typedef struct _GPTileBatchReq     GPTileBatchReq;
 typedef struct _GPParamDef         GPParamDef;
 typedef struct _GPParamDefInt      GPParamDefInt;
 typedef struct _GPParamDefUnit     GPParamDefUnit;
@@ -104,6 +108,7 @@ struct _GPConfig
   guint32  tile_width;
   guint32  tile_height;
   gint32   shm_id;
+  gint32   region_fd;
   gint8    check_size;
   gint8    check_type;
   gint8    show_help_button;
@@ -146,6 +151,42 @@ struct _GPTileData
   guchar  *data;
 };
 
+/*  asks the core to copy the 'width' x 'height' rectangle at 'x', 'y'
+ *  between the drawable and the start of the region shared memory,
+ *  in the drawable's format without row padding.  the plug-in makes
+ *  sure the shared memory is large enough first.  answered with
+ *  GP_TILE_ACK once the copy is done.
+ */
+struct _GPRegionReq
+{
+  gint32   drawable_id;
+  guint32  shadow;
+  guint32  write;
+  gint32   x;
+  gint32   y;
+  guint32  width;
+  guint32  height;
+};
+
+/*  asks for, or announces, up to GP_TILE_BATCH_MAX_TILES tiles of a
+ *  drawable in one round trip.  for reading, the core answers with one
+ *  GP_TILE_DATA message per tile, in the order of 'tile_nums'.  for
+ *  writing, the plug-in follows the request with one GP_TILE_DATA
+ *  message per tile and the core answers with a single GP_TILE_ACK.
+ *  tile data of a batch always travels in the messages, never in the
+ *  tile shared memory.
+ */
+#define GP_TILE_BATCH_MAX_TILES 64
+
+struct _GPTileBatchReq
+{
+  gint32   drawable_id;
+  guint32  shadow;
+  guint32  write;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+};
+
 struct _GPParamDefInt
 {
   gint64 min_val;
@@ -305,6 +346,12 @@ gboolean  gp_tile_ack_write         (GIOChannel      *channel,
 gboolean  gp_tile_data_write        (GIOChannel      *channel,
                                      GPTileData      *tile_data,
                                      gpointer         user_data);
+gboolean  gp_region_req_write       (GIOChannel      *channel,
+                                     GPRegionReq     *region_req,
+                                     gpointer         user_data);
+gboolean  gp_tile_batch_req_write   (GIOChannel      *channel,
+                                     GPTileBatchReq  *tile_batch_req,
+                                     gpointer         user_data);
 gboolean  gp_proc_run_write         (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
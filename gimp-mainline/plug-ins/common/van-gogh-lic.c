@@ -146,6 +146,10 @@ static gboolean source_drw_has_alpha = FALSE;
 static gint    effect_width, effect_height;
 static gint    border_x, border_y, border_w, border_h;
 
+/* converts the source pixels, in the drawable's format, to GimpRGB */
+static const Babl *src_fish = NULL;
+static gint        src_bpp  = 0;
+
 static GtkWidget *dialog;
 
 /************************/
@@ -153,25 +157,12 @@ static GtkWidget *dialog;
 /************************/
 
 static void
-peek (GeglBuffer *buffer,
-      gint        x,
-      gint        y,
-      GimpRGB    *color)
-{
-  gegl_buffer_sample (buffer, x, y, NULL,
-                      color, babl_format ("R'G'B'A double"),
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-}
-
-static void
-poke (GeglBuffer *buffer,
-      gint        x,
-      gint        y,
-      GimpRGB    *color)
+peek (const guchar *src,
+      gint          x,
+      gint          y,
+      GimpRGB      *color)
 {
-  gegl_buffer_set (buffer, GEGL_RECTANGLE (x, y, 1, 1), 0,
-                   babl_format ("R'G'B'A double"), color,
-                   GEGL_AUTO_ROWSTRIDE);
+  babl_process (src_fish, src + (y * border_w + x) * src_bpp, color, 1);
 }
 
 static gint
@@ -376,10 +367,10 @@ lic_noise (gint    x,
 }
 
 static void
-getpixel (GeglBuffer *buffer,
-          GimpRGB    *p,
-          gdouble     u,
-          gdouble     v)
+getpixel (const guchar *src,
+          GimpRGB      *p,
+          gdouble       u,
+          gdouble       v)
 {
   register gint x1, y1, x2, y2;
   gint width, height;
@@ -404,10 +395,10 @@ getpixel (GeglBuffer *buffer,
   x2 = (x1 + 1) % width;
   y2 = (y1 + 1) % height;
 
-  peek (buffer, x1, y1, &pp[0]);
-  peek (buffer, x2, y1, &pp[1]);
-  peek (buffer, x1, y2, &pp[2]);
-  peek (buffer, x2, y2, &pp[3]);
+  peek (src, x1, y1, &pp[0]);
+  peek (src, x2, y1, &pp[1]);
+  peek (src, x1, y2, &pp[2]);
+  peek (src, x2, y2, &pp[3]);
 
   if (source_drw_has_alpha)
     *p = gimp_bilinear_rgba (u, v, pp);
@@ -416,12 +407,12 @@ getpixel (GeglBuffer *buffer,
 }
 
 static void
-lic_image (GeglBuffer *buffer,
-           gint        x,
-           gint        y,
-           gdouble     vx,
-           gdouble     vy,
-           GimpRGB    *color)
+lic_image (const guchar *src,
+           gint          x,
+           gint          y,
+           gdouble       vx,
+           gdouble       vy,
+           GimpRGB      *color)
 {
   gdouble u, step = 2.0 * l / isteps;
   gdouble xx = (gdouble) x, yy = (gdouble) y;
@@ -438,7 +429,7 @@ lic_image (GeglBuffer *buffer,
   /* Calculate integral numerically */
   /* ============================== */
 
-  getpixel (buffer, &col1, xx + l * c, yy + l * s);
+  getpixel (src, &col1, xx + l * c, yy + l * s);
 
   if (source_drw_has_alpha)
     gimp_rgba_multiply (&col1, filter (-l));
@@ -447,7 +438,7 @@ lic_image (GeglBuffer *buffer,
 
   for (u = -l + step; u <= l; u += step)
     {
-      getpixel (buffer, &col2, xx - u * c, yy - u * s);
+      getpixel (src, &col2, xx - u * c, yy - u * s);
 
       if (source_drw_has_alpha)
         {
@@ -540,19 +531,39 @@ rgb_to_hsl (GimpDrawable     *drawable,
 }
 
 
-static void
+static gboolean
 compute_lic (GimpDrawable *drawable,
              const guchar *scalarfield,
              gboolean      rotate)
 {
-  GeglBuffer *src_buffer;
-  GeglBuffer *dest_buffer;
-  gint        xcount, ycount;
-  GimpRGB     color;
-  gdouble     vx, vy, tmp;
+  const Babl    *format = gimp_drawable_get_format (drawable);
+  GeglRectangle  rect   = { 0, 0, border_w, border_h };
+  const Babl    *dest_fish;
+  guchar        *src;
+  guchar        *dest;
+  GimpRGB       *row;
+  gint           xcount, ycount;
+  gdouble        vx, vy, tmp;
+
+  src_fish  = babl_fish (format, babl_format ("R'G'B'A double"));
+  dest_fish = babl_fish (babl_format ("R'G'B'A double"), format);
+  src_bpp   = babl_format_get_bytes_per_pixel (format);
+
+  /* the pixels are read and written all at once, instead of one at a
+   * time, which would cost a round trip to the core for every tile
+   */
+  src  = g_new (guchar, (gsize) border_w * border_h * src_bpp);
+  dest = g_new (guchar, (gsize) border_w * border_h * src_bpp);
+  row  = g_new (GimpRGB, border_w);
+
+  if (! gimp_drawable_read_region (drawable, FALSE, &rect, src))
+    {
+      g_free (src);
+      g_free (dest);
+      g_free (row);
 
-  src_buffer  = gimp_drawable_get_buffer (drawable);
-  dest_buffer = gimp_drawable_get_shadow_buffer (drawable);
+      return FALSE;
+    }
 
   for (ycount = 0; ycount < border_h; ycount++)
     {
@@ -585,30 +596,39 @@ compute_lic (GimpDrawable *drawable,
 
           if (licvals.effect_convolve == 0)
             {
-              peek (src_buffer, xcount, ycount, &color);
+              GimpRGB *color = &row[xcount];
+
+              peek (src, xcount, ycount, color);
 
               tmp = lic_noise (xcount, ycount, vx, vy);
 
               if (source_drw_has_alpha)
-                gimp_rgba_multiply (&color, tmp);
+                gimp_rgba_multiply (color, tmp);
               else
-                gimp_rgb_multiply (&color, tmp);
+                gimp_rgb_multiply (color, tmp);
             }
           else
             {
-              lic_image (src_buffer, xcount, ycount, vx, vy, &color);
+              lic_image (src, xcount, ycount, vx, vy, &row[xcount]);
             }
-
-          poke (dest_buffer, xcount, ycount, &color);
         }
 
+      babl_process (dest_fish,
+                    row, dest + (gsize) ycount * border_w * src_bpp,
+                    border_w);
+
       gimp_progress_update ((gfloat) ycount / (gfloat) border_h);
     }
 
-  g_object_unref (src_buffer);
-  g_object_unref (dest_buffer);
+  gimp_drawable_write_region (drawable, TRUE, &rect, dest);
+
+  g_free (src);
+  g_free (dest);
+  g_free (row);
 
   gimp_progress_update (1.0);
+
+  return TRUE;
 }
 
 static void
@@ -658,7 +678,11 @@ compute_image (GimpDrawable *drawable)
       break;
     }
 
-  compute_lic (drawable, scalarfield, licvals.effect_operator);
+  if (! compute_lic (drawable, scalarfield, licvals.effect_operator))
+    {
+      g_free (scalarfield);
+      return;
+    }
 
   g_free (scalarfield);
 